@@ -21,6 +21,12 @@
     #include "tm4c1294/hal_icm_tm4c.h"
 
 
+#elif defined(__BOARD_HOST_SIM__)
+
+    #include "host/hal_common_host.h"
+    #include "host/hal_icm_host.h"
+
+
 #elif __BOARD_ATMEGA328P__
 //TODO: Arduino support
     #include "atmega328p_hal.h"
@@ -0,0 +1,206 @@
+/*
+ * hal_common_host.c
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ */
+#include "hal_common_host.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+//  Nominal clock of the board being simulated (TM4C1294 @ 120MHz)
+uint32_t g_ui32SysClock = 120000000;
+
+//  Simulated time in us since start of the program
+static uint64_t _timeUs = 0;
+
+//  Peripheral simulators are notified each time simulated time advances
+#define HAL_TICK_HOOKS_MAX  4
+static void (*_tickHooks[HAL_TICK_HOOKS_MAX])(uint64_t);
+static uint8_t _tickHookCount = 0;
+
+//  Sleep statistics collected by HAL_BOARD_IdleUntil
+static HAL_BOARD_IdleStats _idleStats;
+
+//  PWM outputs only keep their last value
+#define HAL_PWM_MAX         8
+static uint32_t _pwm[HAL_PWM_MAX];
+
+/**
+ *  Dummy function to be called to suppress "Unused variable" warnings
+ */
+void UNUSED (int32_t arg) { (void)arg; }
+
+/**
+ * Nothing to configure on host, kept for compatibility with board HALs
+ */
+void HAL_BOARD_CLOCK_Init()
+{
+}
+
+/**
+ * Nothing to configure on host, kept for compatibility with board HALs
+ */
+void HAL_DMA_Init()
+{
+}
+
+/**
+ * Software-triggered reboot, terminates simulation
+ */
+void HAL_BOARD_Reset()
+{
+    exit(0);
+}
+
+/**
+ * Simulated board always starts from power-on
+ * @return false
+ */
+bool HAL_BOARD_WarmReset()
+{
+    return false;
+}
+
+/**
+ * Wait for given amount of us - advances simulated time
+ * @param us time in us to wait
+ */
+void HAL_DelayUS(uint32_t us)
+{
+    HAL_BOARD_AdvanceUS(us);
+}
+
+/**
+ * Calculate load value from timer based on desired time in milliseconds
+ * @param ms time in milliseconds
+ * @return equivalent number of clock cycles for main oscillator
+ */
+uint32_t _TM4CMsToCycles(uint32_t ms)
+{
+    return (g_ui32SysClock / 1000) * ms;
+}
+
+void HAL_SetPWM(uint32_t id, uint32_t pwm)
+{
+    if (id < HAL_PWM_MAX)
+        _pwm[id] = pwm;
+}
+
+uint32_t HAL_GetPWM(uint32_t id)
+{
+    return (id < HAL_PWM_MAX) ? _pwm[id] : 0;
+}
+
+/**
+ * Nothing to configure on host, simulated time runs from start of the program
+ */
+void HAL_BOARD_TimeInit()
+{
+}
+
+/**
+ * Get current simulated time
+ * @return Time in us since start of the program
+ */
+uint64_t HAL_BOARD_TimeUS()
+{
+    return _timeUs;
+}
+
+/**
+ * Get current simulated time in cycles of nominal system clock. Simulated time
+ * only has 1us resolution, so it's always a multiple of cycles per us
+ * @return Time in cycles since start of the program
+ */
+uint64_t HAL_BOARD_TimeCycles()
+{
+    return _timeUs * (g_ui32SysClock / 1000000);
+}
+
+/**
+ * Convert time in cycles (HAL_BOARD_TimeCycles) to us
+ */
+uint64_t HAL_BOARD_CyclesToUS(uint64_t cycles)
+{
+    return cycles / (g_ui32SysClock / 1000000);
+}
+
+/**
+ * Advance simulated time and let simulated peripherals catch up
+ * Time is advanced in 1us steps so that peripherals see every instant at
+ * which something could happen (e.g. new sample becoming available)
+ * @param us Amount of time to advance
+ */
+void HAL_BOARD_AdvanceUS(uint32_t us)
+{
+    while (us--)
+    {
+        _timeUs++;
+        for (uint8_t i = 0; i < _tickHookCount; i++)
+            _tickHooks[i](_timeUs);
+    }
+}
+
+/**
+ * Simulated sleep: advance simulated time until wakeUs or until an interrupt
+ * of a simulated peripheral hands over work to main loop (pending() returns
+ * true), whichever comes first. Waking up on time costs nothing, so wake-up
+ * latency is always 0
+ * @param wakeUs Time (HAL_BOARD_TimeUS) at which to wake up at the latest,
+ *        UINT64_MAX to only wake on interrupt
+ * @param pending (optional) Returns true if there's work that was handed over
+ *        from an interrupt and the core shouldn't sleep
+ * @return true if core was asleep, false if it wasn't put to sleep at all
+ */
+bool HAL_BOARD_IdleUntil(uint64_t wakeUs, bool((*pending)(void)))
+{
+    uint64_t start = _timeUs;
+
+    if ((wakeUs <= _timeUs) || ((pending != 0) && pending()))
+        return false;
+
+    //  Without pending() the only interrupt that could wake the core is the
+    //  one of the wake-up timer
+    while ((_timeUs < wakeUs) && ((pending == 0) || !pending()))
+        HAL_BOARD_AdvanceUS(1);
+
+    _idleStats.sleeps++;
+    _idleStats.idleCycles += (_timeUs - start) * (g_ui32SysClock / 1000000);
+    if (_timeUs >= wakeUs)
+        _idleStats.timerWakes++;
+
+    return true;
+}
+
+/**
+ * Get sleep statistics collected since HAL_BOARD_IdleStatsReset (or start)
+ * @param stats Statistics are copied here
+ */
+void HAL_BOARD_IdleStatsGet(HAL_BOARD_IdleStats *stats)
+{
+    *stats = _idleStats;
+}
+
+/**
+ * Clear sleep statistics
+ */
+void HAL_BOARD_IdleStatsReset()
+{
+    memset(&_idleStats, 0, sizeof(_idleStats));
+}
+
+/**
+ * Register peripheral simulator to be notified on each advance of time
+ * @param tickHook Function called with current simulated time in us
+ */
+void HAL_BOARD_TickRegister(void((*tickHook)(uint64_t nowUs)))
+{
+    for (uint8_t i = 0; i < _tickHookCount; i++)
+        if (_tickHooks[i] == tickHook)
+            return;
+
+    if (_tickHookCount < HAL_TICK_HOOKS_MAX)
+        _tickHooks[_tickHookCount++] = tickHook;
+}
@@ -0,0 +1,65 @@
+/**
+ * hal_common_host.h
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Board-level HAL for running libraries on a host PC (Linux) against
+ *  simulated peripherals. Time is simulated as well: it only advances through
+ *  HAL_DelayUS, HAL_BOARD_AdvanceUS and simulated bus transfers, which makes
+ *  every run deterministic and independent of host load.
+ */
+#include "hwconfig.h"
+
+#ifndef ROVERKERNEL_HAL_HOST_HAL_COMMON_HOST_H_
+#define ROVERKERNEL_HAL_HOST_HAL_COMMON_HOST_H_
+
+#define HAL_OK                  0
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/// Global clock variable (nominal, kept for compatibility with board HALs)
+extern uint32_t g_ui32SysClock;
+
+
+extern void         HAL_DelayUS(uint32_t us);
+extern void         HAL_BOARD_CLOCK_Init();
+extern void         HAL_DMA_Init();
+extern void         HAL_BOARD_Reset();
+extern bool         HAL_BOARD_WarmReset();
+extern void         UNUSED (int32_t arg);
+extern uint32_t     _TM4CMsToCycles(uint32_t ms);
+
+extern void         HAL_SetPWM(uint32_t id, uint32_t pwm);
+extern uint32_t     HAL_GetPWM(uint32_t id);
+
+/**     Simulated time       */
+extern void         HAL_BOARD_TimeInit();
+extern uint64_t     HAL_BOARD_TimeUS();
+extern uint64_t     HAL_BOARD_TimeCycles();
+extern uint64_t     HAL_BOARD_CyclesToUS(uint64_t cycles);
+extern void         HAL_BOARD_AdvanceUS(uint32_t us);
+extern void         HAL_BOARD_TickRegister(void((*tickHook)(uint64_t nowUs)));
+
+/**     Tickless idle (sleep until given time or any interrupt)       */
+typedef struct
+{
+    uint32_t    sleeps;         //  Times core was put to sleep
+    uint32_t    timerWakes;     //  Of those, woken by reaching wake time
+    uint64_t    idleCycles;     //  Time spent asleep
+    uint32_t    latencyMax;     //  Longest delay from wake time to running
+    uint64_t    latencySum;     //  Sum of those delays (cycles, timer wakes)
+} HAL_BOARD_IdleStats;
+
+extern bool         HAL_BOARD_IdleUntil(uint64_t wakeUs, bool((*pending)(void)));
+extern void         HAL_BOARD_IdleStatsGet(HAL_BOARD_IdleStats *stats);
+extern void         HAL_BOARD_IdleStatsReset();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ROVERKERNEL_HAL_HOST_HAL_COMMON_HOST_H_ */
@@ -0,0 +1,926 @@
+/**
+ *  hal_icm_host.c
+ *
+ *  Simulated ICM20948 for running driver stack on a host PC.
+ *  Register & DMP-memory model is only as deep as the driver needs it: plain
+ *  registers keep last written value, few registers with side effects (bank
+ *  select, memory port, FIFO port & count, reset, interrupt status, I2C master)
+ *  are modeled explicitly. DMP program itself is not executed, instead DMP
+ *  packets are synthesized in FIFO for every output enabled in DATA_OUT_CTL1,
+ *  paced by gyro sample-rate divider and per-output ODR divider read back from
+ *  DMP memory, exactly where firmware would take them from.
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ */
+#include "hal_icm_host.h"
+
+#if defined(__HAL_USE_ICM20948__)       //  Compile only if module is enabled
+
+#include "HAL/host/hal_common_host.h"
+
+#include <string.h>
+
+/**     ICM20948 registers & bits modeled by simulator (see Icm20948Defs.h) */
+#define SIM_REG_WHO_AM_I            0x00
+#define SIM_REG_USER_CTRL           0x03
+#define SIM_REG_LP_CONFIG           0x05
+#define SIM_REG_PWR_MGMT_1          0x06
+#define SIM_REG_DMP_INT_STATUS      0x18
+#define SIM_REG_INT_STATUS          0x19
+#define SIM_REG_ACCEL_XOUT_H        0x2D
+#define SIM_REG_GYRO_XOUT_H         0x33
+#define SIM_REG_EXT_SLV_SENS_DATA   0x3B
+#define SIM_REG_FIFO_RST            0x68
+#define SIM_REG_FIFO_COUNT_H        0x70
+#define SIM_REG_FIFO_COUNT_L        0x71
+#define SIM_REG_FIFO_R_W            0x72
+#define SIM_REG_MEM_START_ADDR      0x7C
+#define SIM_REG_MEM_R_W             0x7D
+#define SIM_REG_MEM_BANK_SEL        0x7E
+#define SIM_REG_BANK_SEL            0x7F
+//  Bank 2
+#define SIM_REG_GYRO_SMPLRT_DIV     0x00
+//  Bank 3
+#define SIM_REG_I2C_SLV0_ADDR       0x03
+
+#define SIM_BIT_DMP_EN              0x80
+#define SIM_BIT_FIFO_EN             0x40
+#define SIM_BIT_I2C_MST_EN          0x20
+#define SIM_BIT_H_RESET             0x80
+#define SIM_BIT_SLEEP               0x40
+#define SIM_BIT_DMP_INT             0x02
+#define SIM_BIT_I2C_READ            0x80
+#define SIM_BIT_SLV_EN              0x80
+
+#define SIM_WHO_AM_I                0xEA
+#define SIM_FIFO_SIZE               1024
+//  DMP memory: 256B banks, 14301B image loaded at 0x90 fits in 64 banks
+#define SIM_DMP_MEM_SIZE            (64 * 256)
+//  Internal sample rate of gyro from which DMP rate is divided
+#define SIM_BASE_RATE_HZ            1125
+
+/**     DMP memory keys & FIFO packet layout (see Icm20948Dmp3Driver.c and
+ *      Icm20948DataBaseControl.h)       */
+#define SIM_DATA_OUT_CTL1           (4 * 16)
+#define SIM_DATA_OUT_CTL2           (4 * 16 + 2)
+#define SIM_FIFO_WATERMARK          (31 * 16 + 14)
+#define SIM_BM_BATCH_CNTR           (27 * 16)
+#define SIM_BM_BATCH_THLD           (19 * 16 + 12)
+#define SIM_BATCH_MODE_EN           0x0100
+#define SIM_HEADER2_SET             0x0008
+#define SIM_ACCEL_ACCURACY_SET      0x4000
+#define SIM_GYRO_ACCURACY_SET       0x2000
+#define SIM_CPASS_ACCURACY_SET      0x1000
+
+/**     AK09916 magnetometer behind I2C master       */
+#define SIM_AK_ADDR                 0x0C
+#define SIM_AK_REG_WIA1             0x00
+#define SIM_AK_REG_WIA2             0x01
+#define SIM_AK_REG_ST1              0x10
+#define SIM_AK_REG_HXL              0x11
+#define SIM_AK_REG_CNTL3            0x32
+
+/**
+ * Description of every output DMP can push into FIFO, in the order in which
+ * they appear in the packet
+ */
+static const struct
+{
+    uint16_t    bit;        //  Bit in packet header (and DATA_OUT_CTL1)
+    uint16_t    odrKey;     //  Address of ODR divider in DMP memory
+    uint8_t     size;       //  Bytes of payload in FIFO packet
+} _simOutputs[] =
+{
+    { 0x8000, 11 * 16 + 14, 6 },    //  ACCEL
+    { 0x4000, 11 * 16 + 10, 12 },   //  GYRO + GYRO_BIAS
+    { 0x2000, 11 * 16 +  6, 6 },    //  CPASS
+    { 0x1000, 11 * 16 +  2, 8 },    //  ALS
+    { 0x0800, 10 * 16 + 12, 12 },   //  QUAT6
+    { 0x0400, 10 * 16 +  8, 14 },   //  QUAT9
+    { 0x0200, 10 * 16 +  4, 6 },    //  PQUAT6
+    { 0x0100, 10 * 16 +  0, 14 },   //  GEOMAG
+    { 0x0020, 11 * 16 +  4, 12 },   //  CPASS_CALIBR
+};
+#define SIM_OUTPUTS     (sizeof(_simOutputs) / sizeof(_simOutputs[0]))
+#define SIM_PAYLOAD_MAX 14
+
+/**
+ * Complete state of simulated chip, zeroed on power-off
+ */
+static struct
+{
+    bool        powered;
+    uint8_t     regs[4][128];
+    uint8_t     bank;
+    uint8_t     dmpMem[SIM_DMP_MEM_SIZE];
+    uint8_t     fifo[SIM_FIFO_SIZE];
+    uint16_t    fifoRd;
+    uint16_t    fifoCount;
+    uint8_t     akRegs[0x40];
+    uint64_t    nextTickUs;     //  Time of next DMP sample, 0 if DMP stopped
+    uint32_t    tickPeriodNs;
+    uint32_t    tickFracNs;     //  Accumulated remainder of tick period
+    uint16_t    odrCnt[SIM_OUTPUTS];
+    uint16_t    sampleCnt;      //  Value put in packet footer
+} _sim;
+
+/**
+ * Scripted sensor data, survives power cycling
+ */
+static struct
+{
+    uint8_t     payload[SIM_OUTPUTS][SIM_PAYLOAD_MAX];
+    uint16_t    accuracy[3];    //  accel, gyro, compass
+    int16_t     mag[3];
+    void        (*genHook)(uint16_t, uint64_t, uint8_t *, uint16_t);
+    bool        dmpMuted;       //  Don't synthesize DMP packets
+} _simData;
+
+/**
+ * Serial interface that replaces simulated chip when attached
+ */
+static struct
+{
+    int         (*read)(void *, uint8_t, uint8_t *, uint32_t);
+    int         (*write)(void *, uint8_t, const uint8_t *, uint32_t);
+    void        *context;
+} _simSerif;
+
+static struct
+{
+    HAL_MPU_SimBusRecord    log[HAL_MPU_SIM_BUS_LOG_SIZE];
+    uint32_t                count;
+    HAL_MPU_SimBusTotals    totals;
+    uint32_t                fracNs; //  Bus time not yet advanced, below 1us
+} _simBus;
+
+//  Hook called on each new DMP packet, as if data-ready pin was raised
+static void (*_dataReadyHook)(void) = 0;
+static bool _dataReadyEn = false;
+//  Data-ready pin level, raised on packet and cleared on INT_STATUS read
+static bool _dataReadyPin = false;
+
+//  Currently configured bus clock in Hz
+static uint32_t _busClock = HAL_MPU_BUS_SPEED_SAFE;
+
+static void _HAL_MPU_SimTick(uint64_t nowUs);
+
+
+/*******************************************************************************
+ ********              Model of the chip (registers & DMP)               ********
+ ******************************************************************************/
+
+static uint16_t _SimDmpKey16(uint16_t key)
+{
+    return ((uint16_t)_sim.dmpMem[key] << 8) | _sim.dmpMem[key + 1];
+}
+
+static uint32_t _SimDmpKey32(uint16_t key)
+{
+    return ((uint32_t)_SimDmpKey16(key) << 16) | _SimDmpKey16(key + 2);
+}
+
+/**
+ * Bring register file to its power-on state, DMP memory is kept
+ */
+static void _SimResetRegs()
+{
+    memset(_sim.regs, 0, sizeof(_sim.regs));
+    _sim.bank = 0;
+    _sim.regs[0][SIM_REG_WHO_AM_I] = SIM_WHO_AM_I;
+    _sim.regs[0][SIM_REG_PWR_MGMT_1] = 0x41;
+    _sim.regs[0][SIM_REG_LP_CONFIG] = 0x40;
+
+    _sim.fifoRd = 0;
+    _sim.fifoCount = 0;
+    _sim.nextTickUs = 0;
+    _dataReadyPin = false;
+
+    memset(_sim.akRegs, 0, sizeof(_sim.akRegs));
+    _sim.akRegs[SIM_AK_REG_WIA1] = 0x48;
+    _sim.akRegs[SIM_AK_REG_WIA2] = 0x09;
+}
+
+static void _SimFifoPush(const uint8_t *data, uint16_t length)
+{
+    for (uint16_t i = 0; i < length; i++)
+        _sim.fifo[(_sim.fifoRd + _sim.fifoCount + i) % SIM_FIFO_SIZE] = data[i];
+    _sim.fifoCount += length;
+}
+
+/**
+ * Raise DMP interrupt and data-ready pin
+ */
+static void _SimRaiseDmpInt()
+{
+    _sim.regs[0][SIM_REG_INT_STATUS] |= SIM_BIT_DMP_INT;
+    _dataReadyPin = true;
+    _simBus.totals.dataReadyInts++;
+    if (_dataReadyEn && (_dataReadyHook != 0))
+        _dataReadyHook();
+}
+
+/**
+ * Decide whether DMP sample ends with an interrupt. Normally every packet is
+ * signaled, in batch mode (BATCH_MODE_EN in DATA_OUT_CTL2) DMP counts samples
+ * in BM_BATCH_CNTR and interrupts only once the count reaches BM_BATCH_THLD or
+ * FIFO fills up to FIFO_WATERMARK
+ * @param newPacket true if sample pushed a packet into FIFO
+ */
+static void _SimDmpInterrupt(bool newPacket)
+{
+    uint32_t count, threshold;
+
+    if (!(_SimDmpKey16(SIM_DATA_OUT_CTL2) & SIM_BATCH_MODE_EN))
+    {
+        if (newPacket)
+            _SimRaiseDmpInt();
+        return;
+    }
+
+    count = _SimDmpKey32(SIM_BM_BATCH_CNTR) + 1;
+    threshold = _SimDmpKey32(SIM_BM_BATCH_THLD);
+
+    if (((count >= threshold) ||
+         (_sim.fifoCount >= _SimDmpKey16(SIM_FIFO_WATERMARK))) &&
+        (_sim.fifoCount > 0))
+    {
+        count = 0;
+        _SimRaiseDmpInt();
+    }
+
+    for (uint8_t i = 0; i < 4; i++)
+        _sim.dmpMem[SIM_BM_BATCH_CNTR + i] = (uint8_t)(count >> (24 - 8 * i));
+}
+
+/**
+ * Start or stop DMP sample clock depending on USER_CTRL & PWR_MGMT_1. Sample
+ * period follows gyro sample-rate divider, change of the divider takes effect
+ * from the next sample on
+ */
+static void _SimUpdateDmpClock()
+{
+    bool run = (_sim.regs[0][SIM_REG_USER_CTRL] & SIM_BIT_DMP_EN) &&
+               !(_sim.regs[0][SIM_REG_PWR_MGMT_1] & SIM_BIT_SLEEP);
+    uint32_t div = (uint32_t)_sim.regs[2][SIM_REG_GYRO_SMPLRT_DIV] + 1;
+
+    _sim.tickPeriodNs = (uint32_t)((1000000000ULL * div) / SIM_BASE_RATE_HZ);
+
+    if (!run)
+        _sim.nextTickUs = 0;
+    else if (_sim.nextTickUs == 0)
+    {
+        _sim.tickFracNs = 0;
+        _sim.nextTickUs = HAL_BOARD_TimeUS() + _sim.tickPeriodNs / 1000;
+        memset(_sim.odrCnt, 0, sizeof(_sim.odrCnt));
+    }
+}
+
+/**
+ * Perform one DMP sample: build a packet out of every output due at this
+ * sample and push it into FIFO, then raise DMP interrupt if due
+ */
+static void _SimDmpSample(uint64_t nowUs)
+{
+    uint8_t packet[128];
+    uint16_t len = 2, header = 0, header2 = 0;
+    uint16_t outCtl = _SimDmpKey16(SIM_DATA_OUT_CTL1);
+    uint16_t outCtl2 = _SimDmpKey16(SIM_DATA_OUT_CTL2);
+
+    if (_simData.dmpMuted || !(_sim.regs[0][SIM_REG_USER_CTRL] & SIM_BIT_FIFO_EN))
+        return;
+
+    for (uint8_t i = 0; i < SIM_OUTPUTS; i++)
+    {
+        if (!(outCtl & _simOutputs[i].bit))
+            continue;
+        if (_sim.odrCnt[i]++ < _SimDmpKey16(_simOutputs[i].odrKey))
+            continue;
+        _sim.odrCnt[i] = 0;
+        header |= _simOutputs[i].bit;
+    }
+    if (header == 0)
+    {
+        _SimDmpInterrupt(false);
+        return;
+    }
+
+    //  Accuracy is reported along every packet carrying the sensor it belongs to
+    if ((header & 0x8000) && (outCtl2 & SIM_ACCEL_ACCURACY_SET))
+        header2 |= SIM_ACCEL_ACCURACY_SET;
+    if ((header & 0x4000) && (outCtl2 & SIM_GYRO_ACCURACY_SET))
+        header2 |= SIM_GYRO_ACCURACY_SET;
+    if ((header & 0x2000) && (outCtl2 & SIM_CPASS_ACCURACY_SET))
+        header2 |= SIM_CPASS_ACCURACY_SET;
+    if (header2 != 0)
+    {
+        header |= SIM_HEADER2_SET;
+        packet[len++] = header2 >> 8;
+        packet[len++] = header2 & 0xFF;
+    }
+    packet[0] = header >> 8;
+    packet[1] = header & 0xFF;
+
+    for (uint8_t i = 0; i < SIM_OUTPUTS; i++)
+    {
+        if (!(header & _simOutputs[i].bit))
+            continue;
+        memcpy(&packet[len], _simData.payload[i], _simOutputs[i].size);
+        if (_simData.genHook != 0)
+            _simData.genHook(_simOutputs[i].bit, nowUs, &packet[len],
+                             _simOutputs[i].size);
+        len += _simOutputs[i].size;
+    }
+
+    for (uint8_t i = 0; i < 3; i++)
+        if (header2 & (SIM_ACCEL_ACCURACY_SET >> i))
+        {
+            packet[len++] = _simData.accuracy[i] >> 8;
+            packet[len++] = _simData.accuracy[i] & 0xFF;
+        }
+
+    _sim.sampleCnt++;
+    packet[len++] = _sim.sampleCnt >> 8;
+    packet[len++] = _sim.sampleCnt & 0xFF;
+
+    //  Mirror raw accel & gyro into their data registers as well
+    if (header & 0x8000)
+        memcpy(&_sim.regs[0][SIM_REG_ACCEL_XOUT_H], _simData.payload[0], 6);
+    if (header & 0x4000)
+        memcpy(&_sim.regs[0][SIM_REG_GYRO_XOUT_H], _simData.payload[1], 6);
+
+    if (_sim.fifoCount + len > SIM_FIFO_SIZE)
+    {
+        _simBus.totals.fifoOverflows++;
+        _SimDmpInterrupt(false);
+        return;
+    }
+
+    _SimFifoPush(packet, len);
+    _simBus.totals.fifoPackets++;
+    _SimDmpInterrupt(true);
+}
+
+/**
+ * Run every transaction configured on I2C master slaves 0-3, only AK09916 is
+ * present on the auxiliary bus
+ */
+static void _SimI2CMasterRun()
+{
+    uint8_t sensIdx = 0;
+
+    for (uint8_t n = 0; n < 4; n++)
+    {
+        uint8_t *slv = &_sim.regs[3][SIM_REG_I2C_SLV0_ADDR + 4 * n];
+        uint8_t addr = slv[0] & 0x7F, reg = slv[1], ctrl = slv[2];
+
+        if (!(ctrl & SIM_BIT_SLV_EN) || (addr != SIM_AK_ADDR))
+            continue;
+
+        if (slv[0] & SIM_BIT_I2C_READ)
+        {
+            for (uint8_t i = 0; (i < (ctrl & 0x0F)) && (sensIdx < 24); i++)
+                _sim.regs[0][SIM_REG_EXT_SLV_SENS_DATA + sensIdx++] =
+                        _sim.akRegs[(reg + i) & 0x3F];
+        }
+        else if ((reg == SIM_AK_REG_CNTL3) && (slv[3] & 0x01))
+        {
+            //  Soft-reset
+            memset(_sim.akRegs + 0x02, 0, sizeof(_sim.akRegs) - 2);
+        }
+        else
+            _sim.akRegs[reg & 0x3F] = slv[3];
+    }
+}
+
+/**
+ * Side effects of writing a byte into register of currently selected bank
+ */
+static void _SimWriteReg(uint8_t reg, uint8_t value)
+{
+    if (reg == SIM_REG_BANK_SEL)
+    {
+        _sim.bank = (value >> 4) & 0x03;
+        return;
+    }
+    if (_sim.bank != 0)
+    {
+        _sim.regs[_sim.bank][reg] = value;
+        if ((_sim.bank == 2) && (reg == SIM_REG_GYRO_SMPLRT_DIV))
+            _SimUpdateDmpClock();
+        return;
+    }
+
+    switch (reg)
+    {
+    case SIM_REG_MEM_R_W:
+    {
+        uint16_t addr = ((uint16_t)_sim.regs[0][SIM_REG_MEM_BANK_SEL] << 8) |
+                        _sim.regs[0][SIM_REG_MEM_START_ADDR];
+        if (addr < SIM_DMP_MEM_SIZE)
+            _sim.dmpMem[addr] = value;
+        //  Address auto-increments within the bank only
+        _sim.regs[0][SIM_REG_MEM_START_ADDR]++;
+        return;
+    }
+    case SIM_REG_PWR_MGMT_1:
+        if (value & SIM_BIT_H_RESET)
+        {
+            _SimResetRegs();
+            return;
+        }
+        break;
+    case SIM_REG_FIFO_RST:
+        if ((value & 0x1F) != 0)
+        {
+            _sim.fifoRd = 0;
+            _sim.fifoCount = 0;
+        }
+        break;
+    case SIM_REG_FIFO_R_W:
+        _SimFifoPush(&value, 1);
+        return;
+    case SIM_REG_WHO_AM_I:
+    case SIM_REG_FIFO_COUNT_H:
+    case SIM_REG_FIFO_COUNT_L:
+        return;     //  Read-only
+    default:
+        break;
+    }
+
+    if ((reg == SIM_REG_USER_CTRL) && (value & SIM_BIT_I2C_MST_EN) &&
+        !(_sim.regs[0][reg] & SIM_BIT_I2C_MST_EN))
+    {
+        _sim.regs[0][reg] = value;
+        _SimI2CMasterRun();
+    }
+
+    _sim.regs[0][reg] = value;
+
+    if ((reg == SIM_REG_USER_CTRL) || (reg == SIM_REG_PWR_MGMT_1))
+        _SimUpdateDmpClock();
+}
+
+/**
+ * Side effects of reading a byte from register of currently selected bank
+ */
+static uint8_t _SimReadReg(uint8_t reg)
+{
+    uint8_t value;
+
+    if (reg == SIM_REG_BANK_SEL)
+        return _sim.bank << 4;
+    if (_sim.bank != 0)
+        return _sim.regs[_sim.bank][reg];
+
+    switch (reg)
+    {
+    case SIM_REG_MEM_R_W:
+    {
+        uint16_t addr = ((uint16_t)_sim.regs[0][SIM_REG_MEM_BANK_SEL] << 8) |
+                        _sim.regs[0][SIM_REG_MEM_START_ADDR];
+        _sim.regs[0][SIM_REG_MEM_START_ADDR]++;
+        return (addr < SIM_DMP_MEM_SIZE) ? _sim.dmpMem[addr] : 0;
+    }
+    case SIM_REG_FIFO_COUNT_H:
+        return _sim.fifoCount >> 8;
+    case SIM_REG_FIFO_COUNT_L:
+        return _sim.fifoCount & 0xFF;
+    case SIM_REG_FIFO_R_W:
+        if (_sim.fifoCount == 0)
+            return 0xFF;
+        value = _sim.fifo[_sim.fifoRd];
+        _sim.fifoRd = (_sim.fifoRd + 1) % SIM_FIFO_SIZE;
+        _sim.fifoCount--;
+        return value;
+    case SIM_REG_INT_STATUS:
+    case SIM_REG_DMP_INT_STATUS:
+        //  Clear on read, also releases data-ready pin
+        value = _sim.regs[0][reg];
+        _sim.regs[0][reg] = 0;
+        _dataReadyPin = false;
+        return value;
+    default:
+        return _sim.regs[0][reg];
+    }
+}
+
+/**
+ * Account for bus transaction: log it and let simulated time pass for as long
+ * as it takes to clock address byte and payload at current bus speed
+ */
+static void _SimBusTransaction(bool write, uint8_t reg, uint32_t length)
+{
+    uint64_t ns;
+
+    if (_simBus.count < HAL_MPU_SIM_BUS_LOG_SIZE)
+    {
+        HAL_MPU_SimBusRecord *rec = &_simBus.log[_simBus.count++];
+        rec->timeUs = HAL_BOARD_TimeUS();
+        rec->write = write;
+        rec->bank = _sim.bank;
+        rec->reg = reg;
+        rec->length = length;
+    }
+
+    if (write)
+    {
+        _simBus.totals.writes++;
+        _simBus.totals.bytesWritten += length;
+    }
+    else
+    {
+        _simBus.totals.reads++;
+        _simBus.totals.bytesRead += length;
+    }
+
+    ns = ((uint64_t)(length + 1) * 8 * 1000000000ULL) / _busClock
+         + _simBus.fracNs;
+    _simBus.fracNs = ns % 1000;
+    _simBus.totals.busTimeUs += ns / 1000;
+    HAL_BOARD_AdvanceUS((uint32_t)(ns / 1000));
+}
+
+/**
+ * Notified by board HAL on every advance of simulated time, generates DMP
+ * samples that became due
+ */
+static void _HAL_MPU_SimTick(uint64_t nowUs)
+{
+    while (_sim.powered && (_sim.nextTickUs != 0) && (_sim.nextTickUs <= nowUs))
+    {
+        uint64_t tickUs = _sim.nextTickUs;
+
+        _sim.tickFracNs += _sim.tickPeriodNs % 1000;
+        _sim.nextTickUs += _sim.tickPeriodNs / 1000 + _sim.tickFracNs / 1000;
+        _sim.tickFracNs %= 1000;
+
+        _SimDmpSample(tickUs);
+    }
+}
+
+
+/*******************************************************************************
+ ********                   HAL API (same as board HALs)                 ********
+ ******************************************************************************/
+
+/**
+ * Initializes simulated bus and hooks simulator into simulated time
+ */
+void HAL_MPU_Init()
+{
+    _busClock = HAL_MPU_BUS_SPEED_SAFE;
+    _simBus.fracNs = 0;
+    HAL_BOARD_TickRegister(_HAL_MPU_SimTick);
+
+    //  Simulated chip is powered until told otherwise, like on the board
+    if (!_sim.powered)
+        HAL_MPU_PowerSwitch(true);
+}
+
+/**
+ * Change clock of simulated bus, affects only duration of transfers
+ * @param speed New bus clock in Hz
+ */
+void HAL_MPU_SetBusSpeed(uint32_t speed)
+{
+    if (speed != 0)
+        _busClock = speed;
+}
+
+/**
+ * Get clock of simulated bus
+ * @return Bus clock in Hz as last requested
+ */
+uint32_t HAL_MPU_GetBusSpeed()
+{
+    return _busClock;
+}
+
+/**
+ * Power simulated chip on/off. Power-off loses whole state of the chip
+ * including DMP memory, power-on brings registers to their reset values
+ * @param powerState Desired state of power switch
+ */
+void HAL_MPU_PowerSwitch(bool powerState)
+{
+    if (powerState == _sim.powered)
+        return;
+
+    if (!powerState)
+        memset(&_sim, 0, sizeof(_sim));
+    else
+    {
+        _SimResetRegs();
+        _sim.powered = true;
+        HAL_MPU_SimSetMagnetometer(_simData.mag[0], _simData.mag[1],
+                                   _simData.mag[2]);
+    }
+}
+
+/**
+ * Check if simulated chip has raised its data-ready pin
+ * @return true if pin is high, false otherwise
+ */
+bool HAL_MPU_DataAvail()
+{
+    return _dataReadyPin;
+}
+
+/**
+ * Register function to be called each time simulated chip puts a new packet
+ * in FIFO, and enable the "interrupt"
+ * @param custHook Function to call, executed from within HAL_BOARD_AdvanceUS
+ */
+void HAL_MPU_IntRegister(void((*custHook)(void)))
+{
+    _dataReadyHook = custHook;
+    HAL_MPU_IntEnable(true);
+}
+
+/**
+ * Enable or disable data-ready "interrupt"
+ * @param enable Desired state of the interrupt
+ */
+void HAL_MPU_IntEnable(bool enable)
+{
+    _dataReadyEn = enable;
+}
+
+/**
+ * Write one byte into register of simulated chip
+ * @param I2Caddress (NOT USED) Here for compatibility with I2C HAL
+ * @param regAddress Address of register to write into
+ * @param data Data to write into the register
+ */
+void HAL_MPU_WriteByte(uint8_t I2Caddress, uint8_t regAddress, uint8_t data)
+{
+    (void)I2Caddress;
+    HAL_MPU_WriteBytes(0, regAddress, &data, 1);
+}
+
+/**
+ * Write a byte-array into simulated chip. Register address auto-increments
+ * except for memory & FIFO ports
+ * @param context (NOT USED) Here for compatibility with serif interface
+ * @param regAddress Address of a first register to start writing into
+ * @param data Buffer of data to send
+ * @param length Length of data to send
+ * @return 0 on success, -1 if chip is not powered
+ */
+int HAL_MPU_WriteBytes(void * context, uint8_t regAddress,
+                       const uint8_t *data, uint32_t length)
+{
+    (void)context;
+    if (_simSerif.write != 0)
+        return _simSerif.write(_simSerif.context, regAddress, data, length);
+
+    regAddress &= 0x7F;
+    if (!_sim.powered)
+        return -1;
+
+    //  Log before executing so that record shows bank the write was aimed at
+    _SimBusTransaction(true, regAddress, length);
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+        _SimWriteReg(regAddress, data[i]);
+        if ((_sim.bank != 0) || ((regAddress != SIM_REG_MEM_R_W) &&
+                                 (regAddress != SIM_REG_FIFO_R_W)))
+            regAddress = (regAddress + 1) & 0x7F;
+    }
+
+    return 0;
+}
+
+/**
+ * Read one byte from register of simulated chip
+ * @param I2Caddress (NOT USED) Here for compatibility with I2C HAL
+ * @param regAddress Address of register to read from
+ * @return Content of the register
+ */
+uint8_t HAL_MPU_ReadByte(uint8_t I2Caddress, uint8_t regAddress)
+{
+    uint8_t data = 0;
+
+    (void)I2Caddress;
+    HAL_MPU_ReadBytes(0, regAddress, &data, 1);
+
+    return data;
+}
+
+/**
+ * Read several bytes from simulated chip. Register address auto-increments
+ * except for memory & FIFO ports
+ * @param context (NOT USED) Here for compatibility with serif interface
+ * @param regAddress Address of register to read from
+ * @param data Pointer to data buffer in which data is saved after reading
+ * @param length Number of bytes to read
+ * @return 0 on success, -1 if chip is not powered
+ */
+int HAL_MPU_ReadBytes(void * context, uint8_t regAddress,
+                      uint8_t* data, uint32_t length)
+{
+    uint8_t startReg = regAddress & 0x7F;
+
+    (void)context;
+    if (_simSerif.read != 0)
+        return _simSerif.read(_simSerif.context, regAddress, data, length);
+
+    regAddress = startReg;
+    if (!_sim.powered)
+        return -1;
+
+    for (uint32_t i = 0; i < length; i++)
+    {
+        data[i] = _SimReadReg(regAddress);
+        if ((_sim.bank != 0) || ((regAddress != SIM_REG_MEM_R_W) &&
+                                 (regAddress != SIM_REG_FIFO_R_W)))
+            regAddress = (regAddress + 1) & 0x7F;
+    }
+
+    _SimBusTransaction(false, startReg, length);
+
+    return 0;
+}
+
+/**
+ * Transfers on host complete immediately, done-hook is called before return
+ */
+int HAL_MPU_WriteBytesAsync(uint8_t regAddress, const uint8_t *data,
+                            uint32_t length, void((*doneHook)(void)))
+{
+    int retVal = HAL_MPU_WriteBytes(0, regAddress, data, length);
+
+    if ((retVal == 0) && (doneHook != 0))
+        doneHook();
+
+    return retVal;
+}
+
+/**
+ * Transfers on host complete immediately, done-hook is called before return
+ */
+int HAL_MPU_ReadBytesAsync(uint8_t regAddress, uint8_t* data, uint32_t length,
+                           void((*doneHook)(void)))
+{
+    int retVal = HAL_MPU_ReadBytes(0, regAddress, data, length);
+
+    if ((retVal == 0) && (doneHook != 0))
+        doneHook();
+
+    return retVal;
+}
+
+/**
+ * Check whether asynchronous transfer is still running
+ * @return Always false, transfers on host complete immediately
+ */
+bool HAL_MPU_TransferBusy()
+{
+    return false;
+}
+
+
+/*******************************************************************************
+ ********                      Simulator control API                     ********
+ ******************************************************************************/
+
+/**
+ * Set payload DMP puts in FIFO for given output, as it would appear in FIFO
+ * (big-endian, in DMP units). Defaults to all zeros
+ * @param outputBit Header bit of the output (e.g. 0x8000 for accelerometer)
+ * @param data Payload
+ * @param length Length of payload, truncated to size of the output in FIFO
+ */
+void HAL_MPU_SimSetOutput(uint16_t outputBit, const uint8_t *data,
+                          uint16_t length)
+{
+    for (uint8_t i = 0; i < SIM_OUTPUTS; i++)
+        if (_simOutputs[i].bit == outputBit)
+        {
+            if (length > _simOutputs[i].size)
+                length = _simOutputs[i].size;
+            memcpy(_simData.payload[i], data, length);
+        }
+}
+
+/**
+ * Register function generating payload of every output on each DMP sample,
+ * called after payload set by HAL_MPU_SimSetOutput has been copied in
+ * @param genHook Function to call, 0 to disable
+ */
+void HAL_MPU_SimSetGenerator(void((*genHook)(uint16_t outputBit,
+                             uint64_t timeUs, uint8_t *data, uint16_t length)))
+{
+    _simData.genHook = genHook;
+}
+
+/**
+ * Stop or resume synthesizing DMP packets, while muted FIFO is only filled
+ * through HAL_MPU_SimPushFifo
+ * @param mute true to stop synthesizing packets
+ */
+void HAL_MPU_SimMuteDmp(bool mute)
+{
+    _simData.dmpMuted = mute;
+}
+
+/**
+ * Route all bus transfers to given serial interface instead of simulated chip
+ * (e.g. to serve FIFO content straight from memory when benchmarking). Such
+ * transfers take no simulated time and aren't logged
+ * @param read Function serving reads, 0 to detach
+ * @param write Function serving writes, 0 to detach
+ * @param context Passed back as first argument of read & write
+ */
+void HAL_MPU_SimAttachSerif(int((*read)(void *context, uint8_t reg,
+                                        uint8_t *data, uint32_t length)),
+                            int((*write)(void *context, uint8_t reg,
+                                         const uint8_t *data, uint32_t length)),
+                            void *context)
+{
+    _simSerif.read = read;
+    _simSerif.write = write;
+    _simSerif.context = context;
+}
+
+/**
+ * Set accuracy reported by DMP for its sensors (0-3)
+ */
+void HAL_MPU_SimSetAccuracy(uint8_t accel, uint8_t gyro, uint8_t compass)
+{
+    _simData.accuracy[0] = accel;
+    _simData.accuracy[1] = gyro;
+    _simData.accuracy[2] = compass;
+}
+
+/**
+ * Push raw data into FIFO of simulated chip and raise DMP interrupt, used to
+ * replay FIFO content captured on real hardware
+ * @param data Data to push
+ * @param length Length of data
+ * @return 0 on success, -1 if FIFO doesn't have enough room (nothing pushed)
+ */
+int HAL_MPU_SimPushFifo(const uint8_t *data, uint16_t length)
+{
+    if (!_sim.powered || (_sim.fifoCount + length > SIM_FIFO_SIZE))
+        return -1;
+
+    _SimFifoPush(data, length);
+    _SimRaiseDmpInt();
+
+    return 0;
+}
+
+/**
+ * Set raw magnetic field measured by AK09916, in its LSBs
+ */
+void HAL_MPU_SimSetMagnetometer(int16_t x, int16_t y, int16_t z)
+{
+    int16_t mag[3] = { x, y, z };
+
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        _simData.mag[i] = mag[i];
+        //  Little-endian in magnetometer registers, big-endian in DMP packet
+        _sim.akRegs[SIM_AK_REG_HXL + 2 * i] = (uint16_t)mag[i] & 0xFF;
+        _sim.akRegs[SIM_AK_REG_HXL + 2 * i + 1] = (uint16_t)mag[i] >> 8;
+        _simData.payload[2][2 * i] = (uint16_t)mag[i] >> 8;
+        _simData.payload[2][2 * i + 1] = (uint16_t)mag[i] & 0xFF;
+    }
+    _sim.akRegs[SIM_AK_REG_ST1] = 0x01;
+}
+
+/**
+ * Get log of bus transactions, holding first HAL_MPU_SIM_BUS_LOG_SIZE
+ * transactions since last HAL_MPU_SimBusLogReset
+ * @param log Pointer set to array of records
+ * @param count Number of valid records in the array
+ */
+void HAL_MPU_SimBusLog(const HAL_MPU_SimBusRecord **log, uint32_t *count)
+{
+    *log = _simBus.log;
+    *count = _simBus.count;
+}
+
+/**
+ * Get totals of bus traffic since last HAL_MPU_SimBusLogReset, these keep
+ * counting after the log itself is full
+ */
+void HAL_MPU_SimBusTotalsGet(HAL_MPU_SimBusTotals *totals)
+{
+    *totals = _simBus.totals;
+}
+
+/**
+ * Clear bus log & totals
+ */
+void HAL_MPU_SimBusLogReset()
+{
+    _simBus.count = 0;
+    memset(&_simBus.totals, 0, sizeof(_simBus.totals));
+}
+
+#endif  /* __HAL_USE_ICM20948__ */
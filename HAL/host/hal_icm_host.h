@@ -0,0 +1,121 @@
+/**
+ * hal_icm_host.h
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Hardware abstraction layer (HAL) for ICM20948 on a host PC. Implements the
+ *  same API as TM4C1294 HAL, but on top of a simulated ICM20948 so that the
+ *  whole driver stack can run (and be benchmarked) without a board:
+ *    * Register file with 4 user banks, bank selected through REG_BANK_SEL
+ *    * DMP memory accessed through MEM_BANK_SEL, MEM_START_ADDR and MEM_R_W
+ *    * FIFO filled with DMP packets for every output enabled in DMP memory
+ *      (DATA_OUT_CTL1) at rate given by gyro sample-rate divider and output
+ *      ODR divider, with payload that can be scripted
+ *    * DMP batch mode, interrupting at batch threshold or FIFO watermark
+ *    * AK09916 magnetometer behind ICM20948 I2C master
+ *    * Log of every bus transaction
+ *  Bus transfers take as long (in simulated time) as they would at configured
+ *  bus speed. Data-ready hook is called from within HAL_BOARD_AdvanceUS as if
+ *  it was an interrupt.
+ *
+ *  Application still has to provide inv_icm20948_sleep/sleep_us/get_time_us,
+ *  on host these should be built on HAL_DelayUS and HAL_BOARD_TimeUS. As
+ *  simulated time doesn't pass on its own, get_time_us should also advance it
+ *  by 1us (HAL_BOARD_AdvanceUS) so that loops polling for data terminate.
+ */
+#include "hwconfig.h"
+
+//  Compile following section only if hwconfig.h says to include this module
+#if !defined(_HAL_HOST_HAL_ICM_HOST_H_) && defined(__HAL_USE_ICM20948__)
+#define _HAL_HOST_HAL_ICM_HOST_H_
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**     Serial bus clock presets in Hz, same meaning as for board HALs       */
+#define HAL_MPU_BUS_SPEED_SAFE      1000000
+#define HAL_MPU_BUS_SPEED_FAST      7000000
+
+/**     Single bus transaction as seen by simulated ICM20948       */
+typedef struct
+{
+    uint64_t    timeUs;     //  Time at which transaction started
+    uint8_t     write;      //  1 for write, 0 for read
+    uint8_t     bank;       //  User bank selected at the time of transaction
+    uint8_t     reg;        //  First register accessed
+    uint32_t    length;     //  Number of data bytes (address byte excluded)
+} HAL_MPU_SimBusRecord;
+
+/**     Totals of bus traffic since last HAL_MPU_SimBusLogReset       */
+typedef struct
+{
+    uint32_t    reads;
+    uint32_t    writes;
+    uint32_t    bytesRead;
+    uint32_t    bytesWritten;
+    uint64_t    busTimeUs;      //  Simulated time spent on the bus
+    uint32_t    fifoPackets;    //  DMP packets pushed into FIFO
+    uint32_t    fifoOverflows;  //  DMP packets dropped due to full FIFO
+    uint32_t    dataReadyInts;  //  DMP interrupts raised (MCU wakeups)
+} HAL_MPU_SimBusTotals;
+
+//  Number of most recent transactions kept in the log
+#define HAL_MPU_SIM_BUS_LOG_SIZE    4096
+
+/**     MPU9250 - related HW API       */
+    extern void     HAL_MPU_Init();
+    extern void     HAL_MPU_SetBusSpeed(uint32_t speed);
+    extern uint32_t HAL_MPU_GetBusSpeed();
+    extern void     HAL_MPU_PowerSwitch(bool powerState);
+    extern bool     HAL_MPU_DataAvail();
+    extern void     HAL_MPU_IntRegister(void((*custHook)(void)));
+    extern void     HAL_MPU_IntEnable(bool enable);
+
+    extern void     HAL_MPU_WriteByte(uint8_t I2Caddress, uint8_t regAddress,
+                                      uint8_t data);
+    extern int      HAL_MPU_WriteBytes(void * context, uint8_t regAddress,
+                                       const uint8_t *data, uint32_t length);
+
+    extern uint8_t  HAL_MPU_ReadByte(uint8_t I2Caddress, uint8_t regAddress);
+    extern int      HAL_MPU_ReadBytes(void * context, uint8_t regAddress,
+                                      uint8_t* data, uint32_t length);
+
+    extern int      HAL_MPU_WriteBytesAsync(uint8_t regAddress,
+                                            const uint8_t *data, uint32_t length,
+                                            void((*doneHook)(void)));
+    extern int      HAL_MPU_ReadBytesAsync(uint8_t regAddress, uint8_t* data,
+                                           uint32_t length,
+                                           void((*doneHook)(void)));
+    extern bool     HAL_MPU_TransferBusy();
+
+/**     Simulator control API       */
+    extern void     HAL_MPU_SimSetOutput(uint16_t outputBit, const uint8_t *data,
+                                         uint16_t length);
+    extern void     HAL_MPU_SimSetGenerator(void((*genHook)(uint16_t outputBit,
+                                            uint64_t timeUs, uint8_t *data,
+                                            uint16_t length)));
+    extern void     HAL_MPU_SimSetAccuracy(uint8_t accel, uint8_t gyro,
+                                           uint8_t compass);
+    extern int      HAL_MPU_SimPushFifo(const uint8_t *data, uint16_t length);
+    extern void     HAL_MPU_SimSetMagnetometer(int16_t x, int16_t y, int16_t z);
+    extern void     HAL_MPU_SimMuteDmp(bool mute);
+    extern void     HAL_MPU_SimAttachSerif(int((*read)(void *context,
+                                           uint8_t reg, uint8_t *data,
+                                           uint32_t length)),
+                                           int((*write)(void *context,
+                                           uint8_t reg, const uint8_t *data,
+                                           uint32_t length)),
+                                           void *context);
+    extern void     HAL_MPU_SimBusLog(const HAL_MPU_SimBusRecord **log,
+                                      uint32_t *count);
+    extern void     HAL_MPU_SimBusTotalsGet(HAL_MPU_SimBusTotals *totals);
+    extern void     HAL_MPU_SimBusLogReset();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _HAL_HOST_HAL_ICM_HOST_H_ */
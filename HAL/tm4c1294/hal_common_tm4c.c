@@ -21,10 +21,36 @@
 #include "driverlib/fpu.h"
 #include "driverlib/interrupt.h"
 #include "driverlib/pwm.h"
+#include "driverlib/udma.h"
+#include "driverlib/timer.h"
+#include "driverlib/cpu.h"
 
 
 uint32_t g_ui32SysClock;
 
+/// Upper 32 bits of time base, lower ones are TIMER7 counting system clock
+static volatile uint32_t _timeHigh = 0;
+/// System clock cycles per us, set by HAL_BOARD_TimeInit
+static uint32_t _cyclesPerUs = 120;
+/// Sleep statistics collected by HAL_BOARD_IdleUntil
+static HAL_BOARD_IdleStats _idleStats;
+
+/// Longest sleep, TIMER7 match register only holds lower 32 bits of wake time
+#define HAL_IDLE_MAX_CYCLES     0x80000000
+
+void HAL_BOARD_TimeIntHandler(void);
+
+/// uDMA channel control table, shared by all peripherals using uDMA
+#if defined(ewarm)
+#pragma data_alignment=1024
+static uint8_t _dmaControlTable[1024];
+#elif defined(ccs)
+#pragma DATA_ALIGN(_dmaControlTable, 1024)
+static uint8_t _dmaControlTable[1024];
+#else
+static uint8_t _dmaControlTable[1024] __attribute__ ((aligned(1024)));
+#endif
+
 /**
  *  Dummy function to be called to suppress "Unused variable" warnings
  */
@@ -47,6 +73,190 @@ void HAL_BOARD_CLOCK_Init()
     MAP_IntMasterEnable();
 }
 
+/**
+ * Enable uDMA controller and assign it a channel control table. Safe to call
+ * from every driver using uDMA, initialization is done only once
+ */
+void HAL_DMA_Init()
+{
+    static bool initialized = false;
+
+    if (initialized)
+        return;
+
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_UDMA);
+    while (!MAP_SysCtlPeripheralReady(SYSCTL_PERIPH_UDMA));
+    MAP_uDMAEnable();
+    MAP_uDMAControlBaseSet(_dmaControlTable);
+
+    initialized = true;
+}
+
+/**
+ * Start 64-bit time base: TIMER7 counts system clock cycles up through the
+ * whole 32-bit range and its overflow interrupt extends it to 64 bits. Has to
+ * be called after HAL_BOARD_CLOCK_Init
+ */
+void HAL_BOARD_TimeInit()
+{
+    MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_TIMER7);
+    while (!MAP_SysCtlPeripheralReady(SYSCTL_PERIPH_TIMER7));
+
+    _cyclesPerUs = g_ui32SysClock / 1000000;
+    _timeHigh = 0;
+
+    MAP_TimerConfigure(TIMER7_BASE, TIMER_CFG_PERIODIC_UP);
+    MAP_TimerLoadSet(TIMER7_BASE, TIMER_A, 0xFFFFFFFF);
+    //  Match event wakes the core from HAL_BOARD_IdleUntil, its interrupt is
+    //  only unmasked while sleeping
+    HWREG(TIMER7_BASE + TIMER_O_TAMR) |= TIMER_TAMR_TAMIE;
+    TimerIntRegister(TIMER7_BASE, TIMER_A, HAL_BOARD_TimeIntHandler);
+    MAP_TimerIntEnable(TIMER7_BASE, TIMER_TIMA_TIMEOUT);
+    MAP_TimerEnable(TIMER7_BASE, TIMER_A);
+}
+
+/**
+ * Get current time in system clock cycles, resolution of 8.3ns at 120MHz and
+ * no wrap-around during lifetime of the board. Safe to call from interrupts,
+ * also with interrupts disabled
+ * @return Cycles since HAL_BOARD_TimeInit
+ */
+uint64_t HAL_BOARD_TimeCycles()
+{
+    uint32_t high, low, pending;
+
+    //  Retry if overflow interrupt ran in the middle
+    do
+    {
+        high = _timeHigh;
+        low = HWREG(TIMER7_BASE + TIMER_O_TAV);
+        pending = HWREG(TIMER7_BASE + TIMER_O_RIS) & TIMER_TIMA_TIMEOUT;
+    } while (high != _timeHigh);
+
+    //  Overflow whose interrupt hasn't run yet (interrupts are disabled, or
+    //  it's just about to), counter being low tells that it happened before
+    //  counter was read
+    if (pending && (low < 0x80000000))
+        high++;
+
+    return ((uint64_t)high << 32) | low;
+}
+
+/**
+ * Get current time in us
+ * @return Time in us since HAL_BOARD_TimeInit
+ */
+uint64_t HAL_BOARD_TimeUS()
+{
+    return HAL_BOARD_TimeCycles() / _cyclesPerUs;
+}
+
+/**
+ * Convert time in cycles (HAL_BOARD_TimeCycles) to us
+ */
+uint64_t HAL_BOARD_CyclesToUS(uint64_t cycles)
+{
+    return cycles / _cyclesPerUs;
+}
+
+/**
+ * Put the core to sleep until time base reaches wakeUs or any interrupt is
+ * raised, whichever comes first. Interrupts are disabled while pending() is
+ * checked and until core is asleep (WFI wakes on interrupts that are pending
+ * but masked), so an interrupt arriving after the check still wakes the core
+ * instead of being slept through. Its handler runs before this returns
+ * @param wakeUs Time (HAL_BOARD_TimeUS) at which to wake up at the latest,
+ *        UINT64_MAX to only wake on interrupt (in fact after 17.9s at 120MHz)
+ * @param pending (optional) Returns true if there's work that was handed over
+ *        from an interrupt and the core shouldn't sleep
+ * @return true if core was asleep, false if it wasn't put to sleep at all
+ */
+bool HAL_BOARD_IdleUntil(uint64_t wakeUs, bool((*pending)(void)))
+{
+    bool masked = MAP_IntMasterDisable();
+    uint64_t wakeCycles = UINT64_MAX, now, woke;
+    bool slept = false;
+
+    if (wakeUs < (UINT64_MAX / _cyclesPerUs))
+        wakeCycles = wakeUs * _cyclesPerUs;
+    now = HAL_BOARD_TimeCycles();
+    //  Not worth it if wake time is closer than about the time needed to arm
+    //  the timer and get back
+    if (((pending == 0) || !pending()) && (wakeCycles > now + _cyclesPerUs))
+    {
+        if ((wakeCycles - now) > HAL_IDLE_MAX_CYCLES)
+            wakeCycles = now + HAL_IDLE_MAX_CYCLES;
+
+        //  One-shot wake-up: match on lower 32 bits of time base
+        MAP_TimerMatchSet(TIMER7_BASE, TIMER_A, (uint32_t)wakeCycles);
+        MAP_TimerIntClear(TIMER7_BASE, TIMER_TIMA_MATCH);
+        MAP_TimerIntEnable(TIMER7_BASE, TIMER_TIMA_MATCH);
+
+        //  Match that went by while it was being armed would never come
+        if (HAL_BOARD_TimeCycles() < wakeCycles)
+            CPUwfi();
+
+        woke = HAL_BOARD_TimeCycles();
+        MAP_TimerIntDisable(TIMER7_BASE, TIMER_TIMA_MATCH);
+
+        _idleStats.sleeps++;
+        _idleStats.idleCycles += woke - now;
+        if (woke >= wakeCycles)
+        {
+            uint32_t latency = (uint32_t)(woke - wakeCycles);
+
+            _idleStats.timerWakes++;
+            _idleStats.latencySum += latency;
+            if (latency > _idleStats.latencyMax)
+                _idleStats.latencyMax = latency;
+        }
+        slept = true;
+    }
+
+    if (!masked)
+        MAP_IntMasterEnable();
+
+    return slept;
+}
+
+/**
+ * Get sleep statistics collected since HAL_BOARD_IdleStatsReset (or boot)
+ * @param stats Statistics are copied here
+ */
+void HAL_BOARD_IdleStatsGet(HAL_BOARD_IdleStats *stats)
+{
+    bool masked = MAP_IntMasterDisable();
+
+    *stats = _idleStats;
+    if (!masked)
+        MAP_IntMasterEnable();
+}
+
+/**
+ * Clear sleep statistics
+ */
+void HAL_BOARD_IdleStatsReset()
+{
+    bool masked = MAP_IntMasterDisable();
+
+    memset(&_idleStats, 0, sizeof(_idleStats));
+    if (!masked)
+        MAP_IntMasterEnable();
+}
+
+/**
+ * TIMER7 overflow, every 2^32 cycles (35.8s at 120MHz), and match used as
+ * wake-up by HAL_BOARD_IdleUntil (nothing to do there, it's already awake)
+ */
+void HAL_BOARD_TimeIntHandler(void)
+{
+    uint32_t status = MAP_TimerIntStatus(TIMER7_BASE, true);
+
+    MAP_TimerIntClear(TIMER7_BASE, status);
+    if (status & TIMER_TIMA_TIMEOUT)
+        _timeHigh++;
+}
+
 /**
  * Software-triggered reboot of microcontroller
  */
@@ -55,6 +265,28 @@ void HAL_BOARD_Reset()
     MAP_SysCtlReset();
 }
 
+/**
+ * Check whether microcontroller was last reset while power stayed on (watchdog,
+ * software or reset pin) as opposed to power-on or brown-out reset, in which
+ * case external peripherals might have kept their state
+ * @return true if last reset was a warm reset
+ */
+bool HAL_BOARD_WarmReset()
+{
+    static int8_t warm = -1;
+
+    //  Reset cause register is sticky, read and clear it only once per boot
+    if (warm < 0)
+    {
+        uint32_t cause = MAP_SysCtlResetCauseGet();
+
+        MAP_SysCtlResetCauseClear(cause);
+        warm = ((cause & (SYSCTL_CAUSE_POR | SYSCTL_CAUSE_BOR)) == 0);
+    }
+
+    return (warm != 0);
+}
+
 /**
  * Wait for given amount of us - blocking function
  * @param us time in us to wait
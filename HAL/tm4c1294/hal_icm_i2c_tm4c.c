@@ -36,6 +36,12 @@
 /**     MPU9250 - related macros        */
 #define MPU9250_I2C_BASE I2C2_BASE
 
+//  Hook called from data-ready interrupt
+static void (*_dataReadyHook)(void) = 0;
+
+//  Currently configured I2C clock in Hz
+static uint32_t _i2cClock = 400000;
+
 /**
  * Initializes I2C2 bus for communication with MPU
  *   * I2C Bus frequency 400kHz, PN4 as SDA, PN5 as SCL
@@ -61,18 +67,46 @@ void HAL_MPU_Init(void((*custHook)(void)))
     MAP_I2CMasterEnable(MPU9250_I2C_BASE);
 
     // Run I2C bus in high-speed mode, 400kHz speed
+    _i2cClock = 400000;
     MAP_I2CMasterInitExpClk(MPU9250_I2C_BASE, g_ui32SysClock, true);
 
-    //  Configure power-switch pin
+    //  Configure power-switch pin, keep MPU powered while doing so in order
+    //  not to lose its state on warm restart (call HAL_MPU_PowerSwitch to
+    //  power-cycle it)
+    MAP_GPIOPinWrite(GPIO_PORTL_BASE, GPIO_PIN_4, 0xFF);
     MAP_GPIOPinTypeGPIOOutput(GPIO_PORTL_BASE, GPIO_PIN_4);
-    MAP_GPIOPinWrite(GPIO_PORTL_BASE, GPIO_PIN_4, 0x00);
 
-    //  Configure interrupt pin to receive output
-    //      (not used as actual interrupts)
+    //  Configure interrupt pin to receive output, interrupt itself is enabled
+    //  once a hook is registered through HAL_MPU_IntRegister
     MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOA);
     MAP_GPIOPinTypeGPIOInput(GPIO_PORTA_BASE, GPIO_PIN_5);
     MAP_GPIOPinWrite(GPIO_PORTA_BASE, GPIO_PIN_5, 0x00);
+    MAP_GPIOIntTypeSet(GPIO_PORTA_BASE, GPIO_PIN_5, GPIO_RISING_EDGE);
+
+}
+
+/**
+ * Change clock of I2C bus used for communication with MPU
+ * I2C peripheral only supports standard (100kHz) and fast (400kHz) mode, so
+ * any speed above 100kHz selects fast mode
+ * @param speed Requested I2C clock in Hz
+ */
+void HAL_MPU_SetBusSpeed(uint32_t speed)
+{
+    while (MAP_I2CMasterBusy(MPU9250_I2C_BASE));
 
+    _i2cClock = (speed > 100000) ? 400000 : 100000;
+    MAP_I2CMasterInitExpClk(MPU9250_I2C_BASE, g_ui32SysClock,
+                            (_i2cClock == 400000));
+}
+
+/**
+ * Get clock of I2C bus used for communication with MPU
+ * @return I2C clock in Hz
+ */
+uint32_t HAL_MPU_GetBusSpeed()
+{
+    return _i2cClock;
 }
 
 /**
@@ -97,6 +131,45 @@ bool HAL_MPU_DataAvail()
     return (MAP_GPIOPinRead(GPIO_PORTA_BASE, GPIO_PIN_5) != 0);
 }
 
+/**
+ * Interrupt service routine for rising edge on data-ready pin (PA5)
+ */
+void HAL_MPU_DataReadyIntHandler(void)
+{
+    uint32_t status = MAP_GPIOIntStatus(GPIO_PORTA_BASE, true);
+    MAP_GPIOIntClear(GPIO_PORTA_BASE, status);
+
+    if ((status & GPIO_PIN_5) && (_dataReadyHook != 0))
+        _dataReadyHook();
+}
+
+/**
+ * Register function to be called from interrupt each time MPU raises its
+ * data-ready pin, and enable the interrupt
+ * @param custHook Function to call, executed in interrupt context
+ */
+void HAL_MPU_IntRegister(void((*custHook)(void)))
+{
+    _dataReadyHook = custHook;
+    GPIOIntRegister(GPIO_PORTA_BASE, HAL_MPU_DataReadyIntHandler);
+    HAL_MPU_IntEnable(true);
+}
+
+/**
+ * Enable or disable data-ready interrupt
+ * @param enable Desired state of the interrupt
+ */
+void HAL_MPU_IntEnable(bool enable)
+{
+    if (enable)
+    {
+        MAP_GPIOIntClear(GPIO_PORTA_BASE, GPIO_PIN_5);
+        MAP_GPIOIntEnable(GPIO_PORTA_BASE, GPIO_PIN_5);
+    }
+    else
+        MAP_GPIOIntDisable(GPIO_PORTA_BASE, GPIO_PIN_5);
+}
+
 /**
  * Write one byte of data to I2C bus and wait until transmission is over (blocking)
  * @param I2Caddress 7-bit address of I2C device (8. bit is for R/W)
@@ -4,7 +4,11 @@
  *  SPI drivers for MPU9250 on TM4C1294NCPDT
  *  This file implements communication with MPU9250 IMU by utilizing SPI bus.
  *  SPI2 bus is used at 1MHZ speed with PN2 as slave select (configured as GPIO),
- *  PA5 as data-ready signal, and PL4 as power-control pin.
+ *  PA5 as data-ready signal, and PL4 as power-control pin. Multi-byte transfers
+ *  are moved by uDMA (channels 12 & 13) and completed in SSI2 interrupt, so
+ *  they can run in background while CPU does something else. Blocking calls
+ *  poll SSI2 interrupt handler while they wait, so they also work with
+ *  interrupts masked and from interrupts of any priority.
  *
  *  Created on: Mar 4, 2017
  *      Author: Vedran
@@ -21,6 +25,7 @@
 #include "inc/hw_timer.h"
 #include "inc/hw_ints.h"
 #include "inc/hw_gpio.h"
+#include "inc/hw_ssi.h"
 
 #include "driverlib/rom_map.h"
 #include "driverlib/rom.h"
@@ -31,14 +36,52 @@
 #include "utils/uartstdio.h"
 #include "driverlib/ssi.h"
 #include "driverlib/timer.h"
+#include "driverlib/udma.h"
 
 
 /**     ICM20948 - related macros        */
 #define ICM20948_SPI_BASE SSI2_BASE
+#define ICM20948_DMA_RX   UDMA_CH12_SSI2RX
+#define ICM20948_DMA_TX   UDMA_CH13_SSI2TX
+//  Max number of items uDMA can move in a single basic-mode transfer
+#define DMA_MAX_TRANSFER  1024
+
+/**
+ * State of asynchronous SPI transfer in progress. Address byte is sent by
+ * CPU, payload is moved by uDMA in chunks of at most DMA_MAX_TRANSFER bytes
+ * while CS is held low for the whole transfer. State only changes with
+ * interrupts masked, so whoever looks at it (SSI2 interrupt, or a blocking
+ * call polling for completion from any context) finds the bus either free or
+ * with a chunk handed over to uDMA
+ */
+static struct
+{
+    volatile bool busy;
+    bool        read;
+    uint8_t     *rxPtr;
+    const uint8_t *txPtr;
+    uint32_t    remaining;
+    uint32_t    chunk;
+    void        ((*doneHook)(void));
+} _spiXfer;
+
+//  Hook called from data-ready interrupt
+static void (*_dataReadyHook)(void) = 0;
+
+//  Currently configured SPI clock in Hz
+static uint32_t _spiClock = HAL_MPU_BUS_SPEED_SAFE;
+
+//  Source of dummy bytes clocked out on reads & sink for junk received on writes
+static const uint8_t _spiTxDummy = 0x00;
+static uint8_t _spiRxDummy;
+
+void HAL_MPU_SPIIntHandler(void);
+static void _HAL_MPU_WaitIdle();
 
 /**
  * Initializes SPI2 bus for communication with MPU
- *   * SPI Bus frequency 1MHz, PD0 as MISO, PD1 as MOSI, PD3 as SCLK
+ *   * SPI Bus frequency 1MHz (see HAL_MPU_SetBusSpeed), PD0 as MISO, PD1 as
+ *     MOSI, PD3 as SCLK
  *   * Pin PL4 as power switch (control external MOSFET to cut-off power to MPU)
  *   * Pin PA5 as input, to receive data-ready signal from MPU
  *   * Pin PN2 as slave select, but configured as GPIO and manually toggled
@@ -61,8 +104,9 @@ void HAL_MPU_Init(void((*custHook)(void)))
     MAP_GPIOPinTypeSSI(GPIO_PORTD_BASE, GPIO_PIN_0 | GPIO_PIN_1 | GPIO_PIN_3);
 
     //  Setup SPI: 1MHz, 8 bit data, mode 0
+    _spiClock = HAL_MPU_BUS_SPEED_SAFE;
     MAP_SSIConfigSetExpClk(SSI2_BASE, g_ui32SysClock, SSI_FRF_MOTO_MODE_0,
-                           SSI_MODE_MASTER, 1000000, 8);
+                           SSI_MODE_MASTER, _spiClock, 8);
     //  Enable SPI peripheral
     MAP_SSIEnable(SSI2_BASE);
 
@@ -70,21 +114,64 @@ void HAL_MPU_Init(void((*custHook)(void)))
     uint32_t dummy[1];
     while (MAP_SSIDataGetNonBlocking(SSI2_BASE, &dummy[0]));
 
-    //  Configure power-switch pin
+    //  Route SSI2 requests to uDMA and get notified when RX channel is done
+    HAL_DMA_Init();
+    MAP_uDMAChannelAssign(ICM20948_DMA_RX);
+    MAP_uDMAChannelAssign(ICM20948_DMA_TX);
+    MAP_uDMAChannelAttributeDisable(ICM20948_DMA_RX, UDMA_ATTR_ALL);
+    MAP_uDMAChannelAttributeDisable(ICM20948_DMA_TX, UDMA_ATTR_ALL);
+    MAP_SSIDMAEnable(SSI2_BASE, SSI_DMA_RX | SSI_DMA_TX);
+    SSIIntRegister(SSI2_BASE, HAL_MPU_SPIIntHandler);
+    MAP_SSIIntEnable(SSI2_BASE, SSI_DMARX);
+    _spiXfer.busy = false;
+
+    //  Configure power-switch pin, keep MPU powered while doing so in order
+    //  not to lose its state on warm restart (call HAL_MPU_PowerSwitch to
+    //  power-cycle it)
+    MAP_GPIOPinWrite(GPIO_PORTL_BASE, GPIO_PIN_4, 0xFF);
     MAP_GPIOPinTypeGPIOOutput(GPIO_PORTL_BASE, GPIO_PIN_4);
-    MAP_GPIOPinWrite(GPIO_PORTL_BASE, GPIO_PIN_4, 0x00);
 
-    //  Configure input pin to receive interrupts from MPU
-    //      (not used as actual interrupt)
+    //  Configure input pin to receive interrupts from MPU, interrupt itself is
+    //  enabled once a hook is registered through HAL_MPU_IntRegister
     MAP_SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOA);
     MAP_GPIOPinTypeGPIOInput(GPIO_PORTA_BASE, GPIO_PIN_5);
     MAP_GPIOPinWrite(GPIO_PORTA_BASE, GPIO_PIN_5, 0x00);
+    MAP_GPIOIntTypeSet(GPIO_PORTA_BASE, GPIO_PIN_5, GPIO_RISING_EDGE);
 
     //  Configure slave select pin
     MAP_GPIOPinTypeGPIOOutput(GPIO_PORTN_BASE, GPIO_PIN_2);
     MAP_GPIOPinWrite(GPIO_PORTN_BASE, GPIO_PIN_2, 0xFF);
 }
 
+/**
+ * Change clock of SPI bus used for communication with MPU
+ * Blocks until any transfer in progress has completed, then reconfigures SSI2
+ * keeping all other settings (mode 0, 8 bit data, uDMA requests)
+ * @param speed New SPI clock in Hz (ICM20948 supports up to 7MHz)
+ */
+void HAL_MPU_SetBusSpeed(uint32_t speed)
+{
+    //  Clock can't be changed in the middle of a transfer
+    _HAL_MPU_WaitIdle();
+    while (MAP_SSIBusy(ICM20948_SPI_BASE));
+
+    MAP_SSIDisable(ICM20948_SPI_BASE);
+    MAP_SSIConfigSetExpClk(ICM20948_SPI_BASE, g_ui32SysClock,
+                           SSI_FRF_MOTO_MODE_0, SSI_MODE_MASTER, speed, 8);
+    MAP_SSIEnable(ICM20948_SPI_BASE);
+
+    _spiClock = speed;
+}
+
+/**
+ * Get clock of SPI bus used for communication with MPU
+ * @return SPI clock in Hz as last requested
+ */
+uint32_t HAL_MPU_GetBusSpeed()
+{
+    return _spiClock;
+}
+
 /**
  * Control power-switch for MPU9250
  * Controls whether or not MPU sensors receives power (n-ch MOSFET as switch)
@@ -107,124 +194,305 @@ bool HAL_MPU_DataAvail()
     return (MAP_GPIOPinRead(GPIO_PORTA_BASE, GPIO_PIN_5) != 0);
 }
 
+/**
+ * Interrupt service routine for rising edge on data-ready pin (PA5)
+ */
+void HAL_MPU_DataReadyIntHandler(void)
+{
+    uint32_t status = MAP_GPIOIntStatus(GPIO_PORTA_BASE, true);
+    MAP_GPIOIntClear(GPIO_PORTA_BASE, status);
+
+    if ((status & GPIO_PIN_5) && (_dataReadyHook != 0))
+        _dataReadyHook();
+}
+
+/**
+ * Register function to be called from interrupt each time MPU raises its
+ * data-ready pin, and enable the interrupt
+ * @param custHook Function to call, executed in interrupt context
+ */
+void HAL_MPU_IntRegister(void((*custHook)(void)))
+{
+    _dataReadyHook = custHook;
+    GPIOIntRegister(GPIO_PORTA_BASE, HAL_MPU_DataReadyIntHandler);
+    HAL_MPU_IntEnable(true);
+}
+
+/**
+ * Enable or disable data-ready interrupt
+ * @param enable Desired state of the interrupt
+ */
+void HAL_MPU_IntEnable(bool enable)
+{
+    if (enable)
+    {
+        MAP_GPIOIntClear(GPIO_PORTA_BASE, GPIO_PIN_5);
+        MAP_GPIOIntEnable(GPIO_PORTA_BASE, GPIO_PIN_5);
+    }
+    else
+        MAP_GPIOIntDisable(GPIO_PORTA_BASE, GPIO_PIN_5);
+}
+
 /**
  * Write one byte of data to SPI bus and wait until transmission is over (blocking)
+ * Goes through the same transfer as multi-byte writes (see HAL_MPU_WriteBytes)
  * @param I2Caddress (NOT USED) Here for compatibility with I2C HAL implementation
  * @param regAddress Address of register in MPU to write into
  * @param data Data to write into the register
  */
 void HAL_MPU_WriteByte(uint8_t I2Caddress, uint8_t regAddress, uint8_t data)
 {
-    uint32_t dummy[1];
-
-    regAddress = regAddress & 0x7F; //  MSB = 0 for writing operation
-    //  Drive CS low and wait one SPI clock cycle
-    MAP_GPIOPinWrite(GPIO_PORTN_BASE, GPIO_PIN_2, 0x00);
-    HAL_DelayUS(1);
-    //  Send register address
-    SSIDataPut(SSI2_BASE, regAddress);
-    //  Send register data
-    SSIDataPut(SSI2_BASE, data);
-    //  Wait until sending buffer is empty
-    while(SSIBusy(SSI2_BASE));
-    //  Drive CS high to stop communication
-    MAP_GPIOPinWrite(GPIO_PORTN_BASE, GPIO_PIN_2, 0xFF);
-
-    //  Empty any received junk from the receive buffer
-    while (SSIDataGetNonBlocking(SSI2_BASE, &dummy[0]));
+    HAL_MPU_WriteBytes(0, regAddress, &data, 1);
 }
 
 /**
  * Send a byte-array of data through SPI bus (blocking)
- * @param I2Caddress (NOT USED) Here for compatibility with I2C HAL implementation
+ * Thin wrapper around asynchronous transfer: waits for the transfer in
+ * progress (if any) to complete, then for its own
+ * @param context (NOT USED) Here for compatibility with serif interface
  * @param regAddress Address of a first register in MPU to start writing into
  * @param data Buffer of data to send
  * @param length Length of data to send
- * @return 0 to verify that function didn't hang somewhere
+ * @return 0 (always succeeds)
  */
 int HAL_MPU_WriteBytes(void * context, uint8_t regAddress,
                        const uint8_t *data, uint32_t length)
 {
-    uint16_t i;
-    uint32_t dummy[1];
-
-    regAddress = regAddress & 0x7F; //  MSB = 0 for writing operation
-    MAP_GPIOPinWrite(GPIO_PORTN_BASE, GPIO_PIN_2, 0x00);
-    HAL_DelayUS(1);
-    SSIDataPut(SSI2_BASE, regAddress);
-
-    for (i = 0; i < length; i++)
-        SSIDataPut(SSI2_BASE, data[i]);
-
-    while(SSIBusy(SSI2_BASE));
-    MAP_GPIOPinWrite(GPIO_PORTN_BASE, GPIO_PIN_2, 0xFF);
-
-    while (SSIDataGetNonBlocking(SSI2_BASE, &dummy[0]));
+    while (HAL_MPU_WriteBytesAsync(regAddress, data, length, 0) != 0)
+        _HAL_MPU_WaitIdle();
+    _HAL_MPU_WaitIdle();
 
     return 0;
 }
 
 /**
  * Read one byte of data from SPI device (performs dummy write as well)
+ * Goes through the same transfer as multi-byte reads (see HAL_MPU_ReadBytes)
  * @param I2Caddress (NOT USED) Here for compatibility with I2C HAL implementation
  * @param regAddress Address of register in MPU to read from
  * @return Byte of data received from SPI device
  */
 uint8_t HAL_MPU_ReadByte(uint8_t I2Caddress, uint8_t regAddress)
 {
-    uint32_t dummy[1], data;
-
-    regAddress = regAddress | 0x80; //  MSB = 1 for reading operation
-    MAP_GPIOPinWrite(GPIO_PORTN_BASE, GPIO_PIN_2, 0x00);
-    HAL_DelayUS(1);
-
-    SSIDataPut(SSI2_BASE, regAddress);
-    SSIDataGet(SSI2_BASE, &dummy[0]);
-    SSIDataPut(SSI2_BASE, 0x00);
-    SSIDataGet(SSI2_BASE, &data);
-
-    while(SSIBusy(SSI2_BASE));
-    MAP_GPIOPinWrite(GPIO_PORTN_BASE, GPIO_PIN_2, 0xFF);
+    uint8_t data;
 
-    while (SSIDataGetNonBlocking(SSI2_BASE, &dummy[0]));
+    HAL_MPU_ReadBytes(0, regAddress, &data, 1);
 
-    return (uint8_t)(data & 0xFF);
+    return data;
 }
 
 /**
  * Read several bytes from SPI device (performs dummy write as well)
- * @param I2Caddress (NOT USED) Here for compatibility with I2C HAL implementation
+ * Thin wrapper around asynchronous transfer: waits for the transfer in
+ * progress (if any) to complete, then for its own
+ * @param context (NOT USED) Here for compatibility with serif interface
  * @param regAddress Address of register in MPU to read from
- * @param count Number of bytes to red
- * @param dest Pointer to data buffer in which data is saved after reading
+ * @param data Pointer to data buffer in which data is saved after reading
+ * @param length Number of bytes to read
+ * @return 0 (always succeeds)
  */
 int HAL_MPU_ReadBytes(void * context, uint8_t regAddress,
                       uint8_t* data, uint32_t length)
 {
-    uint16_t i;
+    while (HAL_MPU_ReadBytesAsync(regAddress, data, length, 0) != 0)
+        _HAL_MPU_WaitIdle();
+    _HAL_MPU_WaitIdle();
+
+    return 0;
+}
+
+/**
+ * Program uDMA for the next chunk of transfer in progress and start it. Both
+ * channels always run: TX clocks the bus, RX drains SSI receive FIFO
+ */
+static void _HAL_MPU_StartChunk()
+{
+    _spiXfer.chunk = _spiXfer.remaining;
+    if (_spiXfer.chunk > DMA_MAX_TRANSFER)
+        _spiXfer.chunk = DMA_MAX_TRANSFER;
+
+    if (_spiXfer.read)
+    {
+        MAP_uDMAChannelControlSet(ICM20948_DMA_RX | UDMA_PRI_SELECT,
+                UDMA_SIZE_8 | UDMA_SRC_INC_NONE | UDMA_DST_INC_8 | UDMA_ARB_4);
+        MAP_uDMAChannelTransferSet(ICM20948_DMA_RX | UDMA_PRI_SELECT,
+                UDMA_MODE_BASIC, (void *)(SSI2_BASE + SSI_O_DR),
+                _spiXfer.rxPtr, _spiXfer.chunk);
+        MAP_uDMAChannelControlSet(ICM20948_DMA_TX | UDMA_PRI_SELECT,
+                UDMA_SIZE_8 | UDMA_SRC_INC_NONE | UDMA_DST_INC_NONE | UDMA_ARB_4);
+        MAP_uDMAChannelTransferSet(ICM20948_DMA_TX | UDMA_PRI_SELECT,
+                UDMA_MODE_BASIC, (void *)&_spiTxDummy,
+                (void *)(SSI2_BASE + SSI_O_DR), _spiXfer.chunk);
+    }
+    else
+    {
+        MAP_uDMAChannelControlSet(ICM20948_DMA_RX | UDMA_PRI_SELECT,
+                UDMA_SIZE_8 | UDMA_SRC_INC_NONE | UDMA_DST_INC_NONE | UDMA_ARB_4);
+        MAP_uDMAChannelTransferSet(ICM20948_DMA_RX | UDMA_PRI_SELECT,
+                UDMA_MODE_BASIC, (void *)(SSI2_BASE + SSI_O_DR),
+                &_spiRxDummy, _spiXfer.chunk);
+        MAP_uDMAChannelControlSet(ICM20948_DMA_TX | UDMA_PRI_SELECT,
+                UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_4);
+        MAP_uDMAChannelTransferSet(ICM20948_DMA_TX | UDMA_PRI_SELECT,
+                UDMA_MODE_BASIC, (void *)_spiXfer.txPtr,
+                (void *)(SSI2_BASE + SSI_O_DR), _spiXfer.chunk);
+    }
+
+    //  Enable RX first so that no received byte is missed
+    MAP_uDMAChannelEnable(ICM20948_DMA_RX);
+    MAP_uDMAChannelEnable(ICM20948_DMA_TX);
+}
+
+/**
+ * Claim the bus, select the chip, send register address and kick off uDMA
+ * transfer of the payload. Address byte is exchanged by CPU as it's a single
+ * byte. All of it runs with interrupts masked (1 SPI clock + 1 byte, ~2us at
+ * HAL_MPU_BUS_SPEED_FAST), as transfers are also started from interrupt
+ * context (e.g. from doneHook or data-ready hook) and a blocking call in an
+ * interrupt that preempted this would otherwise wait on a transfer that never
+ * gets to start
+ * @param regAddress Register address, including R/W bit
+ * @param rxPtr Buffer to read into (reads only)
+ * @param txPtr Buffer to send (writes only)
+ * @return 0 if transfer was started, -1 if bus is busy
+ */
+static int _HAL_MPU_StartTransfer(uint8_t regAddress, uint8_t *rxPtr,
+                                  const uint8_t *txPtr, uint32_t length,
+                                  void((*doneHook)(void)))
+{
     uint32_t dummy[1];
+    bool masked = MAP_IntMasterDisable();
+
+    if (_spiXfer.busy)
+    {
+        if (!masked)
+            MAP_IntMasterEnable();
+        return -1;
+    }
 
-    regAddress = regAddress | 0x80; //  MSB = 1 for reading operation
+    _spiXfer.busy = true;
+    _spiXfer.read = ((regAddress & 0x80) != 0);
+    _spiXfer.rxPtr = rxPtr;
+    _spiXfer.txPtr = txPtr;
+    _spiXfer.remaining = length;
+    _spiXfer.chunk = 0;
+    _spiXfer.doneHook = doneHook;
+
+    //  Drive CS low and wait one SPI clock cycle
     MAP_GPIOPinWrite(GPIO_PORTN_BASE, GPIO_PIN_2, 0x00);
     HAL_DelayUS(1);
 
     SSIDataPut(SSI2_BASE, regAddress);
     SSIDataGet(SSI2_BASE, &dummy[0]);
 
-    for (i = 0; i < length; i++)
-    {
-        uint32_t tmp;
-        SSIDataPut(SSI2_BASE, 0x00);
-        SSIDataGet(SSI2_BASE, &tmp);
-        data[i] = tmp & 0xFF;
-    }
-
-    while(SSIBusy(SSI2_BASE));
-    MAP_GPIOPinWrite(GPIO_PORTN_BASE, GPIO_PIN_2, 0xFF);
+    if (length > 0)
+        _HAL_MPU_StartChunk();
+    if (!masked)
+        MAP_IntMasterEnable();
 
-    while (SSIDataGetNonBlocking(SSI2_BASE, &dummy[0]));
+    //  Nothing for uDMA to move, complete the transfer right away
+    if (length == 0)
+        HAL_MPU_SPIIntHandler();
 
     return 0;
 }
 
+/**
+ * Wait for transfer in progress (if any) to complete. SSI2 interrupt doesn't
+ * run while interrupts are masked or while the caller is an interrupt of the
+ * same or higher priority, so its handler is polled here instead of waiting
+ * for it. Handler does nothing until uDMA is done with the chunk, and runs
+ * with interrupts masked, so it never races the interrupt itself
+ */
+static void _HAL_MPU_WaitIdle()
+{
+    while (_spiXfer.busy)
+        HAL_MPU_SPIIntHandler();
+}
+
+/**
+ * Send a byte-array of data through SPI bus (non-blocking)
+ * Data buffer must remain valid until transfer completes
+ * @param regAddress Address of a first register in MPU to start writing into
+ * @param data Buffer of data to send
+ * @param length Length of data to send
+ * @param doneHook Function called once transfer is over, or 0. Called from
+ *        interrupt, or from a blocking call that polled for completion
+ * @return 0 if transfer was started, -1 if bus is busy
+ */
+int HAL_MPU_WriteBytesAsync(uint8_t regAddress, const uint8_t *data,
+                            uint32_t length, void((*doneHook)(void)))
+{
+    return _HAL_MPU_StartTransfer(regAddress & 0x7F, 0, data, length, doneHook);
+}
+
+/**
+ * Read several bytes from SPI device (non-blocking)
+ * Data buffer is filled in background by uDMA and is valid once transfer
+ * completes
+ * @param regAddress Address of register in MPU to read from
+ * @param data Pointer to data buffer in which data is saved after reading
+ * @param length Number of bytes to read
+ * @param doneHook Function called once transfer is over, or 0. Called from
+ *        interrupt, or from a blocking call that polled for completion
+ * @return 0 if transfer was started, -1 if bus is busy
+ */
+int HAL_MPU_ReadBytesAsync(uint8_t regAddress, uint8_t* data, uint32_t length,
+                           void((*doneHook)(void)))
+{
+    return _HAL_MPU_StartTransfer(regAddress | 0x80, data, 0, length, doneHook);
+}
+
+/**
+ * Check if asynchronous transfer is still in progress
+ * @return true if SPI bus is in use, false otherwise
+ */
+bool HAL_MPU_TransferBusy()
+{
+    return _spiXfer.busy;
+}
+
+/**
+ * SSI2 interrupt, raised when uDMA RX channel has received all bytes of a
+ * chunk. Starts next chunk, or releases CS and notifies the user when
+ * the whole transfer is done. Also polled by blocking calls while they wait
+ * (see _HAL_MPU_WaitIdle), so it does nothing while uDMA is still busy.
+ * doneHook is called with interrupts restored, so it can start a new transfer
+ */
+void HAL_MPU_SPIIntHandler(void)
+{
+    void (*doneHook)(void) = 0;
+    bool masked = MAP_IntMasterDisable();
+    uint32_t status = MAP_SSIIntStatus(SSI2_BASE, true);
+
+    MAP_SSIIntClear(SSI2_BASE, status);
+
+    if (_spiXfer.busy && !MAP_uDMAChannelIsEnabled(ICM20948_DMA_RX))
+    {
+        //  Account for the chunk that just completed
+        _spiXfer.remaining -= _spiXfer.chunk;
+        if (_spiXfer.read)
+            _spiXfer.rxPtr += _spiXfer.chunk;
+        else
+            _spiXfer.txPtr += _spiXfer.chunk;
+
+        if (_spiXfer.remaining > 0)
+            _HAL_MPU_StartChunk();
+        else
+        {
+            //  Drive CS high to stop communication
+            while(SSIBusy(SSI2_BASE));
+            MAP_GPIOPinWrite(GPIO_PORTN_BASE, GPIO_PIN_2, 0xFF);
+
+            _spiXfer.busy = false;
+            doneHook = _spiXfer.doneHook;
+        }
+    }
+    if (!masked)
+        MAP_IntMasterEnable();
+
+    if (doneHook != 0)
+        doneHook();
+}
+
 #endif /* __HAL_USE_ICM20948_SPI__ */
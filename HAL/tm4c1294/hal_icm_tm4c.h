@@ -11,8 +11,11 @@
  *  Hardware dependencies:
  *    * Check hwconfig to find out whether HAL uses I2C2(PN4 as SDA and PN5 as
  *      SCL) or SPI2(PD0 as MISO, PD1 as MOSI, PD3 as SCLK, PN2 as CS)
- *    * GPIO PA5 - Data available interrupt pin (normal input, not interrupt pin)
+ *    * GPIO PA5 - Data available interrupt pin (rising-edge interrupt, can
+ *      also be polled)
  *    * GPIO PL4 - Power switch for MPU (active high)
+ *    * uDMA channels 12 & 13 (SSI2 RX & TX) and SSI2 interrupt - asynchronous
+ *      SPI transfers
  */
 #include "hwconfig.h"
 
@@ -25,10 +28,20 @@ extern "C"
 {
 #endif
 
+/**     Serial bus clock presets in Hz. SAFE is used while loading & verifying
+ *      DMP firmware, FAST (max. for ICM20948 SPI) for streaming data. I2C
+ *      variant runs at 400kHz for anything above 100kHz       */
+#define HAL_MPU_BUS_SPEED_SAFE      1000000
+#define HAL_MPU_BUS_SPEED_FAST      7000000
+
 /**     MPU9250 - related HW API       */
     extern void     HAL_MPU_Init();
+    extern void     HAL_MPU_SetBusSpeed(uint32_t speed);
+    extern uint32_t HAL_MPU_GetBusSpeed();
     extern void     HAL_MPU_PowerSwitch(bool powerState);
     extern bool     HAL_MPU_DataAvail();
+    extern void     HAL_MPU_IntRegister(void((*custHook)(void)));
+    extern void     HAL_MPU_IntEnable(bool enable);
 
     extern void     HAL_MPU_WriteByte(uint8_t I2Caddress, uint8_t regAddress,
                                       uint8_t data);
@@ -39,6 +52,14 @@ extern "C"
     extern int      HAL_MPU_ReadBytes(void * context, uint8_t regAddress,
                                       uint8_t* data, uint32_t length);
 
+    extern int      HAL_MPU_WriteBytesAsync(uint8_t regAddress,
+                                            const uint8_t *data, uint32_t length,
+                                            void((*doneHook)(void)));
+    extern int      HAL_MPU_ReadBytesAsync(uint8_t regAddress, uint8_t* data,
+                                           uint32_t length,
+                                           void((*doneHook)(void)));
+    extern bool     HAL_MPU_TransferBusy();
+
 #ifdef __cplusplus
 }
 #endif
@@ -15,8 +15,11 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-//  Define platform in use in hal.h
+//  Define platform in use in hal.h. Host simulator (HAL/host) is selected by
+//  building with -D__BOARD_HOST_SIM__ instead
+#ifndef __BOARD_HOST_SIM__
 #define __BOARD_TM4C1294NCPDT__
+#endif
 
 /*
  * Compile all libraries in debug mode, allowing them to print debug data to
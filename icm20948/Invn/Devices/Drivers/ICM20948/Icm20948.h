@@ -38,6 +38,7 @@
 #include "Icm20948Setup.h"
 #include "Icm20948Serif.h"
 #include "Icm20948Transport.h"
+#include "Icm20948LoadFirmware.h"
 #include "Icm20948DataConverter.h"
 #include "Icm20948AuxCompassAkm.h"
 #include "Icm20948SelfTest.h"
@@ -67,6 +68,19 @@ typedef struct sensor_type_icm20948{
 	uint64_t odr_us;
 }sensor_type_icm20948_t;
 
+/** @brief Estimate of the actual sample period of a streamed sensor
+ *  Sensor clock drifts away from its nominal rate, so period and phase of the samples are tracked
+ *  from the data-ready interrupts (alpha-beta filter), all times are in us with 16 fractional bits
+ */
+typedef struct inv_icm20948_odr_est{
+	uint64_t last_q16;		// estimated time of the last sample handed out
+	uint64_t period_q16;	// estimated sample period
+	uint64_t nominal_q16;	// period set by DMP divider, corrected for PLL, estimate was seeded with
+	uint64_t irq_us;		// interrupt time of the last update, 0 if estimate has to be (re)started
+	uint32_t updates;		// number of interrupts that updated the period since it was seeded
+	uint32_t resyncs;		// number of interrupts too far off the prediction, phase was reset on them
+}inv_icm20948_odr_est_t;
+
 typedef enum {
 	CHIP_LOW_NOISE_ICM20948,
 	CHIP_LOW_POWER_ICM20948,
@@ -89,6 +103,9 @@ typedef struct inv_icm20948 {
 		unsigned char accel_averaging;
 		uint8_t gyro_fullscale; 
 		uint8_t accel_fullscale;
+		float gyro_raw_scale;   /* raw gyro from FIFO (Q15 of fullscale) to dps, updated with gyro_fullscale */
+		uint8_t gyro_q20_shift; /* shift of raw gyro from Q15 of fullscale to Q20 of 2000dps */
+		float accel_scale;      /* accel from FIFO (Q30 of fullscale) to g, updated with accel_fullscale */
 		uint8_t lp_en_support:1;
 		uint8_t firmware_loaded:1;
 		uint8_t serial_interface;
@@ -126,12 +143,16 @@ typedef struct inv_icm20948 {
 	{
 		int fifoError;
 		unsigned char fifo_overflow;
+		/* optional tap on raw bytes read from FIFO, see inv_icm20948_fifo_set_capture() */
+		void (*capture)(void * context, const unsigned char * data, uint_fast16_t len);
+		void * capture_context;
 	} fifo_info;
 	/* interface mapping */
 	unsigned long sStepCounterToBeSubtracted;
 	unsigned long sOldSteps;
 	/* data converter */
 	long s_quat_chip_to_body[4];
+	float s_mat_chip_to_body[INV_ICM20948_BODY_MAX][9]; /* s_quat_chip_to_body as row-major matrix, scaled for each output */
 	/* base driver */
 	uint8_t sAllowLpEn;
 	uint8_t s_compass_available;
@@ -170,13 +191,20 @@ typedef struct inv_icm20948 {
 	long soft_iron_matrix[9];
 	uint8_t skip_sample[INV_ICM20948_SENSOR_MAX+1];
 	uint64_t timestamp[INV_ICM20948_SENSOR_MAX+1];
+	uint64_t irq_time_us; // time of the data-ready edge serviced by next poll, 0 to take current time
 	uint8_t sFirstBatch[INV_ICM20948_SENSOR_MAX+1];
 	sensor_type_icm20948_t sensorlist[INV_ICM20948_SENSOR_MAX+1];
+	inv_icm20948_odr_est_t odr_est[INV_ICM20948_SENSOR_MAX+1];
 	unsigned short saved_count;
 	/* Icm20948Transport*/
 	unsigned char reg;
 	unsigned char lastBank;
 	unsigned char lLastBankSelected;
+	struct inv_icm20948_bus_stats bus_stats;
+	struct inv_icm20948_reg_shadow reg_shadow;
+	unsigned char xfer_depth;
+	/* Icm20948LoadFirmware */
+	struct inv_icm20948_fw_load fw_load;
 	/* augmented sensors*/
 	unsigned short sGravityOdrMs;
 	unsigned short sGrvOdrMs;
@@ -443,6 +443,31 @@ uint32_t inv_icm20948_get_odr_in_units(struct inv_icm20948 * s, unsigned short o
 
 	return odr;
 }
+
+/*
+ Same as inv_icm20948_get_odr_in_units(s, odrInDivider, ODR_IN_Us), but in us
+ with 16 fractional bits, so that the part of a period below 1us isn't lost
+ (e.g. 4444.44us at 225Hz).
+*/
+uint64_t inv_icm20948_get_odr_in_us_q16(struct inv_icm20948 * s, unsigned short odrInDivider)
+{
+	uint64_t UsQ16;
+	unsigned char PLL=0, gyro_is_on=0;
+
+	if(s->base_state.timebase_correction_pll == 0)
+		inv_icm20948_read_mems_reg(s, REG_TIMEBASE_CORRECTION_PLL, 1, &s->base_state.timebase_correction_pll);
+
+	PLL = s->base_state.timebase_correction_pll;
+	gyro_is_on = inv_is_gyro_enabled(s);
+
+	UsQ16 = ((uint64_t)odrInDivider * 1000000ULL << 16) / 1125ULL * 1270ULL;
+	if( PLL < 0x80 ) // correction positive
+		UsQ16 /= (1270ULL + (gyro_is_on ? PLL : 0));
+	else
+		UsQ16 /= (1270ULL - (gyro_is_on ? (PLL & 0x7F) : 0));
+
+	return UsQ16;
+}
  
 /**
 * Sets the DMP for a particular gyro configuration.
@@ -497,6 +522,9 @@ int inv_icm20948_set_gyro_fullscale(struct inv_icm20948 * s, int level)
 {
 	int result;
 	s->base_state.gyro_fullscale = level;
+	s->base_state.gyro_raw_scale = (1 << level) * 250.f / (1L<<15);
+	s->base_state.gyro_q20_shift = 5 - (MPU_FS_2000dps - level);
+	inv_icm20948_convert_update_body_matrix(s);
 	result = inv_icm20948_set_icm20948_gyro_fullscale(s, level);
 	result |= inv_icm20948_set_gyro_sf(s, s->base_state.gyro_div, level);
 	result |= dmp_icm20948_set_gyro_fsr(s, 250<<level);
@@ -574,6 +602,8 @@ int inv_icm20948_set_accel_fullscale(struct inv_icm20948 * s, int level)
 {
 	int result;
 	s->base_state.accel_fullscale = level;
+	s->base_state.accel_scale = (1 << level) * 2.f / (1L<<30);
+	inv_icm20948_convert_update_body_matrix(s);
 	result = inv_icm20948_set_icm20948_accel_fullscale(s, level);
 	result |= dmp_icm20948_set_accel_fsr(s, 2<<level);
 	result |= dmp_icm20948_set_accel_scale2(s, 2<<level);
@@ -115,6 +115,12 @@ unsigned char INV_EXPORT inv_icm20948_get_gyro_divider(struct inv_icm20948 * s);
 */
 uint32_t INV_EXPORT inv_icm20948_get_odr_in_units(struct inv_icm20948 * s, unsigned short odrInDivider, unsigned char odr_units );
 
+/** @brief Returns the real odr in Micro Seconds, with 16 fractional bits
+* @param[in] odrInDivider 	Odr In divider 
+* @return Odr in us, Q16.
+*/
+uint64_t INV_EXPORT inv_icm20948_get_odr_in_us_q16(struct inv_icm20948 * s, unsigned short odrInDivider);
+
 /** @brief Sets the accel sample rate
 * @param[in] div 		Value written to ACCEL_SMPLRT_DIV register
 * @return 				0 on success, negative value on error.
@@ -75,6 +75,39 @@ void inv_icm20948_convert_quat_rotate_fxp(const long *quat_q30, const long *in,
 void inv_icm20948_set_chip_to_body(struct inv_icm20948 * s, long *quat)
 {
     memcpy(s->s_quat_chip_to_body, quat, sizeof(s->s_quat_chip_to_body));
+    inv_icm20948_convert_update_body_matrix(s);
+}
+
+/** Build rotation matrix equivalent to q*v*q' done by inv_icm20948_convert_quat_rotate_fxp,
+* one for each DMP output, with scale of that output folded in
+*/
+void inv_icm20948_convert_update_body_matrix(struct inv_icm20948 * s)
+{
+    const float w = s->s_quat_chip_to_body[0] * INV_TWO_POWER_NEG_30;
+    const float x = s->s_quat_chip_to_body[1] * INV_TWO_POWER_NEG_30;
+    const float y = s->s_quat_chip_to_body[2] * INV_TWO_POWER_NEG_30;
+    const float z = s->s_quat_chip_to_body[3] * INV_TWO_POWER_NEG_30;
+    float rot[9], scale[INV_ICM20948_BODY_MAX];
+    int i, j;
+
+    rot[0] = w*w + x*x - y*y - z*z;
+    rot[1] = 2.f * (x*y - w*z);
+    rot[2] = 2.f * (x*z + w*y);
+    rot[3] = 2.f * (x*y + w*z);
+    rot[4] = w*w - x*x + y*y - z*z;
+    rot[5] = 2.f * (y*z - w*x);
+    rot[6] = 2.f * (x*z - w*y);
+    rot[7] = 2.f * (y*z + w*x);
+    rot[8] = w*w - x*x - y*y + z*z;
+
+    scale[INV_ICM20948_BODY_GYRO_RAW] = s->base_state.gyro_raw_scale;
+    scale[INV_ICM20948_BODY_GYRO] = 2000.f / (1L<<20);
+    scale[INV_ICM20948_BODY_ACCEL] = s->base_state.accel_scale;
+    scale[INV_ICM20948_BODY_COMPASS] = 1.f / (1L<<16);
+
+    for (i = 0; i < INV_ICM20948_BODY_MAX; i++)
+        for (j = 0; j < 9; j++)
+            s->s_mat_chip_to_body[i][j] = rot[j] * scale[i];
 }
 
 /** Convert fixed point DMP rotation vector to floating point android notation
@@ -176,6 +209,37 @@ void inv_icm20948_convert_dmp3_to_body(struct inv_icm20948 * s, const long *vec3
     values[2] = out[2] * scale;
 }
 
+void inv_icm20948_convert_dmp3_to_body_flt(struct inv_icm20948 * s, enum inv_icm20948_body_output output, const long *vec3, float *values)
+{
+    const float *m = s->s_mat_chip_to_body[output];
+    const float v0 = (float)vec3[0], v1 = (float)vec3[1], v2 = (float)vec3[2];
+
+    values[0] = m[0]*v0 + m[1]*v1 + m[2]*v2;
+    values[1] = m[3]*v0 + m[4]*v1 + m[5]*v2;
+    values[2] = m[6]*v0 + m[7]*v1 + m[8]*v2;
+}
+
+void inv_icm20948_convert_dmp3_to_body_soa(struct inv_icm20948 * s, enum inv_icm20948_body_output output, float gain,
+	const int32_t * restrict x, const int32_t * restrict y, const int32_t * restrict z, uint_fast16_t n,
+	float * restrict bx, float * restrict by, float * restrict bz)
+{
+    const float *mat = s->s_mat_chip_to_body[output];
+    float m[9];
+    uint_fast16_t i;
+
+    // Gain is folded in the matrix once, it is a power of two in practice so result matches per-vector conversion
+    for (i = 0; i < 9; i++)
+        m[i] = mat[i] * gain;
+
+    for (i = 0; i < n; i++) {
+        const float v0 = (float)x[i], v1 = (float)y[i], v2 = (float)z[i];
+
+        bx[i] = m[0]*v0 + m[1]*v1 + m[2]*v2;
+        by[i] = m[3]*v0 + m[4]*v1 + m[5]*v2;
+        bz[i] = m[6]*v0 + m[7]*v1 + m[8]*v2;
+    }
+}
+
 /** Converts a 32-bit long to a little endian byte stream */
 unsigned char *inv_icm20948_int32_to_little8(long x, unsigned char *little8)
 {
@@ -848,6 +912,53 @@ long inv_icm20948_math_atan2_q15_fxp(long y_q15, long x_q15)
     return angle;
 }
 
+/** Body of inv_icm20948_math_atan2f_fast, shared with array version so that it can be inlined in its loop */
+static inline float math_atan2f_fast(float y, float x)
+{
+    static const float A7[4] = {0.999133448222780f, -0.320533292381664f, 0.144982490144465f, -0.038254464970299f};
+    const float absx = fabsf(x), absy = fabsf(y);
+    const float maxABS = fmaxf(absx, absy);
+    float tmp, tmp2, Z;
+
+    // (0, pi/4]: tmp = abs(y)/abs(x), (pi/4, pi/2): tmp = abs(x)/abs(y)
+    tmp = (maxABS > 0.f) ? fminf(absx, absy) / maxABS : 0.f;
+    tmp2 = tmp * tmp;
+    Z = (((A7[3] * tmp2 + A7[2]) * tmp2 + A7[1]) * tmp2 + A7[0]) * tmp;
+
+    Z = (absx < absy) ? 1.57079633f - Z : Z;
+    Z = (x < 0.f) ? 3.14159265f - Z : Z;    // second and third quadrant
+    return copysignf(Z, y);
+}
+
+float inv_icm20948_math_atan2f_fast(float y, float x)
+{
+    return math_atan2f_fast(y, x);
+}
+
+float inv_icm20948_math_asinf_fast(float x)
+{
+    x = fmaxf(-1.f, fminf(x, 1.f));
+    return math_atan2f_fast(x, sqrtf(1.f - x * x));
+}
+
+void inv_icm20948_math_atan2f_fast_array(const float *y, const float *x, uint_fast16_t n, float *out)
+{
+    uint_fast16_t i;
+
+    for (i = 0; i < n; i++)
+        out[i] = math_atan2f_fast(y[i], x[i]);
+}
+
+void inv_icm20948_math_asinf_fast_array(const float *x, uint_fast16_t n, float *out)
+{
+    uint_fast16_t i;
+
+    for (i = 0; i < n; i++) {
+        const float s = fmaxf(-1.f, fminf(x[i], 1.f));
+        out[i] = math_atan2f_fast(s, sqrtf(1.f - s * s));
+    }
+}
+
 uint8_t *inv_icm20948_convert_int16_to_big8(int16_t x, uint8_t *big8)
 {
     big8[0] = (uint8_t)((x >> 8) & 0xff);
@@ -30,6 +30,15 @@ struct inv_icm20948;
 //#endif
 #define INV_TWO_POWER_NEG_30 9.313225746154785e-010f
 
+/** @brief DMP outputs converted to body frame through a cached float matrix, each with its scale folded in */
+enum inv_icm20948_body_output {
+	INV_ICM20948_BODY_GYRO_RAW = 0, /* raw gyro, Q15 of gyro fullscale, to dps */
+	INV_ICM20948_BODY_GYRO,         /* calibrated gyro and gyro bias, Q20 of 2000dps, to dps */
+	INV_ICM20948_BODY_ACCEL,        /* calibrated accel, Q30 of accel fullscale, to g */
+	INV_ICM20948_BODY_COMPASS,      /* compass, Q16 in uT, to uT */
+	INV_ICM20948_BODY_MAX
+};
+
 #define ABS(x) (((x)>=0)?(x):-(x)) /*!< Computes the absolute value of its argument \a x. \ingroup invn_macro */
 #define MAX(x,y) (((x)>(y))?(x):(y)) /*!< Computes the maximum of \a x and \a y. \ingroup invn_macro*/
 #define MIN(x,y) (((x)<(y))?(x):(y)) /*!< Computes the minimum of \a x and \a y. \ingroup invn_macro */
@@ -80,6 +89,30 @@ void INV_EXPORT inv_icm20948_convert_rotation_vector_3(const long *quat4_world,
 */
 void INV_EXPORT inv_icm20948_convert_dmp3_to_body(struct inv_icm20948 * s, const long *vec3, float scale, float *values);
 
+/** @brief Rebuilds float chip to body matrices from s_quat_chip_to_body and scales in base_state
+* Called whenever chip to body quaternion or fullscale range changes
+*/
+void INV_EXPORT inv_icm20948_convert_update_body_matrix(struct inv_icm20948 * s);
+
+/** @brief Converts DMP vector to body frame in android units, through cached float matrix
+* Same as inv_icm20948_convert_dmp3_to_body with the scale of given output, but a single matrix-vector multiply
+* @param[in] output which of the DMP outputs is converted, defines the scale
+* @param[in] vec3 vector of the DMP
+* @param[out] values in Android format
+*/
+void INV_EXPORT inv_icm20948_convert_dmp3_to_body_flt(struct inv_icm20948 * s, enum inv_icm20948_body_output output, const long *vec3, float *values);
+
+/** @brief Converts n DMP vectors to body frame in android units, each axis held in its own array
+* Same as inv_icm20948_convert_dmp3_to_body_flt for every vector, laid out so that compiler can vectorize the loop
+* @param[in] output which of the DMP outputs is converted, defines the scale
+* @param[in] gain extra factor applied on input, e.g. 1<<15 for accel samples kept on 16 bits
+* @param[in] x,y,z axes of DMP vectors
+* @param[in] n number of vectors
+* @param[out] bx,by,bz axes of vectors in Android format, can't overlap inputs
+*/
+void INV_EXPORT inv_icm20948_convert_dmp3_to_body_soa(struct inv_icm20948 * s, enum inv_icm20948_body_output output, float gain,
+	const int32_t *x, const int32_t *y, const int32_t *z, uint_fast16_t n, float *bx, float *by, float *bz);
+
 /** @brief Converts the data in android quaternion values
 * @param[in] accel_gyro_matrix 	vector of the DMP 
 * @param[out] angle 			angle calculated
@@ -251,6 +284,40 @@ This code depends on: \ref reciprocal_fun_q15 , \ref inverse_sqrt_q15 , \ref inv
 */
 long INV_EXPORT inv_icm20948_math_atan2_q15_fxp(long y_q15, long x_q15);
 
+/** \brief Float counterpart of inv_icm20948_math_atan2_q15_fxp, same seventh order Chebychev polynomial.
+ \details No scaling is needed in float, so the error is the one of the polynomial alone: max 0.0053 degrees (9.2e-5 rad)
+ through entire range, against 0.02 degrees for fixed point. Written without branches, one division and 4 multiply-adds.
+* @param [in] y first operand of atan2(y, x)
+* @param [in] x second operand of atan2(y, x)
+* @return output angle in radians, in [-pi, pi], 0 if both operands are 0
+* \ingroup GeometryFlt
+*/
+float INV_EXPORT inv_icm20948_math_atan2f_fast(float y, float x);
+
+/** \brief Arcsine through inv_icm20948_math_atan2f_fast, asin(x) = atan2(x, sqrt(1 - x^2)), same max error.
+* @param [in] x operand, clamped to [-1, 1]
+* @return output angle in radians, in [-pi/2, pi/2]
+* \ingroup GeometryFlt
+*/
+float INV_EXPORT inv_icm20948_math_asinf_fast(float x);
+
+/** \brief inv_icm20948_math_atan2f_fast over arrays, out[i] = atan2(y[i], x[i]). Loop can be vectorized by compiler.
+* @param [in] y first operands
+* @param [in] x second operands
+* @param [in] n number of elements
+* @param [out] out output angles in radians, may be the same array as x or y
+* \ingroup GeometryFlt
+*/
+void INV_EXPORT inv_icm20948_math_atan2f_fast_array(const float *y, const float *x, uint_fast16_t n, float *out);
+
+/** \brief inv_icm20948_math_asinf_fast over arrays, out[i] = asin(x[i]).
+* @param [in] x operands
+* @param [in] n number of elements
+* @param [out] out output angles in radians, may be the same array as x
+* \ingroup GeometryFlt
+*/
+void INV_EXPORT inv_icm20948_math_asinf_fast_array(const float *x, uint_fast16_t n, float *out);
+
 /** 
  * \brief Converts a 16-bit short to a big endian byte stream 
  * \param [in] x operand 
@@ -14,64 +14,178 @@
 #include "Icm20948LoadFirmware.h"
 #include "Icm20948Defs.h"
 #include "Icm20948DataBaseDriver.h"
+#include "Icm20948Dmp3Driver.h"
+
+/* DMP memory is addressed in 256-byte banks, a single burst can't cross a bank */
+#define FW_BANK_SIZE	256
+
+/* CRC-32 (reflected, poly 0xEDB88320) lookup table for 4-bit nibbles */
+static const uint32_t fw_crc_table[16] = {
+	0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+	0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+	0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+	0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+uint32_t inv_icm20948_firmware_crc(uint32_t crc, const unsigned char *data, unsigned int len)
+{
+	crc = ~crc;
+	while (len--) {
+		crc ^= *data++;
+		crc = (crc >> 4) ^ fw_crc_table[crc & 0x0F];
+		crc = (crc >> 4) ^ fw_crc_table[crc & 0x0F];
+	}
+	return ~crc;
+}
+
+void inv_icm20948_firmware_set_verify(struct inv_icm20948 * s, enum inv_icm20948_fw_verify mode, uint32_t image_crc)
+{
+	s->fw_load.verify_mode = (uint8_t)mode;
+	s->fw_load.image_crc = image_crc;
+}
+
+void inv_icm20948_firmware_get_load_info(struct inv_icm20948 * s, struct inv_icm20948_fw_load * info)
+{
+	*info = s->fw_load;
+}
+
+/* Largest burst starting at memaddr that stays within one DMP memory bank */
+static unsigned int fw_chunk_size(unsigned short memaddr, unsigned int size, unsigned int max_size)
+{
+	unsigned int chunk = FW_BANK_SIZE - (memaddr & (FW_BANK_SIZE - 1));
+
+	if (chunk > max_size)
+		chunk = max_size;
+	if (chunk > size)
+		chunk = size;
+	return chunk;
+}
+
+/* CRC-32 of size bytes of DMP memory starting at memaddr, read in bank-sized bursts */
+static int fw_memory_crc(struct inv_icm20948 * s, unsigned short memaddr, unsigned int size, uint32_t *crc)
+{
+	static unsigned char data_rd[FW_BANK_SIZE];
+	unsigned int max_read = min(inv_icm20948_get_max_read(s), FW_BANK_SIZE);
+	unsigned int chunk_size;
+	int result;
+
+	*crc = 0;
+	while (size > 0) {
+		chunk_size = fw_chunk_size(memaddr, size, max_read);
+		result = inv_icm20948_read_mems(s, memaddr, chunk_size, data_rd);
+		if (result)
+			return result;
+		*crc = inv_icm20948_firmware_crc(*crc, data_rd, chunk_size);
+		size -= chunk_size;
+		memaddr += chunk_size;
+	}
+	return 0;
+}
+
+int inv_icm20948_firmware_probe(struct inv_icm20948 * s, const unsigned char *data, unsigned short size, unsigned short load_addr)
+{
+	unsigned char start_rd[2];
+	unsigned short start_addr, code_offset;
+	uint32_t crc;
+	int result, intact = 0;
+
+	// Program start address is set only after successful load
+	inv_icm20948_get_dmp_start_address(s, &start_addr);
+	if ((start_addr < load_addr) || (start_addr - load_addr >= size))
+		return 0;
+	code_offset = start_addr - load_addr;
+
+	// Chip kept power across MCU reset and may be left in any register bank, don't trust transport caches
+	inv_icm20948_transport_init(s);
+	inv_icm20948_transport_begin(s);
+	result = inv_icm20948_read_mems_reg(s, REG_PRGM_START_ADDRH, 2, start_rd);
+	if ((result == 0) && ((((unsigned short)start_rd[0] << 8) | start_rd[1]) == start_addr)) {
+		result = fw_memory_crc(s, start_addr, size - code_offset, &crc);
+		intact = (crc == inv_icm20948_firmware_crc(0, data + code_offset, size - code_offset));
+	}
+	result |= inv_icm20948_transport_end(s);
+
+	if (result)
+		return result;
+	if (!intact)
+		return 0;
+
+	s->fw_load.keep_loaded = 1;
+	return 1;
+}
 
 int inv_icm20948_firmware_load(struct inv_icm20948 * s, const unsigned char *data_start, unsigned short size_start, unsigned short load_addr)
 { 
-    int write_size;
+    unsigned int chunk_size;
     int result;
     unsigned short memaddr;
     const unsigned char *data;
     unsigned short size;
-    unsigned char data_cmp[INV_MAX_SERIAL_READ];
-    int flag = 0;
+    static unsigned char data_cmp[FW_BANK_SIZE];
+    unsigned int max_write = min(inv_icm20948_get_max_write(s), FW_BANK_SIZE);
+    unsigned int max_read = min(inv_icm20948_get_max_read(s), FW_BANK_SIZE);
+    uint32_t crc = 0;
+    uint64_t t_start;
 
 	if(s->base_state.firmware_loaded)
 		return 0;
+
+	if(s->fw_load.keep_loaded) {
+		s->fw_load.write_time_us = 0;
+		s->fw_load.verify_time_us = 0;
+		s->fw_load.bytes_written = 0;
+		return 0;
+	}
 		
-    // Write DMP memory
+    // Write DMP memory in bank-sized bursts
+    t_start = inv_icm20948_get_time_us();
     data = data_start;
     size = size_start;
     memaddr = load_addr;
     while (size > 0) {
-        write_size = min(size, INV_MAX_SERIAL_WRITE);
-        if ((memaddr & 0xff) + write_size > 0x100) {
-            // Moved across a bank
-            write_size = (memaddr & 0xff) + write_size - 0x100;
-        }
-        result = inv_icm20948_write_mems(s, memaddr, write_size, (unsigned char *)data);
+        chunk_size = fw_chunk_size(memaddr, size, max_write);
+        result = inv_icm20948_write_mems(s, memaddr, chunk_size, data);
         if (result)  
             return result;
-        data += write_size;
-        size -= write_size;
-        memaddr += write_size;
+        data += chunk_size;
+        size -= chunk_size;
+        memaddr += chunk_size;
     }
+    s->fw_load.write_time_us = (uint32_t)(inv_icm20948_get_time_us() - t_start);
+    s->fw_load.bytes_written = size_start;
 
     // Verify DMP memory
+    t_start = inv_icm20948_get_time_us();
+    s->fw_load.verify_time_us = 0;
+    if (s->fw_load.verify_mode == INV_ICM20948_FW_VERIFY_NONE)
+        return 0;
 
-    data = data_start;
-    size = size_start;
-    memaddr = load_addr;
-    while (size > 0) {
-        write_size = min(size, INV_MAX_SERIAL_READ);
-        if ((memaddr & 0xff) + write_size > 0x100) {
-            // Moved across a bank
-            write_size = (memaddr & 0xff) + write_size - 0x100;
-        }
-        result = inv_icm20948_read_mems(s, memaddr, write_size, data_cmp);
+    if (s->fw_load.verify_mode == INV_ICM20948_FW_VERIFY_CRC) {
+        result = fw_memory_crc(s, load_addr, size_start, &crc);
         if (result)
-            flag++; // Error, DMP not written correctly
-        if (memcmp(data_cmp, data, write_size))
+            return result; // Error, DMP not read correctly
+        if (s->fw_load.image_crc == 0)
+            s->fw_load.image_crc = inv_icm20948_firmware_crc(0, data_start, size_start);
+        if (crc != s->fw_load.image_crc)
             return -1;
-        data += write_size;
-        size -= write_size;
-        memaddr += write_size;
     }
-
-#if defined(WIN32)   
-    //if(!flag)
-      // inv_log("DMP Firmware was updated successfully..\r\n");
-#endif
+    else {
+        data = data_start;
+        size = size_start;
+        memaddr = load_addr;
+        while (size > 0) {
+            chunk_size = fw_chunk_size(memaddr, size, max_read);
+            result = inv_icm20948_read_mems(s, memaddr, chunk_size, data_cmp);
+            if (result)
+                return result; // Error, DMP not read correctly
+            if (memcmp(data_cmp, data, chunk_size))
+                return -1;
+            data += chunk_size;
+            size -= chunk_size;
+            memaddr += chunk_size;
+        }
+    }
+    s->fw_load.verify_time_us = (uint32_t)(inv_icm20948_get_time_us() - t_start);
 
     return 0;
 }
-
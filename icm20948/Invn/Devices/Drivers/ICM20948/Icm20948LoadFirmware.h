@@ -22,9 +22,30 @@ extern "C"
 {
 #endif
 
+#include <stdint.h>
+
 /* forward declaration */
 struct inv_icm20948;
 
+/** @brief How firmware is checked after being written to DMP memory
+*/
+enum inv_icm20948_fw_verify {
+	INV_ICM20948_FW_VERIFY_MEMCMP = 0, /**< read back and compare against image (default) */
+	INV_ICM20948_FW_VERIFY_CRC,        /**< read back and compare CRC-32 against image CRC */
+	INV_ICM20948_FW_VERIFY_NONE,       /**< skip read back */
+};
+
+/** @brief Firmware loading configuration and timing of the last load
+*/
+struct inv_icm20948_fw_load {
+	uint8_t  verify_mode;    /**< one of inv_icm20948_fw_verify */
+	uint32_t image_crc;      /**< expected CRC-32 of the image, 0 to compute it on load */
+	uint32_t write_time_us;  /**< time spent writing the image */
+	uint32_t verify_time_us; /**< time spent reading back and checking the image */
+	uint32_t bytes_written;  /**< image bytes written to DMP memory */
+	uint8_t  keep_loaded;    /**< image found intact in DMP memory, skip next load */
+};
+
 /** @brief Loads the DMP firmware from SRAM
 * @param[in] data  pointer where the image 
 * @param[in] size  size if the image
@@ -33,6 +54,40 @@ struct inv_icm20948;
 */
 int INV_EXPORT inv_icm20948_firmware_load(struct inv_icm20948 * s, const unsigned char *data, unsigned short size, unsigned short load_addr);
 
+/** @brief Check whether DMP memory still holds the image from a previous load
+* Compares program start address register against the one used by the driver and
+* CRC-32 of DMP program memory (from program start address to the end of the image)
+* against the image. Data area below program start is not checked as it is
+* rewritten during configuration. If image is intact, next call to
+* inv_icm20948_firmware_load() is skipped. Cached register bank and shadowed
+* registers are reset first, chip state is not known when probing.
+* @param[in] data  pointer where the image
+* @param[in] size  size if the image
+* @param[in] load_addr  address image was loaded to
+* @return 1 if image is intact, 0 if not, negative value on bus error
+*/
+int INV_EXPORT inv_icm20948_firmware_probe(struct inv_icm20948 * s, const unsigned char *data, unsigned short size, unsigned short load_addr);
+
+/** @brief Select how the firmware is verified on next load
+* @param[in] mode  one of inv_icm20948_fw_verify
+* @param[in] image_crc  CRC-32 of the image as returned by inv_icm20948_firmware_crc(),
+*                       0 to have it computed from the image on load (used for CRC mode only)
+*/
+void INV_EXPORT inv_icm20948_firmware_set_verify(struct inv_icm20948 * s, enum inv_icm20948_fw_verify mode, uint32_t image_crc);
+
+/** @brief Returns configuration and timing of the last firmware load
+* @param[out] info  copy of firmware load information
+*/
+void INV_EXPORT inv_icm20948_firmware_get_load_info(struct inv_icm20948 * s, struct inv_icm20948_fw_load * info);
+
+/** @brief Update CRC-32 (IEEE 802.3, same as zlib crc32) with a block of data
+* @param[in] crc   CRC of previous blocks, 0 for the first one
+* @param[in] data  pointer to data
+* @param[in] len   number of bytes
+* @return updated CRC
+*/
+uint32_t INV_EXPORT inv_icm20948_firmware_crc(uint32_t crc, const unsigned char *data, unsigned int len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,8 +19,24 @@
 
 #include "Icm20948AuxCompassAkm.h"
 
+#include "../../../EmbUtils/dataconverter.h"
+
 struct inv_fifo_decoded_t fd;
 
+/** Largest packet DMP can push in FIFO, with every header and header2 bit set */
+#define FIFO_MAX_PACKET_SZ	128
+
+/** Software FIFO, mirror of DMP HW FIFO, hence of max HARDWARE_FIFO_SIZE.
+* Used as a ring: consumed packets only move fifo_rd forward, so bytes are never compacted.
+*/
+static unsigned char fifo_data[HARDWARE_FIFO_SIZE];
+/** Index in fifo_data of the oldest byte not yet parsed, write index is fifo_rd + bytes present in SW FIFO */
+static uint_fast16_t fifo_rd;
+/** Scratch buffer used to linearize the occasional packet wrapping around the end of fifo_data */
+static unsigned char fifo_wrap[FIFO_MAX_PACKET_SZ];
+/** Bytes copied to fifo_wrap so far, the only bytes of SW FIFO ever moved once read */
+static uint32_t fifo_wrap_bytes;
+
 static void inv_decode_3_16bit_elements(short *out_data, const unsigned char *in_data);
 static void inv_decode_3_32bit_elements(long *out_data, const unsigned char *in_data);
 
@@ -152,10 +168,12 @@ static int dmp_read_fifo(struct inv_icm20948 * s, unsigned char *data, uint_fast
 {
 	int result;
     uint_fast16_t bytesRead = 0;
+    uint32_t maxRead = inv_icm20948_get_max_read(s);
 
+    // Whole FIFO content is read in a single burst when serial interface allows it
     while (bytesRead<len) 
     {
-        unsigned short thisLen = min(INV_MAX_SERIAL_READ, len-bytesRead);
+        unsigned short thisLen = min(maxRead, len-bytesRead);
         
         result = inv_icm20948_read_mems_reg(s, REG_FIFO_R_W, thisLen, &data[bytesRead]);
         if (result)
@@ -165,23 +183,35 @@ static int dmp_read_fifo(struct inv_icm20948 * s, unsigned char *data, uint_fast
 			return result;
 		}
         
+        if (s->fifo_info.capture)
+            s->fifo_info.capture(s->fifo_info.capture_context, &data[bytesRead], thisLen);
+
         bytesRead += thisLen;
     }
 
 	return result;
 }
 
+void inv_icm20948_fifo_set_capture(struct inv_icm20948 * s,
+	void (*capture)(void * context, const unsigned char * data, uint_fast16_t len), void * context)
+{
+	s->fifo_info.capture = 0;
+	s->fifo_info.capture_context = context;
+	s->fifo_info.capture = capture;
+}
+
 /**
 *  @internal
 *  @brief  used to get the FIFO data.
 *  @param  length
-*              Max number of bytes to read from the FIFO that buffer is still able to sustain.
-*  @param  buffer Reads up to length into the buffer.
+*              Max number of bytes to read from the FIFO that SW FIFO is still able to sustain.
+*  @param  wr_idx Index in SW FIFO ring at which first byte read is stored, wraps around at HARDWARE_FIFO_SIZE.
 *
 *  @return number of bytes of read.
 **/
-static uint_fast16_t dmp_get_fifo_all(struct inv_icm20948 * s, uint_fast16_t length, unsigned char *buffer, int *reset)
+static uint_fast16_t dmp_get_fifo_all(struct inv_icm20948 * s, uint_fast16_t length, uint_fast16_t wr_idx, int *reset)
 {
+	uint_fast16_t first;
 	int result;
 	uint_fast16_t in_fifo;
     
@@ -210,7 +240,11 @@ static uint_fast16_t dmp_get_fifo_all(struct inv_icm20948 * s, uint_fast16_t len
 		return 0;
 	}
 
-	result = dmp_read_fifo(s, buffer, in_fifo);
+	/* Read up to the end of the ring, then continue from its start */
+	first = min(in_fifo, HARDWARE_FIFO_SIZE - wr_idx);
+	result = dmp_read_fifo(s, &fifo_data[wr_idx], first);
+	if (!result && (in_fifo > first))
+		result = dmp_read_fifo(s, fifo_data, in_fifo - first);
 	if (result) {
 		s->fifo_info.fifoError = result;
 		return 0;
@@ -221,7 +255,7 @@ static uint_fast16_t dmp_get_fifo_all(struct inv_icm20948 * s, uint_fast16_t len
 /** Determines the packet size by decoding the header. Both header and header2 are set. header2 is set to zero
 *   if it doesn't exist. sample_cnt_array is filled in if not null with number of samples expected for each sensor
 */
-static uint_fast16_t get_packet_size_and_samplecnt(unsigned char *data, unsigned short *header, unsigned short *header2, unsigned short * sample_cnt_array)
+static uint_fast16_t get_packet_size_and_samplecnt(const unsigned char *data, unsigned short *header, unsigned short *header2, unsigned short * sample_cnt_array)
 {
 	int sz = HEADER_SZ; // 2 for header
     
@@ -363,9 +397,46 @@ static int check_fifo_decoded_headers(unsigned short header, unsigned short head
     return 0;
 }
 
-/** Software FIFO, mirror of DMP HW FIFO, hence of max HARDWARE_FIFO_SIZE */
-static unsigned char fifo_data[HARDWARE_FIFO_SIZE];
-    
+/** Return pointer to len contiguous bytes found offset bytes after read index of SW FIFO.
+* Points directly inside the ring unless the bytes wrap around its end, in which case they are copied to fifo_wrap.
+*/
+static const unsigned char * fifo_ring_ptr(uint_fast16_t offset, uint_fast16_t len)
+{
+	uint_fast16_t idx = (fifo_rd + offset) % HARDWARE_FIFO_SIZE;
+	uint_fast16_t first = HARDWARE_FIFO_SIZE - idx;
+
+	if (len <= first)
+		return &fifo_data[idx];
+
+	memcpy(fifo_wrap, &fifo_data[idx], first);
+	memcpy(&fifo_wrap[first], fifo_data, len - first);
+	fifo_wrap_bytes += len;
+	return fifo_wrap;
+}
+
+uint32_t inv_icm20948_fifo_moved_bytes(void)
+{
+	return fifo_wrap_bytes;
+}
+
+/** Drop need_sz bytes at the read index of SW FIFO */
+static void fifo_ring_consume(int need_sz, int *fifo_sw_size)
+{
+	fifo_rd = (fifo_rd + need_sz) % HARDWARE_FIFO_SIZE;
+	*fifo_sw_size -= need_sz;
+}
+
+/** Mirror HW FIFO in free space of SW FIFO ring, *fifo_sw_size bytes being already present in it */
+static void fifo_ring_fill(struct inv_icm20948 * s, int *fifo_sw_size, int *reset)
+{
+	// Restart from beginning of the ring when empty, so that most bursts are read without wrapping
+	if (*fifo_sw_size == 0)
+		fifo_rd = 0;
+
+	*fifo_sw_size += dmp_get_fifo_all(s, (HARDWARE_FIFO_SIZE - *fifo_sw_size),
+			(fifo_rd + *fifo_sw_size) % HARDWARE_FIFO_SIZE, reset);
+}
+
 /** Determine number of samples present in SW FIFO fifo_data containing fifo_size bytes to be analyzed. Total number
 * of samples filled in total_sample_cnt, number of samples per sensor filled in sample_cnt_array array
 */
@@ -377,7 +448,7 @@ static int extract_sample_cnt(struct inv_icm20948 * s, int fifo_size, unsigned s
 	while (fifo_idx < fifo_size) {
 		unsigned short header;
 		unsigned short header2;
-		int need_sz = get_packet_size_and_samplecnt(&fifo_data[fifo_idx], &header, &header2, sample_cnt_array);
+		int need_sz = get_packet_size_and_samplecnt(fifo_ring_ptr(fifo_idx, HEADER_SZ + HEADER2_SZ), &header, &header2, sample_cnt_array);
 		
 		// Guarantee there is a full packet before continuing to decode the FIFO packet
 		if (fifo_size-fifo_idx < need_sz)
@@ -416,7 +487,7 @@ int inv_icm20948_fifo_swmirror(struct inv_icm20948 * s, int *fifo_sw_size, unsig
 
 	// Mirror HW FIFO into local SW FIFO, taking into account remaining *fifo_sw_size bytes still present in SW FIFO
 	if (*fifo_sw_size < HARDWARE_FIFO_SIZE ) {
-		*fifo_sw_size += dmp_get_fifo_all(s, (HARDWARE_FIFO_SIZE - *fifo_sw_size),&fifo_data[*fifo_sw_size],&reset);
+		fifo_ring_fill(s, fifo_sw_size, &reset);
 
 		if (reset)
 			goto error;
@@ -437,17 +508,19 @@ error:
 int inv_icm20948_fifo_pop(struct inv_icm20948 * s, unsigned short *user_header, unsigned short *user_header2, int *fifo_sw_size)  
 {
 	int need_sz=0; // size in bytes of packet to be analyzed from FIFO
-	unsigned char *fifo_ptr = fifo_data; // pointer to next byte in SW FIFO to be parsed
+	const unsigned char *fifo_ptr; // pointer to next byte in SW FIFO to be parsed
     
 	if (*fifo_sw_size > 3) {
 		// extract headers and number of bytes requested by next sample present in FIFO
-		need_sz = get_packet_size_and_samplecnt(fifo_data, &fd.header, &fd.header2, 0);
+		need_sz = get_packet_size_and_samplecnt(fifo_ring_ptr(0, HEADER_SZ + HEADER2_SZ), &fd.header, &fd.header2, 0);
 
 		// Guarantee there is a full packet before continuing to decode the FIFO packet
 		if (*fifo_sw_size < need_sz) {
 		    return s->fifo_info.fifoError;
 		}
 
+		// decode packet in place from the ring
+		fifo_ptr = fifo_ring_ptr(0, need_sz);
 		fifo_ptr += HEADER_SZ;        
 		if (fd.header & HEADER2_SET)
 			fifo_ptr += HEADER2_SZ;        
@@ -456,9 +529,7 @@ int inv_icm20948_fifo_pop(struct inv_icm20948 * s, unsigned short *user_header,
 		fifo_ptr += inv_icm20948_inv_decode_one_ivory_fifo_packet(s, &fd, fifo_ptr);        
 
 		// remove first need_sz bytes from SW FIFO
-		*fifo_sw_size -= need_sz;
-		if(*fifo_sw_size)
-			memmove(fifo_data, &fifo_data[need_sz], *fifo_sw_size);// Data left in FIFO
+		fifo_ring_consume(need_sz, fifo_sw_size);
 
 		*user_header = fd.header;
 		*user_header2 = fd.header2;
@@ -467,12 +538,158 @@ int inv_icm20948_fifo_pop(struct inv_icm20948 * s, unsigned short *user_header,
 	return MPU_SUCCESS;
 }
 
+/** Big endian 16-bit payloads gathered by inv_icm20948_fifo_pop_batch(), before conversion, one array per axis */
+static struct {
+	uint16_t accel[3][INV_FIFO_BATCH_MAX];
+	uint16_t gyro[3][INV_FIFO_BATCH_MAX];
+	uint16_t gyro_bias[3][INV_FIFO_BATCH_MAX];
+	int32_t cpass_calibr[3][INV_FIFO_BATCH_MAX];
+	int32_t conv[3][INV_FIFO_BATCH_MAX];
+} batch_raw;
+
+/** Copy 3 big endian 16-bit elements to index idx of per-axis arrays, bytes are swapped later on whole arrays */
+static void gather_3_16bit_elements(uint16_t dst[3][INV_FIFO_BATCH_MAX], uint_fast16_t idx, const unsigned char *in_data)
+{
+	memcpy(&dst[0][idx], in_data, 2);
+	memcpy(&dst[1][idx], in_data + 2, 2);
+	memcpy(&dst[2][idx], in_data + 4, 2);
+}
+
+/** Copy 3 big endian 32-bit elements to index idx of per-axis arrays, bytes are swapped later on whole arrays */
+static void gather_3_32bit_elements(int32_t dst[3][INV_FIFO_BATCH_MAX], uint_fast16_t idx, const unsigned char *in_data)
+{
+	memcpy(&dst[0][idx], in_data, 4);
+	memcpy(&dst[1][idx], in_data + 4, 4);
+	memcpy(&dst[2][idx], in_data + 8, 4);
+}
+
+/** Byte swap 3 per-axis arrays of n big endian 16-bit elements into batch_raw.conv */
+static void convert_16bit_axes(uint16_t in[3][INV_FIFO_BATCH_MAX], uint_fast16_t n)
+{
+	inv_dc_big16_to_int32_array(in[0], n, batch_raw.conv[0]);
+	inv_dc_big16_to_int32_array(in[1], n, batch_raw.conv[1]);
+	inv_dc_big16_to_int32_array(in[2], n, batch_raw.conv[2]);
+}
+
+/** Byte swap 3 per-axis arrays of n big endian 32-bit elements in place */
+static void convert_32bit_axes(int32_t data[3][INV_FIFO_BATCH_MAX], uint_fast16_t n)
+{
+	inv_dc_big32_to_int32_array((const uint32_t *)data[0], n, data[0]);
+	inv_dc_big32_to_int32_array((const uint32_t *)data[1], n, data[1]);
+	inv_dc_big32_to_int32_array((const uint32_t *)data[2], n, data[2]);
+}
+
+int inv_icm20948_fifo_pop_batch(struct inv_icm20948 * s, struct inv_fifo_batch_t * batch, uint_fast16_t max_packets, int *fifo_sw_size)
+{
+	batch->packets = 0;
+	batch->accel_cnt = batch->gyro_cnt = batch->cpass_cnt = 0;
+	batch->quat6_cnt = batch->quat9_cnt = batch->geomag_cnt = 0;
+
+	if (max_packets > INV_FIFO_BATCH_MAX)
+		max_packets = INV_FIFO_BATCH_MAX;
+
+	// First pass: walk packets and gather payload of each output, same layout as inv_icm20948_inv_decode_one_ivory_fifo_packet()
+	while ((batch->packets < max_packets) && (*fifo_sw_size > 3)) {
+		unsigned short header, header2;
+		const unsigned char *fifo_ptr;
+		int need_sz = get_packet_size_and_samplecnt(fifo_ring_ptr(0, HEADER_SZ + HEADER2_SZ), &header, &header2, 0);
+
+		// Guarantee there is a full packet before continuing to decode the FIFO packet
+		if (*fifo_sw_size < need_sz)
+			break;
+
+		fifo_ptr = fifo_ring_ptr(0, need_sz) + HEADER_SZ;
+		if (header & HEADER2_SET)
+			fifo_ptr += HEADER2_SZ;
+
+		if (header & ACCEL_SET) {
+			gather_3_16bit_elements(batch_raw.accel, batch->accel_cnt++, fifo_ptr);
+			fifo_ptr += ACCEL_DATA_SZ;
+		}
+		if (header & GYRO_SET) {
+			gather_3_16bit_elements(batch_raw.gyro, batch->gyro_cnt, fifo_ptr);
+			fifo_ptr += GYRO_DATA_SZ;
+			gather_3_16bit_elements(batch_raw.gyro_bias, batch->gyro_cnt++, fifo_ptr);
+			fifo_ptr += GYRO_BIAS_DATA_SZ;
+		}
+		if (header & CPASS_SET)
+			fifo_ptr += CPASS_DATA_SZ;
+		if (header & ALS_SET)
+			fifo_ptr += ALS_DATA_SZ;
+		if (header & QUAT6_SET) {
+			gather_3_32bit_elements(batch->quat6, batch->quat6_cnt++, fifo_ptr);
+			fifo_ptr += QUAT6_DATA_SZ;
+		}
+		if (header & QUAT9_SET) {
+			gather_3_32bit_elements(batch->quat9, batch->quat9_cnt++, fifo_ptr);
+			fd.dmp_rv_accuracyQ29 = ((0xff & fifo_ptr[12]) << 24) | ((0xff & fifo_ptr[13]) << 16);
+			fifo_ptr += QUAT9_DATA_SZ;
+		}
+		if (header & PED_STEPDET_SET)
+			fifo_ptr += PED_STEPDET_TIMESTAMP_SZ;
+		if (header & GEOMAG_SET) {
+			gather_3_32bit_elements(batch->geomag, batch->geomag_cnt++, fifo_ptr);
+			fd.dmp_geomag_accuracyQ29 = ((0xff & fifo_ptr[12]) << 24) | ((0xff & fifo_ptr[13]) << 16);
+			fifo_ptr += GEOMAG_DATA_SZ;
+		}
+		if (header & PRESSURE_SET)
+			fifo_ptr += PRESSURE_DATA_SZ;
+		if (header & CPASS_CALIBR_SET) {
+			gather_3_32bit_elements(batch_raw.cpass_calibr, batch->cpass_cnt++, fifo_ptr);
+			fifo_ptr += CPASS_CALIBR_DATA_SZ;
+		}
+		if (header2 & ACCEL_ACCURACY_SET) {
+			fd.accel_accuracy = ((0xff & fifo_ptr[0]) << 8) | (0xff & fifo_ptr[1]);
+			fifo_ptr += ACCEL_ACCURACY_SZ;
+		}
+		if (header2 & GYRO_ACCURACY_SET) {
+			fd.gyro_accuracy = ((0xff & fifo_ptr[0]) << 8) | (0xff & fifo_ptr[1]);
+			fifo_ptr += GYRO_ACCURACY_SZ;
+		}
+		if (header2 & CPASS_ACCURACY_SET)
+			fd.cpass_accuracy = ((0xff & fifo_ptr[0]) << 8) | (0xff & fifo_ptr[1]);
+
+		fifo_ring_consume(need_sz, fifo_sw_size);
+
+		batch->header[batch->packets] = fd.header = header;
+		batch->header2[batch->packets] = fd.header2 = header2;
+		batch->packets++;
+	}
+
+	// Second pass: convert whole arrays at once
+	convert_16bit_axes(batch_raw.accel, batch->accel_cnt);
+	inv_icm20948_convert_dmp3_to_body_soa(s, INV_ICM20948_BODY_ACCEL, (float)(1L << 15),
+			batch_raw.conv[0], batch_raw.conv[1], batch_raw.conv[2], batch->accel_cnt,
+			batch->accel[0], batch->accel[1], batch->accel[2]);
+
+	convert_16bit_axes(batch_raw.gyro, batch->gyro_cnt);
+	inv_icm20948_convert_dmp3_to_body_soa(s, INV_ICM20948_BODY_GYRO_RAW, 1.f,
+			batch_raw.conv[0], batch_raw.conv[1], batch_raw.conv[2], batch->gyro_cnt,
+			batch->gyro_raw[0], batch->gyro_raw[1], batch->gyro_raw[2]);
+
+	convert_16bit_axes(batch_raw.gyro_bias, batch->gyro_cnt);
+	inv_icm20948_convert_dmp3_to_body_soa(s, INV_ICM20948_BODY_GYRO, 1.f,
+			batch_raw.conv[0], batch_raw.conv[1], batch_raw.conv[2], batch->gyro_cnt,
+			batch->gyro_bias[0], batch->gyro_bias[1], batch->gyro_bias[2]);
+
+	convert_32bit_axes(batch_raw.cpass_calibr, batch->cpass_cnt);
+	inv_icm20948_convert_dmp3_to_body_soa(s, INV_ICM20948_BODY_COMPASS, 1.f,
+			batch_raw.cpass_calibr[0], batch_raw.cpass_calibr[1], batch_raw.cpass_calibr[2], batch->cpass_cnt,
+			batch->cpass[0], batch->cpass[1], batch->cpass[2]);
+
+	convert_32bit_axes(batch->quat6, batch->quat6_cnt);
+	convert_32bit_axes(batch->quat9, batch->quat9_cnt);
+	convert_32bit_axes(batch->geomag, batch->geomag_cnt);
+
+	return batch->packets;
+}
+
 int inv_icm20948_dmp_process_fifo(struct inv_icm20948 * s, int *left_in_fifo, unsigned short *user_header, unsigned short *user_header2, long *time_stamp)  
 {
     int result = MPU_SUCCESS;
     int reset=0; 
     int need_sz=0;
-    unsigned char *fifo_ptr = fifo_data;
+    const unsigned char *fifo_ptr;
 
     long long ts=0;
 
@@ -481,7 +698,7 @@ int inv_icm20948_dmp_process_fifo(struct inv_icm20948 * s, int *left_in_fifo, un
     
     if (*left_in_fifo < HARDWARE_FIFO_SIZE ) 
     {
-        *left_in_fifo += dmp_get_fifo_all(s, (HARDWARE_FIFO_SIZE - *left_in_fifo),&fifo_data[*left_in_fifo],&reset);
+        fifo_ring_fill(s, left_in_fifo, &reset);
         //sprintf(test_str, "Left in FIFO: %d\r\n",*left_in_fifo);
         //print_command_console(test_str);
         if (reset) 
@@ -493,7 +710,7 @@ int inv_icm20948_dmp_process_fifo(struct inv_icm20948 * s, int *left_in_fifo, un
     
     if (*left_in_fifo > 3) {
 	// no need to extract number of sample per sensor for current function, so provide 0 as last parameter
-        need_sz = get_packet_size_and_samplecnt(fifo_data, &fd.header, &fd.header2, 0);
+        need_sz = get_packet_size_and_samplecnt(fifo_ring_ptr(0, HEADER_SZ + HEADER2_SZ), &fd.header, &fd.header2, 0);
         
         // Guarantee there is a full packet before continuing to decode the FIFO packet
         if (*left_in_fifo < need_sz) {
@@ -515,6 +732,7 @@ int inv_icm20948_dmp_process_fifo(struct inv_icm20948 * s, int *left_in_fifo, un
             return -1;
         }
         
+        fifo_ptr = fifo_ring_ptr(0, need_sz);
         fifo_ptr += HEADER_SZ;
         
         if (fd.header & HEADER2_SET)
@@ -532,9 +750,7 @@ int inv_icm20948_dmp_process_fifo(struct inv_icm20948 * s, int *left_in_fifo, un
         */
         
         
-        *left_in_fifo -= need_sz;
-        if (*left_in_fifo) 
-            memmove(fifo_data, &fifo_data[need_sz], *left_in_fifo);// Data left in FIFO
+        fifo_ring_consume(need_sz, left_in_fifo);
     }
 
     return result;
@@ -54,6 +54,35 @@ struct inv_fifo_decoded_t
     int new_data;
 };
 
+/** Max number of packets decoded by one call to inv_icm20948_fifo_pop_batch() */
+#define INV_FIFO_BATCH_MAX	32
+
+/** @brief Packets popped from SW FIFO and decoded at once, as a structure of arrays.
+* Samples of each output are kept in the order of the packets carrying them, one array per axis,
+* *_cnt telling how many there are. Vectors are in body frame and Android units, the same values
+* inv_icm20948_poll_sensor() reports; quaternions are left in Q30 chip frame as DMP sends them.
+*/
+struct inv_fifo_batch_t
+{
+	uint_fast16_t packets;
+	unsigned short header[INV_FIFO_BATCH_MAX];
+	unsigned short header2[INV_FIFO_BATCH_MAX];
+
+	uint_fast16_t accel_cnt;
+	float accel[3][INV_FIFO_BATCH_MAX];		/* calibrated accel, in g */
+	uint_fast16_t gyro_cnt;
+	float gyro_raw[3][INV_FIFO_BATCH_MAX];	/* uncalibrated gyro, in dps */
+	float gyro_bias[3][INV_FIFO_BATCH_MAX];	/* gyro bias, in dps */
+	uint_fast16_t cpass_cnt;
+	float cpass[3][INV_FIFO_BATCH_MAX];		/* calibrated compass, in uT */
+	uint_fast16_t quat6_cnt;
+	int32_t quat6[3][INV_FIFO_BATCH_MAX];
+	uint_fast16_t quat9_cnt;
+	int32_t quat9[3][INV_FIFO_BATCH_MAX];
+	uint_fast16_t geomag_cnt;
+	int32_t geomag[3][INV_FIFO_BATCH_MAX];
+};
+
 
 #ifdef __cplusplus
 extern "C"
@@ -66,6 +95,16 @@ extern "C"
 */	
 int INV_EXPORT inv_icm20948_identify_interrupt(struct inv_icm20948 * s, short *int_read);
 
+/** @brief Register a tap on raw FIFO content.
+* Every successful burst read of REG_FIFO_R_W is handed to capture, in the order read,
+* before being decoded. This allows to record DMP output exactly as it came from the chip
+* and to feed it back later through inv_icm20948_poll_sensor().
+* @param[in] capture	function receiving raw bytes, NULL to disable
+* @param[in] context	passed back as first argument of capture
+*/
+void INV_EXPORT inv_icm20948_fifo_set_capture(struct inv_icm20948 * s,
+	void (*capture)(void * context, const unsigned char * data, uint_fast16_t len), void * context);
+
 /** @brief Process the fifo.
 * @param[in] left_in_fifo	pointer for the fifo to be processed
 * @param[in] user_header	pointer for the user header
@@ -207,6 +246,24 @@ int INV_EXPORT inv_icm20948_fifo_swmirror(struct inv_icm20948 * s, int *left_in_
 */	
 int INV_EXPORT inv_icm20948_fifo_pop(struct inv_icm20948 * s, unsigned short *user_header, unsigned short *user_header2, int *left_in_fifo);
 
+/** @brief Number of bytes moved within SW FIFO since start
+* SW FIFO is a ring, bytes are only copied to linearize a packet (or its headers) wrapping around its end.
+* @return 			bytes moved, wraps around at 2^32
+*/
+uint32_t INV_EXPORT inv_icm20948_fifo_moved_bytes(void);
+
+/** @brief Pop up to max_packets samples out of SW FIFO and decode them together
+* First pass walks packet headers and gathers big endian payloads of each output in per-axis arrays,
+* second pass converts every array in one go (byte swap, then int to float through chip to body matrix).
+* Packet contents the batch has no room for (ALS, pressure, pedometer, BAC...) are skipped. Accuracies are
+* still tracked, so inv_icm20948_get_*_accuracy() return the ones of the last packet in batch.
+* @param[out] batch 	decoded packets, overwritten
+* @param[in] max_packets	max number of packets to pop, at most INV_FIFO_BATCH_MAX
+* @param[inout] left_in_fifo 	Contains number of bytes still be parsed from SW FIFO
+* @return 			number of packets decoded, negative value on error.
+*/
+int INV_EXPORT inv_icm20948_fifo_pop_batch(struct inv_icm20948 * s, struct inv_fifo_batch_t * batch, uint_fast16_t max_packets, int *left_in_fifo);
+
 #ifdef __cplusplus
 }
 #endif
@@ -100,7 +100,7 @@ enum inv_icm20948_sensor inv_icm20948_sensor_android_2_sensor_type(int sensor)
 	}
 }
 
-static int skip_sensor(struct inv_icm20948 * s, unsigned char androidSensor)
+int inv_icm20948_skip_sensor(struct inv_icm20948 * s, unsigned char androidSensor)
 {
 	enum inv_icm20948_sensor icm20948_sensor_id = inv_icm20948_sensor_android_2_sensor_type(androidSensor);
 	uint8_t skip_sample = s->skip_sample[icm20948_sensor_id];
@@ -419,8 +419,13 @@ int inv_icm20948_soft_reset(struct inv_icm20948 * s)
 int inv_icm20948_enable_sensor(struct inv_icm20948 * s, enum inv_icm20948_sensor sensor, inv_bool_t state)
 {
 	uint8_t androidSensor = sensor_type_2_android_sensor(sensor);
+	int rc;
 
-	if(0!=inv_icm20948_ctrl_enable_sensor(s, androidSensor, state))
+	/* Group DMP configuration writes so LP_EN is toggled only once */
+	inv_icm20948_transport_begin(s);
+	rc = inv_icm20948_ctrl_enable_sensor(s, androidSensor, state);
+	rc |= inv_icm20948_transport_end(s);
+	if(0!=rc)
 		return -1;
 
 	//In case we disable a sensor, we reset his timestamp
@@ -433,8 +438,13 @@ int inv_icm20948_enable_sensor(struct inv_icm20948 * s, enum inv_icm20948_sensor
 int inv_icm20948_set_sensor_period(struct inv_icm20948 * s, enum inv_icm20948_sensor sensor, uint32_t period)
 {
 	uint8_t androidSensor = sensor_type_2_android_sensor(sensor);
+	int rc;
 
-	if(0!=inv_icm20948_set_odr(s, androidSensor, period))
+	/* Group DMP configuration writes so LP_EN is toggled only once */
+	inv_icm20948_transport_begin(s);
+	rc = inv_icm20948_set_odr(s, androidSensor, period);
+	rc |= inv_icm20948_transport_end(s);
+	if(0!=rc)
 		return -1;
 
 	// reset timestamp value and save current odr
@@ -482,9 +492,104 @@ static int inv_icm20948_is_streamed_sensor(uint8_t id)
 	}
 }
 
+/** @brief Set time at which the interrupt serviced by next inv_icm20948_poll_sensor() was fired
+* Timestamping the data-ready edge when it happens (e.g. in GPIO interrupt) keeps latency of the
+* main loop out of sensor timestamps. Applies to next poll only, which otherwise takes current time.
+* @param[in] irq_time_us	time of the edge in us, as returned by inv_icm20948_get_time_us()
+*/
+void inv_icm20948_set_irq_time(struct inv_icm20948 * s, uint64_t irq_time_us)
+{
+	s->irq_time_us = irq_time_us;
+}
+
+/** @brief Seed period estimate of a sensor from its requested odr, for the DMP divider closest to it
+* (1125Hz divided by an integer) and corrected by the PLL trim of the chip. Period learned so far is kept
+* if odr didn't change, as drift of the clock doesn't depend on which sensors are enabled.
+*/
+static void inv_icm20948_odr_est_seed(struct inv_icm20948 * s, enum inv_icm20948_sensor sensor)
+{
+	inv_icm20948_odr_est_t * est = &s->odr_est[sensor];
+	unsigned short divider = (unsigned short)(s->sensorlist[sensor].odr_us * 1125 / 1000000);
+	uint64_t nominal_q16 = inv_icm20948_get_odr_in_us_q16(s, divider ? divider : 1);
+
+	if (est->nominal_q16 != nominal_q16 || est->period_q16 == 0) {
+		est->nominal_q16 = nominal_q16;
+		est->period_q16 = nominal_q16;
+		est->updates = 0;
+	}
+}
+
+/** @brief Update period estimate of a sensor with an interrupt that delivered sample_cnt samples, and
+* set its timestamp and odr_applied_us so that the samples are spread evenly up to the estimated
+* time of the last one.
+* Last sample is predicted from the previous estimate, and the error between interrupt time and
+* prediction corrects the phase by 1/32 and the period by 1/2048 (per sample). This is a second order
+* loop (like a PLL), so it follows a constant drift without lag while jitter of interrupt latency only
+* shows in the timestamps as a fraction of it, and in the period as a few ppm.
+* Interrupts more than one period off the prediction (seed far from actual rate, FIFO overflow) reset
+* the phase, and the period to the one measured since previous interrupt, which loop then refines.
+*/
+static void inv_icm20948_odr_est_update(struct inv_icm20948 * s, enum inv_icm20948_sensor sensor,
+	unsigned short sample_cnt, uint64_t irq_us)
+{
+	inv_icm20948_odr_est_t * est = &s->odr_est[sensor];
+	uint64_t irq_q16 = irq_us << 16;
+	uint64_t last_q16 = est->last_q16;
+	uint64_t next_q16 = last_q16 + est->period_q16 * sample_cnt;
+
+	if (est->irq_us == 0) {
+		/* No samples since (re)start, last one is taken to arrive with the interrupt */
+		last_q16 = irq_q16 - est->period_q16 * sample_cnt;
+		next_q16 = irq_q16;
+	}
+	else if (irq_us != est->irq_us) {
+		int64_t err = (int64_t)(irq_q16 - next_q16);
+
+		if (err > (int64_t)est->period_q16 || -err > (int64_t)est->period_q16) {
+			if (irq_us > est->irq_us)
+				est->period_q16 = ((irq_us - est->irq_us) << 16) / sample_cnt;
+			last_q16 = irq_q16 - est->period_q16 * sample_cnt;
+			next_q16 = irq_q16;
+			est->resyncs++;
+		}
+		else {
+			next_q16 += err / 32;
+			est->period_q16 += err / 2048 / sample_cnt;
+			est->updates++;
+		}
+	}
+	/* else samples that came in after the interrupt, while FIFO was being read: only extrapolate */
+
+	est->last_q16 = next_q16;
+	est->irq_us = irq_us;
+	s->sensorlist[sensor].odr_applied_us = ((next_q16 - last_q16) / sample_cnt + 0x8000) >> 16;
+	s->timestamp[sensor] = ((next_q16 + 0x8000) >> 16) - s->sensorlist[sensor].odr_applied_us * sample_cnt;
+}
+
+/** @brief Get period of a streamed sensor as estimated from data-ready interrupts, and its deviation
+* from the nominal period (DMP divider corrected for PLL trim)
+* @param[out] period_ns	estimated sample period in ns
+* @param[out] ppm	deviation from nominal period in ppm, positive if samples come slower than nominal
+* @return 0 on success, -1 if estimate wasn't updated yet since sensor was enabled or its odr changed
+*/
+int inv_icm20948_get_odr_estimate(struct inv_icm20948 * s, enum inv_icm20948_sensor sensor,
+	uint32_t * period_ns, int32_t * ppm)
+{
+	const inv_icm20948_odr_est_t * est = &s->odr_est[sensor];
+
+	if (est->updates == 0 || est->nominal_q16 == 0)
+		return -1;
+
+	if (period_ns)
+		*period_ns = (uint32_t)((est->period_q16 * 1000 + 0x8000) >> 16);
+	if (ppm)
+		*ppm = (int32_t)(((int64_t)(est->period_q16 - est->nominal_q16) * 1000000) / (int64_t)est->nominal_q16);
+	return 0;
+}
+
 /** @brief Preprocess all timestamps so that they either contain very last time at which MEMS IRQ was fired
 * or last time sent for the sensor + ODR */
-static int8_t inv_icm20948_updateTs(struct inv_icm20948 * s, int * data_left_in_fifo,
+int8_t inv_icm20948_updateTs(struct inv_icm20948 * s, int * data_left_in_fifo,
 	unsigned short * total_sample_cnt, uint64_t * lastIrqTimeUs)
 {
 	/** @brief Very last time in us at which IRQ was fired since flushing FIFO process was started */
@@ -496,6 +601,7 @@ static int8_t inv_icm20948_updateTs(struct inv_icm20948 * s, int * data_left_in_
 		for(i = 0; i< GENERAL_SENSORS_MAX; i++) {
 			if (inv_icm20948_is_streamed_sensor(i)) {
 				s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)] = *lastIrqTimeUs;
+				s->odr_est[inv_icm20948_sensor_android_2_sensor_type(i)].last_q16 = *lastIrqTimeUs << 16;
 			}
 		}
 		return -1;
@@ -508,28 +614,23 @@ static int8_t inv_icm20948_updateTs(struct inv_icm20948 * s, int * data_left_in_
 				unsigned short fifo_sample_cnt = sample_cnt_array[i];
 
 				/** In case of first batch we have less than the expected number of samples in the batch */
-				/** To avoid a bad timestamping we recompute the startup time based on the theorical ODR and the number of samples */
+				/** To avoid a bad timestamping we restart the phase from the estimated ODR and the number of samples */
 				if (s->sFirstBatch[inv_icm20948_sensor_android_2_sensor_type(i)]) {
-					s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)] += *lastIrqTimeUs-s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)]
-					- fifo_sample_cnt*s->sensorlist[inv_icm20948_sensor_android_2_sensor_type(i)].odr_us;
+					s->odr_est[inv_icm20948_sensor_android_2_sensor_type(i)].irq_us = 0;
 					s->sFirstBatch[inv_icm20948_sensor_android_2_sensor_type(i)] = 0;
 				}
 
-				/** In case it's the first time timestamp is set we create a factice one,
-				In other cases, update timestamp for all streamed sensors depending on number of samples available in FIFO
-				first time to be printed is t1+(t2-t1)/N
-				- t1 is last time we sent data
-				- t2 is when IRQ was fired so that we pop the FIFO
-				- N is number of samples */
+				/** In case it's the first time timestamp is set (sensor enabled or its odr changed) we seed
+				the estimated ODR from the DMP divider,
+				In other cases, timestamps of the samples available in FIFO are spread evenly between
+				the last one we sent and the estimated time of the last one in FIFO, which follows the
+				interrupts with the ODR estimated from them (see inv_icm20948_odr_est_update) */
 
 				if(s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)] == 0) {
-					s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)] = *lastIrqTimeUs;
-					s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)] -= s->sensorlist[inv_icm20948_sensor_android_2_sensor_type(i)].odr_us*(fifo_sample_cnt);
-					s->sensorlist[inv_icm20948_sensor_android_2_sensor_type(i)].odr_applied_us = s->sensorlist[inv_icm20948_sensor_android_2_sensor_type(i)].odr_us;
-				}
-				else {
-					s->sensorlist[inv_icm20948_sensor_android_2_sensor_type(i)].odr_applied_us = (*lastIrqTimeUs-s->timestamp[inv_icm20948_sensor_android_2_sensor_type(i)])/fifo_sample_cnt;
+					inv_icm20948_odr_est_seed(s, inv_icm20948_sensor_android_2_sensor_type(i));
+					s->odr_est[inv_icm20948_sensor_android_2_sensor_type(i)].irq_us = 0;
 				}
+				inv_icm20948_odr_est_update(s, inv_icm20948_sensor_android_2_sensor_type(i), fifo_sample_cnt, *lastIrqTimeUs);
 			}
 		} else {
 			/** update timestamp for all event sensors with time at which MEMS IRQ was fired */
@@ -565,12 +666,18 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 	float rv_float[4];
 	float gmrv_float[4];
 	uint16_t pickup_state = 0;
-	uint64_t lastIrqTimeUs;
+	uint64_t lastIrqTimeUs = s->irq_time_us;
+
+	s->irq_time_us = 0;
+
+	/* Status and FIFO reads below share a single LP_EN disable/enable */
+	inv_icm20948_transport_begin(s);
 
 	inv_icm20948_identify_interrupt(s, &int_read_back);
 
 	if (int_read_back & (BIT_MSG_DMP_INT | BIT_MSG_DMP_INT_0)) {
-		lastIrqTimeUs = inv_icm20948_get_time_us();
+		if (lastIrqTimeUs == 0)
+			lastIrqTimeUs = inv_icm20948_get_time_us();
 		do {
 			unsigned short total_sample_cnt = 0;
 
@@ -584,8 +691,6 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 
 				/* Gyro sample available from DMP FIFO */
 				if (header & GYRO_SET) {
-					float lScaleDeg = (1 << inv_icm20948_get_gyro_fullscale(s)) * 250.f; // From raw to dps to degree per seconds
-					float lScaleDeg_bias = 2000.f; // Gyro bias from FIFO is always in 2^20 = 2000 dps regardless of fullscale
 					signed long  lRawGyroQ15[3] = {0};
 					signed long  lBiasGyroQ20[3] = {0};
 
@@ -594,9 +699,9 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 					lRawGyroQ15[0] = (long) short_data[0];
 					lRawGyroQ15[1] = (long) short_data[1];
 					lRawGyroQ15[2] = (long) short_data[2];
-					inv_icm20948_convert_dmp3_to_body(s, lRawGyroQ15, lScaleDeg/(1L<<15), gyro_raw_float);
+					inv_icm20948_convert_dmp3_to_body_flt(s, INV_ICM20948_BODY_GYRO_RAW, lRawGyroQ15, gyro_raw_float);
 
-					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_RAW_GYROSCOPE) && !skip_sensor(s, ANDROID_SENSOR_RAW_GYROSCOPE)) {
+					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_RAW_GYROSCOPE) && !inv_icm20948_skip_sensor(s, ANDROID_SENSOR_RAW_GYROSCOPE)) {
 						long out[3];
 						inv_icm20948_convert_quat_rotate_fxp(s->s_quat_chip_to_body, lRawGyroQ15, out);
 						s->timestamp[INV_ICM20948_SENSOR_RAW_GYROSCOPE] += s->sensorlist[INV_ICM20948_SENSOR_RAW_GYROSCOPE].odr_applied_us;
@@ -608,7 +713,7 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 					lBiasGyroQ20[0] = (long) short_data[0];
 					lBiasGyroQ20[1] = (long) short_data[1];
 					lBiasGyroQ20[2] = (long) short_data[2];
-					inv_icm20948_convert_dmp3_to_body(s, lBiasGyroQ20, lScaleDeg_bias/(1L<<20), gyro_bias_float);
+					inv_icm20948_convert_dmp3_to_body_flt(s, INV_ICM20948_BODY_GYRO, lBiasGyroQ20, gyro_bias_float);
 
 					/* Extract accuracy and calibrated gyro data based on raw/bias data if calibrated gyro sensor is enabled */
 					gyro_accuracy = inv_icm20948_get_gyro_accuracy();
@@ -621,20 +726,20 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 					if(gyro_accuracy != s->new_accuracy){
 						s->set_accuracy = 1;
 					}
-					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GYROSCOPE) && !skip_sensor(s, ANDROID_SENSOR_GYROSCOPE)) {
+					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GYROSCOPE) && !inv_icm20948_skip_sensor(s, ANDROID_SENSOR_GYROSCOPE)) {
 						// shift to Q20 to do all calibrated gyrometer operations in Q20
 						// Gyro bias from FIFO is always in 2^20 = 2000 dps regardless of fullscale
 						// Raw gyro from FIFO is in 2^15 = gyro fsr (250/500/1000/2000).
-						lRawGyroQ15[0] <<= 5 - (MPU_FS_2000dps - inv_icm20948_get_gyro_fullscale(s));
-						lRawGyroQ15[1] <<= 5 - (MPU_FS_2000dps - inv_icm20948_get_gyro_fullscale(s));
-						lRawGyroQ15[2] <<= 5 - (MPU_FS_2000dps - inv_icm20948_get_gyro_fullscale(s));
+						lRawGyroQ15[0] <<= s->base_state.gyro_q20_shift;
+						lRawGyroQ15[1] <<= s->base_state.gyro_q20_shift;
+						lRawGyroQ15[2] <<= s->base_state.gyro_q20_shift;
 						/* Compute calibrated gyro data based on raw and bias gyro data and convert it from Q20 raw data format to radian per seconds in Android format */
 						inv_icm20948_dmp_get_calibrated_gyro(long_data, lRawGyroQ15, lBiasGyroQ20);
-						inv_icm20948_convert_dmp3_to_body(s, long_data, lScaleDeg_bias/(1L<<20), gyro_float);
+						inv_icm20948_convert_dmp3_to_body_flt(s, INV_ICM20948_BODY_GYRO, long_data, gyro_float);
 						s->timestamp[INV_ICM20948_SENSOR_GYROSCOPE] += s->sensorlist[INV_ICM20948_SENSOR_GYROSCOPE].odr_applied_us;
 						handler(context, INV_ICM20948_SENSOR_GYROSCOPE, s->timestamp[INV_ICM20948_SENSOR_GYROSCOPE], gyro_float, &s->new_accuracy);
 					}
-					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GYROSCOPE_UNCALIBRATED)  && !skip_sensor(s, ANDROID_SENSOR_GYROSCOPE_UNCALIBRATED)) {
+					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GYROSCOPE_UNCALIBRATED)  && !inv_icm20948_skip_sensor(s, ANDROID_SENSOR_GYROSCOPE_UNCALIBRATED)) {
 						float raw_bias_gyr[6];
 						raw_bias_gyr[0] = gyro_raw_float[0];
 						raw_bias_gyr[1] = gyro_raw_float[1];
@@ -649,11 +754,10 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 				}
 				/* Calibrated accel sample available from DMP FIFO */
 				if (header & ACCEL_SET) {
-					float scale;
 					/* Read calibrated accel out of DMP FIFO and convert it from Q25 raw data format to m/s² in Android format */
 					inv_icm20948_dmp_get_accel(long_data);
 
-					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_RAW_ACCELEROMETER) && !skip_sensor(s, ANDROID_SENSOR_RAW_ACCELEROMETER)) {
+					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_RAW_ACCELEROMETER) && !inv_icm20948_skip_sensor(s, ANDROID_SENSOR_RAW_ACCELEROMETER)) {
 						long out[3];
 						inv_icm20948_convert_quat_rotate_fxp(s->s_quat_chip_to_body, long_data, out);
 						
@@ -665,12 +769,10 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 						s->timestamp[INV_ICM20948_SENSOR_RAW_ACCELEROMETER] += s->sensorlist[INV_ICM20948_SENSOR_RAW_ACCELEROMETER].odr_applied_us;
 						handler(context, INV_ICM20948_SENSOR_RAW_ACCELEROMETER, s->timestamp[INV_ICM20948_SENSOR_RAW_ACCELEROMETER], out, &dummy_accuracy);
 					}
-					if((inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_ACCELEROMETER) && !skip_sensor(s, ANDROID_SENSOR_ACCELEROMETER)) ||
+					if((inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_ACCELEROMETER) && !inv_icm20948_skip_sensor(s, ANDROID_SENSOR_ACCELEROMETER)) ||
 						(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_LINEAR_ACCELERATION))) {
 							accel_accuracy = inv_icm20948_get_accel_accuracy();
-							scale = (1 << inv_icm20948_get_accel_fullscale(s)) * 2.f / (1L<<30); // Convert from raw units to g's
-
-							inv_icm20948_convert_dmp3_to_body(s, long_data, scale, accel_float);
+							inv_icm20948_convert_dmp3_to_body_flt(s, INV_ICM20948_BODY_ACCEL, long_data, accel_float);
 
 							if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_ACCELEROMETER)) {
 								s->timestamp[INV_ICM20948_SENSOR_ACCELEROMETER] += s->sensorlist[INV_ICM20948_SENSOR_ACCELEROMETER].odr_applied_us;
@@ -680,15 +782,12 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 				}
 				/* Calibrated compass sample available from DMP FIFO */
 				if (header & CPASS_CALIBR_SET) {
-					float scale;
-
 					/* Read calibrated compass out of DMP FIFO and convert it from Q16 raw data format to µT in Android format */
 					inv_icm20948_dmp_get_calibrated_compass(long_data);
 
 					compass_accuracy = inv_icm20948_get_mag_accuracy();
-					scale = DMP_UNIT_TO_FLOAT_COMPASS_CONVERSION;
-					inv_icm20948_convert_dmp3_to_body(s, long_data, scale, compass_float);
-					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GEOMAGNETIC_FIELD) && !skip_sensor(s, ANDROID_SENSOR_GEOMAGNETIC_FIELD)) {
+					inv_icm20948_convert_dmp3_to_body_flt(s, INV_ICM20948_BODY_COMPASS, long_data, compass_float);
+					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GEOMAGNETIC_FIELD) && !inv_icm20948_skip_sensor(s, ANDROID_SENSOR_GEOMAGNETIC_FIELD)) {
 						s->timestamp[INV_ICM20948_SENSOR_GEOMAGNETIC_FIELD] += s->sensorlist[INV_ICM20948_SENSOR_GEOMAGNETIC_FIELD].odr_applied_us;
 						handler(context, INV_ICM20948_SENSOR_GEOMAGNETIC_FIELD, s->timestamp[INV_ICM20948_SENSOR_GEOMAGNETIC_FIELD], compass_float, &compass_accuracy);
 					}
@@ -701,7 +800,7 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 					compass_raw_float[0] = long_data[0] * DMP_UNIT_TO_FLOAT_COMPASS_CONVERSION;
 					compass_raw_float[1] = long_data[1] * DMP_UNIT_TO_FLOAT_COMPASS_CONVERSION;
 					compass_raw_float[2] = long_data[2] * DMP_UNIT_TO_FLOAT_COMPASS_CONVERSION;
-					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_MAGNETIC_FIELD_UNCALIBRATED) && !skip_sensor(s, ANDROID_SENSOR_MAGNETIC_FIELD_UNCALIBRATED)) {
+					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_MAGNETIC_FIELD_UNCALIBRATED) && !inv_icm20948_skip_sensor(s, ANDROID_SENSOR_MAGNETIC_FIELD_UNCALIBRATED)) {
 						float raw_bias_mag[6];
 						int mag_bias[3];
 
@@ -727,7 +826,7 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 					float ref_quat[4];
 					/* Read 6 axis quaternion out of DMP FIFO in Q30 */
 					inv_icm20948_dmp_get_6quaternion(long_quat);
-					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GAME_ROTATION_VECTOR) && !skip_sensor(s, ANDROID_SENSOR_GAME_ROTATION_VECTOR)) {
+					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GAME_ROTATION_VECTOR) && !inv_icm20948_skip_sensor(s, ANDROID_SENSOR_GAME_ROTATION_VECTOR)) {
 						/* and convert it from Q30 DMP format to Android format only if GRV sensor is enabled */
 						inv_icm20948_convert_rotation_vector(s, long_quat, grv_float);
 						ref_quat[0] = grv_float[3];
@@ -740,7 +839,7 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 
 					/* Compute gravity sensor data in Q16 in g based on 6 axis quaternion in Q30 DMP format */
 					inv_icm20948_augmented_sensors_get_gravity(s, gravityQ16, long_quat);
-					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GRAVITY) && !skip_sensor(s, ANDROID_SENSOR_GRAVITY)) {
+					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GRAVITY) && !inv_icm20948_skip_sensor(s, ANDROID_SENSOR_GRAVITY)) {
 						float gravity_float[3];
 						/* Convert gravity data from Q16 to float format in g */
 						gravity_float[0] = INVN_FXP_TO_FLT(gravityQ16[0], 16);
@@ -750,7 +849,7 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 						handler(context, INV_ICM20948_SENSOR_GRAVITY, s->timestamp[INV_ICM20948_SENSOR_GRAVITY], gravity_float, &accel_accuracy);
 					}
 
-					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_LINEAR_ACCELERATION) && !skip_sensor(s, ANDROID_SENSOR_LINEAR_ACCELERATION)) {
+					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_LINEAR_ACCELERATION) && !inv_icm20948_skip_sensor(s, ANDROID_SENSOR_LINEAR_ACCELERATION)) {
 						float linacc_float[3];
 						long linAccQ16[3];
 						long accelQ16[3];
@@ -773,7 +872,7 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 					float ref_quat[4];
 					/* Read 9 axis quaternion out of DMP FIFO in Q30 */
 					inv_icm20948_dmp_get_9quaternion(long_quat);
-					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_ROTATION_VECTOR) && !skip_sensor(s, ANDROID_SENSOR_ROTATION_VECTOR)) {
+					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_ROTATION_VECTOR) && !inv_icm20948_skip_sensor(s, ANDROID_SENSOR_ROTATION_VECTOR)) {
 						/* and convert it from Q30 DMP format to Android format only if RV sensor is enabled */
 						inv_icm20948_convert_rotation_vector(s, long_quat, rv_float);
 						/* Read rotation vector heading accuracy out of DMP FIFO in Q29*/
@@ -789,7 +888,7 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 						handler(context, INV_ICM20948_SENSOR_ROTATION_VECTOR, s->timestamp[INV_ICM20948_SENSOR_ROTATION_VECTOR], ref_quat, &rv_accuracy);
 					}
 
-					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_ORIENTATION) && !skip_sensor(s, ANDROID_SENSOR_ORIENTATION)) {
+					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_ORIENTATION) && !inv_icm20948_skip_sensor(s, ANDROID_SENSOR_ORIENTATION)) {
 						long orientationQ16[3];
 						float orientation_float[3];
 						/* Compute Android-orientation sensor data based on rotation vector data in Q30 */
@@ -806,7 +905,7 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 					float ref_quat[4];
 					/* Read 6 axis quaternion out of DMP FIFO in Q30 and convert it to Android format */
 					inv_icm20948_dmp_get_gmrvquaternion(long_quat);
-					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GEOMAGNETIC_ROTATION_VECTOR) && !skip_sensor(s, ANDROID_SENSOR_GEOMAGNETIC_ROTATION_VECTOR)) {
+					if(inv_icm20948_ctrl_androidSensor_enabled(s, ANDROID_SENSOR_GEOMAGNETIC_ROTATION_VECTOR) && !inv_icm20948_skip_sensor(s, ANDROID_SENSOR_GEOMAGNETIC_ROTATION_VECTOR)) {
 						inv_icm20948_convert_rotation_vector(s, long_quat, gmrv_float);
 						/* Read geomagnetic rotation vector heading accuracy out of DMP FIFO in Q29*/
 						{
@@ -913,6 +1012,8 @@ int inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 		}
 	}
 
+	inv_icm20948_transport_end(s);
+
 	/* Sometimes, the chip can be put in sleep mode even if there is data in the FIFO. If we poll at this moment, the transport layer will wake-up the chip, but never put it back in sleep. */
 	if (s->mems_put_to_sleep) {
 		inv_icm20948_sleep_mems(s);
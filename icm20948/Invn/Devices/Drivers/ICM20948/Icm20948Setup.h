@@ -83,6 +83,12 @@ int INV_EXPORT inv_icm20948_soft_reset(struct inv_icm20948 * s);
 int INV_EXPORT inv_icm20948_enable_sensor(struct inv_icm20948 * s, enum inv_icm20948_sensor sensor, inv_bool_t state);
 int INV_EXPORT inv_icm20948_set_sensor_period(struct inv_icm20948 * s, enum inv_icm20948_sensor sensor, uint32_t period);
 int INV_EXPORT inv_icm20948_enable_batch_timeout(struct inv_icm20948 * s, unsigned short batchTimeoutMs);
+void INV_EXPORT inv_icm20948_set_irq_time(struct inv_icm20948 * s, uint64_t irq_time_us);
+int INV_EXPORT inv_icm20948_get_odr_estimate(struct inv_icm20948 * s, enum inv_icm20948_sensor sensor,
+		uint32_t * period_ns, int32_t * ppm);
+int8_t INV_EXPORT inv_icm20948_updateTs(struct inv_icm20948 * s, int * data_left_in_fifo,
+		unsigned short * total_sample_cnt, uint64_t * lastIrqTimeUs);
+int INV_EXPORT inv_icm20948_skip_sensor(struct inv_icm20948 * s, unsigned char androidSensor);
 int INV_EXPORT inv_icm20948_poll_sensor(struct inv_icm20948 * s, void * context,
 		void (*handler)(void * context, enum inv_icm20948_sensor sensor, uint64_t timestamp, const void * data, const void *arg));
 int INV_EXPORT inv_icm20948_load(struct inv_icm20948 * s, const uint8_t * image, unsigned short size);
@@ -29,14 +29,42 @@ struct inv_icm20948 * icm20948_instance;
 
 int inv_icm20948_read_reg(struct inv_icm20948 * s, uint8_t reg,	uint8_t * buf, uint32_t len)
 {
+	s->bus_stats.read_transactions++;
+	s->bus_stats.bytes_read += len;
 	return inv_icm20948_serif_read_reg(&s->serif, reg, buf, len);
 }
 
 int inv_icm20948_write_reg(struct inv_icm20948 * s, uint8_t reg, const uint8_t * buf, uint32_t len)
 {
+	s->bus_stats.write_transactions++;
+	s->bus_stats.bytes_written += len;
 	return inv_icm20948_serif_write_reg(&s->serif, reg, buf, len);
 }
 
+uint32_t inv_icm20948_get_max_read(struct inv_icm20948 * s)
+{
+	uint32_t max_read = inv_icm20948_serif_max_read(&s->serif);
+
+	return (max_read != 0) ? max_read : INV_MAX_SERIAL_READ;
+}
+
+uint32_t inv_icm20948_get_max_write(struct inv_icm20948 * s)
+{
+	uint32_t max_write = inv_icm20948_serif_max_write(&s->serif);
+
+	return (max_write != 0) ? max_write : INV_MAX_SERIAL_WRITE;
+}
+
+void inv_icm20948_get_bus_stats(struct inv_icm20948 * s, struct inv_icm20948_bus_stats * stats)
+{
+	*stats = s->bus_stats;
+}
+
+void inv_icm20948_reset_bus_stats(struct inv_icm20948 * s)
+{
+	memset(&s->bus_stats, 0, sizeof(s->bus_stats));
+}
+
 void inv_icm20948_sleep_100us(unsigned long nHowMany100MicroSecondsToSleep)  // time in 100 us
 {
 	inv_icm20948_sleep_us(nHowMany100MicroSecondsToSleep * 100);
@@ -57,6 +85,82 @@ void inv_icm20948_transport_init(struct inv_icm20948 * s)
 {
 	s->lastBank = 0x7E;
 	s->lLastBankSelected = 0xFF;
+	s->reg_shadow.valid = 0;
+}
+
+/* Restore LP_EN after an access which needed it disabled, deferred to the end of transaction scope if one is open */
+static int lp_restore(struct inv_icm20948 * s)
+{
+	if (s->xfer_depth)
+		return 0;
+	return inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 1);
+}
+
+void inv_icm20948_transport_begin(struct inv_icm20948 * s)
+{
+	s->xfer_depth++;
+}
+
+int inv_icm20948_transport_end(struct inv_icm20948 * s)
+{
+	if (s->xfer_depth == 0)
+		return 0;
+	if (--s->xfer_depth)
+		return 0;
+	return inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 1);
+}
+
+/* USER_CTRL bits cleared by the chip itself once reset is done (DMP_RST, SRAM_RST, I2C_MST_RST) */
+#define USER_CTRL_SELF_CLEARING (BIT_DMP_RST | BIT_DIAMOND_DMP_RST | 0x02)
+
+/* Index of register in write-through shadow, -1 if register is not shadowed */
+static int shadow_index(unsigned short reg)
+{
+	switch(reg){
+	case REG_USER_CTRL:  return 0;
+	case REG_PWR_MGMT_1: return 1;
+	case REG_PWR_MGMT_2: return 2;
+	case REG_LP_CONFIG:  return 3;
+	default:             return -1;
+	}
+}
+
+/* Returns 1 if single-byte write of value to reg can be skipped */
+static int shadow_hit(struct inv_icm20948 * s, unsigned short reg, unsigned char value)
+{
+	int i = shadow_index(reg);
+
+	if ((i < 0) || !(s->reg_shadow.valid & (1 << i)) || (s->reg_shadow.value[i] != value))
+		return 0;
+
+	s->bus_stats.shadow_hits++;
+	return 1;
+}
+
+/* Record values written to or read from registers starting at reg */
+static void shadow_update(struct inv_icm20948 * s, unsigned short reg, unsigned int length, const unsigned char *data)
+{
+	unsigned int k;
+
+	for (k = 0; k < length; k++) {
+		int i = shadow_index(reg + k);
+
+		if (i < 0)
+			continue;
+
+		if ((i == 1) && (data[k] & BIT_H_RESET)) {
+			// Device reset, nothing cached is valid anymore
+			inv_icm20948_transport_init(s);
+			return;
+		}
+		if ((i == 0) && (data[k] & USER_CTRL_SELF_CLEARING)) {
+			// Self-clearing reset bits, chip value will differ from the one written
+			s->reg_shadow.valid &= ~(1 << i);
+			continue;
+		}
+		s->reg_shadow.value[i] = data[k];
+		s->reg_shadow.valid |= (1 << i);
+	}
 }
 
 static uint8_t check_reg_access_lp_disable(struct inv_icm20948 * s, unsigned short reg)
@@ -95,18 +199,15 @@ static int inv_set_bank(struct inv_icm20948 * s, unsigned char bank)
 	//if bank reg was set before, just return
 	if(bank==s->lastBank) 
 		return 0;
-	else 
-		s->lastBank = bank;
-
-	result = inv_icm20948_read_reg(s, REG_BANK_SEL, &s->reg, 1);
-
-	if (result)
-		return result;
 
-	s->reg &= 0xce;
-	s->reg |= (bank << 4);
+	// All bits other than USER_BANK are reserved and read as 0, so there is no need to read-modify-write
+	s->reg = (bank << 4) & 0x30;
+	s->bus_stats.bank_selects++;
 	result = inv_icm20948_write_reg(s, REG_BANK_SEL, &s->reg, 1);
 
+	// Only cache the bank once it was actually written
+	s->lastBank = result ? 0x7E : bank;
+
 	return result;
 }
 
@@ -123,10 +224,15 @@ int inv_icm20948_write_mems_reg(struct inv_icm20948 * s, uint16_t reg, unsigned
 {
 	int result = 0;
 	unsigned int bytesWrite = 0;
+	unsigned int maxWrite = inv_icm20948_get_max_write(s);
 	unsigned char regOnly = (unsigned char)(reg & 0x7F);
 
 	unsigned char power_state = inv_icm20948_get_chip_power_state(s);
 
+	s->bus_stats.mems_calls++;
+	if((length == 1) && shadow_hit(s, reg, data[0]))
+		return 0;
+
 	if((power_state & CHIP_AWAKE) == 0)   // Wake up chip since it is asleep
 		result = inv_icm20948_set_chip_power_state(s, CHIP_AWAKE, 1);
 
@@ -137,7 +243,7 @@ int inv_icm20948_write_mems_reg(struct inv_icm20948 * s, uint16_t reg, unsigned
 
 	while (bytesWrite<length) 
 	{
-		int thisLen = min(INV_MAX_SERIAL_WRITE, length-bytesWrite);
+		int thisLen = min(maxWrite, length-bytesWrite);
 
 		result |= inv_icm20948_write_reg(s, regOnly+bytesWrite,&data[bytesWrite], thisLen);
 
@@ -146,9 +252,10 @@ int inv_icm20948_write_mems_reg(struct inv_icm20948 * s, uint16_t reg, unsigned
 
 		bytesWrite += thisLen;
 	}
+	shadow_update(s, reg, length, data);
 
 	if(check_reg_access_lp_disable(s, reg))   //Enable LP_EN since we disabled it at begining of this function.
-		result |= inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 1);
+		result |= lp_restore(s);
 
 	return result;
 }
@@ -167,6 +274,10 @@ int inv_icm20948_write_single_mems_reg(struct inv_icm20948 * s, uint16_t reg, co
 
 	unsigned char power_state = inv_icm20948_get_chip_power_state(s);
 
+	s->bus_stats.mems_calls++;
+	if(shadow_hit(s, reg, data))
+		return 0;
+
 	if((power_state & CHIP_AWAKE) == 0)   // Wake up chip since it is asleep
 		result = inv_icm20948_set_chip_power_state(s, CHIP_AWAKE, 1);
 
@@ -175,9 +286,11 @@ int inv_icm20948_write_single_mems_reg(struct inv_icm20948 * s, uint16_t reg, co
 
 	result |= inv_set_bank(s, reg >> 7);
 	result |= inv_icm20948_write_reg(s, regOnly, &data, 1);
+	if(result == 0)
+		shadow_update(s, reg, 1, &data);
 
 	if(check_reg_access_lp_disable(s, reg))   //Enable LP_EN since we disabled it at begining of this function.
-		result |= inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 1);
+		result |= lp_restore(s);
 
 	return result;
 }
@@ -193,10 +306,11 @@ int inv_icm20948_read_mems_reg(struct inv_icm20948 * s, uint16_t reg, unsigned i
 {
 	int result = 0;
 	unsigned int bytesRead = 0;
+	unsigned int maxRead = inv_icm20948_get_max_read(s);
 	unsigned char regOnly = (unsigned char)(reg & 0x7F);
-	unsigned char i, dat[INV_MAX_SERIAL_READ];
 	unsigned char power_state = inv_icm20948_get_chip_power_state(s);
 
+	s->bus_stats.mems_calls++;
 	if((power_state & CHIP_AWAKE) == 0)   // Wake up chip since it is asleep
 		result = inv_icm20948_set_chip_power_state(s, CHIP_AWAKE, 1);
 
@@ -207,28 +321,19 @@ int inv_icm20948_read_mems_reg(struct inv_icm20948 * s, uint16_t reg, unsigned i
 
 	while (bytesRead<length) 
 	{
-		int thisLen = min(INV_MAX_SERIAL_READ, length-bytesRead);
-		if(s->base_state.serial_interface == SERIAL_INTERFACE_SPI) {
-			result |= inv_icm20948_read_reg(s, regOnly+bytesRead, &dat[bytesRead], thisLen);
-		} else {
-			result |= inv_icm20948_read_reg(s, regOnly+bytesRead, &data[bytesRead],thisLen);
-		}
+		int thisLen = min(maxRead, length-bytesRead);
+
+		result |= inv_icm20948_read_reg(s, regOnly+bytesRead, &data[bytesRead],thisLen);
 
 		if (result)
 			return result;
 
 		bytesRead += thisLen;
 	}
-
-	if(s->base_state.serial_interface == SERIAL_INTERFACE_SPI) {
-		for (i=0; i< length; i++) {
-			*data= dat[i];
-			data++;
-		}
-	}
+	shadow_update(s, reg, length, data);
 
 	if(check_reg_access_lp_disable(s, reg))    // Check if register needs LP_EN to be enabled  
-		result |= inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 1);  //Enable LP_EN
+		result |= lp_restore(s);  //Enable LP_EN
 
 	return result;
 }
@@ -245,7 +350,7 @@ int inv_icm20948_read_mems(struct inv_icm20948 * s, unsigned short reg, unsigned
 	int result=0;
 	unsigned int bytesWritten = 0;
 	unsigned int thisLen;
-	unsigned char i, dat[INV_MAX_SERIAL_READ] = {0};
+	unsigned int maxRead = inv_icm20948_get_max_read(s);
 	unsigned char power_state = inv_icm20948_get_chip_power_state(s);
 	unsigned char lBankSelected;
 	unsigned char lStartAddrSelected;
@@ -253,6 +358,7 @@ int inv_icm20948_read_mems(struct inv_icm20948 * s, unsigned short reg, unsigned
 	if(!data)
 		return -1;
 
+	s->bus_stats.mems_calls++;
 	if((power_state & CHIP_AWAKE) == 0)   // Wake up chip since it is asleep
 		result = inv_icm20948_set_chip_power_state(s, CHIP_AWAKE, 1);
 
@@ -264,6 +370,7 @@ int inv_icm20948_read_mems(struct inv_icm20948 * s, unsigned short reg, unsigned
 	lBankSelected = (reg >> 8);
 	if (lBankSelected != s->lLastBankSelected)
 	{
+		s->bus_stats.bank_selects++;
 		result |= inv_icm20948_write_reg(s, REG_MEM_BANK_SEL, &lBankSelected, 1);
 		if (result)
 			return result;
@@ -281,13 +388,9 @@ int inv_icm20948_read_mems(struct inv_icm20948 * s, unsigned short reg, unsigned
 		if (result)
 			return result;
 
-		thisLen = min(INV_MAX_SERIAL_READ, length-bytesWritten);
-		/* Write data */
-		if(s->base_state.serial_interface == SERIAL_INTERFACE_SPI) {
-			result |= inv_icm20948_read_reg(s, REG_MEM_R_W, &dat[bytesWritten], thisLen);
-		} else {
-			result |= inv_icm20948_read_reg(s, REG_MEM_R_W, &data[bytesWritten], thisLen);
-		}
+		thisLen = min(maxRead, length-bytesWritten);
+		/* Read data */
+		result |= inv_icm20948_read_reg(s, REG_MEM_R_W, &data[bytesWritten], thisLen);
 		if (result)
 			return result;
 
@@ -295,16 +398,9 @@ int inv_icm20948_read_mems(struct inv_icm20948 * s, unsigned short reg, unsigned
 		reg += thisLen;
 	}
 
-	if(s->base_state.serial_interface == SERIAL_INTERFACE_SPI) {
-		for (i=0; i< length; i++) {
-			*data= dat[i];
-			data++;
-		}
-	}
-
 	//Enable LP_EN if we disabled it at begining of this function.
 	if(check_reg_access_lp_disable(s, reg))
-		result |= inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 1);
+		result |= lp_restore(s);
 
 	return result;
 }
@@ -321,6 +417,7 @@ int inv_icm20948_write_mems(struct inv_icm20948 * s, unsigned short reg, unsigne
 	int result=0;
 	unsigned int bytesWritten = 0;
 	unsigned int thisLen;
+	unsigned int maxWrite = inv_icm20948_get_max_write(s);
 	unsigned char lBankSelected;
 	unsigned char lStartAddrSelected;
 
@@ -329,6 +426,7 @@ int inv_icm20948_write_mems(struct inv_icm20948 * s, unsigned short reg, unsigne
 	if(!data)
 		return -1;
 
+	s->bus_stats.mems_calls++;
 	if((power_state & CHIP_AWAKE) == 0)   // Wake up chip since it is asleep
 		result = inv_icm20948_set_chip_power_state(s, CHIP_AWAKE, 1);
 
@@ -339,6 +437,7 @@ int inv_icm20948_write_mems(struct inv_icm20948 * s, unsigned short reg, unsigne
 	lBankSelected = (reg >> 8);
 	if (lBankSelected != s->lLastBankSelected)
 	{
+		s->bus_stats.bank_selects++;
 		result |= inv_icm20948_write_reg(s, REG_MEM_BANK_SEL, &lBankSelected, 1);
 		if (result)
 			return result;
@@ -356,7 +455,7 @@ int inv_icm20948_write_mems(struct inv_icm20948 * s, unsigned short reg, unsigne
 		if (result)
 			return result;
 
-		thisLen = min(INV_MAX_SERIAL_WRITE, length-bytesWritten);
+		thisLen = min(maxWrite, length-bytesWritten);
 
 		/* Write data */ 
 		result |= inv_icm20948_write_reg(s, REG_MEM_R_W, &data[bytesWritten], thisLen);
@@ -368,7 +467,7 @@ int inv_icm20948_write_mems(struct inv_icm20948 * s, unsigned short reg, unsigne
 	}
 
 	//Enable LP_EN since we disabled it at begining of this function.
-	result |= inv_icm20948_set_chip_power_state(s, CHIP_LP_ENABLE, 1);
+	result |= lp_restore(s);
 
 	return result;
 }
@@ -384,8 +483,15 @@ int inv_icm20948_write_single_mems_reg_core(struct inv_icm20948 * s, uint16_t re
 	int result = 0;
 	unsigned char regOnly = (unsigned char)(reg & 0x7F);
 
+	if(shadow_hit(s, reg, data))
+		return 0;
+	if(reg == REG_PWR_MGMT_1)
+		s->bus_stats.power_writes++;
+
 	result |= inv_set_bank(s, reg >> 7);
 	result |= inv_icm20948_write_reg(s, regOnly, &data, 1);
+	if(result == 0)
+		shadow_update(s, reg, 1, &data);
 
 	return result;
 }
@@ -40,13 +40,68 @@ extern "C" {
 /* forward declaration */
 struct inv_icm20948;
 
-/** @brief Max size that can be read across I2C or SPI data lines */
+/** @brief Max size that can be read across I2C or SPI data lines, used when serif doesn't specify max_read */
 #define INV_MAX_SERIAL_READ 16
-/** @brief Max size that can be written across I2C or SPI data lines */
+/** @brief Max size that can be written across I2C or SPI data lines, used when serif doesn't specify max_write */
 #define INV_MAX_SERIAL_WRITE 16
 
+/** @brief Serial bus traffic counters, updated on every call to serif read_reg/write_reg
+ */
+struct inv_icm20948_bus_stats {
+	uint32_t read_transactions;
+	uint32_t write_transactions;
+	uint32_t bytes_read;
+	uint32_t bytes_written;
+	uint32_t mems_calls;      /**< calls to *_mems_reg and *_mems functions */
+	uint32_t bank_selects;    /**< writes to REG_BANK_SEL and REG_MEM_BANK_SEL */
+	uint32_t power_writes;    /**< writes to REG_PWR_MGMT_1 (wake & LP_EN toggling) */
+	uint32_t shadow_hits;     /**< register writes skipped as shadow already held the value */
+};
+
+/** @brief Number of control registers kept in write-through shadow
+ */
+#define INV_ICM20948_REG_SHADOW_SIZE 4
+
+/** @brief Write-through shadow of control registers, redundant writes to them are skipped
+ */
+struct inv_icm20948_reg_shadow {
+	uint8_t valid;      /**< bitmask of entries known to match the chip */
+	uint8_t value[INV_ICM20948_REG_SHADOW_SIZE]; /**< USER_CTRL, PWR_MGMT_1, PWR_MGMT_2, LP_CONFIG */
+};
+
+/** @brief Reset transport layer caches (register banks and shadow), has to be called
+ *  whenever chip state is unknown, e.g. after power-up or reset
+ */
 void INV_EXPORT inv_icm20948_transport_init(struct inv_icm20948 * s);
 
+/** @brief Start a group of register accesses
+ *  LP_EN disabled for the first access needing it is kept disabled until matching
+ *  inv_icm20948_transport_end(), instead of being toggled around every access.
+ *  Scopes can be nested.
+ */
+void INV_EXPORT inv_icm20948_transport_begin(struct inv_icm20948 * s);
+
+/** @brief End a group of register accesses started with inv_icm20948_transport_begin()
+ *  @return 0 on success, error code if LP_EN could not be restored
+ */
+int INV_EXPORT inv_icm20948_transport_end(struct inv_icm20948 * s);
+
+/** @brief Returns number of bytes that can be read in a single serial transaction
+*/
+uint32_t INV_EXPORT inv_icm20948_get_max_read(struct inv_icm20948 * s);
+
+/** @brief Returns number of bytes that can be written in a single serial transaction
+*/
+uint32_t INV_EXPORT inv_icm20948_get_max_write(struct inv_icm20948 * s);
+
+/** @brief Copy bus traffic counters accumulated since last reset
+*/
+void INV_EXPORT inv_icm20948_get_bus_stats(struct inv_icm20948 * s, struct inv_icm20948_bus_stats * stats);
+
+/** @brief Reset bus traffic counters
+*/
+void INV_EXPORT inv_icm20948_reset_bus_stats(struct inv_icm20948 * s);
+
 int INV_EXPORT inv_icm20948_read_reg(struct inv_icm20948 * s, uint8_t reg, uint8_t * buf, uint32_t len);
 
 int INV_EXPORT inv_icm20948_write_reg(struct inv_icm20948 * s, uint8_t reg, const uint8_t * buf, uint32_t len);
@@ -816,7 +816,8 @@ static int DynProtocol_encodeSensorEvent(DynProtocol_t * self, const DynProtocol
 
 	timestamp = (uint32_t)vSensordata->base.timestamp;
 
-	if(maxBufferSize < 4) {
+	/* status, sensor id and timestamp are written before any other check */
+	if(maxBufferSize < 6) {
 		goto error_size;
 	}
 
@@ -1608,19 +1609,18 @@ error_size:
 	return -1;
 }
 
-int DynProtocol_encodeAsync(DynProtocol_t * self,
+/* Encode async packet (GID, CID, payload) in outBuffer
+ * Returns packet length, INV_ERROR_SIZE if it doesn't fit or INV_ERROR_BAD_ARG
+ */
+static int DynProtocol_encodeAsyncPkt(DynProtocol_t * self,
 		enum DynProtocolEid eid, const DynProtocolEdata_t * edata,
-		uint8_t * outBuffer, uint16_t maxBufferSize, uint16_t *outBufferSize)
+		uint8_t * outBuffer, uint16_t maxBufferSize)
 {
 	uint16_t idx = 0;
 	int len;
 
-	(void)self;
-
-	*outBufferSize = 0;
-
 	if(maxBufferSize < 2)
-		goto error_size;
+		return INV_ERROR_SIZE;
 
 	outBuffer[idx]  = EVENT_TYPE_ASYNC; // Set event type
 	outBuffer[idx++] |= DYN_PROTOCOL_GROUP_ID & ~EVENT_TYPE_MASK; // Set group ID
@@ -1630,20 +1630,37 @@ int DynProtocol_encodeAsync(DynProtocol_t * self,
 	case DYN_PROTOCOL_EID_NEW_SENSOR_DATA:
 	{
 		len = DynProtocol_encodeSensorEvent(self, edata, &outBuffer[idx], maxBufferSize - idx, DYN_PROTOCOL_ETYPE_ASYNC);
-		if(len == -1)
-			goto error_arg;
+		if(len < 0)
+			return INV_ERROR_BAD_ARG;
 		else if(len > maxBufferSize - idx)
-			goto error_size;
+			return INV_ERROR_SIZE;
 
 		idx += len;
 		break;
 	}
 
 	default:
-		goto error_arg;
+		return INV_ERROR_BAD_ARG;
 	}
 
-	*outBufferSize = (idx);
+	return idx;
+}
+
+int DynProtocol_encodeAsync(DynProtocol_t * self,
+		enum DynProtocolEid eid, const DynProtocolEdata_t * edata,
+		uint8_t * outBuffer, uint16_t maxBufferSize, uint16_t *outBufferSize)
+{
+	int len;
+
+	*outBufferSize = 0;
+
+	len = DynProtocol_encodeAsyncPkt(self, eid, edata, outBuffer, maxBufferSize);
+	if(len == INV_ERROR_SIZE)
+		goto error_size;
+	else if(len < 0)
+		goto error_arg;
+
+	*outBufferSize = (uint16_t)len;
 
 	return 0;
 
@@ -1656,6 +1673,41 @@ error_size:
 	return -1;
 }
 
+/** @brief Encode async event in place, right after data already in a frame payload
+ *
+ * Nothing is copied: event is written straight into payload (e.g. payload_data of a
+ * DynProTransportUartFrame_t reserved from a frame pool), and several events can be
+ * packed in one frame this way. They are decoded one after another as separate packets.
+ *
+ * @param[in] self           handle to protocol
+ * @param[in] eid            event id (only DYN_PROTOCOL_EID_NEW_SENSOR_DATA)
+ * @param[in] edata          event data
+ * @param[in] payload        frame payload
+ * @param[in] maxPayloadLen  size of payload
+ * @param[in,out] payloadLen bytes already in payload, updated with encoded event
+ *
+ * @return 0 on success, INV_ERROR_SIZE if event does not fit in what is left of payload
+ *         (payloadLen is left unchanged), INV_ERROR_BAD_ARG on unexpected argument
+ */
+int DynProtocol_encodeAsyncAppend(DynProtocol_t * self,
+		enum DynProtocolEid eid, const DynProtocolEdata_t * edata,
+		uint8_t * payload, uint16_t maxPayloadLen, uint16_t * payloadLen)
+{
+	int len;
+
+	if(*payloadLen > maxPayloadLen)
+		return INV_ERROR_BAD_ARG;
+
+	len = DynProtocol_encodeAsyncPkt(self, eid, edata, &payload[*payloadLen],
+			maxPayloadLen - *payloadLen);
+	if(len < 0)
+		return len;
+
+	*payloadLen += (uint16_t)len;
+
+	return 0;
+}
+
 const char * DynProtocol_sensorTypeToStr(int type)
 {
 	switch(type) {
@@ -256,6 +256,10 @@ int DynProtocol_encodeAsync(DynProtocol_t * self,
 		enum DynProtocolEid eid, const DynProtocolEdata_t * edata,
 		uint8_t * outBuffer, uint16_t maxBufferSize, uint16_t *outBufferSize);
 
+int DynProtocol_encodeAsyncAppend(DynProtocol_t * self,
+		enum DynProtocolEid eid, const DynProtocolEdata_t * edata,
+		uint8_t * payload, uint16_t maxPayloadLen, uint16_t * payloadLen);
+
 int DynProtocol_encodeResponse(DynProtocol_t * self,
 		enum DynProtocolEid eid, const DynProtocolEdata_t * edata,
 		uint8_t * outBuffer, uint16_t maxBufferSize, uint16_t *outBufferSize);
@@ -32,7 +32,6 @@
 
 #define SYNC_BYTE_0                         0x55
 #define SYNC_BYTE_1                         0xAA
-#define DYN_PRO_TRANSPORT_UART_OVERHEAD     4
 
 static inline void DynProTransportUart_callEventCB(DynProTransportUart_t * self, 
 		enum DynProTransportEvent event,
@@ -284,3 +283,59 @@ int DynProTransportUart_txEncodeFrame(DynProTransportUart_t * self,
 
 	return 0;
 }
+
+/** @brief Initialize frame pool, all frames are free
+ *
+ * @param[in] pool : pointer on frame pool
+ */
+void DynProTransportUart_poolInit(DynProTransportUartFramePool_t * pool)
+{
+	unsigned i;
+
+	for(i = 0; i < DYN_PRO_TRANSPORT_UART_POOL_FRAMES; ++i) {
+		DynProTransportUart_txAssignBuffer(0, &pool->frames[i], pool->buffers[i],
+				sizeof(pool->buffers[i]));
+		pool->in_use[i] = 0;
+	}
+}
+
+/** @brief Reserve a free frame from frame pool, to encode payload directly into it
+ *
+ * Payload of returned frame is empty (payload_len is 0). Once payload is in place
+ * frame is finished by DynProTransportUart_txEncodeFrame(), which only patches the header.
+ *
+ * @param[in] pool : pointer on frame pool
+ *
+ * @return      reserved frame, NULL if all frames are in use
+ */
+DynProTransportUartFrame_t * DynProTransportUart_txReserveFrame(
+	DynProTransportUartFramePool_t * pool)
+{
+	unsigned i;
+
+	for(i = 0; i < DYN_PRO_TRANSPORT_UART_POOL_FRAMES; ++i) {
+		if(!pool->in_use[i]) {
+			pool->in_use[i] = 1;
+			pool->frames[i].payload_len = 0;
+			pool->frames[i].len = 0;
+			return &pool->frames[i];
+		}
+	}
+
+	return NULL;
+}
+
+/** @brief Give frame back to frame pool once it was sent
+ *
+ * Can be called from interrupt (e.g. end of DMA transfer).
+ *
+ * @param[in] pool : pointer on frame pool
+ * @param[in] frame : frame returned by DynProTransportUart_txReserveFrame()
+ */
+void DynProTransportUart_txReleaseFrame(DynProTransportUartFramePool_t * pool,
+	DynProTransportUartFrame_t * frame)
+{
+	if((frame >= &pool->frames[0]) && (frame < &pool->frames[DYN_PRO_TRANSPORT_UART_POOL_FRAMES])) {
+		pool->in_use[frame - &pool->frames[0]] = 0;
+	}
+}
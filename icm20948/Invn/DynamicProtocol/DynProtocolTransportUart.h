@@ -56,6 +56,33 @@ typedef struct {
 	uint16_t len;
 } DynProTransportUartFrame_t;
 
+/** Size of 0x55 0xAA <NB_BYTES (2)> header in front of every frame */
+#define DYN_PRO_TRANSPORT_UART_OVERHEAD     4
+
+/** Number of frames in a frame pool */
+#ifndef DYN_PRO_TRANSPORT_UART_POOL_FRAMES
+#define DYN_PRO_TRANSPORT_UART_POOL_FRAMES  4
+#endif
+
+/** Largest payload of a frame from frame pool (receiver quick check allows up to 128) */
+#ifndef DYN_PRO_TRANSPORT_UART_POOL_PAYLOAD
+#define DYN_PRO_TRANSPORT_UART_POOL_PAYLOAD 128
+#endif
+
+/** @brief Fixed set of TX frames, each one with its own buffer
+ *
+ * Frame is reserved, its payload is encoded in place (e.g. DynProtocol_encodeAsyncAppend()),
+ * header is patched by DynProTransportUart_txEncodeFrame(), and frame is released once it is
+ * sent (DYN_PRO_TRANSPORT_EVENT_TX_END, or end of DMA transfer). Frames are reserved from one
+ * context only, they can be released from an interrupt.
+ */
+typedef struct {
+	DynProTransportUartFrame_t frames[DYN_PRO_TRANSPORT_UART_POOL_FRAMES];
+	uint8_t buffers[DYN_PRO_TRANSPORT_UART_POOL_FRAMES]
+			[DYN_PRO_TRANSPORT_UART_OVERHEAD + DYN_PRO_TRANSPORT_UART_POOL_PAYLOAD];
+	volatile uint8_t in_use[DYN_PRO_TRANSPORT_UART_POOL_FRAMES];
+} DynProTransportUartFramePool_t;
+
 void DynProTransportUart_init(DynProTransportUart_t * self,
 		DynProTransportEvent_cb event_cb, void * cookie);
 
@@ -74,6 +101,14 @@ int DynProTransportUart_txAssignBuffer(DynProTransportUart_t * self,
 
 int DynProTransportUart_txEncodeFrame(DynProTransportUart_t * self, 
 	DynProTransportUartFrame_t * frame);
+
+void DynProTransportUart_poolInit(DynProTransportUartFramePool_t * pool);
+
+DynProTransportUartFrame_t * DynProTransportUart_txReserveFrame(
+	DynProTransportUartFramePool_t * pool);
+
+void DynProTransportUart_txReleaseFrame(DynProTransportUartFramePool_t * pool,
+	DynProTransportUartFrame_t * frame);
 	
 /** @brief Check 4-byte header validity pointed out by rcv_byte
  *  @param[in] rcv_byte	handler to header
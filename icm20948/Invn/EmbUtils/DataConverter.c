@@ -109,3 +109,29 @@ void inv_dc_float_to_sfix32(const float * in, uint32_t len, uint8_t qx, int32_t
 		out[i] = (int32_t)((in[i] * (1 << qx)) + ((in[i] >= 0) - 0.5f));
 	}
 }
+
+#if defined(__GNUC__)
+#define INV_DC_BSWAP16(x)	__builtin_bswap16(x)
+#define INV_DC_BSWAP32(x)	__builtin_bswap32(x)
+#else
+#define INV_DC_BSWAP16(x)	((uint16_t)(((x) >> 8) | ((x) << 8)))
+#define INV_DC_BSWAP32(x)	(((x) >> 24) | (((x) >> 8) & 0xff00) | (((x) & 0xff00) << 8) | ((x) << 24))
+#endif
+
+void inv_dc_big16_to_int32_array(const uint16_t * in, uint32_t len, int32_t * out)
+{
+	uint32_t i;
+
+	for(i = 0; i < len; ++i) {
+		out[i] = (int16_t)INV_DC_BSWAP16(in[i]);
+	}
+}
+
+void inv_dc_big32_to_int32_array(const uint32_t * in, uint32_t len, int32_t * out)
+{
+	uint32_t i;
+
+	for(i = 0; i < len; ++i) {
+		out[i] = (int32_t)INV_DC_BSWAP32(in[i]);
+	}
+}
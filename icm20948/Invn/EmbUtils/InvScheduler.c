@@ -16,135 +16,204 @@
 
 #include "InvScheduler.h"
 
+/* Heap of queued tasks, next task to be executed at index 0 */
+
+static inline uint32_t InvScheduler_getTaskTimeout(const InvSchedulerTask *task)
+{
+	return (task->delay != 0) ? task->delay : task->period;
+}
+
+/* Return non-zero if task a has to be executed before task b:
+ * started tasks first (they are given their time reference on next dispatch),
+ * then the one due first (i.e. the most late), then the one with higher
+ * priority, then the one queued first
+ */
+static int InvScheduler_isTaskBefore(const InvSchedulerTask *a,
+		const InvSchedulerTask *b)
+{
+	if(a->state != b->state)
+		return (a->state == INVSCHEDULER_TASK_STATE_STARTED);
+
+	if(a->state == INVSCHEDULER_TASK_STATE_READY) {
+		const int32_t diff = (int32_t)((a->lasttime + InvScheduler_getTaskTimeout(a)) -
+				(b->lasttime + InvScheduler_getTaskTimeout(b)));
+
+		if(diff != 0)
+			return (diff < 0);
+		if(a->priority != b->priority)
+			return (a->priority > b->priority);
+	}
+
+	return ((int32_t)(a->order - b->order) < 0);
+}
+
+static inline void InvScheduler_placeTask(InvScheduler * scheduler,
+		InvSchedulerTask *task, uint16_t index)
+{
+	scheduler->queue[index] = task;
+	task->index = index;
+}
+
+static void InvScheduler_siftUp(InvScheduler * scheduler, InvSchedulerTask *task,
+		uint16_t index)
+{
+	while(index > 0) {
+		const uint16_t parent = (index - 1) / 2;
+
+		if(!InvScheduler_isTaskBefore(task, scheduler->queue[parent]))
+			break;
+		InvScheduler_placeTask(scheduler, scheduler->queue[parent], index);
+		index = parent;
+	}
+	InvScheduler_placeTask(scheduler, task, index);
+}
+
+static void InvScheduler_siftDown(InvScheduler * scheduler, InvSchedulerTask *task,
+		uint16_t index)
+{
+	for(;;) {
+		uint16_t child = 2 * index + 1;
+
+		if(child >= scheduler->count)
+			break;
+		if(child + 1 < scheduler->count &&
+				InvScheduler_isTaskBefore(scheduler->queue[child + 1], scheduler->queue[child]))
+			++child;
+		if(!InvScheduler_isTaskBefore(scheduler->queue[child], task))
+			break;
+		InvScheduler_placeTask(scheduler, scheduler->queue[child], index);
+		index = child;
+	}
+	InvScheduler_placeTask(scheduler, task, index);
+}
+
+/* Queue task, or stop it and count it as dropped if heap is full */
 static void InvScheduler_insertTask(InvScheduler * scheduler,
 		InvSchedulerTask *task)
 {
-	if(scheduler->queue == 0) {
-		task->prev = task;
-		task->next = 0;
-		scheduler->queue = task;
-	} else {
-		task->prev = scheduler->queue->prev;
-		task->next = 0;
-		scheduler->queue->prev->next = task;
-		scheduler->queue->prev       = task;
+	if(scheduler->count >= INVSCHEDULER_MAX_TASKS) {
+		task->state = INVSCHEDULER_TASK_STATE_STOP;
+		++scheduler->dropped;
+		return;
 	}
+
+	task->order = scheduler->order++;
+	InvScheduler_siftUp(scheduler, task, scheduler->count++);
 }
 
 static inline void InvScheduler_removeTask(InvScheduler * scheduler,
 		InvSchedulerTask *task)
 {
-	if(scheduler->queue == task) {
-		scheduler->queue = task->next;
-	} else {
-		if(scheduler->queue->prev == task)
-			scheduler->queue->prev = task->prev;
-		task->prev->next = task->next;
+	const uint16_t index = task->index;
+	InvSchedulerTask * last = scheduler->queue[--scheduler->count];
+
+	/* fill the hole with the last task and move it to its place */
+	if(last != task) {
+		if(index > 0 && InvScheduler_isTaskBefore(last, scheduler->queue[(index - 1) / 2]))
+			InvScheduler_siftUp(scheduler, last, index);
+		else
+			InvScheduler_siftDown(scheduler, last, index);
 	}
-	if(task->next)
-		task->next->prev = task->prev;
 }
 
 static InvSchedulerTask * InvScheduler_getTaskToSchedule(InvScheduler * scheduler,
 		uint32_t now)
 {
-	InvSchedulerTask * cur  = scheduler->queue;
-	InvSchedulerTask * task = 0;
-	uint32_t           max_diff = 0;
-
-	while(cur) {
-		const uint32_t timeout = (cur->delay != 0) ? cur->delay : cur->period;
-		uint32_t elpased;
-
-		/* initalize task states after it was started */
-		if(cur->state == INVSCHEDULER_TASK_STATE_STARTED) {
-			cur->state    = INVSCHEDULER_TASK_STATE_READY;
-			cur->lasttime = now;
-
-			if(cur->delay == 0) {
-				cur->lasttime -= cur->period; /* ensure task is run ASAP */
-			}
-		}
-
-		elpased = (now - cur->lasttime);
+	InvSchedulerTask * task;
 
-		/* check timeout against elpased time */
-		if(elpased >= timeout) {
-			const uint32_t diff = (elpased - timeout);
+	/* initalize task states after it was started */
+	while(scheduler->count > 0 &&
+			scheduler->queue[0]->state == INVSCHEDULER_TASK_STATE_STARTED) {
+		task = scheduler->queue[0];
+		task->state    = INVSCHEDULER_TASK_STATE_READY;
+		task->lasttime = now;
 
-			if(task == 0 || diff > max_diff ||
-					(diff == max_diff && cur->priority > task->priority)) {
-				task = cur;
-				max_diff = diff;
-			}
+		if(task->delay == 0) {
+			task->lasttime -= task->period; /* ensure task is run ASAP */
 		}
-
-		cur = cur->next;
+		InvScheduler_siftDown(scheduler, task, 0);
 	}
 
-	return task;
+	if(scheduler->count == 0)
+		return 0;
+
+	/* check timeout against elpased time of the most late task */
+	task = scheduler->queue[0];
+	if((now - task->lasttime) >= InvScheduler_getTaskTimeout(task))
+		return task;
+
+	return 0;
 }
 
 int InvScheduler_getActiveTaskCountU(const InvScheduler *scheduler)
 {
-	int count = 0;
-	const InvSchedulerTask *cur;
-
 	/* /!\ RUNNING task is not in the queue hence ignored */
-	for(cur = scheduler->queue; cur != 0; cur = cur->next)
-		++count;
-
-	return count;
+	return scheduler->count;
 }
 
 uint32_t InvScheduler_getNextTimeU(const InvScheduler *scheduler)
 {
 	const uint32_t           now = scheduler->currentTime;
-	const InvSchedulerTask * cur = scheduler->queue;
-	uint32_t                 max_diff = UINT32_MAX;
-
-	for(; cur != 0; cur = cur->next ) {
-		if(cur->state == INVSCHEDULER_TASK_STATE_STARTED) {
-			return 0;
-		} else {
-			const uint32_t timeout = (cur->delay != 0) ? cur->delay : cur->period;
-			const uint32_t elpased = (now - cur->lasttime);
-
-			if(elpased >= timeout) {
-				return 0;
-			} else {
-				const uint32_t diff = timeout - elpased;
-
-				if(diff < max_diff) {
-					max_diff = diff;
-				}
-			}
-		}
-	}
+	const InvSchedulerTask * cur;
+	uint32_t                 timeout, elpased;
 
-	return max_diff;
+	if(scheduler->count == 0)
+		return UINT32_MAX;
+
+	cur = scheduler->queue[0];
+	if(cur->state == INVSCHEDULER_TASK_STATE_STARTED)
+		return 0;
+
+	timeout = InvScheduler_getTaskTimeout(cur);
+	elpased = (now - cur->lasttime);
+
+	return (elpased >= timeout) ? 0 : (timeout - elpased);
 }
 
 uint32_t InvScheduler_getMinPeriodU(const InvScheduler *scheduler)
 {
-	if(scheduler->queue) {
-		InvSchedulerTask *cur = scheduler->queue->next;
-		uint32_t min = scheduler->queue->period;
+	uint32_t min = UINT32_MAX;
+	uint16_t i;
 
-		/* /!\ RUNNING task is not in the queue hence ignored */
-		/* /!\ delay is not taken into account */
+	/* /!\ RUNNING task is not in the queue hence ignored */
+	/* /!\ delay is not taken into account */
 
-		for(; cur != 0; cur = cur->next ) {
-			if(cur->period < min) {
-				min = cur->period;
-			}
+	for(i = 0; i < scheduler->count; ++i) {
+		if(scheduler->queue[i]->period < min) {
+			min = scheduler->queue[i]->period;
 		}
-
-		return min;
 	}
 
-	return UINT32_MAX;
+	return min;
+}
+
+#ifdef INVSCHEDULER_TASK_STATS
+static void InvScheduler_updateTaskStats(InvSchedulerTask *task, uint32_t late,
+		uint32_t runTime)
+{
+	InvSchedulerTaskStats * stats = &task->stats;
+
+	++stats->runs;
+	if(task->period != 0 && late >= task->period)
+		++stats->overruns;
+	if(late > stats->lateMax)
+		stats->lateMax = late;
+	stats->lateSum += late;
+	if(runTime > stats->runTimeMax)
+		stats->runTimeMax = runTime;
+	stats->runTimeSum += runTime;
+}
+
+void InvScheduler_resetTaskStatsU(InvSchedulerTask *task)
+{
+	task->stats.runs       = 0;
+	task->stats.overruns   = 0;
+	task->stats.lateMax    = 0;
+	task->stats.lateSum    = 0;
+	task->stats.runTimeMax = 0;
+	task->stats.runTimeSum = 0;
 }
+#endif
 
 int InvScheduler_dispatchOneTask(InvScheduler *scheduler)
 {
@@ -157,6 +226,10 @@ int InvScheduler_dispatchOneTask(InvScheduler *scheduler)
 	task = InvScheduler_getTaskToSchedule(scheduler, now);
 
 	if(task) {
+#ifdef INVSCHEDULER_TASK_STATS
+		const uint32_t late = (now - task->lasttime) - InvScheduler_getTaskTimeout(task);
+		uint32_t start;
+#endif
 		/* update lastime and task state */
 		task->delay    = 0; /* clear delay */
 		task->lasttime = now;
@@ -166,7 +239,13 @@ int InvScheduler_dispatchOneTask(InvScheduler *scheduler)
 
 		InvScheduler_unlock(scheduler->contextLock);
 		InvScheduler_onTaskEnterHook(task, scheduler->currentTime);
+#ifdef INVSCHEDULER_TASK_STATS
+		start = InvScheduler_getStatsTime();
+		task->func(task->arg); /* execute the task */
+		InvScheduler_updateTaskStats(task, late, InvScheduler_getStatsTime() - start);
+#else
 		task->func(task->arg); /* execute the task */
+#endif
 		InvScheduler_onTaskExitHook(task, scheduler->currentTime);
 		InvScheduler_lock(scheduler->contextLock);
 
@@ -206,6 +285,9 @@ void InvScheduler_initTaskDo(InvScheduler *scheduler, InvSchedulerTask *task,
 #ifdef INVSCHEDULER_TASK_NAME
 	task->name 		= "";
 #endif
+#ifdef INVSCHEDULER_TASK_STATS
+	InvScheduler_resetTaskStatsU(task);
+#endif
 }
 
 void InvScheduler_startTaskU(InvSchedulerTask *task, uint32_t delay)
@@ -214,9 +296,9 @@ void InvScheduler_startTaskU(InvSchedulerTask *task, uint32_t delay)
 			task->state == INVSCHEDULER_TASK_STATE_READY) {
 		InvScheduler_removeTask(task->scheduler, task);
 	}
-	InvScheduler_insertTask(task->scheduler, task);
 	task->delay = delay;
 	task->state = INVSCHEDULER_TASK_STATE_STARTED;
+	InvScheduler_insertTask(task->scheduler, task);
 }
 
 void InvScheduler_startTask(InvSchedulerTask *task, uint32_t delay)
@@ -242,6 +324,15 @@ void InvScheduler_stopTask(InvSchedulerTask *task)
 	InvScheduler_unlock(task->scheduler->contextLock);
 }
 
+void InvScheduler_updateTaskU(InvSchedulerTask *task)
+{
+	if(task->state == INVSCHEDULER_TASK_STATE_STARTED ||
+			task->state == INVSCHEDULER_TASK_STATE_READY) {
+		InvScheduler_removeTask(task->scheduler, task);
+		InvScheduler_siftUp(task->scheduler, task, task->scheduler->count++);
+	}
+}
+
 /* Debugging functions ********************************************************/
 
 #ifndef NDEBUG
@@ -264,7 +355,7 @@ void InvScheduler_printTask(const InvSchedulerTask *task,
 			"    prio   = %-12u state  = %s \n"
 			"    period = %-12u delay = %-12u\n"
 			"    time   = %-12lu\n"
-			"    next   = %p prev   = %p\n",
+			"    order  = %-12lu index  = %-12u\n",
 			(void *)task,
 #ifdef INVSCHEDULER_TASK_NAME
 			task->name,
@@ -274,17 +365,28 @@ void InvScheduler_printTask(const InvSchedulerTask *task,
 			(unsigned int)task->priority,
 			InvScheduler_taskState2Str(task->state), (unsigned int)task->period,
 			(unsigned int)task->delay, (unsigned long)task->lasttime,
-			(void *)task->next, (void *)task->prev
+			(unsigned long)task->order, (unsigned int)task->index
 	);
+#ifdef INVSCHEDULER_TASK_STATS
+	printf_cb("    runs   = %-12lu overruns = %-12lu\n"
+			"    late   = max %lu, avg %lu\n"
+			"    run    = max %lu, avg %lu\n",
+			(unsigned long)task->stats.runs, (unsigned long)task->stats.overruns,
+			(unsigned long)task->stats.lateMax,
+			(unsigned long)(task->stats.runs ? task->stats.lateSum / task->stats.runs : 0),
+			(unsigned long)task->stats.runTimeMax,
+			(unsigned long)(task->stats.runs ? task->stats.runTimeSum / task->stats.runs : 0)
+	);
+#endif
 }
 
-void InvScheduler_dumpTasks(const InvSchedulerTask * queue,
+void InvScheduler_dumpTasks(const InvScheduler *scheduler,
 		int (*printf_cb)(const char *format, ...))
 {
-	const InvSchedulerTask *cur = queue;
+	uint16_t i;
 
-	for(; cur != 0; cur = cur->next) {
-		InvScheduler_printTask(cur, printf_cb);
+	for(i = 0; i < scheduler->count; ++i) {
+		InvScheduler_printTask(scheduler->queue[i], printf_cb);
 	}
 }
 
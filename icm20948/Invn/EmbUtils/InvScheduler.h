@@ -18,6 +18,10 @@
 /** @defgroup InvScheduler InvScheduler
  *  @brief Simple cooperative scheduler
  *
+ *  Started tasks are kept in a binary min-heap ordered by the time they are
+ *  due (then priority, then order they were queued in), so dispatching a task
+ *  costs O(log n) instead of a walk over all tasks.
+ *
  *  @ingroup EmbUtils
  *  @{
  */
@@ -38,6 +42,17 @@ extern "C" {
 
 /* InvScheduler definitions ***************************************************/
 
+/** @brief Overloadable maximum number of tasks started at the same time
+ *
+ *  Heap of started tasks holds this many tasks. A task that is started, or
+ *  rescheduled after it ran, while the heap is full is left in
+ *  INVSCHEDULER_TASK_STATE_STOP state instead and counted in
+ *  InvScheduler::dropped (see InvScheduler_getDroppedCount())
+ */
+#ifndef INVSCHEDULER_MAX_TASKS
+  #define INVSCHEDULER_MAX_TASKS   (32)
+#endif
+
 /** @brief InvScheduler task state definition
  */
 enum InvSchedulerTaskState {
@@ -59,6 +74,24 @@ enum InvSchedulerTaskState {
 /* Forward declarations */
 struct InvScheduler;
 
+#ifdef INVSCHEDULER_TASK_STATS
+/** @brief 	InvSchedulerTask execution statistics, kept if INVSCHEDULER_TASK_STATS
+ *  is defined. Lateness is time in tick between the moment task was due and
+ *  the moment it was executed. Run time is measured with
+ *  InvScheduler_getStatsTime(), if it is provided
+ */
+typedef struct InvSchedulerTaskStats {
+	uint32_t runs;                      /**< number of executions        */
+	uint32_t overruns;                  /**< executions a period or more
+	                                         late, a period was skipped  */
+	uint32_t lateMax;                   /**< largest lateness            */
+	uint64_t lateSum;                   /**< sum of lateness (jitter is
+	                                         lateSum/runs on average)    */
+	uint32_t runTimeMax;                /**< longest run time            */
+	uint64_t runTimeSum;                /**< sum of run times            */
+} InvSchedulerTaskStats;
+#endif
+
 /** @brief 	InvSchedulerTask objct states definition
  */
 typedef struct InvSchedulerTask {
@@ -74,15 +107,24 @@ typedef struct InvSchedulerTask {
 	uint32_t delay;                     /**< task delay value            */
 	struct InvScheduler * scheduler;    /**< reference to scheduler the
 	                                         task is attach to           */
-	struct InvSchedulerTask *next;      /**< next task in list           */
-	struct InvSchedulerTask *prev;      /**< previous task in list       */
+	uint32_t order;                     /**< order in which task was
+	                                         queued, for equal due time
+	                                         and priority                */
+	uint16_t index;                     /**< position in scheduler heap  */
+#ifdef INVSCHEDULER_TASK_STATS
+	InvSchedulerTaskStats stats;        /**< execution statistics        */
+#endif
 } InvSchedulerTask;
 
 /** @brief 	InvScheduler object states definition
  */
 typedef struct InvScheduler {
 	volatile uint32_t 	currentTime;	/** current time value                    */
-	struct InvSchedulerTask *queue;	    /** list of task awaiting to be scheduled */
+	struct InvSchedulerTask *queue[INVSCHEDULER_MAX_TASKS]; /** heap of task awaiting
+	                                        to be scheduled, next due one first    */
+	uint16_t            count;          /** number of tasks in the heap           */
+	uint32_t            order;          /** order given to next queued task       */
+	uint32_t            dropped;        /** tasks stopped because heap was full   */
 	void * contextLock;                 /** reference to some context passed to
 	                                        lock/unlock macro to protect critical section */
 } InvScheduler;
@@ -133,7 +175,9 @@ typedef struct InvScheduler {
 static inline void InvScheduler_init(InvScheduler *scheduler)
 {
 	scheduler->currentTime  = 0;
-	scheduler->queue        = 0;
+	scheduler->count        = 0;
+	scheduler->order        = 0;
+	scheduler->dropped      = 0;
 	scheduler->contextLock  = 0;
 }
 
@@ -270,6 +314,16 @@ static inline int InvScheduler_getActiveTaskCount(const InvScheduler *scheduler)
 	return count;
 }
 
+/** @brief Return number of times a task was stopped instead of being queued
+ *  because INVSCHEDULER_MAX_TASKS tasks were already started
+ *  @param[in] scheduler    handle to scheduler
+ *  @return number of dropped tasks since InvScheduler_init()
+ */
+static inline uint32_t InvScheduler_getDroppedCount(const InvScheduler *scheduler)
+{
+	return scheduler->dropped;
+}
+
 /** @brief Initialize a new task
  *  @param[in] scheduler     handle to the scheduler the task is linked to
  *  @param[in] task          task states
@@ -296,6 +350,9 @@ static inline void InvScheduler_initTask(InvScheduler *scheduler,
 }
 
 /** @brief Start a task after a delay
+ *  @warning If INVSCHEDULER_MAX_TASKS tasks are already started, task is not
+ *           started, stays in INVSCHEDULER_TASK_STATE_STOP state and is
+ *           counted in InvScheduler_getDroppedCount()
  *  @param[in] task     task to start
  *  @param[in] delay    delay in tick before executing the task
  */
@@ -314,6 +371,12 @@ void InvScheduler_stopTaskU(InvSchedulerTask *task);
  */
 void InvScheduler_stopTask(InvSchedulerTask *task);
 
+/** @brief Move a task to its place in the heap after its period or priority
+ *  changed
+ *  @param[in] task    handle to task
+ */
+void InvScheduler_updateTaskU(InvSchedulerTask *task);
+
 /** @brief Change period of a task
  *  @param[in] task    handle to task
  */
@@ -321,6 +384,7 @@ static inline void InvScheduler_setTaskPeriodU(InvSchedulerTask *task,
 		uint32_t period)
 {
 	task->period = period;
+	InvScheduler_updateTaskU(task);
 }
 
 /** @brief Change priority of a task
@@ -330,8 +394,16 @@ static inline void InvScheduler_setTaskPrioU(InvSchedulerTask *task,
 		uint8_t prio)
 {
 	task->priority = prio;
+	InvScheduler_updateTaskU(task);
 }
 
+#ifdef INVSCHEDULER_TASK_STATS
+/** @brief Clear execution statistics of a task
+ *  @param[in] task    handle to task
+ */
+void InvScheduler_resetTaskStatsU(InvSchedulerTask *task);
+#endif
+
 /* Optionnal hooks called before/after exectuting a task **********************/
 
 #ifndef   InvScheduler_onTaskEnterHook
@@ -356,6 +428,15 @@ extern void InvScheduler_onTaskExitHook(const InvSchedulerTask *task,
 		uint32_t time);
 #endif
 
+#ifndef   InvScheduler_getStatsTime
+  #define InvScheduler_getStatsTime() 0
+#else
+/** @brief Time source for task run time statistics (e.g. CPU cycles)
+ *  @return current time, in any unit
+ */
+extern uint32_t InvScheduler_getStatsTime(void);
+#endif
+
 /* Debugging functions ********************************************************/
 
 #ifndef NDEBUG
@@ -367,7 +448,7 @@ void InvScheduler_printTask(const InvSchedulerTask *task,
 
 /** @brief Dumps all tasks from a scheduler to string
  */
-void InvScheduler_dumpTasks(const InvSchedulerTask *queue,
+void InvScheduler_dumpTasks(const InvScheduler *scheduler,
 		int (*printf_cb)(const char *format, ...));
 
 #endif
@@ -82,6 +82,24 @@ void INV_EXPORT inv_dc_sfix32_to_float(const int32_t * in, uint32_t len, uint8_t
  */
 void INV_EXPORT inv_dc_float_to_sfix32(const float * in, uint32_t len, uint8_t qx, int32_t * out);
 
+/** @brief Converts an array of big endian 16-bit signed integers to an array of 32-bit signed integers
+ *  Input is read with native (little endian) 16-bit loads, so every element only needs its bytes swapped.
+ *  Written as a plain loop over byte swaps so that compiler turns it into REVSH on Cortex-M4 and
+ *  can vectorize it where SIMD is available.
+ *  @param[in]   in    Pointer to the first big endian element, as copied from the FIFO
+ *  @param[in]   len   Length of the array
+ *  @param[out]  out   Pointer to the memory area where the output will be stored, can't overlap in
+ */
+void INV_EXPORT inv_dc_big16_to_int32_array(const uint16_t * in, uint32_t len, int32_t * out);
+
+/** @brief Converts an array of big endian 32-bit signed integers to native 32-bit signed integers
+ *  Same as inv_dc_big16_to_int32_array() for 32-bit elements (REV on Cortex-M4), can be done in place
+ *  @param[in]   in    Pointer to the first big endian element, as copied from the FIFO
+ *  @param[in]   len   Length of the array
+ *  @param[out]  out   Pointer to the memory area where the output will be stored, can be equal to in
+ */
+void INV_EXPORT inv_dc_big32_to_int32_array(const uint32_t * in, uint32_t len, int32_t * out);
+
 #ifdef __cplusplus
 }
 #endif
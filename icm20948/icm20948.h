@@ -20,6 +20,17 @@ enum OrientationDOF
     Orientation9DOF
 };
 
+/**
+ * Math used for RPY angles: atan2f/asinf from libm, or polynomial
+ * approximations from the driver (max error 0.0053 degrees, see
+ * inv_icm20948_math_atan2f_fast)
+ */
+enum OrientationMath
+{
+    OrientationMathLibm,
+    OrientationMathFast
+};
+
 enum AccelerometerFSR
 {
     AccelFSR2g = 2,
@@ -41,6 +52,21 @@ enum GyroscopeFSR
 #define MPU_NOT_ALLOWED         3
 
 #include "Invn/Devices/Drivers/Icm20948/Icm20948Setup.h"
+#include "libs/spscqueue.hpp"
+#include "libs/seqlock.hpp"
+#include "libs/histogram.hpp"
+#include "icm20948_capture.h"
+
+//  Number of samples buffered per sensor for PopSamples (power of 2, one slot
+//  is always kept free)
+#ifndef ICM20948_SAMPLE_QUEUE_LEN
+#define ICM20948_SAMPLE_QUEUE_LEN   16
+#endif
+
+//  Number of bins in histogram of data-ready interval jitter (even)
+#ifndef ICM20948_JITTER_BINS
+#define ICM20948_JITTER_BINS        32
+#endif
 
 /**
  * Class object for MPU9250 sensor
@@ -49,6 +75,33 @@ class ICM20948
 {
     friend void build_sensor_event_data(void * context, inv_icm20948_sensor sensortype, uint64_t timestamp, const void * data, const void *arg);
     public:
+        /**
+         * Single timestamped output of one of the sensors
+         */
+        struct Sample
+        {
+            uint64_t    timestamp;  //  Time of the sample in us
+            float       data[4];    //  Vector (x,y,z) or quaternion (w,x,y,z)
+            float       accuracy;   //  Accuracy as reported by the driver
+        };
+
+        /**
+         * Hooks receiving every sample of a sensor: sensor, timestamp in us,
+         * data (quaternion (w,x,y,z) or vector (x,y,z)) and its accuracy
+         */
+        typedef void (*QuaternionHook)(inv_icm20948_sensor sensor,
+                uint64_t timestamp, const float *quat, float accuracy);
+        typedef void (*Vector3Hook)(inv_icm20948_sensor sensor,
+                uint64_t timestamp, const float *vect, float accuracy);
+        /**
+         * Function reading DMP FIFO and passing sensor events to handler,
+         * inv_icm20948_poll_sensor or one of ICM20948Poller<>::Poll
+         */
+        typedef int (*PollFunc)(struct inv_icm20948 *s, void *context,
+                void (*handler)(void *context, enum inv_icm20948_sensor sensor,
+                                uint64_t timestamp, const void *data,
+                                const void *arg));
+
         static ICM20948& GetI();
         static ICM20948* GetP();
 
@@ -57,22 +110,56 @@ class ICM20948
         int8_t SetGyroscopeFSR(GyroscopeFSR gFsr);
         int8_t SetMagnetometerBias(float biasX, float biasY, float biasZ);
         int8_t SetMountingMatrix(float *mountMatrix);
+        void   SetOrientationMath(OrientationMath math);
 
         int8_t  InitHW();
-        int8_t  InitSW();
+        int8_t  InitSW(bool warmRestart = false);
         int8_t  Enabled(bool en);
+        uint32_t MeasureBusThroughput(uint32_t speed);
 
         bool    IsDataReady();
-        int8_t  ReadSensorData(const float &timestamp);
+        bool    WaitForData(uint32_t timeoutUs, uint64_t *timestamp = 0);
+        void    OnDataReady(void((*custHook)(uint64_t)));
+        uint64_t NextDataUs();
+        int8_t  ReadSensorData(uint64_t timestamp = 0);
+        //  Defined in icm20948_poller.hpp
+        template <uint32_t SensorMask>
+        int8_t  ReadSensorData(uint64_t timestamp = 0);
+
+        /**
+         * Histogram of intervals between data-ready edges, in cycles of
+         * HAL_BOARD_TimeCycles, centered around the expected interval
+         */
+        typedef Histogram<ICM20948_JITTER_BINS> JitterHistogram;
+        void    MeasureJitter(uint32_t periodUs, uint32_t binNs);
+        const JitterHistogram& Jitter() const;
 
         int8_t EnableSensor(inv_icm20948_sensor sensor, uint32_t period);
         int8_t DisableSensor(inv_icm20948_sensor sensor);
+        int8_t EnableBatching(uint16_t timeoutMs, uint16_t watermark = 0);
+        int8_t DisableBatching();
+
+        int8_t  OnQuaternion(inv_icm20948_sensor sensor, QuaternionHook hook);
+        int8_t  OnVector3(inv_icm20948_sensor sensor, Vector3Hook hook);
+
+        uint16_t PopSamples(inv_icm20948_sensor sensor, Sample *buf, uint16_t max);
+        bool    GetLatest(inv_icm20948_sensor sensor, Sample &sample) const;
+        uint32_t SampleOverflows(inv_icm20948_sensor sensor) const;
+        int8_t  GetSamplePeriod(inv_icm20948_sensor sensor, float *periodUs,
+                                int32_t *driftPpm = 0);
+
+        int8_t  StartCapture(void((*writer)(const uint8_t *data, uint16_t length)));
+        void    StopCapture();
 
 
         int8_t  GetLinearAcceleration(float *acc);
         int8_t  GetGyroscope(float *gyro);
         int8_t  GetOrientationRPY(OrientationDOF type, float* orientationRPY, bool inDeg);
         int8_t  GetOrientationQuat(OrientationDOF type, float* orientationQuat);
+        static void QuatToRPY(const float *quat, float *rpy, bool inDeg,
+                              OrientationMath math);
+        static void QuatToRPY(const Sample *quats, uint16_t n, float (*rpy)[3],
+                              bool inDeg, OrientationMath math);
         int8_t  GetMagnetometer(float *mag);
         int8_t  GetGravity(float *gv);
 
@@ -82,32 +169,92 @@ class ICM20948
     protected:
         ICM20948();
         ~ICM20948();
-        ICM20948(ICM20948 &arg) {}              //  No definition - forbid this
-        void operator=(ICM20948 const &arg) {} //  No definition - forbid this
+        ICM20948(ICM20948 &) {}                 //  No definition - forbid this
+        void operator=(ICM20948 const &) {}    //  No definition - forbid this
 
         /**
-         * Data setters using averaging windows
+         * Sensors for which samples are kept, each has its own queue
+         */
+        enum _SampleChannel
+        {
+            _ChAccel,
+            _ChLinearAccel,
+            _ChGyro,
+            _ChMag,
+            _ChGravity,
+            _ChQuat6DOF,
+            _ChQuat9DOF,
+            _ChCount
+        };
+        /**
+         * How output of a sensor is handled: converter to float vector or
+         * quaternion, its length (0 if not supported) and channel in which
+         * samples are kept (-1 if they aren't)
+         */
+        struct _SensorRoute
+        {
+            void    (*convert)(const void *data, const void *arg, float *out,
+                               float *accuracy);
+            uint8_t length;
+            int8_t  channel;
+        };
+        static const _SensorRoute _sensorRoute[INV_ICM20948_SENSOR_MAX];
+
+        int8_t _ReadSensorData(PollFunc poll, uint64_t timestamp);
+        static int8_t _Channel(inv_icm20948_sensor sensor);
+        void _Publish(uint8_t channel, const Sample &sample);
+        void _LatestVector(uint8_t channel, float *data, uint8_t length) const;
+
+        /**
+         * Data filters using averaging windows, applied in place
          */
         void _SetAcceleration(float *acc);
         void _SetGyroscope(float *gyro);
 
-
+        static void _DataReadyISR();
+        static bool _EdgePending();
+        uint64_t _LastEdgeUs() const;
+        static void _CaptureFifo(void *context, const unsigned char *data,
+                                 uint_fast16_t len);
 
         bool _initialized;
 
-        //  Linear acceleration [x,y,z] in m/s^2
-        volatile float _acc[3];
-        //  Gyroscope readings in degrees-per-second [x,y,z]
-        volatile float _gyro[3];
-        //  Magnetometer readings [x,y,z] in
-        volatile float _mag[3];
-        //  Gravity vector
-        volatile float _gv[3];
-        //  Quaternions(w,x,y,z) and their accuracy
-        volatile float _quat9DOF[4];
-        volatile float _quat9DOFaccuracy;
-        volatile float _quat6DOF[4];
-        volatile float _quat6DOFaccuracy;
+        //  Timestamps (in HAL_BOARD_TimeCycles) of data-ready edges not yet
+        //  consumed by main loop
+        SPSCQueue<uint64_t, 8> _drdyQueue;
+        //  Optional user hook called from data-ready interrupt
+        void (*_drdyHook)(uint64_t);
+        //  Time (in us) of the latest data-ready edge, written by interrupt,
+        //  read through _LastEdgeUs
+        volatile uint64_t _lastEdgeUs;
+        //  Time (in us) of the latest edge consumed by main loop but not yet
+        //  passed to driver by ReadSensorData, 0 if none
+        uint64_t _pendingEdgeUs;
+        //  Jitter of intervals between edges, whether it's being collected and
+        //  time of previous edge in cycles
+        JitterHistogram _jitter;
+        volatile bool _jitterOn;
+        uint64_t _prevEdgeCycles;
+
+        //  Period of every enabled sensor in ms (0 if disabled)
+        uint32_t _sensorPeriod[INV_ICM20948_SENSOR_MAX];
+        //  Batch timeout in ms (0 if batching is disabled) and FIFO watermark
+        uint16_t _batchTimeoutMs;
+        uint16_t _batchWatermark;
+        //  FIFO capture sink, and time of the last record written to it
+        void (*_captureWriter)(const uint8_t *, uint16_t);
+        uint64_t _captureLastUs;
+
+        //  Every sample produced since last PopSamples, and the latest one, for
+        //  each of the channels. Units: acceleration in m/s^2, gyroscope in
+        //  degrees-per-second, magnetometer in uT, gravity vector in g's,
+        //  quaternions (w,x,y,z)
+        SPSCQueue<Sample, ICM20948_SAMPLE_QUEUE_LEN> _samples[_ChCount];
+        SeqLock<Sample> _latest[_ChCount];
+        //  User hook for each sensor (quaternion or vector, as per its route)
+        Vector3Hook _sensorHook[INV_ICM20948_SENSOR_MAX];
+        //  Math used by GetOrientationRPY
+        OrientationMath _orientationMath;
 
 };
 
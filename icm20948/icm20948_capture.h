@@ -0,0 +1,43 @@
+/**
+ * icm20948_capture.h
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Binary format of raw DMP FIFO captures produced by ICM20948::StartCapture.
+ *  Capture starts with ICM20948CaptureHeader describing configuration needed
+ *  to decode the data, followed by a record for every burst read from FIFO:
+ *      uint32_t    Time since previous record in us (since startTimeUs for the
+ *                  first one), taken at the data-ready interrupt which
+ *                  preceded the read
+ *      uint16_t    Number of FIFO bytes in the record
+ *      uint8_t[]   FIFO bytes, exactly as read from REG_FIFO_R_W
+ *  All fields are little-endian. Kept plain C so that host tools can use it.
+ */
+#ifndef ICM20948_CAPTURE_H_
+#define ICM20948_CAPTURE_H_
+
+#include <stdint.h>
+
+#define ICM20948_CAPTURE_MAGIC      0x50434349  //  "ICCP"
+#define ICM20948_CAPTURE_VERSION    1
+//  Number of sensor slots in header, at least INV_ICM20948_SENSOR_MAX
+#define ICM20948_CAPTURE_SENSORS    32
+//  Size of a record header (delta time + length)
+#define ICM20948_CAPTURE_RECORD_HDR 6
+
+typedef struct
+{
+    uint32_t    magic;
+    uint16_t    version;
+    uint16_t    headerSize;     //  Size of this header in bytes
+    uint64_t    startTimeUs;    //  Time at which capture was started
+    uint16_t    accelFsr;       //  Accelerometer full-scale range in g
+    uint16_t    gyroFsr;        //  Gyroscope full-scale range in dps
+    uint32_t    reserved;
+    //  Period in ms of every enabled sensor (0 if disabled), indexed by
+    //  inv_icm20948_sensor
+    uint32_t    sensorPeriodMs[ICM20948_CAPTURE_SENSORS];
+} ICM20948CaptureHeader;
+
+#endif /* ICM20948_CAPTURE_H_ */
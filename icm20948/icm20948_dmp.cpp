@@ -11,11 +11,13 @@
 #include "HAL/hal.h"
 #include "libs/myLib.h"
 #include "libs/helper_3dmath.h"
-#include "libs/linkedlist.hpp"
+#include "libs/medianfilter.hpp"
 #include <cstdio>
 
 #include "Invn/Devices/Drivers/Icm20948/Icm20948.h"
 #include "Invn/Devices/Drivers/Icm20948/Icm20948MPUFifoControl.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948DataBaseControl.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948Dmp3Driver.h"
 #include "Invn/Devices/Drivers/Ak0991x/Ak0991x.h"
 #include "Invn/Devices/SensorTypes.h"
 #include "Invn/Devices/SensorConfig.h"
@@ -42,6 +44,8 @@
 #define CHIP_SELECT                 1
 #endif
 
+#define DMP_DEFAULT_FIFO_WATERMARK  800     /* FIFO watermark set by DMP init, in bytes */
+
 #define ICM_I2C_ADDR_REVA           0x68    /* I2C slave address for INV device on Rev A board */
 #define ICM_I2C_ADDR_REVB           0x69    /* I2C slave address for INV device on Rev B board */
 
@@ -60,6 +64,9 @@
 static const uint8_t dmp3_image[] = {
 #include "Invn/icm20948_img.dmp3a.h"
 };
+//  CRC-32 of dmp3_image used to verify firmware after loading, has to be
+//  updated whenever image changes (0 to have it computed on every load)
+static const uint32_t dmp3_image_crc = 0x2E7D42E6;
 
 /*
 * Just a handy variable to handle the icm20948 object
@@ -86,29 +93,6 @@ static float cfg_mounting_matrix[9]= {
 };
 
 
-static uint8_t convert_to_generic_ids[INV_ICM20948_SENSOR_MAX] = {
-    INV_SENSOR_TYPE_ACCELEROMETER,
-    INV_SENSOR_TYPE_GYROSCOPE,
-    INV_SENSOR_TYPE_RAW_ACCELEROMETER,
-    INV_SENSOR_TYPE_RAW_GYROSCOPE,
-    INV_SENSOR_TYPE_UNCAL_MAGNETOMETER,
-    INV_SENSOR_TYPE_UNCAL_GYROSCOPE,
-    INV_SENSOR_TYPE_BAC,
-    INV_SENSOR_TYPE_STEP_DETECTOR,
-    INV_SENSOR_TYPE_STEP_COUNTER,
-    INV_SENSOR_TYPE_GAME_ROTATION_VECTOR,
-    INV_SENSOR_TYPE_ROTATION_VECTOR,
-    INV_SENSOR_TYPE_GEOMAG_ROTATION_VECTOR,
-    INV_SENSOR_TYPE_MAGNETOMETER,
-    INV_SENSOR_TYPE_SMD,
-    INV_SENSOR_TYPE_PICK_UP_GESTURE,
-    INV_SENSOR_TYPE_TILT_DETECTOR,
-    INV_SENSOR_TYPE_GRAVITY,
-    INV_SENSOR_TYPE_LINEAR_ACCELERATION,
-    INV_SENSOR_TYPE_ORIENTATION,
-    INV_SENSOR_TYPE_B2S
-};
-
 static uint8_t icm20948_get_grv_accuracy(void)
 {
     uint8_t accel_accuracy;
@@ -138,6 +122,39 @@ void switch_I2C_to_revA(void)
     return;
 }
 
+/*
+ * Reset icm20948 driver states and attach it to serial interface from HAL
+ */
+static void icm20948_reset_driver(void)
+{
+    /*
+    * Initialize icm20948 serif structure
+    */
+    struct inv_icm20948_serif icm20948_serif;
+    icm20948_serif.context   = 0; /* no need */
+    icm20948_serif.read_reg  = HAL_MPU_ReadBytes;
+    icm20948_serif.write_reg = HAL_MPU_WriteBytes;
+    icm20948_serif.max_read  = 1024*16; /* maximum number of bytes allowed per serial read */
+    icm20948_serif.max_write = 1024*16; /* maximum number of bytes allowed per serial write */
+
+    icm20948_serif.is_spi = interface_is_SPI();
+
+    /*
+     * Reset icm20948 driver states (release previous instance first as this
+     * can be called more than once per boot)
+     */
+    icm20948_instance = 0;
+    inv_icm20948_reset_states(&icm_device, &icm20948_serif);
+    //  Chip might have been left in any register bank, don't trust caches
+    inv_icm20948_transport_init(&icm_device);
+
+    //  Verify firmware by comparing CRC of read-back memory instead of image
+    inv_icm20948_firmware_set_verify(&icm_device, INV_ICM20948_FW_VERIFY_CRC,
+                                     dmp3_image_crc);
+
+    inv_icm20948_register_aux_compass(&icm_device, INV_ICM20948_COMPASS_ID_AK09916, AK0991x_DEFAULT_I2C_ADDR);
+}
+
 /* Extra functions from i2cdevlib from github:
  * https://github.com/jrowberg/i2cdevlib/tree/master/Arduino/MPU9150
  */
@@ -164,112 +181,110 @@ uint8_t dmp_GetYawPitchRoll(float *data, Quaternion *q, VectorFloat *gravity) {
 }
 
 /**
- * Process received data from the IMU an save it into appropriate buffers
- * @param context
- * @param sensortype
- * @param timestamp
- * @param data
- * @param arg
+ * Converters of driver's sensor output into a float vector/quaternion and its
+ * accuracy, one for each kind of data driver passes to the handler
+ * @param data Data as passed to build_sensor_event_data
+ * @param arg Argument as passed to build_sensor_event_data (accuracy)
+ * @param out Buffer for 3-element vector or 4-element quaternion
+ * @param accuracy Accuracy of the data
  */
-void build_sensor_event_data(void * context, inv_icm20948_sensor sensortype, uint64_t timestamp, const void * data, const void *arg)
+static void convert_vector(const void *data, const void *arg, float *out, float *accuracy)
 {
-    float raw_bias_data[6];
-    inv_sensor_event_t event;
-    (void)context;
-    uint8_t sensor_id = convert_to_generic_ids[sensortype];
+    //  Uncalibrated sensors pass [x,y,z,bias_x,bias_y,bias_z], bias is dropped
+    memcpy((void*)out, data, 3*sizeof(float));
+    *accuracy = (arg != 0) ? (float)*(const int*)arg : 0.0;
+}
 
-    memset((void *)&event, 0, sizeof(event));
-    event.sensor = sensor_id;
-    event.timestamp = timestamp;
-    switch(sensor_id)
-    {
-        case INV_SENSOR_TYPE_UNCAL_GYROSCOPE:
-            memcpy(raw_bias_data, data, sizeof(raw_bias_data));
-            memcpy(event.data.gyr.vect, &raw_bias_data[0], sizeof(event.data.gyr.vect));
-            memcpy(event.data.gyr.bias, &raw_bias_data[3], sizeof(event.data.gyr.bias));
-            memcpy(&(event.data.gyr.accuracy_flag), arg, sizeof(event.data.gyr.accuracy_flag));
-            break;
-        case INV_SENSOR_TYPE_UNCAL_MAGNETOMETER:
-            memcpy(raw_bias_data, data, sizeof(raw_bias_data));
-            memcpy(event.data.mag.vect, &raw_bias_data[0], sizeof(event.data.mag.vect));
-            memcpy(event.data.mag.bias, &raw_bias_data[3], sizeof(event.data.mag.bias));
-            memcpy(&(event.data.gyr.accuracy_flag), arg, sizeof(event.data.gyr.accuracy_flag));
-            break;
-        case INV_SENSOR_TYPE_GYROSCOPE:
-            memcpy(event.data.gyr.vect, data, sizeof(event.data.gyr.vect));
-            memcpy(&(event.data.gyr.accuracy_flag), arg, sizeof(event.data.gyr.accuracy_flag));
-            memcpy((void*)&ICM20948::GetI()._gyro, event.data.gyr.vect, sizeof(event.data.gyr.vect));
-            //  Alternatively, update acceleration data through a median filter
-            //  using the call
-            //ICM20948::GetI()._SetGyroscope(event.data.gyr.vect);
-            break;
-        case INV_SENSOR_TYPE_GRAVITY:
-            memcpy(event.data.acc.vect, data, sizeof(event.data.acc.vect));
-            event.data.acc.accuracy_flag = inv_icm20948_get_accel_accuracy();
-            memcpy((void*)ICM20948::GetI()._gv, event.data.acc.vect, sizeof(event.data.acc.vect));
-            break;
-        case INV_SENSOR_TYPE_ACCELEROMETER:
+static void convert_accel(const void *data, const void *arg, float *out, float *accuracy)
+{
+    convert_vector(data, arg, out, accuracy);
 
-        case INV_SENSOR_TYPE_LINEAR_ACCELERATION:
-            memcpy(event.data.acc.vect, data, sizeof(event.data.acc.vect));
-            memcpy(&(event.data.acc.accuracy_flag), arg, sizeof(event.data.acc.accuracy_flag));
-            memcpy((void*)&ICM20948::GetI()._acc, event.data.acc.vect, sizeof(event.data.acc.vect));
-            //  Alternatively, update acceleration data through a median filter
-            //  using the call
-            //ICM20948::GetI()._SetAcceleration(event.data.acc.vect);
+    //  Acceleration is returned in G's
+    out[0] *= GRAVITY_CONST;
+    out[1] *= GRAVITY_CONST;
+    out[2] *= GRAVITY_CONST;
+}
 
-            break;
-        case INV_SENSOR_TYPE_MAGNETOMETER:
-            memcpy(event.data.mag.vect, data, sizeof(event.data.mag.vect));
-            memcpy(&(event.data.mag.accuracy_flag), arg, sizeof(event.data.mag.accuracy_flag));
-            memcpy((void*)ICM20948::GetI()._mag, event.data.mag.vect, sizeof(event.data.mag.vect));
-            break;
-        case INV_SENSOR_TYPE_GEOMAG_ROTATION_VECTOR:
-            break;
-        case INV_SENSOR_TYPE_ROTATION_VECTOR:
-            memcpy(&(event.data.quaternion.accuracy), arg, sizeof(event.data.quaternion.accuracy));
-            memcpy(event.data.quaternion.quat, data, sizeof(event.data.quaternion.quat));
-            memcpy((void*)ICM20948::GetI()._quat9DOF, event.data.quaternion.quat, sizeof(event.data.quaternion.quat));
-            memcpy((void*)&ICM20948::GetI()._quat9DOFaccuracy, (void*)&(event.data.quaternion.accuracy), sizeof(event.data.quaternion.accuracy));
-            break;
-        case INV_SENSOR_TYPE_GAME_ROTATION_VECTOR:
-            memcpy(event.data.quaternion.quat, data, sizeof(event.data.quaternion.quat));
-            event.data.quaternion.accuracy_flag = icm20948_get_grv_accuracy();
-            memcpy((void*)ICM20948::GetI()._quat6DOF, event.data.quaternion.quat, sizeof(event.data.quaternion.quat));
-            float tmpAccuracy = (float)event.data.quaternion.accuracy;
-            memcpy((void*)&ICM20948::GetI()._quat6DOFaccuracy, (void*)&tmpAccuracy, sizeof(tmpAccuracy));
-            break;
-        case INV_SENSOR_TYPE_BAC:
-            memcpy(&(event.data.bac.event), data, sizeof(event.data.bac.event));
-            break;
-        case INV_SENSOR_TYPE_PICK_UP_GESTURE:
-        case INV_SENSOR_TYPE_TILT_DETECTOR:
-        case INV_SENSOR_TYPE_STEP_DETECTOR:
-        case INV_SENSOR_TYPE_SMD:
-            event.data.event = true;
-            break;
-        case INV_SENSOR_TYPE_B2S:
-            event.data.event = true;
-            memcpy(&(event.data.b2s.direction), data, sizeof(event.data.b2s.direction));
-            break;
-        case INV_SENSOR_TYPE_STEP_COUNTER:
-            memcpy(&(event.data.step.count), data, sizeof(event.data.step.count));
-            break;
-        case INV_SENSOR_TYPE_ORIENTATION:
-            //we just want to copy x,y,z from orientation data
-            memcpy(&(event.data.orientation), data, 3*sizeof(float));
-            break;
-        case INV_SENSOR_TYPE_RAW_ACCELEROMETER:
-            memcpy(event.data.raw3d.vect, data, sizeof(event.data.raw3d.vect));
-            memcpy(&(event.data.acc.accuracy_flag), arg, sizeof(event.data.acc.accuracy_flag));
-            break;
-        case INV_SENSOR_TYPE_RAW_GYROSCOPE:
-            memcpy(event.data.raw3d.vect, data, sizeof(event.data.raw3d.vect));
-            break;
-        default:
-            return;
-    }
+static void convert_quat(const void *data, const void *arg, float *out, float *accuracy)
+{
+    memcpy((void*)out, data, 4*sizeof(float));
+    *accuracy = *(const float*)arg;
+}
+
+static void convert_quat_grv(const void *data, const void *arg, float *out, float *accuracy)
+{
+    (void)arg;
+    memcpy((void*)out, data, 4*sizeof(float));
+    *accuracy = (float)icm20948_get_grv_accuracy();
+}
+
+/**
+ * Route of every sensor type through build_sensor_event_data, indexed by
+ * inv_icm20948_sensor. Types without converter (events, raw data in LSBs) are
+ * not supported and dropped
+ */
+const ICM20948::_SensorRoute ICM20948::_sensorRoute[INV_ICM20948_SENSOR_MAX] =
+{
+    { convert_accel,    3, ICM20948::_ChAccel },        //  ACCELEROMETER
+    { convert_vector,   3, ICM20948::_ChGyro },         //  GYROSCOPE
+    { 0,                0, -1 },                        //  RAW_ACCELEROMETER
+    { 0,                0, -1 },                        //  RAW_GYROSCOPE
+    { convert_vector,   3, -1 },                        //  MAGNETIC_FIELD_UNCALIBRATED
+    { convert_vector,   3, -1 },                        //  GYROSCOPE_UNCALIBRATED
+    { 0,                0, -1 },                        //  ACTIVITY_CLASSIFICATON
+    { 0,                0, -1 },                        //  STEP_DETECTOR
+    { 0,                0, -1 },                        //  STEP_COUNTER
+    { convert_quat_grv, 4, ICM20948::_ChQuat6DOF },     //  GAME_ROTATION_VECTOR
+    { convert_quat,     4, ICM20948::_ChQuat9DOF },     //  ROTATION_VECTOR
+    { convert_quat,     4, -1 },                        //  GEOMAGNETIC_ROTATION_VECTOR
+    { convert_vector,   3, ICM20948::_ChMag },          //  GEOMAGNETIC_FIELD
+    { 0,                0, -1 },                        //  WAKEUP_SIGNIFICANT_MOTION
+    { 0,                0, -1 },                        //  FLIP_PICKUP
+    { 0,                0, -1 },                        //  WAKEUP_TILT_DETECTOR
+    { convert_vector,   3, ICM20948::_ChGravity },      //  GRAVITY
+    { convert_accel,    3, ICM20948::_ChLinearAccel },  //  LINEAR_ACCELERATION
+    { convert_vector,   3, -1 },                        //  ORIENTATION
+    { 0,                0, -1 },                        //  B2S
+};
 
+/**
+ * Process received data from the IMU and save it into appropriate buffers
+ * Called by the driver for every sample decoded from FIFO. Sensor's route is
+ * looked up in a table, and sample is converted only if it's either kept by
+ * the class or user has registered a hook for it
+ * @param context Pointer to ICM20948 object
+ * @param sensortype Sensor which produced the sample
+ * @param timestamp Timestamp of the sample in us
+ * @param data Sample data
+ * @param arg Accuracy of the sample
+ */
+void build_sensor_event_data(void * context, inv_icm20948_sensor sensortype, uint64_t timestamp, const void * data, const void *arg)
+{
+    ICM20948 &imu = *(ICM20948*)context;
+    const ICM20948::_SensorRoute *route;
+    ICM20948::Vector3Hook hook;
+    ICM20948::Sample sample;
+
+    if ((uint8_t)sensortype >= INV_ICM20948_SENSOR_MAX)
+        return;
+
+    route = &ICM20948::_sensorRoute[sensortype];
+    hook = imu._sensorHook[sensortype];
+    if ((route->channel < 0) && (hook == 0))
+        return;
+
+    //  Sample is converted in place, only unused element has to be cleared
+    sample.timestamp = timestamp;
+    sample.data[3] = 0;
+    route->convert(data, arg, sample.data, &sample.accuracy);
+    //  Alternatively, accelerometer & gyroscope data can be passed through a
+    //  median filter here, using imu._SetAcceleration(sample.data) or
+    //  imu._SetGyroscope(sample.data)
+
+    if (route->channel >= 0)
+        imu._Publish(route->channel, sample);
+    if (hook != 0)
+        hook(sensortype, timestamp, sample.data, sample.accuracy);
 }
 
 
@@ -317,6 +332,7 @@ int8_t ICM20948::InitHW()
 {
     HAL_MPU_Init();
     HAL_MPU_PowerSwitch(true);
+    HAL_MPU_IntRegister(ICM20948::_DataReadyISR);
 
     return MPU_SUCCESS;
 }
@@ -360,43 +376,64 @@ int8_t ICM20948::SetMountingMatrix(float *mountMatrix)
     if (_initialized)
         return MPU_NOT_ALLOWED;
 
-    memcpy((void*)mountMatrix, (void*)cfg_mounting_matrix, sizeof(cfg_mounting_matrix));
+    memcpy((void*)cfg_mounting_matrix, (void*)mountMatrix, sizeof(cfg_mounting_matrix));
 
     return MPU_SUCCESS;
 }
 
+/**
+ * Select math used by GetOrientationRPY, can be changed at any time
+ * @param math OrientationMathLibm (default) or OrientationMathFast
+ */
+void ICM20948::SetOrientationMath(OrientationMath math)
+{
+    _orientationMath = math;
+}
+
 /**
  * Initialize MPU sensor, load DMP firmware and configure DMP output. Prior to
- * any software initialization, this function power-cycles the board
+ * any software initialization, this function power-cycles the board.
+ * On warm restart (MCU was reset but MPU stayed powered) power cycle and
+ * firmware loading are skipped if DMP memory still holds the image, only
+ * sensor control registers are reconfigured
+ * @param warmRestart true to try to reuse firmware already loaded in DMP
  * @return One of MPU_* error codes
  */
-int8_t ICM20948::InitSW()
+int8_t ICM20948::InitSW(bool warmRestart)
 {
+    bool dmpIntact = false;
 
-    //  Power cycle MPU chip on every SW initialization
-    HAL_MPU_PowerSwitch(false);
-    HAL_DelayUS(20000);
-    HAL_MPU_PowerSwitch(true);
-    HAL_DelayUS(30000);
+    //  Driver is reset below, taking sensor configuration & FIFO capture with it
+    _captureWriter = 0;
+    memset((void*)_sensorPeriod, 0, sizeof(_sensorPeriod));
+    _batchTimeoutMs = 0;
 
-    /*
-    * Initialize icm20948 serif structure
-    */
-    struct inv_icm20948_serif icm20948_serif;
-    icm20948_serif.context   = 0; /* no need */
-    icm20948_serif.read_reg  = HAL_MPU_ReadBytes;
-    icm20948_serif.write_reg = HAL_MPU_WriteBytes;
-    icm20948_serif.max_read  = 1024*16; /* maximum number of bytes allowed per serial read */
-    icm20948_serif.max_write = 1024*16; /* maximum number of bytes allowed per serial write */
+    if (warmRestart)
+    {
+        icm20948_reset_driver();
 
-    icm20948_serif.is_spi = interface_is_SPI();
+        //  Only reading back DMP memory, so it's safe to do it at full speed
+        HAL_MPU_SetBusSpeed(HAL_MPU_BUS_SPEED_FAST);
+        dmpIntact = (inv_icm20948_firmware_probe(&icm_device, dmp3_image,
+                                        sizeof(dmp3_image), DMP_LOAD_START) == 1);
+#ifdef __DEBUG_SESSION__
+        DEBUG_WRITE("Warm restart, DMP image %s\n", dmpIntact ? "intact" : "lost");
+#endif
+    }
 
-    /*
-     * Reset icm20948 driver states
-     */
-    inv_icm20948_reset_states(&icm_device, &icm20948_serif);
+    //  Firmware is loaded and verified at conservative bus speed
+    HAL_MPU_SetBusSpeed(HAL_MPU_BUS_SPEED_SAFE);
 
-    inv_icm20948_register_aux_compass(&icm_device, INV_ICM20948_COMPASS_ID_AK09916, AK0991x_DEFAULT_I2C_ADDR);
+    if (!dmpIntact)
+    {
+        //  Power cycle MPU chip on every cold SW initialization
+        HAL_MPU_PowerSwitch(false);
+        HAL_DelayUS(20000);
+        HAL_MPU_PowerSwitch(true);
+        HAL_DelayUS(30000);
+
+        icm20948_reset_driver();
+    }
 
     /*
      * Setup the icm20948 device
@@ -455,6 +492,15 @@ int8_t ICM20948::InitSW()
 #endif
         return MPU_ERROR;
     }
+#ifdef __DEBUG_SESSION__
+    {
+        struct inv_icm20948_fw_load fwInfo;
+        inv_icm20948_firmware_get_load_info(&icm_device, &fwInfo);
+        DEBUG_WRITE("DMP3 loaded: %u B, write %u us, verify %u us\n",
+                    fwInfo.bytes_written, fwInfo.write_time_us,
+                    fwInfo.verify_time_us);
+    }
+#endif
 
     /*
     * Configure and initialize the ICM20948 for normal use
@@ -520,11 +566,56 @@ int8_t ICM20948::InitSW()
     }
 #endif
 
+    //  Steady-state FIFO reads run at full speed
+    HAL_MPU_SetBusSpeed(HAL_MPU_BUS_SPEED_FAST);
+
     _initialized = true;
 
     return MPU_SUCCESS;
 }
 
+/**
+ * Measure throughput achieved on the serial bus at given clock
+ * Repeatedly reads a block of DMP memory through the driver, so that bank
+ * switching and addressing overhead is included, and times it. Bus clock is
+ * restored to previous value afterwards. Has to be called after InitSW.
+ * @param speed Bus clock in Hz to benchmark
+ * @return Achieved throughput in bytes/s, 0 on error
+ */
+uint32_t ICM20948::MeasureBusThroughput(uint32_t speed)
+{
+    static uint8_t buffer[256];
+    struct inv_icm20948_bus_stats before, after;
+    uint32_t prevSpeed = HAL_MPU_GetBusSpeed();
+    uint64_t start, elapsed;
+    uint32_t bytes;
+    int rc = 0;
+
+    if (!_initialized)
+        return 0;
+
+    HAL_MPU_SetBusSpeed(speed);
+    inv_icm20948_get_bus_stats(&icm_device, &before);
+
+    start = inv_icm20948_get_time_us();
+    for (uint8_t i = 0; i < 32; i++)
+        rc |= inv_icm20948_read_mems(&icm_device, DMP_LOAD_START,
+                                     sizeof(buffer), buffer);
+    elapsed = inv_icm20948_get_time_us() - start;
+
+    inv_icm20948_get_bus_stats(&icm_device, &after);
+    HAL_MPU_SetBusSpeed(prevSpeed);
+
+    if ((rc != 0) || (elapsed == 0))
+        return 0;
+
+    //  Count everything that went over the bus, including bank selection
+    bytes = (after.bytes_read - before.bytes_read)
+          + (after.bytes_written - before.bytes_written);
+
+    return (uint32_t)(((uint64_t)bytes * 1000000) / elapsed);
+}
+
 /**
  * Control power supply of the ICM20948
  * Enable or disable power supply of the ICM20948 using external MOSFET
@@ -548,6 +639,109 @@ bool ICM20948::IsDataReady()
     return HAL_MPU_DataAvail();
 }
 
+/**
+ * Wait for ICM20948 to signal new data through data-ready interrupt
+ * All pending data-ready events are consumed, as a single FIFO read will
+ * retrieve everything that has accumulated in the meantime. Core sleeps while
+ * waiting (HAL_BOARD_IdleUntil), woken up by the interrupt or timeout
+ * @param timeoutUs Maximum time to wait in microseconds
+ * @param timestamp (optional) Time in us at which the latest data-ready edge
+ *        was captured
+ * @return true if new sensor data is available
+ *        false if timeout expired
+ */
+bool ICM20948::WaitForData(uint32_t timeoutUs, uint64_t *timestamp)
+{
+    uint64_t start = inv_icm20948_get_time_us();
+    uint64_t edgeTime = 0;
+
+    while (_drdyQueue.Empty())
+    {
+        if ((inv_icm20948_get_time_us() - start) >= timeoutUs)
+            return false;
+        HAL_BOARD_IdleUntil(start + timeoutUs, _EdgePending);
+    }
+
+    while (_drdyQueue.Pop(edgeTime));
+
+    //  Samples read by next ReadSensorData are timestamped with this edge
+    _pendingEdgeUs = HAL_BOARD_CyclesToUS(edgeTime);
+    if (timestamp != 0)
+        *timestamp = _pendingEdgeUs;
+
+    return true;
+}
+
+/**
+ * Time at which the next data-ready edge is expected: the latest edge plus
+ * period of the fastest enabled sensor (as estimated from edges, or nominal
+ * until there's an estimate), or batch timeout while batching
+ * @return Time in us, 0 if there's no edge to expect
+ */
+uint64_t ICM20948::NextDataUs()
+{
+    uint64_t lastUs = _LastEdgeUs();
+    uint32_t periodMs = 0;
+    float periodUs = 0;
+    uint8_t fastest = 0;
+
+    for (uint8_t i = 0; i < INV_ICM20948_SENSOR_MAX; i++)
+        if ((_sensorPeriod[i] != 0) &&
+            ((periodMs == 0) || (_sensorPeriod[i] < periodMs)))
+        {
+            periodMs = _sensorPeriod[i];
+            fastest = i;
+        }
+
+    if ((periodMs == 0) || (lastUs == 0))
+        return 0;
+    if (_batchTimeoutMs != 0)
+        return lastUs + (uint64_t)_batchTimeoutMs * 1000;
+    if (GetSamplePeriod((inv_icm20948_sensor)fastest, &periodUs) != MPU_SUCCESS)
+        periodUs = periodMs * 1000.0f;
+
+    return lastUs + (uint64_t)(periodUs + 0.5f);
+}
+
+/**
+ * Register function to be called on each data-ready interrupt
+ * @param custHook Function to call, receives time of the edge in us. Executed
+ *        in interrupt context so it should be kept short
+ */
+void ICM20948::OnDataReady(void((*custHook)(uint64_t)))
+{
+    _drdyHook = custHook;
+}
+
+/**
+ * Start collecting histogram of intervals between data-ready edges (Jitter),
+ * dropping anything collected so far
+ * @param periodUs Expected interval in us: sensor period, or batch timeout
+ *        when batching. 0 stops collecting
+ * @param binNs Width of histogram bin in ns
+ */
+void ICM20948::MeasureJitter(uint32_t periodUs, uint32_t binNs)
+{
+    uint32_t cyclesPerUs = g_ui32SysClock / 1000000;
+    uint64_t binCycles = ((uint64_t)binNs * cyclesPerUs + 999) / 1000;
+
+    //  Interrupt leaves histogram alone while it's being reconfigured
+    _jitterOn = false;
+    _jitter.Configure((int64_t)periodUs * cyclesPerUs, (uint32_t)binCycles);
+    _prevEdgeCycles = 0;
+    _jitterOn = (periodUs != 0);
+}
+
+/**
+ * Histogram of intervals between data-ready edges since MeasureJitter, in
+ * cycles of HAL_BOARD_TimeCycles (g_ui32SysClock per second). Interrupt keeps
+ * updating it, so values read while it's running might not be consistent
+ */
+const ICM20948::JitterHistogram& ICM20948::Jitter() const
+{
+    return _jitter;
+}
+
 /**
  * Enable sensors and set its sampling rate
  * @param sensor Sensor to enable
@@ -561,6 +755,13 @@ int8_t ICM20948::EnableSensor(inv_icm20948_sensor sensor, uint32_t period)
     retVal = inv_icm20948_enable_sensor(&icm_device, sensor, 1);
     retVal |= inv_icm20948_set_sensor_period(&icm_device, sensor, period);
 
+    if (retVal == 0)
+        _sensorPeriod[sensor] = period;
+
+    //  Batch size is counted in samples, recalculate it for the new rate
+    if ((retVal == 0) && (_batchTimeoutMs != 0))
+        retVal = EnableBatching(_batchTimeoutMs, _batchWatermark);
+
     return retVal;
 }
 
@@ -575,26 +776,289 @@ int8_t ICM20948::DisableSensor(inv_icm20948_sensor sensor)
 
     retVal = inv_icm20948_enable_sensor(&icm_device, sensor, 0);
 
+    if (retVal == 0)
+        _sensorPeriod[sensor] = 0;
+
+    //  Batch size is counted in samples, recalculate it for the new rate
+    if ((retVal == 0) && (_batchTimeoutMs != 0))
+        if (EnableBatching(_batchTimeoutMs, _batchWatermark) != MPU_SUCCESS)
+            retVal = DisableBatching();
+
     return retVal;
 }
 
+/**
+ * Enable batching of sensor data in DMP
+ * Instead of raising data-ready interrupt for every sample, DMP keeps samples
+ * in its FIFO and interrupts once per batch, when timeout has passed or FIFO
+ * has filled up to the watermark, whichever comes first. Every ReadSensorData
+ * then drains the whole batch in one go. Has to be called after the sensors
+ * are enabled, and ICM20948_SAMPLE_QUEUE_LEN should be large enough to hold
+ * all samples of a batch if PopSamples is used.
+ * @param timeoutMs Max time in ms between two interrupts, can't be shorter
+ *        than the period of the fastest sensor enabled
+ * @param watermark FIFO fill level in bytes at which DMP interrupts regardless
+ *        of timeout (0 to keep default of 800 bytes)
+ * @return One of MPU_* error codes
+ */
+int8_t ICM20948::EnableBatching(uint16_t timeoutMs, uint16_t watermark)
+{
+    int rc;
+
+    if (watermark == 0)
+        watermark = DMP_DEFAULT_FIFO_WATERMARK;
+    if ((timeoutMs == 0) || (watermark > FIFO_SIZE))
+        return MPU_NOT_ALLOWED;
+
+    //  Group DMP configuration writes so LP_EN is toggled only once
+    inv_icm20948_transport_begin(&icm_device);
+    //  Fails if no sensor is enabled, or timeout is shorter than sensor period
+    rc = inv_icm20948_ctrl_set_batch_timeout_ms(&icm_device, timeoutMs);
+    if (rc == 0)
+    {
+        rc |= dmp_icm20948_set_FIFO_watermark(&icm_device, watermark);
+        rc |= inv_icm20948_ctrl_enable_batch(&icm_device, 1);
+    }
+    rc |= inv_icm20948_transport_end(&icm_device);
+
+    if (rc != 0)
+        return MPU_ERROR;
+
+    _batchTimeoutMs = timeoutMs;
+    _batchWatermark = watermark;
+
+    return MPU_SUCCESS;
+}
+
+/**
+ * Disable batching of sensor data, DMP interrupts on every sample again
+ * @return One of MPU_* error codes
+ */
+int8_t ICM20948::DisableBatching()
+{
+    int rc;
+
+    inv_icm20948_transport_begin(&icm_device);
+    rc = inv_icm20948_ctrl_enable_batch(&icm_device, 0);
+    rc |= dmp_icm20948_set_FIFO_watermark(&icm_device,
+                                          DMP_DEFAULT_FIFO_WATERMARK);
+    rc |= inv_icm20948_transport_end(&icm_device);
+
+    _batchTimeoutMs = 0;
+
+    return (rc == 0) ? MPU_SUCCESS : MPU_ERROR;
+}
+
+/**
+ * Register hook receiving every sample of a quaternion-type sensor
+ * Hook is called from the context which calls ReadSensorData, with
+ * quaternion in format (w,x,y,z). Supported sensors are game rotation vector,
+ * rotation vector and geomagnetic rotation vector
+ * @param sensor Sensor to subscribe to
+ * @param hook Function to call, or 0 to unsubscribe
+ * @return One of MPU_* error codes
+ */
+int8_t ICM20948::OnQuaternion(inv_icm20948_sensor sensor, QuaternionHook hook)
+{
+    if (((uint8_t)sensor >= INV_ICM20948_SENSOR_MAX) ||
+        (_sensorRoute[sensor].length != 4))
+        return MPU_NOT_ALLOWED;
+
+    _sensorHook[sensor] = hook;
+
+    return MPU_SUCCESS;
+}
+
+/**
+ * Register hook receiving every sample of a 3D-vector sensor
+ * Hook is called from the context which calls ReadSensorData, with vector in
+ * the same units as the getters return it (e.g. acceleration in m/s^2).
+ * Supported sensors are accelerometer, gyroscope, magnetometer (incl.
+ * uncalibrated ones, without bias), gravity, linear acceleration and
+ * orientation
+ * @param sensor Sensor to subscribe to
+ * @param hook Function to call, or 0 to unsubscribe
+ * @return One of MPU_* error codes
+ */
+int8_t ICM20948::OnVector3(inv_icm20948_sensor sensor, Vector3Hook hook)
+{
+    if (((uint8_t)sensor >= INV_ICM20948_SENSOR_MAX) ||
+        (_sensorRoute[sensor].length != 3))
+        return MPU_NOT_ALLOWED;
+
+    _sensorHook[sensor] = hook;
+
+    return MPU_SUCCESS;
+}
+
+/**
+ * Take samples of a sensor produced since the last call, oldest first
+ * Every sensor has its own queue of ICM20948_SAMPLE_QUEUE_LEN-1 samples which
+ * is filled by ReadSensorData. When queue is full newest samples are dropped
+ * (and counted, see SampleOverflows) while the latest one is still available
+ * through GetLatest. Queue is lock-free as long as only one context calls
+ * PopSamples and only one calls ReadSensorData for the same sensor.
+ * Samples are kept for accelerometer, linear acceleration, gyroscope,
+ * magnetometer, gravity, game rotation vector and rotation vector
+ * @param sensor Sensor whose samples to take
+ * @param buf Buffer to store samples in
+ * @param max Max number of samples to store in the buffer
+ * @return Number of samples stored in the buffer
+ */
+uint16_t ICM20948::PopSamples(inv_icm20948_sensor sensor, Sample *buf,
+                              uint16_t max)
+{
+    int8_t channel = _Channel(sensor);
+    uint16_t count = 0;
+
+    if (channel < 0)
+        return 0;
+
+    while ((count < max) && _samples[channel].Pop(buf[count]))
+        count++;
+
+    return count;
+}
+
+/**
+ * Get the latest sample of a sensor, without taking it from the queue
+ * @param sensor Sensor whose sample to get
+ * @param sample Reference to store the sample in
+ * @return true if sensor has produced at least one sample, false otherwise
+ */
+bool ICM20948::GetLatest(inv_icm20948_sensor sensor, Sample &sample) const
+{
+    int8_t channel = _Channel(sensor);
+
+    if (channel < 0)
+        return false;
+
+    return _latest[channel].Read(sample);
+}
+
+/**
+ * Get number of samples of a sensor dropped because its queue was full
+ * @param sensor Sensor whose overflows to return
+ * @return Number of dropped samples since power-up
+ */
+uint32_t ICM20948::SampleOverflows(inv_icm20948_sensor sensor) const
+{
+    int8_t channel = _Channel(sensor);
+
+    if (channel < 0)
+        return 0;
+
+    return _samples[channel].Overflows();
+}
+
+/**
+ * Get sampling period of a sensor as estimated from its data-ready interrupts
+ * Sensor clock deviates from nominal rate (and drifts with temperature), so
+ * driver keeps tracking the actual period and uses it to timestamp samples.
+ * Estimate is seeded from the DMP divider and PLL trim of the chip, and
+ * restarted whenever sensor is enabled with a different period
+ * @param sensor Streamed sensor whose period to get
+ * @param periodUs Estimated period in us
+ * @param driftPpm (optional) Deviation from nominal period in ppm, positive
+ *        if sensor samples slower than nominal
+ * @return One of MPU_* error codes, MPU_NOT_ALLOWED if sensor hasn't delivered
+ *         enough samples yet
+ */
+int8_t ICM20948::GetSamplePeriod(inv_icm20948_sensor sensor, float *periodUs,
+                                 int32_t *driftPpm)
+{
+    uint32_t periodNs;
+    int32_t ppm;
+
+    if (inv_icm20948_get_odr_estimate(&icm_device, sensor, &periodNs, &ppm) != 0)
+        return MPU_NOT_ALLOWED;
+
+    *periodUs = periodNs / 1000.0f;
+    if (driftPpm != 0)
+        *driftPpm = ppm;
+
+    return MPU_SUCCESS;
+}
+
+/**
+ * Start capturing raw DMP FIFO content (see icm20948_capture.h for format)
+ * Writer first receives capture header, then a record for every FIFO read
+ * done by ReadSensorData, timestamped with the latest data-ready edge. It's
+ * called from whichever context calls ReadSensorData. Capture is stopped by
+ * StopCapture or InitSW, and should be started after sensors are enabled as
+ * header records sensor configuration at the time of the call
+ * @param writer Function that stores captured data (e.g. to serial port)
+ * @return One of MPU_* error codes
+ */
+int8_t ICM20948::StartCapture(void((*writer)(const uint8_t *data, uint16_t length)))
+{
+    ICM20948CaptureHeader header;
+
+    if (!_initialized || (writer == 0))
+        return MPU_NOT_ALLOWED;
+
+    memset((void*)&header, 0, sizeof(header));
+    header.magic = ICM20948_CAPTURE_MAGIC;
+    header.version = ICM20948_CAPTURE_VERSION;
+    header.headerSize = sizeof(header);
+    header.startTimeUs = inv_icm20948_get_time_us();
+    header.accelFsr = cfg_acc_fsr;
+    header.gyroFsr = cfg_gyr_fsr;
+    for (uint8_t i = 0; i < INV_ICM20948_SENSOR_MAX; i++)
+        header.sensorPeriodMs[i] = _sensorPeriod[i];
+
+    _captureLastUs = header.startTimeUs;
+    _captureWriter = writer;
+    writer((const uint8_t*)&header, sizeof(header));
+
+    inv_icm20948_fifo_set_capture(&icm_device, ICM20948::_CaptureFifo, this);
+
+    return MPU_SUCCESS;
+}
+
+/**
+ * Stop capturing raw DMP FIFO content
+ */
+void ICM20948::StopCapture()
+{
+    inv_icm20948_fifo_set_capture(&icm_device, 0, 0);
+    _captureWriter = 0;
+}
+
 /**
  * Trigger reading data from ICM20948
  * Read data from MPU9250s' FIFO and extract quaternions, acceleration, gravity
  * vector & roll-pitch-yaw
- * @param timestamp Reference to the current time in seconds
+ * @param timestamp Time in us of data-ready edge which signalled the data. 0
+ *        (default) to use the latest edge captured by data-ready interrupt,
+ *        or current time if there's none
  * @return One of MPU_* error codes
  */
-int8_t ICM20948::ReadSensorData(const float &timestamp)
+int8_t ICM20948::ReadSensorData(uint64_t timestamp)
+{
+    return _ReadSensorData(inv_icm20948_poll_sensor, timestamp);
+}
+
+/**
+ * Read data from ICM20948 FIFO through given poll function
+ * @param poll inv_icm20948_poll_sensor or one of ICM20948Poller<>::Poll
+ * @param timestamp As in ReadSensorData
+ * @return One of MPU_* error codes
+ */
+int8_t ICM20948::_ReadSensorData(PollFunc poll, uint64_t timestamp)
 {
     int8_t retVal = MPU_ERROR;
+    uint64_t edgeTime;
+
+    //  Edges not consumed by WaitForData (data polled for instead)
+    while (_drdyQueue.Pop(edgeTime))
+        _pendingEdgeUs = HAL_BOARD_CyclesToUS(edgeTime);
 
-    retVal = inv_icm20948_poll_sensor(&icm_device, (void *)0, build_sensor_event_data);
+    inv_icm20948_set_irq_time(&icm_device,
+                              (timestamp != 0) ? timestamp : _pendingEdgeUs);
+    _pendingEdgeUs = 0;
 
-    //  Gravity is returned in G's
-    _acc[0] *= GRAVITY_CONST;
-    _acc[1] *= GRAVITY_CONST;
-    _acc[2] *= GRAVITY_CONST;
+    retVal = poll(&icm_device, (void *)this, build_sensor_event_data);
 
      return retVal;
 }
@@ -612,50 +1076,124 @@ int8_t ICM20948::ReadSensorData(const float &timestamp)
  */
 int8_t ICM20948::GetOrientationRPY(OrientationDOF type, float* orientationRPY, bool inDeg)
 {
-    Quaternion qt;
-    float _ypr[3];
+    float q[4];
 
     if (type == Orientation6DOF)
-    {
-        qt.w = _quat6DOF[0];
-        qt.x = _quat6DOF[1];
-        qt.y = _quat6DOF[2];
-        qt.z = _quat6DOF[3];
-    }
-    else if (type == Orientation9DOF)
-    {
-        qt.w = _quat9DOF[0];
-        qt.x = _quat9DOF[1];
-        qt.y = _quat9DOF[2];
-        qt.z = _quat9DOF[3];
+        _LatestVector(_ChQuat6DOF, q, 4);
+    else
+        _LatestVector(_ChQuat9DOF, q, 4);
 
-    }
+    QuatToRPY(q, orientationRPY, inDeg, _orientationMath);
 
+    return MPU_SUCCESS;
+}
 
+/**
+ * Arguments of atan2/asin giving RPY angles of quaternion (w,x,y,z)
+ * @param q Quaternion (w,x,y,z)
+ * @param args sin & cos of roll, sin of pitch, sin & cos of yaw (last two
+ *        scaled by cos of pitch)
+ */
+static inline void RPYArguments(const float *q, float *args)
+{
     // roll (x-axis rotation)
-    float sinr_cosp = 2 * (qt.w * qt.x + qt.y * qt.z);
-    float cosr_cosp = 1 - 2 * (qt.x * qt.x + qt.y * qt.y);
-    _ypr[2] = atan2f(sinr_cosp, cosr_cosp);
-
+    args[0] = 2 * (q[0] * q[1] + q[2] * q[3]);
+    args[1] = 1 - 2 * (q[1] * q[1] + q[2] * q[2]);
     // pitch (y-axis rotation)
-    float sinp = 2 * (qt.w * qt.y - qt.z * qt.x);
-    if (fabsf(sinp) >= 1)
-        _ypr[1] = copysignf(M_PI / 2, sinp); // use 90 degrees if out of range
-    else
-        _ypr[1] = asinf(sinp);
-
+    args[2] = 2 * (q[0] * q[2] - q[3] * q[1]);
     // yaw (z-axis rotation)
-    float siny_cosp = 2 * (qt.w * qt.z + qt.x * qt.y);
-    float cosy_cosp = 1 - 2 * (qt.y * qt.y + qt.z * qt.z);
-    _ypr[0] = atan2f(siny_cosp, cosy_cosp);
+    args[3] = 2 * (q[0] * q[3] + q[1] * q[2]);
+    args[4] = 1 - 2 * (q[2] * q[2] + q[3] * q[3]);
+}
+
+/**
+ * Convert quaternion to RPY angles
+ * @param quat Quaternion (w,x,y,z)
+ * @param rpy pointer to float buffer of size 3 to hold roll-pitch-yaw
+ * @param inDeg if true RPY returned in degrees, if false in radians
+ * @param math OrientationMathLibm or OrientationMathFast
+ */
+void ICM20948::QuatToRPY(const float *quat, float *rpy, bool inDeg,
+                         OrientationMath math)
+{
+    float _ypr[3];
+    float args[5];
+
+    RPYArguments(quat, args);
+
+    if (math == OrientationMathFast)
+    {
+        _ypr[2] = inv_icm20948_math_atan2f_fast(args[0], args[1]);
+        _ypr[1] = inv_icm20948_math_asinf_fast(args[2]);
+        _ypr[0] = inv_icm20948_math_atan2f_fast(args[3], args[4]);
+    }
+    else
+    {
+        _ypr[2] = atan2f(args[0], args[1]);
+        if (fabsf(args[2]) >= 1)
+            _ypr[1] = copysignf(M_PI / 2, args[2]); // use 90 degrees if out of range
+        else
+            _ypr[1] = asinf(args[2]);
+        _ypr[0] = atan2f(args[3], args[4]);
+    }
 
     for (uint8_t i = 0; i < 3; i++)
         if (inDeg)
-            orientationRPY[2-i] = _ypr[i]*180.0/M_PI;
+            rpy[2-i] = _ypr[i]*180.0/M_PI;
         else
-            orientationRPY[2-i] = _ypr[i];
+            rpy[2-i] = _ypr[i];
+}
 
-    return MPU_SUCCESS;
+/**
+ * Convert quaternions of n samples (e.g. from PopSamples) to RPY angles. With
+ * OrientationMathFast angles are computed a chunk of samples at a time through
+ * array versions of the approximations, which compiler can vectorize
+ * @param quats Samples holding quaternions (w,x,y,z)
+ * @param n Number of samples
+ * @param rpy Buffer of n roll-pitch-yaw triplets
+ * @param inDeg if true RPY returned in degrees, if false in radians
+ * @param math OrientationMathLibm or OrientationMathFast
+ */
+void ICM20948::QuatToRPY(const Sample *quats, uint16_t n, float (*rpy)[3],
+                         bool inDeg, OrientationMath math)
+{
+    const uint16_t chunkLen = 16;
+    //  atan2/asin arguments of a chunk, one array per argument, angles are
+    //  written back in place of first one
+    float args[5][chunkLen];
+    const float scale = inDeg ? (float)(180.0/M_PI) : 1.f;
+
+    if (math != OrientationMathFast)
+    {
+        for (uint16_t i = 0; i < n; i++)
+            QuatToRPY(quats[i].data, rpy[i], inDeg, math);
+        return;
+    }
+
+    for (uint32_t base = 0; base < n; base += chunkLen)
+    {
+        uint16_t len = ((n - base) < chunkLen) ? (n - base) : chunkLen;
+
+        for (uint16_t i = 0; i < len; i++)
+        {
+            float a[5];
+
+            RPYArguments(quats[base + i].data, a);
+            for (uint8_t k = 0; k < 5; k++)
+                args[k][i] = a[k];
+        }
+
+        inv_icm20948_math_atan2f_fast_array(args[0], args[1], len, args[0]);
+        inv_icm20948_math_asinf_fast_array(args[2], len, args[2]);
+        inv_icm20948_math_atan2f_fast_array(args[3], args[4], len, args[3]);
+
+        for (uint16_t i = 0; i < len; i++)
+        {
+            rpy[base + i][0] = args[0][i] * scale;
+            rpy[base + i][1] = args[2][i] * scale;
+            rpy[base + i][2] = args[3][i] * scale;
+        }
+    }
 }
 
 /**
@@ -667,15 +1205,9 @@ int8_t ICM20948::GetOrientationRPY(OrientationDOF type, float* orientationRPY, b
 int8_t ICM20948::GetOrientationQuat(OrientationDOF type, float* orientationQuat)
 {
     if (type == Orientation6DOF)
-    {
-        for (uint8_t i = 0; i < 4; i++)
-            orientationQuat[i] = _quat6DOF[i];
-    }
+        _LatestVector(_ChQuat6DOF, orientationQuat, 4);
     else if (type == Orientation9DOF)
-    {
-        for (uint8_t i = 0; i < 4; i++)
-            orientationQuat[i] = _quat6DOF[i];
-    }
+        _LatestVector(_ChQuat9DOF, orientationQuat, 4);
 
     return MPU_SUCCESS;
 }
@@ -690,7 +1222,10 @@ int8_t ICM20948::GetOrientationQuat(OrientationDOF type, float* orientationQuat)
  */
 int8_t ICM20948::GetLinearAcceleration(float *acc)
 {
-    memcpy((void*)acc, (void*)_acc, sizeof(_acc));
+    if (_latest[_ChLinearAccel].Count() > 0)
+        _LatestVector(_ChLinearAccel, acc, 3);
+    else
+        _LatestVector(_ChAccel, acc, 3);
 
     return MPU_SUCCESS;
 }
@@ -703,7 +1238,7 @@ int8_t ICM20948::GetLinearAcceleration(float *acc)
  */
 int8_t ICM20948::GetGyroscope(float *gyro)
 {
-    memcpy((void*)gyro, (void*)_gyro, sizeof(float)*3);
+    _LatestVector(_ChGyro, gyro, 3);
 
     return MPU_SUCCESS;
 }
@@ -716,7 +1251,7 @@ int8_t ICM20948::GetGyroscope(float *gyro)
  */
 int8_t ICM20948::GetMagnetometer(float *mag)
 {
-    memcpy((void*)mag, (void*)_mag, sizeof(float)*3);
+    _LatestVector(_ChMag, mag, 3);
 
     return MPU_SUCCESS;
 }
@@ -728,85 +1263,177 @@ int8_t ICM20948::GetMagnetometer(float *mag)
  */
 int8_t ICM20948::GetGravity(float *gv)
 {
-    memcpy((void*)gv, (void*)_gv, sizeof(float)*3);
+    _LatestVector(_ChGravity, gv, 3);
 
     return MPU_SUCCESS;
 }
 
+/**
+ * Map sensor to the channel its samples are kept in
+ * @param sensor Sensor to map
+ * @return Channel index or -1 if samples of the sensor aren't kept
+ */
+int8_t ICM20948::_Channel(inv_icm20948_sensor sensor)
+{
+    if ((uint8_t)sensor >= INV_ICM20948_SENSOR_MAX)
+        return -1;
+
+    return _sensorRoute[sensor].channel;
+}
+
+/**
+ * Copy vector/quaternion part of the latest sample on a channel
+ * Zeros are returned if channel hasn't received any samples yet
+ * @param channel Channel to read
+ * @param data Buffer to store the data in
+ * @param length Number of elements to copy (3 or 4)
+ */
+void ICM20948::_LatestVector(uint8_t channel, float *data, uint8_t length) const
+{
+    Sample sample;
+
+    if (!_latest[channel].Read(sample))
+        memset((void*)&sample, 0, sizeof(sample));
+
+    memcpy((void*)data, (void*)sample.data, sizeof(float)*length);
+}
+
 ///-----------------------------------------------------------------------------
 ///                      Data setters                                [PROTECTED]
 ///-----------------------------------------------------------------------------
 
+/**
+ * Store new sample in the queue and as the latest value of a channel
+ * Called from the driver callback, i.e. context which calls ReadSensorData
+ * @param channel Channel to store the sample in
+ * @param sample Sample to store
+ */
+void ICM20948::_Publish(uint8_t channel, const Sample &sample)
+{
+    _latest[channel].Write(sample);
+    _samples[channel].Push(sample);
+}
+
 /**
  * Update accelerometer data by passing it through a median filter (window=23)
- * Accelerometer data for each axis is saved in a doubly linked list, sorted in
- * ascending order.
- * @param acc New accelerometer data sample
+ * on each axis
+ * @param acc New accelerometer data sample [x,y,z], replaced with filtered one
  */
 void ICM20948::_SetAcceleration(float *acc)
 {
-    //  Median filter with windows 3 on acceleration
-    static const uint8_t windowSize = 23;
-    static LinkedList buffer;
-    static uint8_t counter = 0;
-
-    //  Insert the element on the list, in a sorted manner
-    if (buffer.Size() == windowSize)
-        buffer.DeleteWhereIndex(counter);
-    buffer.addS(acc[0], counter);
+    static MedianFilter<float, 23> filter[3];
 
-    //  Take a middle element from the sorted list
-    if (buffer.Size() == windowSize)
-        _acc[0] = buffer.at((windowSize-1)/2);
-
-    //  Increment counter for the next step
-    counter = (counter + 1) % windowSize;
+    for (uint8_t axis = 0; axis < 3; axis++)
+        acc[axis] = filter[axis].Push(acc[axis]);
 }
 
 
 /**
  * Update gyroscope data
  * Updates raw gyroscope data by passing it through a median filter (window=3)
- * @param gyro New gyro data sample [x,y,z]
+ * on each axis
+ * @param gyro New gyro data sample [x,y,z], replaced with filtered one
  */
 void  ICM20948::_SetGyroscope(float *gyro)
 {
-    //  Median filter with windows 3 on gyro
-     static int8_t counter = 0;
-     static float buffer[3][3];
+    static MedianFilter<float, 3> filter[3];
+
+    for (uint8_t axis = 0; axis < 3; axis++)
+        gyro[axis] = filter[axis].Push(gyro[axis]);
+}
+
+
+///-----------------------------------------------------------------------------
+///                      Interrupt handling                          [PROTECTED]
+///-----------------------------------------------------------------------------
+
+/**
+ * Called from HAL when ICM20948 raises its data-ready pin
+ * Timestamps the edge and hands it over to main loop
+ */
+void ICM20948::_DataReadyISR()
+{
+    ICM20948 &imu = ICM20948::GetI();
+    uint64_t cycles = HAL_BOARD_TimeCycles();
+    uint64_t now = HAL_BOARD_CyclesToUS(cycles);
+
+    if (imu._jitterOn && (imu._prevEdgeCycles != 0))
+        imu._jitter.Add((int64_t)(cycles - imu._prevEdgeCycles));
+    imu._prevEdgeCycles = cycles;
+
+    imu._lastEdgeUs = now;
+    imu._drdyQueue.Push(cycles);
+
+    if (imu._drdyHook != 0)
+        imu._drdyHook(now);
+}
+
+/**
+ * Time of the latest data-ready edge, safe to call outside of interrupt. 64-bit
+ * value is read in two halves on Cortex-M4, so it's read until two reads
+ * agree, in case interrupt updated it in between
+ * @return Time in us, 0 if there was no edge yet
+ */
+uint64_t ICM20948::_LastEdgeUs() const
+{
+    uint64_t edgeUs;
 
-     memcpy((void*)&buffer[counter], (void*)gyro, sizeof(float)*3);
+    do
+        edgeUs = _lastEdgeUs;
+    while (edgeUs != _lastEdgeUs);
 
-     //  For each axis, go through all 3 members and find median then save
-     //  median into a variable that will be returned as final gyro value
-     for (int8_t axis = 0; axis < 3; axis++)
-         for (int8_t i = counter; i < 6; i++)
-             if ( ((buffer[i%3][axis] >= buffer[(i-1+3)%3][axis]) &&
-                   (buffer[i%3][axis] <= buffer[(i+1)%3][axis])) ||
-                  ((buffer[i%3][axis] <= buffer[(i-1+3)%3][axis]) &&
-                   (buffer[i%3][axis] >= buffer[(i+1)%3][axis])) )
-             {
-                 _gyro[axis] = buffer[i%3][axis];
-                 break;
-             }
+    return edgeUs;
+}
 
-     counter = (counter + 1) % 3;
+/**
+ * Whether data-ready edge was handed over to main loop, keeps core awake in
+ * HAL_BOARD_IdleUntil. Called with interrupts disabled
+ */
+bool ICM20948::_EdgePending()
+{
+    return !ICM20948::GetI()._drdyQueue.Empty();
 }
 
+/**
+ * Called by driver with every burst of raw bytes read from FIFO while capture
+ * is running, writes them out as a capture record
+ */
+void ICM20948::_CaptureFifo(void *context, const unsigned char *data,
+                            uint_fast16_t len)
+{
+    ICM20948 *imu = (ICM20948*)context;
+    uint64_t edgeUs = imu->_LastEdgeUs();
+    uint64_t delta = 0;
+    uint8_t record[ICM20948_CAPTURE_RECORD_HDR];
+
+    //  Several bursts can follow one edge, these are recorded with zero delta
+    if (edgeUs > imu->_captureLastUs)
+        delta = edgeUs - imu->_captureLastUs;
+    if (delta > 0xFFFFFFFF)
+        delta = 0xFFFFFFFF;
+    imu->_captureLastUs += delta;
+
+    for (uint8_t i = 0; i < 4; i++)
+        record[i] = (uint8_t)(delta >> (8 * i));
+    record[4] = (uint8_t)(len & 0xFF);
+    record[5] = (uint8_t)(len >> 8);
+
+    imu->_captureWriter(record, sizeof(record));
+    imu->_captureWriter(data, (uint16_t)len);
+}
 
 ///-----------------------------------------------------------------------------
 ///                      Class constructor & destructor              [PROTECTED]
 ///-----------------------------------------------------------------------------
 
-ICM20948::ICM20948(): _initialized(false), _quat9DOFaccuracy(0.0), _quat6DOFaccuracy(0.0)
+ICM20948::ICM20948(): _initialized(false), _drdyHook(0), _lastEdgeUs(0),
+        _pendingEdgeUs(0), _jitterOn(false), _prevEdgeCycles(0),
+        _batchTimeoutMs(0), _batchWatermark(0), _captureWriter(0),
+        _captureLastUs(0), _orientationMath(OrientationMathLibm)
 {
     //  Initialize arrays
-    memset((void*)_acc, 0, sizeof(_acc));
-    memset((void*)_gyro, 0, sizeof(_gyro));
-    memset((void*)_mag, 0, sizeof(_mag));
-    memset((void*)_gv, 0, sizeof(_gv));
-    memset((void*)_quat9DOF, 0, sizeof(_quat9DOF));
-    memset((void*)_quat6DOF, 0, sizeof(_quat6DOF));
+    memset((void*)_sensorPeriod, 0, sizeof(_sensorPeriod));
+    memset((void*)_sensorHook, 0, sizeof(_sensorHook));
 }
 
 ICM20948::~ICM20948()
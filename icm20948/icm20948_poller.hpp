@@ -0,0 +1,565 @@
+/**
+ * icm20948_poller.hpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Variant of inv_icm20948_poll_sensor() specialized at compile time for a
+ *  set of sensors, given as a mask of ICM20948_SENSOR_BIT(inv_icm20948_sensor).
+ *  Sensor checks are resolved at compile time, so branches and conversions
+ *  of sensors outside the mask are dropped by the compiler. Data of those
+ *  sensors is still popped from FIFO, it's just never decoded or reported.
+ *  Vectors are converted through chip-to-body matrices with scale factors
+ *  folded in, rebuilt whenever mounting matrix or full-scale range is set.
+ *  For sensors in the mask output is identical to inv_icm20948_poll_sensor(),
+ *  provided that no sensor outside of the mask is enabled.
+ *
+ *  Usage: ICM20948Poller<ICM20948_SENSOR_BIT(INV_ICM20948_SENSOR_GYROSCOPE) |
+ *                        ...>::Poll(&icm_device, context, handler);
+ *  or, through ICM20948 class, ICM20948::ReadSensorData<mask>(timestamp).
+ *  Driver headers define min/max macros, so include this one after standard
+ *  library headers.
+ */
+#ifndef ICM20948_POLLER_HPP_
+#define ICM20948_POLLER_HPP_
+
+#include <stdint.h>
+#include "icm20948.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948Augmented.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948DataBaseControl.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948DataBaseDriver.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948Defs.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948Dmp3Driver.h"
+#include "Invn/Devices/Drivers/Icm20948/Icm20948MPUFifoControl.h"
+#include "Invn/Devices/SensorTypes.h"
+
+//  Bit of a sensor (one of inv_icm20948_sensor) in the poller sensor mask
+#define ICM20948_SENSOR_BIT(sensor)     (1UL << (sensor))
+
+/**
+ * Handler of sensor events, same as the one of inv_icm20948_poll_sensor()
+ */
+typedef void (*ICM20948EventHandler)(void *context,
+        enum inv_icm20948_sensor sensor, uint64_t timestamp, const void *data,
+        const void *arg);
+
+template <uint32_t SensorMask>
+class ICM20948Poller
+{
+    static_assert((SensorMask != 0) &&
+                  ((SensorMask >> INV_ICM20948_SENSOR_MAX) == 0),
+                  "Mask has to contain only ICM20948_SENSOR_BIT of sensors");
+
+    public:
+        static int Poll(struct inv_icm20948 *s, void *context,
+                        ICM20948EventHandler handler);
+
+    private:
+        ///  Whether sensor is part of the mask (known at compile time)
+        static constexpr bool _Has(enum inv_icm20948_sensor sensor)
+        {
+            return (SensorMask & ICM20948_SENSOR_BIT(sensor)) != 0;
+        }
+
+        ///  Whether sensor in the mask has been enabled and this sample of it
+        ///  isn't to be skipped, same as the check in inv_icm20948_poll_sensor
+        static inline bool _Report(struct inv_icm20948 *s,
+                                   enum inv_icm20948_sensor sensor,
+                                   unsigned char androidSensor)
+        {
+            if (!_Has(sensor) ||
+                !inv_icm20948_ctrl_androidSensor_enabled(s, androidSensor))
+                return false;
+
+            if (s->skip_sample[sensor])
+            {
+                s->skip_sample[sensor]--;
+                return false;
+            }
+            return true;
+        }
+
+        ///  Advance timestamp of streamed sensor by its ODR and report sample
+        static inline void _Send(struct inv_icm20948 *s, void *context,
+                                 ICM20948EventHandler handler,
+                                 enum inv_icm20948_sensor sensor,
+                                 const void *data, const void *arg)
+        {
+            s->timestamp[sensor] += s->sensorlist[sensor].odr_applied_us;
+            handler(context, sensor, s->timestamp[sensor], data, arg);
+        }
+
+        //  Groups of sensors sharing the same FIFO output
+        static constexpr bool _gyro =
+                _Has(INV_ICM20948_SENSOR_RAW_GYROSCOPE) ||
+                _Has(INV_ICM20948_SENSOR_GYROSCOPE) ||
+                _Has(INV_ICM20948_SENSOR_GYROSCOPE_UNCALIBRATED);
+        static constexpr bool _accel =
+                _Has(INV_ICM20948_SENSOR_RAW_ACCELEROMETER) ||
+                _Has(INV_ICM20948_SENSOR_ACCELEROMETER) ||
+                _Has(INV_ICM20948_SENSOR_LINEAR_ACCELERATION);
+        static constexpr bool _quat6 =
+                _Has(INV_ICM20948_SENSOR_GAME_ROTATION_VECTOR) ||
+                _Has(INV_ICM20948_SENSOR_GRAVITY) ||
+                _Has(INV_ICM20948_SENSOR_LINEAR_ACCELERATION);
+        static constexpr bool _quat9 =
+                _Has(INV_ICM20948_SENSOR_ROTATION_VECTOR) ||
+                _Has(INV_ICM20948_SENSOR_ORIENTATION);
+        static constexpr bool _bac =
+                _Has(INV_ICM20948_SENSOR_ACTIVITY_CLASSIFICATON) ||
+                _Has(INV_ICM20948_SENSOR_WAKEUP_TILT_DETECTOR);
+};
+
+/**
+ * Read and report all data available in DMP FIFO
+ * Follows inv_icm20948_poll_sensor(), but only for sensors in SensorMask
+ * @param s Driver instance
+ * @param context Passed to handler as is
+ * @param handler Called for every sample of every sensor
+ * @return 0
+ */
+template <uint32_t SensorMask>
+int ICM20948Poller<SensorMask>::Poll(struct inv_icm20948 *s, void *context,
+                                     ICM20948EventHandler handler)
+{
+    short int_read_back = 0;
+    unsigned short header = 0, header2 = 0;
+    int data_left_in_fifo = 0;
+    int dummy_accuracy = 0;
+    int accel_accuracy = 0;
+    float accel_float[3] = {0};
+    uint64_t lastIrqTimeUs = s->irq_time_us;
+
+    //  Edge time set through inv_icm20948_set_irq_time applies to this poll
+    s->irq_time_us = 0;
+
+    //  Status and FIFO reads below share a single LP_EN disable/enable
+    inv_icm20948_transport_begin(s);
+
+    inv_icm20948_identify_interrupt(s, &int_read_back);
+
+    if (int_read_back & (BIT_MSG_DMP_INT | BIT_MSG_DMP_INT_0))
+    {
+        if (lastIrqTimeUs == 0)
+            lastIrqTimeUs = inv_icm20948_get_time_us();
+        do
+        {
+            unsigned short total_sample_cnt = 0;
+
+            //  Mirror FIFO contents, stop processing FIFO on error
+            if (inv_icm20948_updateTs(s, &data_left_in_fifo, &total_sample_cnt,
+                                      &lastIrqTimeUs))
+                break;
+
+            while (total_sample_cnt--)
+            {
+                if (inv_icm20948_fifo_pop(s, &header, &header2,
+                                          &data_left_in_fifo))
+                    break;
+
+                //  Raw gyro (Q15 of full scale) and gyro bias (Q20 of 2000dps)
+                if (_gyro && (header & GYRO_SET))
+                {
+                    short short_data[3];
+                    long rawQ15[3], biasQ20[3];
+                    int gyro_accuracy;
+
+                    inv_icm20948_dmp_get_raw_gyro(short_data);
+                    rawQ15[0] = short_data[0];
+                    rawQ15[1] = short_data[1];
+                    rawQ15[2] = short_data[2];
+
+                    if (_Report(s, INV_ICM20948_SENSOR_RAW_GYROSCOPE,
+                                ANDROID_SENSOR_RAW_GYROSCOPE))
+                    {
+                        long out[3];
+                        inv_icm20948_convert_quat_rotate_fxp(s->s_quat_chip_to_body,
+                                                             rawQ15, out);
+                        _Send(s, context, handler,
+                              INV_ICM20948_SENSOR_RAW_GYROSCOPE, out,
+                              &dummy_accuracy);
+                    }
+
+                    inv_icm20948_dmp_get_gyro_bias(short_data);
+                    biasQ20[0] = short_data[0];
+                    biasQ20[1] = short_data[1];
+                    biasQ20[2] = short_data[2];
+
+                    //  New accuracy is reported together with the next bias
+                    gyro_accuracy = inv_icm20948_get_gyro_accuracy();
+                    if (s->set_accuracy)
+                    {
+                        s->set_accuracy = 0;
+                        s->new_accuracy = gyro_accuracy;
+                    }
+                    if (gyro_accuracy != s->new_accuracy)
+                        s->set_accuracy = 1;
+
+                    if (_Report(s, INV_ICM20948_SENSOR_GYROSCOPE,
+                                ANDROID_SENSOR_GYROSCOPE))
+                    {
+                        long calQ20[3], rawQ20[3];
+                        float gyro_float[3];
+                        rawQ20[0] = rawQ15[0] << s->base_state.gyro_q20_shift;
+                        rawQ20[1] = rawQ15[1] << s->base_state.gyro_q20_shift;
+                        rawQ20[2] = rawQ15[2] << s->base_state.gyro_q20_shift;
+                        inv_icm20948_dmp_get_calibrated_gyro(calQ20, rawQ20, biasQ20);
+                        inv_icm20948_convert_dmp3_to_body_flt(s,
+                                INV_ICM20948_BODY_GYRO, calQ20, gyro_float);
+                        _Send(s, context, handler, INV_ICM20948_SENSOR_GYROSCOPE,
+                              gyro_float, &s->new_accuracy);
+                    }
+                    if (_Report(s, INV_ICM20948_SENSOR_GYROSCOPE_UNCALIBRATED,
+                                ANDROID_SENSOR_GYROSCOPE_UNCALIBRATED))
+                    {
+                        float raw_bias_gyr[6];
+                        inv_icm20948_convert_dmp3_to_body_flt(s,
+                                INV_ICM20948_BODY_GYRO_RAW, rawQ15, raw_bias_gyr);
+                        inv_icm20948_convert_dmp3_to_body_flt(s,
+                                INV_ICM20948_BODY_GYRO, biasQ20, raw_bias_gyr + 3);
+                        _Send(s, context, handler,
+                              INV_ICM20948_SENSOR_GYROSCOPE_UNCALIBRATED,
+                              raw_bias_gyr, &s->new_accuracy);
+                    }
+                }
+
+                //  Calibrated accel, Q30 of full scale
+                if (_accel && (header & ACCEL_SET))
+                {
+                    long long_data[3];
+                    inv_icm20948_dmp_get_accel(long_data);
+
+                    if (_Report(s, INV_ICM20948_SENSOR_RAW_ACCELEROMETER,
+                                ANDROID_SENSOR_RAW_ACCELEROMETER))
+                    {
+                        long out[3];
+                        inv_icm20948_convert_quat_rotate_fxp(s->s_quat_chip_to_body,
+                                                             long_data, out);
+                        //  Fit into 16 bits, as Q12/Q11/Q10/Q9 of full scale
+                        out[0] >>= 15;
+                        out[1] >>= 15;
+                        out[2] >>= 15;
+                        _Send(s, context, handler,
+                              INV_ICM20948_SENSOR_RAW_ACCELEROMETER, out,
+                              &dummy_accuracy);
+                    }
+                    //  Linear acceleration needs accel even if it's not reported
+                    if (_Report(s, INV_ICM20948_SENSOR_ACCELEROMETER,
+                                ANDROID_SENSOR_ACCELEROMETER) ||
+                        (_Has(INV_ICM20948_SENSOR_LINEAR_ACCELERATION) &&
+                         inv_icm20948_ctrl_androidSensor_enabled(s,
+                                ANDROID_SENSOR_LINEAR_ACCELERATION)))
+                    {
+                        accel_accuracy = inv_icm20948_get_accel_accuracy();
+                        inv_icm20948_convert_dmp3_to_body_flt(s,
+                                INV_ICM20948_BODY_ACCEL, long_data, accel_float);
+
+                        if (_Has(INV_ICM20948_SENSOR_ACCELEROMETER) &&
+                            inv_icm20948_ctrl_androidSensor_enabled(s,
+                                    ANDROID_SENSOR_ACCELEROMETER))
+                            _Send(s, context, handler,
+                                  INV_ICM20948_SENSOR_ACCELEROMETER,
+                                  accel_float, &accel_accuracy);
+                    }
+                }
+
+                //  Calibrated compass, Q16 in uT
+                if (_Has(INV_ICM20948_SENSOR_GEOMAGNETIC_FIELD) &&
+                    (header & CPASS_CALIBR_SET))
+                {
+                    long long_data[3];
+                    float compass_float[3];
+                    int compass_accuracy;
+
+                    inv_icm20948_dmp_get_calibrated_compass(long_data);
+                    if (_Report(s, INV_ICM20948_SENSOR_GEOMAGNETIC_FIELD,
+                                ANDROID_SENSOR_GEOMAGNETIC_FIELD))
+                    {
+                        compass_accuracy = inv_icm20948_get_mag_accuracy();
+                        inv_icm20948_convert_dmp3_to_body_flt(s,
+                                INV_ICM20948_BODY_COMPASS, long_data, compass_float);
+                        _Send(s, context, handler,
+                              INV_ICM20948_SENSOR_GEOMAGNETIC_FIELD,
+                              compass_float, &compass_accuracy);
+                    }
+                }
+
+                //  Raw compass, Q16 in uT, reported along with its bias
+                if (_Has(INV_ICM20948_SENSOR_MAGNETIC_FIELD_UNCALIBRATED) &&
+                    (header & CPASS_SET))
+                {
+                    long long_data[3];
+
+                    inv_icm20948_dmp_get_raw_compass(long_data);
+                    if (_Report(s, INV_ICM20948_SENSOR_MAGNETIC_FIELD_UNCALIBRATED,
+                                ANDROID_SENSOR_MAGNETIC_FIELD_UNCALIBRATED))
+                    {
+                        float raw_bias_mag[6];
+                        int mag_bias[3];
+                        int compass_accuracy;
+
+                        inv_icm20948_ctrl_get_mag_bias(s, mag_bias);
+                        for (uint8_t i = 0; i < 3; i++)
+                        {
+                            raw_bias_mag[i] = long_data[i] / (float)(1UL << 16);
+                            raw_bias_mag[i+3] = mag_bias[i] / (float)(1UL << 16);
+                        }
+                        compass_accuracy = inv_icm20948_get_mag_accuracy();
+                        _Send(s, context, handler,
+                              INV_ICM20948_SENSOR_MAGNETIC_FIELD_UNCALIBRATED,
+                              raw_bias_mag, &compass_accuracy);
+                    }
+                }
+
+                //  6-axis (accel+gyro) quaternion, Q30
+                if (_quat6 && (header & QUAT6_SET))
+                {
+                    long long_quat[3];
+                    long gravityQ16[3];
+
+                    inv_icm20948_dmp_get_6quaternion(long_quat);
+                    if (_Report(s, INV_ICM20948_SENSOR_GAME_ROTATION_VECTOR,
+                                ANDROID_SENSOR_GAME_ROTATION_VECTOR))
+                    {
+                        float grv_float[4], ref_quat[4];
+                        inv_icm20948_convert_rotation_vector(s, long_quat, grv_float);
+                        ref_quat[0] = grv_float[3];
+                        ref_quat[1] = grv_float[0];
+                        ref_quat[2] = grv_float[1];
+                        ref_quat[3] = grv_float[2];
+                        _Send(s, context, handler,
+                              INV_ICM20948_SENSOR_GAME_ROTATION_VECTOR,
+                              ref_quat, 0);
+                    }
+
+                    if (_Has(INV_ICM20948_SENSOR_GRAVITY) ||
+                        _Has(INV_ICM20948_SENSOR_LINEAR_ACCELERATION))
+                        inv_icm20948_augmented_sensors_get_gravity(s, gravityQ16,
+                                                                   long_quat);
+
+                    if (_Report(s, INV_ICM20948_SENSOR_GRAVITY,
+                                ANDROID_SENSOR_GRAVITY))
+                    {
+                        float gravity_float[3];
+                        gravity_float[0] = (int32_t)gravityQ16[0] / (float)(1UL << 16);
+                        gravity_float[1] = (int32_t)gravityQ16[1] / (float)(1UL << 16);
+                        gravity_float[2] = (int32_t)gravityQ16[2] / (float)(1UL << 16);
+                        _Send(s, context, handler, INV_ICM20948_SENSOR_GRAVITY,
+                              gravity_float, &accel_accuracy);
+                    }
+
+                    if (_Report(s, INV_ICM20948_SENSOR_LINEAR_ACCELERATION,
+                                ANDROID_SENSOR_LINEAR_ACCELERATION))
+                    {
+                        float linacc_float[3];
+                        long linAccQ16[3], accelQ16[3];
+
+                        for (uint8_t i = 0; i < 3; i++)
+                            accelQ16[i] = (int32_t)((float)(accel_float[i])*(1ULL << 16)
+                                                  + ((accel_float[i] >= 0) - 0.5f));
+                        inv_icm20948_augmented_sensors_get_linearacceleration(linAccQ16,
+                                gravityQ16, accelQ16);
+                        linacc_float[0] = (int32_t)linAccQ16[0] / (float)(1UL << 16);
+                        linacc_float[1] = (int32_t)linAccQ16[1] / (float)(1UL << 16);
+                        linacc_float[2] = (int32_t)linAccQ16[2] / (float)(1UL << 16);
+                        _Send(s, context, handler,
+                              INV_ICM20948_SENSOR_LINEAR_ACCELERATION,
+                              linacc_float, &accel_accuracy);
+                    }
+                }
+
+                //  9-axis quaternion, Q30, with heading accuracy in Q29
+                if (_quat9 && (header & QUAT9_SET))
+                {
+                    long long_quat[3];
+
+                    inv_icm20948_dmp_get_9quaternion(long_quat);
+                    if (_Report(s, INV_ICM20948_SENSOR_ROTATION_VECTOR,
+                                ANDROID_SENSOR_ROTATION_VECTOR))
+                    {
+                        float rv_float[4], ref_quat[4];
+                        float rv_accuracy;
+                        inv_icm20948_convert_rotation_vector(s, long_quat, rv_float);
+                        rv_accuracy = inv_icm20948_get_rv_accuracy() / (float)(1ULL << 29);
+                        ref_quat[0] = rv_float[3];
+                        ref_quat[1] = rv_float[0];
+                        ref_quat[2] = rv_float[1];
+                        ref_quat[3] = rv_float[2];
+                        _Send(s, context, handler,
+                              INV_ICM20948_SENSOR_ROTATION_VECTOR, ref_quat,
+                              &rv_accuracy);
+                    }
+                    if (_Report(s, INV_ICM20948_SENSOR_ORIENTATION,
+                                ANDROID_SENSOR_ORIENTATION))
+                    {
+                        long orientationQ16[3];
+                        float orientation_float[3];
+                        inv_icm20948_augmented_sensors_get_orientation(orientationQ16,
+                                                                       long_quat);
+                        orientation_float[0] = (int32_t)orientationQ16[0] / (float)(1UL << 16);
+                        orientation_float[1] = (int32_t)orientationQ16[1] / (float)(1UL << 16);
+                        orientation_float[2] = (int32_t)orientationQ16[2] / (float)(1UL << 16);
+                        _Send(s, context, handler,
+                              INV_ICM20948_SENSOR_ORIENTATION,
+                              orientation_float, 0);
+                    }
+                }
+
+                //  6-axis (accel+compass) quaternion, Q30, with accuracy in Q29
+                if (_Has(INV_ICM20948_SENSOR_GEOMAGNETIC_ROTATION_VECTOR) &&
+                    (header & GEOMAG_SET))
+                {
+                    long long_quat[3];
+
+                    inv_icm20948_dmp_get_gmrvquaternion(long_quat);
+                    if (_Report(s, INV_ICM20948_SENSOR_GEOMAGNETIC_ROTATION_VECTOR,
+                                ANDROID_SENSOR_GEOMAGNETIC_ROTATION_VECTOR))
+                    {
+                        float gmrv_float[4], ref_quat[4];
+                        float gmrv_accuracy;
+                        inv_icm20948_convert_rotation_vector(s, long_quat, gmrv_float);
+                        gmrv_accuracy = inv_icm20948_get_gmrv_accuracy() / (float)(1ULL << 29);
+                        ref_quat[0] = gmrv_float[3];
+                        ref_quat[1] = gmrv_float[0];
+                        ref_quat[2] = gmrv_float[1];
+                        ref_quat[3] = gmrv_float[2];
+                        _Send(s, context, handler,
+                              INV_ICM20948_SENSOR_GEOMAGNETIC_ROTATION_VECTOR,
+                              ref_quat, &gmrv_accuracy);
+                    }
+                }
+
+                //  Activity recognition: high byte has started activities,
+                //  low byte ended ones
+                if (_bac && (header2 & ACT_RECOG_SET))
+                {
+                    static const struct
+                    {
+                        uint8_t act_id;
+                        enum inv_sensor_bac_event sensor_bac;
+                    } map[] = {
+                        { 0x01, INV_SENSOR_BAC_EVENT_ACT_IN_VEHICLE_BEGIN },
+                        { 0x02, INV_SENSOR_BAC_EVENT_ACT_WALKING_BEGIN },
+                        { 0x04, INV_SENSOR_BAC_EVENT_ACT_RUNNING_BEGIN },
+                        { 0x08, INV_SENSOR_BAC_EVENT_ACT_ON_BICYCLE_BEGIN },
+                        { 0x20, INV_SENSOR_BAC_EVENT_ACT_STILL_BEGIN },
+                        { 0x10, INV_SENSOR_BAC_EVENT_ACT_TILT_BEGIN },
+                    };
+                    const enum inv_icm20948_sensor bac =
+                            INV_ICM20948_SENSOR_ACTIVITY_CLASSIFICATON;
+                    const enum inv_icm20948_sensor tilt =
+                            INV_ICM20948_SENSOR_WAKEUP_TILT_DETECTOR;
+                    uint16_t bac_state = 0;
+                    long bac_ts = 0;
+                    int bac_event;
+
+                    inv_icm20948_dmp_get_bac_state(&bac_state);
+                    inv_icm20948_dmp_get_bac_ts(&bac_ts);
+                    for (uint8_t i = 0; i < 6; i++)
+                    {
+                        if ((bac_state >> 8) & map[i].act_id)
+                        {
+                            if (_Has(bac) &&
+                                inv_icm20948_ctrl_get_activitiy_classifier_on_flag(s))
+                            {
+                                bac_event = map[i].sensor_bac;
+                                handler(context, bac, s->timestamp[bac],
+                                        &bac_event, 0);
+                            }
+                            if (_Has(tilt) && (map[i].act_id == 0x10) &&
+                                inv_icm20948_ctrl_androidSensor_enabled(s,
+                                        ANDROID_SENSOR_WAKEUP_TILT_DETECTOR))
+                                handler(context, tilt, s->timestamp[tilt], 0, 0);
+                        }
+                        else if (_Has(bac) && (bac_state & map[i].act_id) &&
+                                 inv_icm20948_ctrl_get_activitiy_classifier_on_flag(s))
+                        {
+                            bac_event = -map[i].sensor_bac;
+                            handler(context, bac, s->timestamp[bac], &bac_event, 0);
+                        }
+                    }
+                }
+
+                if (_Has(INV_ICM20948_SENSOR_FLIP_PICKUP) &&
+                    (header2 & FLIP_PICKUP_SET))
+                {
+                    uint16_t pickup_state = 0;
+                    inv_icm20948_dmp_get_flip_pickup_state(&pickup_state);
+                    handler(context, INV_ICM20948_SENSOR_FLIP_PICKUP,
+                            s->timestamp[INV_ICM20948_SENSOR_FLIP_PICKUP],
+                            &pickup_state, 0);
+                }
+
+                //  Steps counted, reported only when changed and excluding
+                //  steps accumulated while step counter wasn't active
+                if (_Has(INV_ICM20948_SENSOR_STEP_COUNTER) &&
+                    (header & PED_STEPDET_SET) &&
+                    inv_icm20948_ctrl_androidSensor_enabled(s,
+                            ANDROID_SENSOR_STEP_COUNTER))
+                {
+                    unsigned long lsteps;
+                    uint64_t stepc;
+
+                    dmp_icm20948_get_pedometer_num_of_steps(s, &lsteps);
+                    stepc = (unsigned long)(lsteps - s->sStepCounterToBeSubtracted);
+                    if (stepc != s->sOldSteps)
+                    {
+                        s->sOldSteps = stepc;
+                        handler(context, INV_ICM20948_SENSOR_STEP_COUNTER,
+                                s->timestamp[INV_ICM20948_SENSOR_STEP_COUNTER],
+                                &stepc, 0);
+                    }
+                }
+            }
+        } while (data_left_in_fifo);
+
+        //  Events signaled through interrupt status instead of FIFO
+        if (_Has(INV_ICM20948_SENSOR_WAKEUP_SIGNIFICANT_MOTION) &&
+            (int_read_back & BIT_MSG_DMP_INT_2))
+        {
+            uint8_t event = 0;
+            handler(context, INV_ICM20948_SENSOR_WAKEUP_SIGNIFICANT_MOTION,
+                    s->timestamp[INV_ICM20948_SENSOR_WAKEUP_SIGNIFICANT_MOTION],
+                    &event, 0);
+        }
+        if (_Has(INV_ICM20948_SENSOR_STEP_DETECTOR) &&
+            (int_read_back & BIT_MSG_DMP_INT_3))
+        {
+            uint8_t event = 0;
+            handler(context, INV_ICM20948_SENSOR_STEP_DETECTOR,
+                    s->timestamp[INV_ICM20948_SENSOR_STEP_DETECTOR], &event, 0);
+        }
+        if (_Has(INV_ICM20948_SENSOR_B2S) && (int_read_back & BIT_MSG_DMP_INT_5))
+        {
+            uint8_t event = 0;
+            handler(context, INV_ICM20948_SENSOR_B2S,
+                    s->timestamp[INV_ICM20948_SENSOR_B2S], &event, 0);
+        }
+    }
+
+    inv_icm20948_transport_end(s);
+
+    //  Chip can be put to sleep while there's still data in FIFO, transport
+    //  layer wakes it up for reading but doesn't put it back to sleep
+    if (s->mems_put_to_sleep)
+        inv_icm20948_sleep_mems(s);
+
+    return 0;
+}
+
+#if defined(ICM20948_H_)
+/**
+ * Same as ICM20948::ReadSensorData(timestamp), but decodes only sensors from
+ * SensorMask (ICM20948_SENSOR_BIT of each)
+ * @param timestamp Time in us of data-ready edge, 0 for the latest captured one
+ * @return One of MPU_* error codes
+ */
+template <uint32_t SensorMask>
+int8_t ICM20948::ReadSensorData(uint64_t timestamp)
+{
+    return _ReadSensorData(ICM20948Poller<SensorMask>::Poll, timestamp);
+}
+#endif
+
+#endif /* ICM20948_POLLER_HPP_ */
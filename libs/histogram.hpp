@@ -0,0 +1,121 @@
+/**
+ * histogram.hpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Histogram of N equally wide bins centered around a configurable value,
+ *  cheap enough to be filled from an interrupt (one 32-bit division per
+ *  value). Values outside of the range are counted in the first or last bin,
+ *  smallest and largest value seen are kept as well.
+ */
+#ifndef __HISTOGRAM__
+#define __HISTOGRAM__
+
+#include <stdint.h>
+
+template <uint16_t N>
+class Histogram
+{
+    static_assert((N >= 2) && ((N & 1) == 0), "N has to be even");
+
+    public:
+        Histogram(): _center(0), _width(1)
+        {
+            Reset();
+        }
+
+        ///  Set center and width of bins, and drop all values
+        ///  @param center Value at the lower edge of bin N/2
+        ///  @param width Width of a bin, at least 1
+        void Configure(int64_t center, uint32_t width)
+        {
+            _center = center;
+            _width = (width > 0) ? width : 1;
+            Reset();
+        }
+
+        ///  Drop all values
+        void Reset()
+        {
+            for (uint16_t i = 0; i < N; i++)
+                _bins[i] = 0;
+            _count = 0;
+            _min = INT64_MAX;
+            _max = INT64_MIN;
+        }
+
+        ///  Count value in its bin
+        void Add(int64_t value)
+        {
+            int64_t d = value - _center, range = (int64_t)_width * (N / 2);
+            int32_t bin;
+
+            if (d < -range)
+                bin = 0;
+            else if (d >= range)
+                bin = N - 1;
+            else
+            {
+                //  Round towards minus infinity so that bins around center
+                //  are as wide as the others
+                int32_t d32 = (int32_t)d;
+                bin = (d32 >= 0) ? (d32 / (int32_t)_width)
+                          : -((-d32 + (int32_t)_width - 1) / (int32_t)_width);
+                bin += N / 2;
+            }
+
+            _bins[bin]++;
+            _count++;
+            if (value < _min)
+                _min = value;
+            if (value > _max)
+                _max = value;
+        }
+
+        ///  Number of values counted in bin i
+        uint32_t Bin(uint16_t i) const
+        {
+            return _bins[i];
+        }
+
+        ///  Lower edge of bin i (first bin also holds everything below it)
+        int64_t BinStart(uint16_t i) const
+        {
+            return _center + ((int64_t)i - N / 2) * (int64_t)_width;
+        }
+
+        ///  Number of values counted since last Reset
+        uint32_t Count() const
+        {
+            return _count;
+        }
+
+        ///  Smallest and largest value counted since last Reset (only valid if
+        ///  Count() > 0)
+        int64_t Min() const
+        {
+            return _min;
+        }
+
+        int64_t Max() const
+        {
+            return _max;
+        }
+
+        ///  Number of bins
+        static constexpr uint16_t Bins()
+        {
+            return N;
+        }
+
+    private:
+        int64_t     _center;
+        uint32_t    _width;
+        uint32_t    _bins[N];
+        uint32_t    _count;
+        int64_t     _min;
+        int64_t     _max;
+};
+
+#endif
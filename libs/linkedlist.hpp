@@ -1,11 +1,8 @@
 #ifndef __LINKED_LIST__
 #define __LINKED_LIST__
 
-#include <memory>
-#include <tuple>
-#include <iostream>
-
-using namespace std;
+#include <stdint.h>
+#include "nodepool.hpp"
 
 
 /**
@@ -32,24 +29,21 @@ class LLnode
  *  Inserting with addS -> linked list with elements sorted in desc order
  *  Inserting with addS(sorting key const.) -> linked list behaves as stack(LIFO)
  *  Inserting with addQ -> linked list behaves as queue
+ *  Nodes are taken from a pool inside the list holding at most Capacity of
+ *  them, so list never touches the heap; adding to a full list fails.
  */
+template <uint16_t Capacity = 64>
 class LinkedList
 {
     //  Shorten the declaration of shared pointer
     //typedef std::shared_ptr< LLnode<T> > p_LLnode;
     typedef LLnode* p_LLnode;
     public:
-        LinkedList(): head(nullptr), tail(nullptr), siz(0), refExists(false) {};
+        LinkedList(): head(nullptr), tail(nullptr), siz(0) {};
         ~LinkedList()
         {
-            if (!refExists)
-            {
-                //  If no reference to this list exists delete is completly
-                while (!LinkedList::empty())
-                    popFront();
-            }
-            //  Else don't delete it because its members are referenced in
-            //  another list
+            while (!LinkedList::empty())
+                popFront();
         }
         
         ///  True if arg1 is smaller or equal to arg2 - sorting in desc order
@@ -62,10 +56,14 @@ class LinkedList
         }
         
         ///  Build queue by adding new elements to the back of the list
-        void addQ(float arg, uint8_t ind)
+        ///  @return false if there's no room for new element, true otherwise
+        bool addQ(float arg, uint8_t ind)
         {
-            p_LLnode tmp =new LLnode(arg, ind);
+            p_LLnode tmp = _pool.Alloc(arg, ind);
             
+            if (tmp == nullptr)
+                return false;
+            siz++;
             if (head == nullptr)
                 head = tail = tmp;
             else
@@ -74,14 +72,18 @@ class LinkedList
                 tail->_next = tmp;
                 tail = tmp;
             }
+            return true;
         }
         
         ///  Add arg in a list in sorted way - assume list is already sorted
-        void addS(float arg, uint8_t ind)
+        ///  @return false if there's no room for new element, true otherwise
+        bool addS(float arg, uint8_t ind)
         {
-            p_LLnode    tmp=new LLnode(arg, ind),//  Create new node on the heap
+            p_LLnode    tmp=_pool.Alloc(arg, ind),//  Take new node from pool
                         node = head;            //  Define starting node
             
+            if (tmp == nullptr)
+                return false;
             siz++;
             //  Traverse the list until we reach the end
             while (node != nullptr)
@@ -120,6 +122,7 @@ class LinkedList
                 tmp->_next = node;
                 node->_prev = tmp;
             }
+            return true;
         }
         
 
@@ -142,11 +145,9 @@ class LinkedList
             //  Move second node to the first position
             //  If there's only one node next points to nullptr so it's safe
             p_LLnode tmp = head->_next;
-            delete head;
+            _pool.Free(head);
             head = tmp;
             if (head != nullptr) head->_prev = nullptr;
-            //  Elements are smart pointers, deletion from heap handled internally
-            //  when all pointers to it are erased
             siz--;
             return retVal;
         }
@@ -198,7 +199,7 @@ class LinkedList
                 node->_next->_prev = node->_prev;
             }
 
-            delete node;
+            _pool.Free(node);
             siz--;
         }
 
@@ -208,9 +209,13 @@ class LinkedList
         }
        
     private:
+        //  Nodes live in the pool of this list, so it can't be copied
+        LinkedList(LinkedList &arg) {}              //  No definition - forbid this
+        void operator=(LinkedList const &arg) {}   //  No definition - forbid this
+
         p_LLnode head, tail;
         uint32_t siz;
-        bool refExists;
+        NodePool<LLnode, Capacity> _pool;
 };
 
 #endif
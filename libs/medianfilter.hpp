@@ -0,0 +1,105 @@
+/**
+ * medianfilter.hpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Streaming median over a sliding window of the last N samples, without any
+ *  heap allocation. Samples are kept twice: in a ring, in order of arrival, so
+ *  that the oldest one is known, and in an array sorted in ascending order.
+ *  On every new sample, slot of the oldest one and position of the new one are
+ *  found in the sorted array by binary search, then the slot is moved to that
+ *  position, shifting only the samples in between. Median is then the middle
+ *  element.
+ */
+#ifndef __MEDIAN_FILTER__
+#define __MEDIAN_FILTER__
+
+#include <stdint.h>
+
+template <typename T, uint16_t N>
+class MedianFilter
+{
+    static_assert(N >= 1, "Window has to hold at least one sample");
+
+    public:
+        MedianFilter(): _count(0), _pos(0) {};
+
+        ///  Add new sample to the window, dropping the oldest one if it's full
+        ///  @return Median of the window, of samples received so far until
+        ///          window fills up (lower one of the two middle ones if even)
+        T Push(const T &arg)
+        {
+            //  Slot freed by the oldest sample, or a new one at the end, and
+            //  position of new sample among the ones present
+            uint16_t i = (_count == N) ? _LowerBound(_ring[_pos]) : _count;
+            uint16_t j = _LowerBound(arg);
+
+            _ring[_pos] = arg;
+            _pos = (_pos + 1 == N) ? 0 : _pos + 1;
+            if (_count < N)
+                _count++;
+
+            //  Move freed slot to the position of new sample
+            if (j > i)
+            {
+                for (j--; i < j; i++)
+                    _sorted[i] = _sorted[i+1];
+            }
+            else
+            {
+                for (; i > j; i--)
+                    _sorted[i] = _sorted[i-1];
+            }
+            _sorted[i] = arg;
+
+            return Median();
+        }
+
+        ///  Median of samples currently in the window
+        T Median() const
+        {
+            return _sorted[(_count - 1) / 2];
+        }
+
+        ///  Number of samples in the window, N once it filled up
+        uint16_t Size() const
+        {
+            return _count;
+        }
+
+        ///  Drop all samples
+        void Reset()
+        {
+            _count = 0;
+            _pos = 0;
+        }
+
+    private:
+        ///  Index of first sorted sample not less than arg (binary search)
+        ///  Range is only narrowed down on each step, so compiler turns the
+        ///  comparison into a conditional move and the loop depends only on
+        ///  number of samples, constant once window is full
+        uint16_t _LowerBound(const T &arg) const
+        {
+            uint16_t first = 0, len = _count;
+
+            if (len == 0)
+                return 0;
+            while (len > 1)
+            {
+                uint16_t half = len / 2;
+
+                first = (_sorted[first + half - 1] < arg) ? first + half : first;
+                len -= half;
+            }
+            return first + (_sorted[first] < arg);
+        }
+
+        T           _ring[N];
+        T           _sorted[N];
+        uint16_t    _count;
+        uint16_t    _pos;
+};
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * nodepool.hpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Fixed-capacity pool of N objects of type T, living inside the pool itself
+ *  instead of on the heap. Free slots are chained into a list through their
+ *  own storage, so both allocating and freeing an object take constant time
+ *  and never fail other than when all N slots are in use. Not thread safe:
+ *  pool has to be used from a single context (or with interrupts disabled).
+ */
+#ifndef __NODE_POOL__
+#define __NODE_POOL__
+
+#include <stdint.h>
+#include <new>
+
+template <typename T, uint16_t N>
+class NodePool
+{
+    static_assert(N >= 1, "Pool has to hold at least one object");
+
+    public:
+        NodePool(): _used(0), _peak(0)
+        {
+            for (uint16_t i = 0; i < N - 1; i++)
+                _slots[i].next = &_slots[i + 1];
+            _slots[N - 1].next = nullptr;
+            _free = &_slots[0];
+        }
+
+        ///  Take a free slot and construct object in it
+        ///  @return Pointer to new object, nullptr if pool is exhausted
+        template <typename... Args>
+        T* Alloc(const Args&... args)
+        {
+            Slot *slot = _free;
+
+            if (slot == nullptr)
+                return nullptr;
+
+            _free = slot->next;
+            if (++_used > _peak)
+                _peak = _used;
+
+            return new (slot->storage) T(args...);
+        }
+
+        ///  Destroy object and return its slot to the pool
+        ///  @param obj Object obtained from Alloc of this pool
+        void Free(T *obj)
+        {
+            Slot *slot = reinterpret_cast<Slot*>(obj);
+
+            obj->~T();
+            slot->next = _free;
+            _free = slot;
+            _used--;
+        }
+
+        ///  Number of objects currently allocated
+        uint16_t Used() const
+        {
+            return _used;
+        }
+
+        ///  Largest number of objects allocated at once so far
+        uint16_t Peak() const
+        {
+            return _peak;
+        }
+
+        ///  Number of objects pool can hold
+        static constexpr uint16_t Capacity()
+        {
+            return N;
+        }
+
+    private:
+        ///  Storage of one object, or link to the next free slot when unused
+        union Slot
+        {
+            Slot *next;
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+
+        Slot        _slots[N];
+        Slot        *_free;
+        uint16_t    _used;
+        uint16_t    _peak;
+};
+
+#endif
@@ -0,0 +1,67 @@
+/**
+ * seqlock.hpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Single-writer sequence lock holding latest value of type T. Writer never
+ *  waits, reader retries its copy until it got one that wasn't overwritten in
+ *  the meantime, so a value bigger than a word is never seen half-updated.
+ *  Reader must not preempt the writer (e.g. read from an interrupt while main
+ *  loop writes) as it would spin for as long as the write is interrupted.
+ */
+#ifndef __SEQ_LOCK__
+#define __SEQ_LOCK__
+
+#include <stdint.h>
+
+//  Keep compiler from moving memory accesses across sequence counter updates
+#ifndef COMPILER_BARRIER
+#define COMPILER_BARRIER()  __asm__ __volatile__("" ::: "memory")
+#endif
+
+template <typename T>
+class SeqLock
+{
+    public:
+        SeqLock(): _seq(0) {};
+
+        ///  Publish new value (writer side only)
+        void Write(const T &arg)
+        {
+            _seq = _seq + 1;
+            COMPILER_BARRIER();
+            _value = arg;
+            COMPILER_BARRIER();
+            _seq = _seq + 1;
+        }
+
+        ///  Get consistent copy of the latest value
+        ///  @return false if value has never been written
+        bool Read(T &arg) const
+        {
+            uint32_t start;
+
+            do
+            {
+                start = _seq;
+                COMPILER_BARRIER();
+                arg = _value;
+                COMPILER_BARRIER();
+            } while ((start & 1) || (start != _seq));
+
+            return (start != 0);
+        }
+
+        ///  Number of values written so far
+        uint32_t Count() const
+        {
+            return _seq >> 1;
+        }
+
+    private:
+        T                   _value;
+        volatile uint32_t   _seq;
+};
+
+#endif
@@ -0,0 +1,87 @@
+/**
+ * spscqueue.hpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Fixed-size, lock-free queue for a single producer and a single consumer,
+ *  typically an interrupt routine producing and main loop consuming. Producer
+ *  only writes head, consumer only writes tail, so neither side has to disable
+ *  interrupts. Capacity is N-1 elements, N has to be a power of 2.
+ */
+#ifndef __SPSC_QUEUE__
+#define __SPSC_QUEUE__
+
+#include <stdint.h>
+
+//  Keep compiler from moving buffer accesses across index updates
+#ifndef COMPILER_BARRIER
+#define COMPILER_BARRIER()  __asm__ __volatile__("" ::: "memory")
+#endif
+
+template <typename T, uint16_t N>
+class SPSCQueue
+{
+    static_assert((N >= 2) && ((N & (N - 1)) == 0), "N has to be a power of 2");
+
+    public:
+        SPSCQueue(): _head(0), _tail(0), _overflows(0) {};
+
+        ///  Add element to the queue (producer side only)
+        ///  @return false if queue is full and element was dropped
+        bool Push(const T &arg)
+        {
+            uint16_t next = (_head + 1) & (N - 1);
+
+            if (next == _tail)
+            {
+                _overflows++;
+                return false;
+            }
+
+            _buffer[_head] = arg;
+            //  Publish element only after it has been written
+            COMPILER_BARRIER();
+            _head = next;
+            return true;
+        }
+
+        ///  Take oldest element from the queue (consumer side only)
+        ///  @return false if queue is empty
+        bool Pop(T &arg)
+        {
+            if (Empty())
+                return false;
+
+            arg = _buffer[_tail];
+            COMPILER_BARRIER();
+            _tail = (_tail + 1) & (N - 1);
+            return true;
+        }
+
+        ///  Check if there's anything to consume
+        bool Empty() const
+        {
+            return (_head == _tail);
+        }
+
+        ///  Number of elements waiting in the queue
+        uint16_t Size() const
+        {
+            return (_head - _tail) & (N - 1);
+        }
+
+        ///  Number of elements dropped because queue was full
+        uint32_t Overflows() const
+        {
+            return _overflows;
+        }
+
+    private:
+        T                   _buffer[N];
+        volatile uint16_t   _head;
+        volatile uint16_t   _tail;
+        volatile uint32_t   _overflows;
+};
+
+#endif
@@ -0,0 +1,168 @@
+/**
+ * tickless.hpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Tickless main loop around InvScheduler. There's no periodic tick interrupt,
+ *  scheduler time is instead brought up to date with HAL time base whenever
+ *  main loop gets to run, and in between the core sleeps until the next task
+ *  is due or an interrupt hands over work (HAL_BOARD_IdleUntil). Keeps track
+ *  of deadlines main loop was given: tasks being run late and events (e.g.
+ *  data-ready edges) serviced after the next one was already due.
+ */
+#ifndef __TICKLESS__
+#define __TICKLESS__
+
+#include <stdint.h>
+#include <string.h>
+#include "HAL/hal.h"
+#include "icm20948/Invn/EmbUtils/InvScheduler.h"
+
+class TicklessIdle
+{
+    public:
+        /**
+         * Deadlines kept and missed since Start
+         */
+        struct Stats
+        {
+            uint32_t    events;         //  Events serviced
+            uint32_t    eventsLate;     //  Of those, serviced after deadline
+            uint32_t    eventsOverdue;  //  Expected events that never came
+            uint32_t    latencyMaxUs;   //  Longest time from event to service
+            uint64_t    latencySumUs;   //  Sum of those times
+            uint32_t    tasksLate;      //  Tasks run later than they were due
+            uint32_t    taskLateMaxUs;  //  Longest such delay
+        };
+
+        TicklessIdle(InvScheduler &scheduler): _scheduler(scheduler),
+                _originUs(0), _ticks(0), _dueUs(UINT64_MAX)
+        {
+            memset(&_stats, 0, sizeof(_stats));
+        }
+
+        ///  Start counting scheduler time from now, and clear statistics
+        ///  (also HAL_BOARD_IdleStats)
+        void Start()
+        {
+            _originUs = HAL_BOARD_TimeUS();
+            _ticks = 0;
+            _dueUs = UINT64_MAX;
+            memset(&_stats, 0, sizeof(_stats));
+            HAL_BOARD_IdleStatsReset();
+        }
+
+        ///  Bring scheduler time up to date and run every task that's due
+        ///  @return Number of tasks run
+        int Dispatch()
+        {
+            uint64_t nowUs;
+
+            NextTaskUs();
+            nowUs = HAL_BOARD_TimeUS();
+            //  Task is late if it missed the tick it was due in
+            if (nowUs >= _dueUs)
+            {
+                if ((nowUs - _dueUs) >= INVSCHEDULER_PERIOD_US)
+                {
+                    _stats.tasksLate++;
+                    if ((nowUs - _dueUs) > _stats.taskLateMaxUs)
+                        _stats.taskLateMaxUs = (uint32_t)(nowUs - _dueUs);
+                }
+                _dueUs = UINT64_MAX;
+            }
+
+            return InvScheduler_dispatchTasks(&_scheduler);
+        }
+
+        ///  Time (HAL_BOARD_TimeUS) at which the next task is due, in the past
+        ///  if one is due already, UINT64_MAX if no task is started
+        uint64_t NextTaskUs()
+        {
+            uint32_t next;
+            uint64_t dueUs;
+
+            _Sync();
+            next = InvScheduler_getNextTime(&_scheduler);
+            if (next == UINT32_MAX)
+                return UINT64_MAX;
+
+            //  Task already due is reported as due now, keep the earlier time
+            //  it was expected at for Dispatch
+            dueUs = _originUs + INVSCHEDULER_TO_US(_ticks + next);
+            if (dueUs < _dueUs)
+                _dueUs = dueUs;
+
+            return dueUs;
+        }
+
+        ///  Time to sleep before either the next task is due or deadline
+        ///  passes (e.g. expected event is overdue), 0 if one has passed
+        ///  @param deadlineUs Time (HAL_BOARD_TimeUS), 0 if there's none
+        uint32_t SleepUs(uint64_t deadlineUs)
+        {
+            uint64_t wakeUs = NextTaskUs(), nowUs = HAL_BOARD_TimeUS();
+
+            if ((deadlineUs != 0) && (deadlineUs < wakeUs))
+                wakeUs = deadlineUs;
+            if (wakeUs <= nowUs)
+                return 0;
+
+            return ((wakeUs - nowUs) < UINT32_MAX) ? (uint32_t)(wakeUs - nowUs)
+                                                   : UINT32_MAX;
+        }
+
+        ///  Count event (e.g. data-ready edge) being serviced
+        ///  @param eventUs Time at which it happened
+        ///  @param deadlineUs Time by which it had to be serviced, usually when
+        ///         next one of the same kind is due, 0 if there's none
+        void Serviced(uint64_t eventUs, uint64_t deadlineUs)
+        {
+            uint64_t nowUs = HAL_BOARD_TimeUS();
+            uint32_t latency = (nowUs > eventUs) ? (uint32_t)(nowUs - eventUs)
+                                                 : 0;
+
+            _stats.events++;
+            _stats.latencySumUs += latency;
+            if (latency > _stats.latencyMaxUs)
+                _stats.latencyMaxUs = latency;
+            if ((deadlineUs != 0) && (nowUs > deadlineUs))
+                _stats.eventsLate++;
+        }
+
+        ///  Count expected event that didn't come in time
+        void Overdue()
+        {
+            _stats.eventsOverdue++;
+        }
+
+        const Stats& GetStats() const
+        {
+            return _stats;
+        }
+
+    private:
+        ///  Advance scheduler by ticks elapsed since it was last updated
+        void _Sync()
+        {
+            uint64_t ticks = INVSCHEDULER_FROM_US(HAL_BOARD_TimeUS() - _originUs);
+
+            if (ticks > _ticks)
+            {
+                InvScheduler_updateTimeDelta(&_scheduler,
+                                             (uint32_t)(ticks - _ticks));
+                _ticks = ticks;
+            }
+        }
+
+        InvScheduler &_scheduler;
+        //  Time base at Start, and scheduler ticks counted since then
+        uint64_t _originUs;
+        uint64_t _ticks;
+        //  Earliest time a task was due at since last Dispatch
+        uint64_t _dueUs;
+        Stats _stats;
+};
+
+#endif /* __TICKLESS__ */
@@ -2,18 +2,21 @@
 #include "libs/myLib.h"
 #include "icm20948/icm20948.h"
 #include "serialPort/uartHW.h"
+#include "libs/tickless.hpp"
 #include <cstdio>
 
 #include "driverlib/interrupt.h"
-#include "driverlib/systick.h"
 
-static float timestamp = 0;
+//  Stream samples as binary frames (SerialPort::WriteFrame, 12 floats in
+//  SAMPLE_FRAME) instead of CSV text, 54 instead of ~130 bytes per sample
+//#define __STREAM_BINARY__
+#define SAMPLE_FRAME    0x01
 
-void SysTickIntHandler(void)
-{
-    // Update the Systick interrupt counter.
-    timestamp += 100.0;
-}
+//  How late an expected data-ready edge can be before IMU FIFO is read anyway,
+//  in case the edge got lost
+#define DRDY_GUARD_US       2000
+//  Period of sleep and latency report (__DEBUG_SESSION__)
+#define STATUS_PERIOD_MS    10000
 
 //  DEfinition of these functions for deployment platform must exist
 extern "C" {
@@ -29,11 +32,48 @@ extern "C" {
     }
 
     uint64_t inv_icm20948_get_time_us(void){
-        return timestamp;
+        return HAL_BOARD_TimeUS();
     }
 
 }
 
+//  Main loop is tickless, core sleeps between data-ready edges and tasks
+static InvScheduler scheduler;
+static TicklessIdle idle(scheduler);
+
+#ifdef __DEBUG_SESSION__
+static InvSchedulerTask statusTask;
+
+/**
+ * Report share of time core spent asleep since last report (the rest of time
+ * it draws run-mode current, idle current itself has to be measured on the
+ * supply), wake-up latency and deadlines missed since start
+ */
+static void StatusTask(void *arg)
+{
+    static uint64_t lastUs = 0, lastIdleCycles = 0;
+    const TicklessIdle::Stats &st = idle.GetStats();
+    HAL_BOARD_IdleStats hal;
+    uint64_t nowUs = HAL_BOARD_TimeUS();
+    uint64_t idleUs;
+
+    HAL_BOARD_IdleStatsGet(&hal);
+    idleUs = HAL_BOARD_CyclesToUS(hal.idleCycles - lastIdleCycles);
+
+    DEBUG_WRITE("Idle %u.%u%%, %u sleeps (%u timer wakes, latency max %u "
+                "cycles)\n", (uint32_t)(idleUs * 100 / (nowUs - lastUs)),
+                (uint32_t)(idleUs * 1000 / (nowUs - lastUs) % 10),
+                hal.sleeps, hal.timerWakes, hal.latencyMax);
+    DEBUG_WRITE("Edge to read %u us avg, %u us max, %u late, %u overdue, "
+                "%u late tasks\n", (uint32_t)(st.latencySumUs /
+                ((st.events != 0) ? st.events : 1)), st.latencyMaxUs,
+                st.eventsLate, st.eventsOverdue, st.tasksLate);
+
+    lastUs = nowUs;
+    lastIdleCycles = hal.idleCycles;
+}
+#endif
+
 /**
  * main.cpp
  */
@@ -52,11 +92,8 @@ int main(void)
 
     //  Initialize board and FPU
     HAL_BOARD_CLOCK_Init();
-
-    SysTickPeriodSet(12000);
-    SysTickIntRegister(SysTickIntHandler);
-    SysTickIntEnable();
-    SysTickEnable();
+    //  Time base for sensor timestamps, 64-bit count of system clock cycles
+    HAL_BOARD_TimeInit();
 
     //  Initialize serial port
     SerialPort::GetI().InitHW();
@@ -70,10 +107,18 @@ int main(void)
     imu.SetGyroscopeFSR(GyroFSR250dps);
     imu.SetMagnetometerBias(-73.363101, -69.95, -3.0);
     imu.SetMountingMatrix(mountMatrix);
+    //  RPY angles printed below don't need more than 0.01 degree accuracy
+    imu.SetOrientationMath(OrientationMathFast);
 
     //  Software initialization of the IMU
-    //  (load DMP firmware and enable all the sensors)
-    imu.InitSW();
+    //  (load DMP firmware and enable all the sensors). After watchdog or other
+    //  warm reset try to reuse firmware still loaded in the IMU
+    imu.InitSW(HAL_BOARD_WarmReset());
+#ifdef __DEBUG_SESSION__
+    DEBUG_WRITE("Bus throughput: %u B/s (init clock), %u B/s (stream clock)\n",
+                imu.MeasureBusThroughput(HAL_MPU_BUS_SPEED_SAFE),
+                imu.MeasureBusThroughput(HAL_MPU_BUS_SPEED_FAST));
+#endif
 
     //
     //  DMP has been loaded, enable the sensors
@@ -121,35 +166,72 @@ int main(void)
     DEBUG_WRITE("    Gravity vector: ");
 #endif
 
-    float data[3];
+    InvScheduler_init(&scheduler);
+#ifdef __DEBUG_SESSION__
+    InvScheduler_initTask(&scheduler, &statusTask, "status", StatusTask, 0,
+                          INVSCHEDULER_TASK_PRIO_MIN,
+                          INVSCHEDULER_FROM_MS(STATUS_PERIOD_MS));
+    InvScheduler_startTask(&statusTask, INVSCHEDULER_FROM_MS(STATUS_PERIOD_MS));
+#endif
+    idle.Start();
+
+    float sample[12];
+    //  Expected edge that was already reported overdue
+    uint64_t overdueUs = 0;
     while (1)
     {
-        //  Check if IMU toggled interrupt pin
-        //  (this example doesn't use interrupts, but polling)
-        if (imu.IsDataReady())
-        {
-            char buffer[160];
+        uint64_t edgeUs, expectedUs, deadlineUs = 0;
 
-            //  Read sensor data
-            imu.ReadSensorData(timestamp);
+        idle.Dispatch();
 
-            //  Read and print orientation as reported by the 6DOF and 9DOF fusion
-            imu.GetOrientationRPY(Orientation6DOF, data, true);
-            snprintf(buffer, 160, "%f,%f,%f",data[0],data[1],data[2]);
-            imu.GetOrientationRPY(Orientation9DOF, data, true);
-            snprintf(buffer, 160, "%s,%f,%f,%f",buffer, data[0],data[1],data[2]);
-            DEBUG_WRITE("%s\n", buffer);
-
-            //  Read acceleration and angular velocity
-            imu.GetLinearAcceleration(data);
-            snprintf(buffer, 160, "%f,%f,%f",data[0],data[1],data[2]);
-            imu.GetGyroscope(data);
-            snprintf(buffer, 160, "%s,%f,%f,%f",buffer, data[0],data[1],data[2]);
-            DEBUG_WRITE("%s\n\n", buffer);
+        //  Sleep until IMU toggles interrupt pin, next task is due or expected
+        //  edge is overdue. Edge is captured in interrupt so no sample can be
+        //  missed or read twice
+        expectedUs = imu.NextDataUs();
+        if ((expectedUs != 0) && (expectedUs != overdueUs))
+            deadlineUs = expectedUs + DRDY_GUARD_US;
 
+        if (!imu.WaitForData(idle.SleepUs(deadlineUs), &edgeUs))
+        {
+            if ((deadlineUs != 0) && (HAL_BOARD_TimeUS() >= deadlineUs))
+            {
+                idle.Overdue();
+                overdueUs = expectedUs;
+                imu.ReadSensorData();
+            }
         }
+        else
+        {
+            //  Sample has to be read before the next one is due
+            deadlineUs = imu.NextDataUs();
+
+            //  Read sensor data, timestamped with the data-ready edge
+            imu.ReadSensorData();
+
+            //  Read orientation as reported by the 6DOF and 9DOF fusion,
+            //  acceleration and angular velocity
+            imu.GetOrientationRPY(Orientation6DOF, &sample[0], true);
+            imu.GetOrientationRPY(Orientation9DOF, &sample[3], true);
+            imu.GetLinearAcceleration(&sample[6]);
+            imu.GetGyroscope(&sample[9]);
+
+            //  Neither waits for UART, sample is dropped if it can't keep up
+            //  (SerialPort::TxDropped)
+#ifdef __STREAM_BINARY__
+            SerialPort::GetI().WriteFrame(SAMPLE_FRAME, sample, sizeof(sample));
+#else
+            char buffer[160];
 
-        // INT pin can be held up for max 50us, so delay here to prevent reading the same data twice
-        HAL_DelayUS(50);
+            snprintf(buffer, 160, "%f,%f,%f,%f,%f,%f\n",
+                     sample[0], sample[1], sample[2],
+                     sample[3], sample[4], sample[5]);
+            DEBUG_WRITE("%s", buffer);
+            snprintf(buffer, 160, "%f,%f,%f,%f,%f,%f\n\n",
+                     sample[6], sample[7], sample[8],
+                     sample[9], sample[10], sample[11]);
+            DEBUG_WRITE("%s", buffer);
+#endif
+            idle.Serviced(edgeUs, deadlineUs);
+        }
     }
 }
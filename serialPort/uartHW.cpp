@@ -14,11 +14,21 @@
 #include "driverlib/sysctl.h"
 #include "driverlib/interrupt.h"
 #include "driverlib/rom_map.h"
+#include "inc/hw_uart.h"
 #include "driverlib/uart.h"
-#include "utils/uartstdio.h"
+#include "driverlib/udma.h"
+#include "utils/ustdlib.h"
 
+#include "HAL/tm4c1294/hal_common_tm4c.h"
 #include "uartHW.h"
 
+#include <string.h>
+
+/**     UART0 TX uDMA channel       */
+#define UART0_DMA_TX        UDMA_CH9_UART0TX
+//  Max number of items uDMA can move in a single basic-mode transfer
+#define DMA_MAX_TRANSFER    1024
+
 ///-----------------------------------------------------------------------------
 ///         Functions for returning static instance                     [PUBLIC]
 ///-----------------------------------------------------------------------------
@@ -42,27 +52,198 @@ SerialPort* SerialPort::GetP()
     return &(SerialPort::GetI());
 }
 
-SerialPort::SerialPort() {}
+SerialPort::SerialPort(): custHook(0), _txHead(0), _txTail(0), _txChunk(0),
+        _txDropped(0), _txStalls(0), _txPeak(0) {}
 SerialPort::~SerialPort() {}
 
+/**
+ * Format a message (same format specifiers as UARTprintf) and queue it for
+ * sending, converting \n into \r\n. Message is dropped if there's no room
+ * for it in the ring, and cut at TX_PRINTF_LEN characters
+ */
 void SerialPort::Send(const char* arg, ...)
 {
+    char buffer[TX_PRINTF_LEN];
     va_list vaArgP;
-
+    int32_t len, newlines = 0;
 
     //	Start the varargs processing.
     va_start(vaArgP, arg);
 
-    UARTvprintf(arg, vaArgP);
+    len = uvsnprintf(buffer, TX_PRINTF_LEN, arg, vaArgP);
 
     //	We're finished with the varargs now.
     va_end(vaArgP);
+
+    if (len > TX_PRINTF_LEN - 1)
+        len = TX_PRINTF_LEN - 1;
+    for (int32_t i = 0; i < len; i++)
+        newlines += (buffer[i] == '\n');
+
+    //  Cut message so that it still fits once expanded, then expand it in
+    //  place starting from the end
+    while (len + newlines > TX_PRINTF_LEN - 1)
+        newlines -= (buffer[--len] == '\n');
+    for (int32_t src = len - 1, dst = len + newlines - 1; src != dst; src--)
+    {
+        buffer[dst--] = buffer[src];
+        if (buffer[src] == '\n')
+            buffer[dst--] = '\r';
+    }
+
+    Write(buffer, len + newlines);
+}
+
+/**
+ * Queue data for sending, without waiting for UART (non-blocking). Safe to
+ * call from interrupts; they are masked while data is copied into the ring
+ * @param buf Data to send, can be reused as soon as function returns
+ * @param len Number of bytes to send
+ * @return true if data was queued, false if it was dropped as a whole because
+ *         ring doesn't have room for it
+ */
+bool SerialPort::Write(const void *buf, uint16_t len)
+{
+    const uint8_t *src = (const uint8_t*)buf;
+    bool masked = IntMasterDisable();
+    uint16_t head = _txHead,
+             used = (head - _txTail) & (TX_RING_LEN - 1),
+             first = TX_RING_LEN - head;
+
+    if (len > TX_RING_LEN - 1 - used)
+    {
+        _txDropped += len;
+        _txStalls++;
+        if (!masked)
+            IntMasterEnable();
+        return false;
+    }
+
+    //  Copy data, wrapping around the end of the ring if needed
+    if (first > len)
+        first = len;
+    memcpy(&_txRing[head], src, first);
+    memcpy(_txRing, src + first, len - first);
+    _txHead = (head + len) & (TX_RING_LEN - 1);
+
+    used += len;
+    if (used > _txPeak)
+        _txPeak = used;
+
+    //  Kick off uDMA unless it's already sending, in which case new data is
+    //  picked up once current transfer is done
+    if (_txChunk == 0)
+        _TxStart();
+
+    if (!masked)
+        IntMasterEnable();
+    return true;
+}
+
+/**
+ * Queue a binary frame: sync bytes, type, payload length, payload and
+ * Fletcher-16 checksum of type, length and payload. Compact alternative to
+ * printing sensor samples as text
+ * @param type Frame type, defined by the application
+ * @return true if frame was queued, false if it was dropped
+ */
+bool SerialPort::WriteFrame(uint8_t type, const void *payload, uint8_t len)
+{
+    uint8_t frame[FRAME_MAX_PAYLOAD + FRAME_OVERHEAD];
+    uint16_t sum1, sum2;
+
+    frame[0] = FRAME_SYNC1;
+    frame[1] = FRAME_SYNC2;
+    frame[2] = type;
+    frame[3] = len;
+    memcpy(&frame[4], payload, len);
+
+    //  Sums stay below 2^16 for up to 257 bytes, reduce them only at the end
+    sum1 = sum2 = 0;
+    for (uint16_t i = 2; i < len + 4; i++)
+    {
+        sum1 += frame[i];
+        sum2 += sum1 % 255;
+    }
+    frame[len + 4] = sum1 % 255;
+    frame[len + 5] = sum2 % 255;
+
+    return Write(frame, len + FRAME_OVERHEAD);
+}
+
+/**
+ * Wait until all queued data has been sent (blocking). Must not be called
+ * with interrupts disabled
+ */
+void SerialPort::Flush()
+{
+    while (_txHead != _txTail);
+}
+
+///  Number of bytes that can currently be queued without being dropped
+uint16_t SerialPort::TxFree() const
+{
+    return TX_RING_LEN - 1 - ((_txHead - _txTail) & (TX_RING_LEN - 1));
+}
+
+///  Number of bytes dropped so far because ring was full
+uint32_t SerialPort::TxDropped() const
+{
+    return _txDropped;
+}
+
+///  Number of writes refused so far because ring was full
+uint32_t SerialPort::TxStalls() const
+{
+    return _txStalls;
+}
+
+///  Highest number of bytes waiting in the ring so far
+uint16_t SerialPort::TxPeak() const
+{
+    return _txPeak;
+}
+
+/**
+ * Start uDMA on the oldest part of the ring that is contiguous in memory.
+ * Called with interrupts masked or from UART interrupt
+ */
+void SerialPort::_TxStart()
+{
+    uint16_t head = _txHead, tail = _txTail, chunk;
+
+    if (head == tail)
+    {
+        _txChunk = 0;
+        return;
+    }
+
+    chunk = (head > tail) ? (head - tail) : (TX_RING_LEN - tail);
+    if (chunk > DMA_MAX_TRANSFER)
+        chunk = DMA_MAX_TRANSFER;
+    _txChunk = chunk;
+
+    uDMAChannelTransferSet(UART0_DMA_TX | UDMA_PRI_SELECT, UDMA_MODE_BASIC,
+                           &_txRing[tail], (void *)(UART0_BASE + UART_O_DR),
+                           chunk);
+    uDMAChannelEnable(UART0_DMA_TX);
+}
+
+/**
+ * Release data sent by uDMA and start sending the rest, if any
+ */
+void SerialPort::_TxDone()
+{
+    _txTail = (_txTail + _txChunk) & (TX_RING_LEN - 1);
+    _TxStart();
 }
 
 /**
  * Initialize UART port used in communication with Raspberry Pi
+ * @param baud Baud rate, up to 1/8 of system clock
+ * @return STATUS_OK on success, STATUS_ARG_ERR if baud rate is out of range
  */
-int8_t SerialPort::InitHW()
+int8_t SerialPort::InitHW(uint32_t baud)
 {
 	uint32_t refClock, refClockHz;
 
@@ -70,7 +251,7 @@ int8_t SerialPort::InitHW()
 	 * Check desired communication speed and adjust clock settings used to
 	 * 		Derive desired baud rate
 	 */
-	if (COMM_BAUD > 2000000)
+	if (baud > 2000000)
 	{
 		refClock =  UART_CLOCK_SYSTEM;
 		refClockHz = g_ui32SysClock;
@@ -80,9 +261,12 @@ int8_t SerialPort::InitHW()
 		refClock =  UART_CLOCK_PIOSC;
 		refClockHz = 16000000;
 	}
+	//  UART needs at least 8 clock cycles per bit (high-speed mode)
+	if ((baud == 0) || (baud > refClockHz / 8))
+	    return STATUS_ARG_ERR;
 
 	/*
-	 * Configure UARTstdio and accompanying GPIO pins for UART communication
+	 * Configure UART and accompanying GPIO pins for UART communication
 	 */
 	SysCtlPeripheralEnable(SYSCTL_PERIPH_UART0);
     SysCtlPeripheralEnable(SYSCTL_PERIPH_GPIOA);
@@ -92,14 +276,27 @@ int8_t SerialPort::InitHW()
 
     UARTClockSourceSet(UART0_BASE, refClock);
     GPIOPinTypeUART(GPIO_PORTA_BASE, GPIO_PIN_0 | GPIO_PIN_1);
-    UARTStdioConfig(0, COMM_BAUD, refClockHz);
+    UARTConfigSetExpClk(UART0_BASE, refClockHz, baud,
+                        UART_CONFIG_WLEN_8 | UART_CONFIG_STOP_ONE |
+                        UART_CONFIG_PAR_NONE);
 
     /*
-     * Enable Interrupt on received data
+     * Route TX requests to uDMA, channel moves bytes from ring to UART data
+     * register and raises UART interrupt once done
      */
-    UARTFIFOLevelSet(UART0_BASE, UART_FIFO_TX1_8, UART_FIFO_RX1_8);
-   	UARTIntEnable(UART0_BASE, UART_INT_RX | UART_INT_RT);
-   	UARTIntRegister(UART0_BASE,UART0RxIntHandler);
+    HAL_DMA_Init();
+    uDMAChannelAssign(UART0_DMA_TX);
+    uDMAChannelAttributeDisable(UART0_DMA_TX, UDMA_ATTR_ALL);
+    uDMAChannelControlSet(UART0_DMA_TX | UDMA_PRI_SELECT,
+            UDMA_SIZE_8 | UDMA_SRC_INC_8 | UDMA_DST_INC_NONE | UDMA_ARB_4);
+    UARTDMAEnable(UART0_BASE, UART_DMA_TX);
+
+    /*
+     * Enable Interrupt on received data and on end of uDMA transfer
+     */
+    UARTFIFOLevelSet(UART0_BASE, UART_FIFO_TX4_8, UART_FIFO_RX1_8);
+   	UARTIntEnable(UART0_BASE, UART_INT_RX | UART_INT_RT | UART_INT_DMATX);
+   	UARTIntRegister(UART0_BASE, UART0IntHandler);
    	IntEnable(INT_UART0);
 
     IntMasterEnable();
@@ -113,23 +310,30 @@ void SerialPort::AddHook(void((*funPoint)(uint8_t*, uint16_t*)))
 }
 
 /**
- * Interrupt service routine for handling incoming data on UART (Tx)
+ * Interrupt service routine for handling incoming data on UART (Tx) and end
+ * of outgoing uDMA transfer
  * @note IMPORTANT Custom hook HAS TO clear the buffer and bufLen variable
  */
-void UART0RxIntHandler(void)
+void UART0IntHandler(void)
 {
 	static uint8_t txBuffer[TX_BUF_LEN];
 	static uint16_t txBufLen = 0;
+	uint32_t status = UARTIntStatus(UART0_BASE, true);
+
+	//Clear interrupt flags
+	UARTIntClear(UART0_BASE, status);
 
-	//Clear interrupt flag
-	UARTIntClear(UART0_BASE, UART_INT_RX);
+	if (status & UART_INT_DMATX)
+	    SerialPort::GetP()->_TxDone();
+	if ((status & (UART_INT_RX | UART_INT_RT)) == 0)
+	    return;
 
 	//Take all chars from Tx FIFO and put them in buffer
 	while(UARTCharsAvail(UART0_BASE))
 	{
 		txBuffer[ txBufLen++ ] = UARTCharGet(UART0_BASE);
 		//	Add echo fo debugging purpose
-		UARTCharPut(UART0_BASE, txBuffer[ txBufLen-1 ]);
+		SerialPort::GetP()->Write(&txBuffer[ txBufLen-1 ], 1);
 	}
 
 	if (SerialPort::GetP()->custHook != 0)
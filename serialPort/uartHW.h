@@ -6,14 +6,33 @@
  *
  *  Debug bridge between PC<--(USB)-->TM4C
  *
+ *  Outgoing data is queued in a ring buffer and moved to UART by uDMA, so
+ *  neither Send nor Write wait for the port. Data that doesn't fit in the ring
+ *  is dropped (and counted) instead of blocking the caller.
  */
 #ifndef UARTHW_H_
 #define UARTHW_H_
 #include "libs/myLib.h"
 
 /*		Communication settings	 	*/
+//  Default baud rate, can be overridden in InitHW. Rates above 2Mbaud are
+//  derived from system clock, up to 7.5Mbaud at 120MHz
+#ifndef COMM_BAUD
 #define COMM_BAUD	115200
+#endif
 #define TX_BUF_LEN	512
+//  Size of outgoing ring buffer, has to be a power of 2
+#define TX_RING_LEN	2048
+//  Longest message Send can format (after expanding \n into \r\n)
+#define TX_PRINTF_LEN	256
+
+/*		Binary frames (WriteFrame)	 	*/
+//  Frame: sync bytes, type, payload length, payload, Fletcher-16 checksum of
+//  type, length and payload (sum1 first)
+#define FRAME_SYNC1	0xA5
+#define FRAME_SYNC2	0x5A
+#define FRAME_OVERHEAD	6
+#define FRAME_MAX_PAYLOAD	255
 
 /*      Macro to short the expression needed to print to debug port     */
 #define DEBUG_WRITE(...) SerialPort::GetI().Send(__VA_ARGS__)
@@ -22,35 +41,61 @@
 #define _FTOI_(X) (int32_t)(trunc(X)),(int32_t)fabs(trunc((X-trunc(X))*100))
 
 
+/*
+ * Function for receiving and processing incomming data - no need to call them
+ */
+
+extern "C"
+{
+    void UART0IntHandler(void);
+    extern uint32_t g_ui32SysClock;
+}
+
+
 /**
  * Interface to a UART-to-USB port, used for debugging
  */
 class SerialPort
 {
+    friend void UART0IntHandler(void);
 	public:
         static SerialPort& GetI();
         static SerialPort* GetP();
 
-		int8_t	InitHW();
+		int8_t	InitHW(uint32_t baud = COMM_BAUD);
 		void	Send(const char* arg, ...);
+		bool	Write(const void *buf, uint16_t len);
+		bool	WriteFrame(uint8_t type, const void *payload, uint8_t len);
+		void	Flush();
 		void	AddHook(void((*custHook)(uint8_t*, uint16_t*)));
 
+		uint16_t	TxFree() const;
+		uint32_t	TxDropped() const;
+		uint32_t	TxStalls() const;
+		uint16_t	TxPeak() const;
+
 		void	((*custHook)(uint8_t*, uint16_t*));  // Hook to user routine
+
 	protected:
 		SerialPort();
         ~SerialPort();
 
-};
-
-
-/*
- * Function for receiving and processing incomming data - no need to call them
- */
+        void	_TxStart();
+        //  Called from UART interrupt once uDMA moved queued data
+        void	_TxDone();
 
-extern "C"
-{
-    void UART0RxIntHandler(void);
-    extern uint32_t g_ui32SysClock;
-}
+        //  Outgoing ring: head written by producers (with interrupts masked),
+        //  tail by UART interrupt once uDMA has sent the data
+        uint8_t             _txRing[TX_RING_LEN];
+        volatile uint16_t   _txHead;
+        volatile uint16_t   _txTail;
+        //  Number of bytes uDMA is currently sending from tail, 0 if idle
+        volatile uint16_t   _txChunk;
+        //  Bytes dropped because ring was full, number of writes that were
+        //  refused for it, and highest ring fill level seen
+        volatile uint32_t   _txDropped;
+        volatile uint32_t   _txStalls;
+        uint16_t            _txPeak;
+};
 
 #endif /* UARTHW_H_ */
@@ -0,0 +1,154 @@
+/**
+ * bench_bus.cpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Bus traffic of driver operations with and without transaction scopes
+ *  (inv_icm20948_transport_begin/end), as counted by driver bus statistics
+ */
+#include "replay_bench.h"
+#include "icm20948/Invn/Devices/Drivers/ICM20948/Icm20948Transport.h"
+#include "icm20948/Invn/Devices/Drivers/ICM20948/Icm20948DataBaseControl.h"
+
+//  Bytes left in SW FIFO between FIFO reads
+static int busFifoLeft = 0;
+
+/**
+ * Read one capture record into SW FIFO and pop its packets, as
+ * inv_icm20948_poll_sensor() does (FIFO served by fake serial interface)
+ */
+static void BusFifoRead(uint32_t i)
+{
+    unsigned short total = 0, header, header2;
+    short status;
+
+    (void)i;
+    inv_icm20948_identify_interrupt(&icm_device, &status);
+    if (inv_icm20948_fifo_swmirror(&icm_device, &busFifoLeft, &total, 0) != 0)
+        return;
+    while (total--)
+        if (inv_icm20948_fifo_pop(&icm_device, &header, &header2,
+                                  &busFifoLeft) != 0)
+            break;
+}
+
+/**
+ * Read a few DMP memory locations, as reading biases or accuracy does
+ * (simulated chip)
+ */
+static void BusDmpRead(uint32_t i)
+{
+    uint8_t data[16];
+
+    (void)i;
+    for (uint8_t k = 0; k < 4; k++)
+        inv_icm20948_read_mems(&icm_device, DMP_LOAD_START + k * sizeof(data),
+                               sizeof(data), data);
+}
+
+/**
+ * Change gyroscope period back and forth, as inv_icm20948_set_sensor_period()
+ * does (simulated chip). LP_EN is held off by the driver for the whole change,
+ * so scope is not expected to save anything here
+ */
+static void BusSetPeriod(uint32_t i)
+{
+    inv_icm20948_set_odr(&icm_device, ANDROID_SENSOR_GYROSCOPE, (i & 1) ? 10 : 5);
+}
+
+/**
+ * Disable and enable gyroscope, as inv_icm20948_enable_sensor() does
+ * (simulated chip)
+ */
+static void BusEnable(uint32_t i)
+{
+    inv_icm20948_ctrl_enable_sensor(&icm_device, ANDROID_SENSOR_GYROSCOPE,
+                                    i & 1);
+}
+
+static const struct
+{
+    const char  *name;
+    void        (*run)(uint32_t i);
+    bool        replay;     //  Needs FIFO from capture
+    bool        batch;      //  Run with batching enabled
+} busOperations[] =
+{
+    { "FIFO read",      BusFifoRead,    true,   false },
+    { "FIFO batched",   BusFifoRead,    true,   true },
+    { "DMP reads",      BusDmpRead,     false,  false },
+    { "set period",     BusSetPeriod,   false,  false },
+    { "enable sensor",  BusEnable,      false,  false },
+};
+
+/**
+ * Run operation <count> times, each in its own transaction scope or not, and
+ * collect bus traffic it caused
+ */
+static void BusRun(uint8_t op, bool scoped, uint32_t count,
+                   struct inv_icm20948_bus_stats *stats)
+{
+    //  FIFO registers need LP_EN disabled only in batch mode
+    if (busOperations[op].batch)
+        ICM20948::GetI().EnableBatching(100);
+    if (busOperations[op].replay)
+    {
+        HAL_MPU_SimAttachSerif(FifoReplay_SerifRead, FifoReplay_SerifWrite, 0);
+        FifoReplay_Rewind(true);
+        busFifoLeft = 0;
+    }
+
+    inv_icm20948_reset_bus_stats(&icm_device);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (scoped)
+            inv_icm20948_transport_begin(&icm_device);
+        busOperations[op].run(i);
+        if (scoped)
+            inv_icm20948_transport_end(&icm_device);
+    }
+    inv_icm20948_get_bus_stats(&icm_device, stats);
+
+    if (busOperations[op].replay)
+        HAL_MPU_SimAttachSerif(0, 0, 0);
+    if (busOperations[op].batch)
+        ICM20948::GetI().DisableBatching();
+}
+
+int Bus(uint32_t count)
+{
+    struct inv_icm20948_bus_stats stats[2];
+    int rc = 0;
+
+    if ((count == 0) || (StartDriver(FifoReplay_Header()) != 0))
+        return -1;
+
+    printf("%-14s %-6s %8s %8s %10s %12s  (per call)\n", "operation", "scope",
+           "mems", "bank_sel", "PWR_MGMT_1", "transactions");
+    for (uint8_t op = 0; op < sizeof(busOperations)/sizeof(busOperations[0]); op++)
+    {
+        for (uint8_t s = 0; s < 2; s++)
+        {
+            BusRun(op, s != 0, count, &stats[s]);
+            printf("%-14s %-6s %8.1f %8.1f %10.1f %12.1f\n",
+                   busOperations[op].name, s ? "yes" : "no",
+                   (double)stats[s].mems_calls / count,
+                   (double)stats[s].bank_selects / count,
+                   (double)stats[s].power_writes / count,
+                   (double)(stats[s].read_transactions +
+                            stats[s].write_transactions) / count);
+        }
+
+        //  Scope can only save LP_EN toggling, never add bus traffic
+        if ((stats[1].power_writes > stats[0].power_writes) ||
+            (stats[1].read_transactions + stats[1].write_transactions >
+             stats[0].read_transactions + stats[0].write_transactions))
+        {
+            printf("%s: more bus traffic in scope\n", busOperations[op].name);
+            rc = -1;
+        }
+    }
+
+    return rc;
+}
@@ -0,0 +1,659 @@
+/**
+ * bench_decode.cpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  fifo_replay commands decoding a capture straight from memory, through
+ *  a fake serial interface: FIFO decoding throughput, sensor event
+ *  handler and batch decoder
+ */
+#include "replay_bench.h"
+
+#include "icm20948/icm20948_poller.hpp"
+
+//  Event handler of ICM20948 class
+extern void build_sensor_event_data(void * context, inv_icm20948_sensor sensortype,
+                                    uint64_t timestamp, const void * data,
+                                    const void *arg);
+
+//  Poller decoding only the sensors enabled when recording (main.cpp)
+typedef ICM20948Poller<ICM20948_SENSOR_BIT(INV_ICM20948_SENSOR_GYROSCOPE) |
+                       ICM20948_SENSOR_BIT(INV_ICM20948_SENSOR_ACCELEROMETER) |
+                       ICM20948_SENSOR_BIT(INV_ICM20948_SENSOR_GAME_ROTATION_VECTOR)>
+        RecordPoller;
+
+static void CountEvent(void *context, enum inv_icm20948_sensor sensor,
+                       uint64_t timestamp, const void *data, const void *arg)
+{
+    (void)sensor;
+    (void)timestamp;
+    (void)data;
+    (void)arg;
+    (*(uint64_t*)context)++;
+}
+
+static int BenchPoll(const char *name, ICM20948::PollFunc poll,
+                     uint32_t passes)
+{
+    uint64_t events = 0, polls = (uint64_t)FifoReplay_Records() * passes;
+    struct timespec start, end;
+    double seconds;
+
+    if (StartDriver(FifoReplay_Header()) != 0)
+        return -1;
+
+    HAL_MPU_SimAttachSerif(FifoReplay_SerifRead, FifoReplay_SerifWrite, 0);
+    FifoReplay_Rewind(true);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint64_t i = 0; i < polls; i++)
+        poll(&icm_device, &events, CountEvent);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    HAL_MPU_SimAttachSerif(0, 0, 0);
+
+    seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    printf("%s:\n", name);
+    printf("  %llu FIFO reads, %llu bytes, %llu sensor events in %.3f s\n",
+           (unsigned long long)polls,
+           (unsigned long long)FifoReplay_Bytes() * passes,
+           (unsigned long long)events, seconds);
+    printf("  %.0f reads/s, %.1f MB/s, %.0f events/s\n", polls / seconds,
+           FifoReplay_Bytes() * (double)passes / seconds / 1e6,
+           events / seconds);
+
+    return 0;
+}
+
+int Bench(uint32_t passes)
+{
+    if (BenchPoll("inv_icm20948_poll_sensor", inv_icm20948_poll_sensor,
+                  passes) != 0)
+        return -1;
+
+    return BenchPoll("ICM20948Poller<gyro|accel|grv>", RecordPoller::Poll,
+                     passes);
+}
+
+/**
+ * Sensor event as passed from the driver to its handler
+ */
+struct DecodedEvent
+{
+    inv_icm20948_sensor sensor;
+    uint64_t            timestamp;
+    float               data[6];
+    union
+    {
+        int             i;
+        float           f;
+    }                   arg;
+    bool                hasArg;
+};
+
+static DecodedEvent *decoded = 0;
+static uint32_t decodedCount = 0, decodedMax = 0;
+
+static void RecordEvent(void *context, enum inv_icm20948_sensor sensor,
+                        uint64_t timestamp, const void *data, const void *arg)
+{
+    DecodedEvent *ev;
+
+    (void)context;
+    if (decodedCount == decodedMax)
+    {
+        decodedMax = (decodedMax == 0) ? 1024 : 2 * decodedMax;
+        decoded = (DecodedEvent*)realloc(decoded, decodedMax * sizeof(*ev));
+    }
+    ev = &decoded[decodedCount++];
+
+    memset(ev, 0, sizeof(*ev));
+    ev->sensor = sensor;
+    ev->timestamp = timestamp;
+    //  Only sensors enabled while recording (float vectors) are captured
+    if (data != 0)
+        memcpy(ev->data, data, (sensor == INV_ICM20948_SENSOR_GYROSCOPE_UNCALIBRATED ||
+                                sensor == INV_ICM20948_SENSOR_MAGNETIC_FIELD_UNCALIBRATED) ?
+                               6 * sizeof(float) : 4 * sizeof(float));
+    if (arg != 0)
+    {
+        memcpy(&ev->arg, arg, sizeof(ev->arg));
+        ev->hasArg = true;
+    }
+}
+
+/**
+ * Event handler as it was before ICM20948 moved to table dispatch: clear a
+ * generic sensor event, fill it through a switch and publish data out of it
+ * the same way ICM20948 does (queue + latest value)
+ */
+static SPSCQueue<ICM20948::Sample, ICM20948_SAMPLE_QUEUE_LEN> legacyQueue[INV_ICM20948_SENSOR_MAX];
+static SeqLock<ICM20948::Sample> legacyLatest[INV_ICM20948_SENSOR_MAX];
+
+static void LegacyPublish(enum inv_icm20948_sensor sensor, uint64_t timestamp,
+                          const float *data, uint8_t length, float accuracy)
+{
+    ICM20948::Sample sample;
+
+    sample.timestamp = timestamp;
+    memset((void*)sample.data, 0, sizeof(sample.data));
+    memcpy((void*)sample.data, (void*)data, sizeof(float)*length);
+    sample.accuracy = accuracy;
+
+    legacyLatest[sensor].Write(sample);
+    legacyQueue[sensor].Push(sample);
+}
+
+static void LegacyEvent(void *context, enum inv_icm20948_sensor sensor,
+                        uint64_t timestamp, const void *data, const void *arg)
+{
+    static const uint8_t genericIds[INV_ICM20948_SENSOR_MAX] = {
+        INV_SENSOR_TYPE_ACCELEROMETER, INV_SENSOR_TYPE_GYROSCOPE,
+        INV_SENSOR_TYPE_RAW_ACCELEROMETER, INV_SENSOR_TYPE_RAW_GYROSCOPE,
+        INV_SENSOR_TYPE_UNCAL_MAGNETOMETER, INV_SENSOR_TYPE_UNCAL_GYROSCOPE,
+        INV_SENSOR_TYPE_BAC, INV_SENSOR_TYPE_STEP_DETECTOR,
+        INV_SENSOR_TYPE_STEP_COUNTER, INV_SENSOR_TYPE_GAME_ROTATION_VECTOR,
+        INV_SENSOR_TYPE_ROTATION_VECTOR, INV_SENSOR_TYPE_GEOMAG_ROTATION_VECTOR,
+        INV_SENSOR_TYPE_MAGNETOMETER, INV_SENSOR_TYPE_SMD,
+        INV_SENSOR_TYPE_PICK_UP_GESTURE, INV_SENSOR_TYPE_TILT_DETECTOR,
+        INV_SENSOR_TYPE_GRAVITY, INV_SENSOR_TYPE_LINEAR_ACCELERATION,
+        INV_SENSOR_TYPE_ORIENTATION, INV_SENSOR_TYPE_B2S
+    };
+    inv_sensor_event_t event;
+
+    (void)context;
+    memset((void *)&event, 0, sizeof(event));
+    event.sensor = genericIds[sensor];
+    event.timestamp = timestamp;
+    switch (event.sensor)
+    {
+        case INV_SENSOR_TYPE_GYROSCOPE:
+            memcpy(event.data.gyr.vect, data, sizeof(event.data.gyr.vect));
+            memcpy(&(event.data.gyr.accuracy_flag), arg, sizeof(event.data.gyr.accuracy_flag));
+            LegacyPublish(sensor, timestamp, event.data.gyr.vect, 3, event.data.gyr.accuracy_flag);
+            break;
+        case INV_SENSOR_TYPE_ACCELEROMETER:
+        case INV_SENSOR_TYPE_LINEAR_ACCELERATION:
+        case INV_SENSOR_TYPE_GRAVITY:
+            memcpy(event.data.acc.vect, data, sizeof(event.data.acc.vect));
+            memcpy(&(event.data.acc.accuracy_flag), arg, sizeof(event.data.acc.accuracy_flag));
+            LegacyPublish(sensor, timestamp, event.data.acc.vect, 3, event.data.acc.accuracy_flag);
+            break;
+        case INV_SENSOR_TYPE_MAGNETOMETER:
+            memcpy(event.data.mag.vect, data, sizeof(event.data.mag.vect));
+            memcpy(&(event.data.mag.accuracy_flag), arg, sizeof(event.data.mag.accuracy_flag));
+            LegacyPublish(sensor, timestamp, event.data.mag.vect, 3, event.data.mag.accuracy_flag);
+            break;
+        case INV_SENSOR_TYPE_ROTATION_VECTOR:
+            memcpy(&(event.data.quaternion.accuracy), arg, sizeof(event.data.quaternion.accuracy));
+            memcpy(event.data.quaternion.quat, data, sizeof(event.data.quaternion.quat));
+            LegacyPublish(sensor, timestamp, event.data.quaternion.quat, 4, event.data.quaternion.accuracy);
+            break;
+        case INV_SENSOR_TYPE_GAME_ROTATION_VECTOR:
+            memcpy(event.data.quaternion.quat, data, sizeof(event.data.quaternion.quat));
+            event.data.quaternion.accuracy_flag =
+                    (int8_t)min(inv_icm20948_get_accel_accuracy(),
+                                inv_icm20948_get_gyro_accuracy());
+            LegacyPublish(sensor, timestamp, event.data.quaternion.quat, 4, event.data.quaternion.accuracy_flag);
+            break;
+        default:
+            return;
+    }
+}
+
+/**
+ * Time feeding decoded events through given handler
+ * @return Time per event in ns
+ */
+static double TimeHandler(void (*handler)(void *, enum inv_icm20948_sensor,
+                                          uint64_t, const void *, const void *),
+                          void *context, uint32_t passes)
+{
+    struct timespec start, end;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (uint32_t p = 0; p < passes; p++)
+        for (uint32_t i = 0; i < decodedCount; i++)
+            handler(context, decoded[i].sensor, decoded[i].timestamp,
+                    decoded[i].data, decoded[i].hasArg ? &decoded[i].arg : 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec))
+           / ((double)decodedCount * passes);
+}
+
+int Dispatch(uint32_t passes)
+{
+    ICM20948 &imu = ICM20948::GetI();
+    ICM20948::Sample sample;
+    double legacyNs, tableNs;
+
+    if (StartDriver(FifoReplay_Header()) != 0)
+        return -1;
+
+    HAL_MPU_SimAttachSerif(FifoReplay_SerifRead, FifoReplay_SerifWrite, 0);
+    FifoReplay_Rewind(false);
+    for (uint32_t i = 0; i < FifoReplay_Records(); i++)
+        inv_icm20948_poll_sensor(&icm_device, 0, RecordEvent);
+    HAL_MPU_SimAttachSerif(0, 0, 0);
+
+    if (decodedCount == 0)
+        return -1;
+
+    legacyNs = TimeHandler(LegacyEvent, 0, passes);
+    tableNs = TimeHandler(build_sensor_event_data, &imu, passes);
+
+    //  Keep queues from filling up and make sure data went through
+    for (uint8_t i = 0; i < INV_ICM20948_SENSOR_MAX; i++)
+        while (imu.PopSamples((inv_icm20948_sensor)i, &sample, 1) != 0);
+
+    printf("%u events x %u passes\n", decodedCount, passes);
+    printf("switch handler: %.1f ns/event\n", legacyNs);
+    printf("table dispatch: %.1f ns/event\n", tableNs);
+
+    free(decoded);
+
+    return 0;
+}
+
+/**
+ * Outputs hashed from both decoders, they must produce the same stream of
+ * samples bit for bit for each output
+ */
+enum { HashAccel, HashGyro, HashBias, HashQuat6, HashMax };
+
+/**
+ * Mirror capture records into SW FIFO until it holds a full batch of packets,
+ * or as many as fit in it, as it would in batching mode
+ * @return Number of packets in SW FIFO, 0 on error
+ */
+static unsigned short FillFifo(int *left, uint64_t *reads)
+{
+    unsigned short total = 0;
+    short status;
+
+    //  Next record is assumed to be as large as an average one so far
+    while ((total < INV_FIFO_BATCH_MAX) &&
+           ((total == 0) || (*left + *left / total <= HARDWARE_FIFO_SIZE)))
+    {
+        inv_icm20948_identify_interrupt(&icm_device, &status);
+        if (inv_icm20948_fifo_swmirror(&icm_device, left, &total, 0) != 0)
+            return 0;
+        (*reads)++;
+    }
+
+    return total;
+}
+
+/**
+ * Decode packets one by one, the way inv_icm20948_poll_sensor() does
+ */
+static void DecodePackets(unsigned short total, int *left, uint64_t *hash)
+{
+    while (total--)
+    {
+        unsigned short header, header2;
+        short s16[3];
+        long v[3];
+        float f[3];
+
+        if (inv_icm20948_fifo_pop(&icm_device, &header, &header2, left) != 0)
+            break;
+
+        if (header & GYRO_SET)
+        {
+            inv_icm20948_dmp_get_raw_gyro(s16);
+            v[0] = s16[0]; v[1] = s16[1]; v[2] = s16[2];
+            inv_icm20948_convert_dmp3_to_body_flt(&icm_device,
+                    INV_ICM20948_BODY_GYRO_RAW, v, f);
+            for (uint8_t k = 0; k < 3; k++)
+                Hash(hash, HashGyro, &f[k]);
+
+            inv_icm20948_dmp_get_gyro_bias(s16);
+            v[0] = s16[0]; v[1] = s16[1]; v[2] = s16[2];
+            inv_icm20948_convert_dmp3_to_body_flt(&icm_device,
+                    INV_ICM20948_BODY_GYRO, v, f);
+            for (uint8_t k = 0; k < 3; k++)
+                Hash(hash, HashBias, &f[k]);
+        }
+        if (header & ACCEL_SET)
+        {
+            inv_icm20948_dmp_get_accel(v);
+            inv_icm20948_convert_dmp3_to_body_flt(&icm_device,
+                    INV_ICM20948_BODY_ACCEL, v, f);
+            for (uint8_t k = 0; k < 3; k++)
+                Hash(hash, HashAccel, &f[k]);
+        }
+        if (header & QUAT6_SET)
+        {
+            inv_icm20948_dmp_get_6quaternion(v);
+            for (uint8_t k = 0; k < 3; k++)
+            {
+                int32_t q = (int32_t)v[k];
+                Hash(hash, HashQuat6, &q);
+            }
+        }
+    }
+}
+
+/**
+ * Decode all packets in SW FIFO through inv_icm20948_fifo_pop_batch()
+ */
+static void DecodeBatches(int *left, uint64_t *hash)
+{
+    static struct inv_fifo_batch_t batch;
+
+    while (inv_icm20948_fifo_pop_batch(&icm_device, &batch, INV_FIFO_BATCH_MAX,
+                                       left) > 0)
+    {
+        for (uint_fast16_t i = 0; i < batch.gyro_cnt; i++)
+            for (uint8_t k = 0; k < 3; k++)
+            {
+                Hash(hash, HashGyro, &batch.gyro_raw[k][i]);
+                Hash(hash, HashBias, &batch.gyro_bias[k][i]);
+            }
+        for (uint_fast16_t i = 0; i < batch.accel_cnt; i++)
+            for (uint8_t k = 0; k < 3; k++)
+                Hash(hash, HashAccel, &batch.accel[k][i]);
+        for (uint_fast16_t i = 0; i < batch.quat6_cnt; i++)
+            for (uint8_t k = 0; k < 3; k++)
+                Hash(hash, HashQuat6, &batch.quat6[k][i]);
+    }
+}
+
+/**
+ * Run capture through one of the decoders
+ * @param batch true to use batch decoder
+ * @param polls Number of capture records to go through
+ * @param hash Hash of decoded values to update, 0 to skip it
+ * @param packets Set to number of decoded packets
+ * @return Time spent decoding in s, mirroring FIFO is the same for both
+ *         decoders so it's left out
+ */
+static double RunDecoder(bool batch, uint64_t polls, uint64_t *hash,
+                         uint64_t *packets)
+{
+    uint64_t reads = 0;
+    double seconds = 0;
+    int left = 0;
+
+    *packets = 0;
+    FifoReplay_Rewind(true);
+    while (reads < polls)
+    {
+        unsigned short total = FillFifo(&left, &reads);
+        struct timespec start, end;
+
+        if (total == 0)
+            break;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if (batch)
+            DecodeBatches(&left, hash);
+        else
+            DecodePackets(total, &left, hash);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        seconds += (end.tv_sec - start.tv_sec) +
+                   (end.tv_nsec - start.tv_nsec) / 1e9;
+        *packets += total;
+    }
+
+    return seconds;
+}
+
+int Batch(uint32_t passes)
+{
+    static const char *names[2] = { "inv_icm20948_fifo_pop", "inv_icm20948_fifo_pop_batch" };
+    uint64_t hash[2][HashMax], packets[2];
+    uint64_t polls = (uint64_t)FifoReplay_Records() * passes;
+    double seconds[2];
+
+    if (StartDriver(FifoReplay_Header()) != 0)
+        return -1;
+
+    HAL_MPU_SimAttachSerif(FifoReplay_SerifRead, FifoReplay_SerifWrite, 0);
+    for (uint8_t m = 0; m < 2; m++)
+    {
+        for (uint8_t k = 0; k < HashMax; k++)
+            hash[m][k] = 14695981039346656037ULL;
+        RunDecoder(m != 0, FifoReplay_Records(), hash[m], &packets[m]);
+        seconds[m] = RunDecoder(m != 0, polls, 0, &packets[m]);
+    }
+    HAL_MPU_SimAttachSerif(0, 0, 0);
+
+    for (uint8_t m = 0; m < 2; m++)
+        printf("%-28s %llu packets in %.3f s, %.0f packets/s\n", names[m],
+               (unsigned long long)packets[m], seconds[m],
+               packets[m] / seconds[m]);
+    printf("decoded samples identical: %s\n",
+           (memcmp(hash[0], hash[1], sizeof(hash[0])) == 0) ? "yes" : "NO");
+
+    return (memcmp(hash[0], hash[1], sizeof(hash[0])) == 0) ? 0 : -1;
+}
+
+/**
+ * SW FIFO as it was before it became a ring: a linear buffer compacted with
+ * memmove after every packet popped (below, as inv_icm20948_fifo_pop() and
+ * get_packet_size_and_samplecnt() were)
+ */
+static unsigned char legacyFifo[HARDWARE_FIFO_SIZE];
+
+extern "C" struct inv_fifo_decoded_t fd;
+
+static int LegacyPacketSize(const unsigned char *data, unsigned short *header,
+                            unsigned short *header2)
+{
+    int sz = HEADER_SZ;
+
+    *header = (((unsigned short)data[0]) << 8) | data[1];
+    if (*header & ACCEL_SET)
+        sz += ACCEL_DATA_SZ;
+    if (*header & GYRO_SET)
+        sz += GYRO_DATA_SZ + GYRO_BIAS_DATA_SZ;
+    if (*header & CPASS_SET)
+        sz += CPASS_DATA_SZ;
+    if (*header & ALS_SET)
+        sz += ALS_DATA_SZ;
+    if (*header & QUAT6_SET)
+        sz += QUAT6_DATA_SZ;
+    if (*header & QUAT9_SET)
+        sz += QUAT9_DATA_SZ;
+    if (*header & PQUAT6_SET)
+        sz += PQUAT6_DATA_SZ;
+    if (*header & GEOMAG_SET)
+        sz += GEOMAG_DATA_SZ;
+    if (*header & CPASS_CALIBR_SET)
+        sz += CPASS_CALIBR_DATA_SZ;
+    if (*header & PED_STEPDET_SET)
+        sz += PED_STEPDET_TIMESTAMP_SZ;
+    if (*header & HEADER2_SET)
+    {
+        *header2 = (((unsigned short)data[2]) << 8) | data[3];
+        sz += HEADER2_SZ;
+    }
+    else
+        *header2 = 0;
+    if (*header2 & ACCEL_ACCURACY_SET)
+        sz += ACCEL_ACCURACY_SZ;
+    if (*header2 & GYRO_ACCURACY_SET)
+        sz += GYRO_ACCURACY_SZ;
+    if (*header2 & CPASS_ACCURACY_SET)
+        sz += CPASS_ACCURACY_SZ;
+    if (*header2 & FLIP_PICKUP_SET)
+        sz += FLIP_PICKUP_SZ;
+    if (*header2 & ACT_RECOG_SET)
+        sz += ACT_RECOG_SZ;
+
+    return sz + ODR_CNT_GYRO_SZ;
+}
+
+static int LegacyPop(unsigned short *header, int *left, uint64_t *moved)
+{
+    const unsigned char *ptr = legacyFifo;
+    int need;
+
+    if (*left <= 3)
+        return -1;
+    need = LegacyPacketSize(legacyFifo, &fd.header, &fd.header2);
+    if (*left < need)
+        return -1;
+
+    ptr += HEADER_SZ;
+    if (fd.header & HEADER2_SET)
+        ptr += HEADER2_SZ;
+    inv_icm20948_inv_decode_one_ivory_fifo_packet(&icm_device, &fd, ptr);
+
+    *left -= need;
+    if (*left)
+        memmove(legacyFifo, &legacyFifo[need], *left);
+    *moved += *left;
+
+    *header = fd.header;
+
+    return 0;
+}
+
+/**
+ * Mirror capture records into legacyFifo the way FillFifo() does into SW FIFO
+ * of the driver, straight from the fake serial interface
+ * @return Number of complete packets in legacyFifo
+ */
+static unsigned short LegacyFill(int *left, uint64_t *reads)
+{
+    unsigned short total = 0, header, header2;
+    uint8_t status, count[2];
+    int parsed = 0, need;
+
+    while ((total < INV_FIFO_BATCH_MAX) &&
+           ((total == 0) || (*left + *left / total <= HARDWARE_FIFO_SIZE)))
+    {
+        FifoReplay_SerifRead(0, REG_INT_STATUS, &status, 1);
+        FifoReplay_SerifRead(0, REG_FIFO_COUNT_H, count, 2);
+        need = (count[0] << 8) | count[1];
+        if (need > HARDWARE_FIFO_SIZE - *left)
+            need = HARDWARE_FIFO_SIZE - *left;
+        FifoReplay_SerifRead(0, REG_FIFO_R_W, &legacyFifo[*left], need);
+        *left += need;
+        (*reads)++;
+
+        while ((*left - parsed > 3) &&
+               (*left - parsed >= (need = LegacyPacketSize(&legacyFifo[parsed],
+                                                          &header, &header2))))
+        {
+            parsed += need;
+            total++;
+        }
+    }
+
+    return total;
+}
+
+/**
+ * Hash values decoded into fd by the last packet popped
+ */
+static void HashDecoded(unsigned short header, uint64_t *hash)
+{
+    short s16[3];
+    long v[3];
+
+    if (header & GYRO_SET)
+    {
+        inv_icm20948_dmp_get_raw_gyro(s16);
+        for (uint8_t k = 0; k < 3; k++)
+            Hash(hash, HashGyro, &s16[k]);
+        inv_icm20948_dmp_get_gyro_bias(s16);
+        for (uint8_t k = 0; k < 3; k++)
+            Hash(hash, HashBias, &s16[k]);
+    }
+    if (header & ACCEL_SET)
+    {
+        inv_icm20948_dmp_get_accel(v);
+        for (uint8_t k = 0; k < 3; k++)
+            Hash(hash, HashAccel, &v[k]);
+    }
+    if (header & QUAT6_SET)
+    {
+        inv_icm20948_dmp_get_6quaternion(v);
+        for (uint8_t k = 0; k < 3; k++)
+            Hash(hash, HashQuat6, &v[k]);
+    }
+}
+
+/**
+ * Pop capture through compacted linear SW FIFO or through the ring of the
+ * driver, time spent mirroring FIFO is left out
+ * @param moved Set to number of bytes moved within SW FIFO
+ * @return Time stamp counter cycles spent popping packets
+ */
+static uint64_t RunFifo(bool ring, uint64_t polls, uint64_t *hash,
+                        uint64_t *packets, uint64_t *moved)
+{
+    uint64_t reads = 0, cycles = 0;
+    uint32_t ringMoved = inv_icm20948_fifo_moved_bytes();
+    int left = 0;
+
+    *packets = 0;
+    *moved = 0;
+    FifoReplay_Rewind(true);
+    while (reads < polls)
+    {
+        unsigned short total = ring ? FillFifo(&left, &reads)
+                                    : LegacyFill(&left, &reads);
+        unsigned short header, header2;
+        uint64_t c0;
+
+        if (total == 0)
+            break;
+        *packets += total;
+
+        c0 = CYCLES();
+        while (total--)
+        {
+            if (ring ? (inv_icm20948_fifo_pop(&icm_device, &header, &header2,
+                                              &left) != 0)
+                     : (LegacyPop(&header, &left, moved) != 0))
+                break;
+            if (hash != 0)
+                HashDecoded(header, hash);
+        }
+        cycles += CYCLES() - c0;
+    }
+    if (ring)
+        *moved = inv_icm20948_fifo_moved_bytes() - ringMoved;
+
+    return cycles;
+}
+
+int Ring(uint32_t passes)
+{
+    static const char *names[2] = { "memmove after each packet", "ring" };
+    uint64_t hash[2][HashMax], packets[2], moved[2], cycles[2];
+    uint64_t polls = (uint64_t)FifoReplay_Records() * passes;
+
+    if (StartDriver(FifoReplay_Header()) != 0)
+        return -1;
+
+    HAL_MPU_SimAttachSerif(FifoReplay_SerifRead, FifoReplay_SerifWrite, 0);
+    for (uint8_t m = 0; m < 2; m++)
+    {
+        for (uint8_t k = 0; k < HashMax; k++)
+            hash[m][k] = 14695981039346656037ULL;
+        RunFifo(m != 0, FifoReplay_Records(), hash[m], &packets[m], &moved[m]);
+        cycles[m] = RunFifo(m != 0, polls, 0, &packets[m], &moved[m]);
+    }
+    HAL_MPU_SimAttachSerif(0, 0, 0);
+
+    printf("%llu packets, popping one (mirroring FIFO left out):\n",
+           (unsigned long long)packets[0]);
+    for (uint8_t m = 0; m < 2; m++)
+        printf("%-26s %6.1f cycles, %6.1f bytes moved\n", names[m],
+               (double)cycles[m] / packets[m], (double)moved[m] / packets[m]);
+    printf("decoded samples identical: %s\n",
+           ((packets[0] == packets[1]) &&
+            (memcmp(hash[0], hash[1], sizeof(hash[0])) == 0)) ? "yes" : "NO");
+
+    return ((packets[0] == packets[1]) &&
+            (memcmp(hash[0], hash[1], sizeof(hash[0])) == 0)) ? 0 : -1;
+}
@@ -0,0 +1,216 @@
+/**
+ * bench_dynpro.cpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  fifo_replay command sending DynProtocol sensor events over UART
+ *  transport
+ */
+#include "replay_bench.h"
+
+#include "icm20948/Invn/DynamicProtocol/DynProtocol.h"
+#include "icm20948/Invn/DynamicProtocol/DynProtocolTransportUart.h"
+
+/**
+ * DynProtocol sensor events sent over UART transport, encoded into a buffer
+ * and copied into a frame, as glue code around DynProtocol_encodeAsync() did,
+ * and encoded in place into frames from frame pool, one event per frame and
+ * as many events as fit in a frame. Frames are "sent" by DMA at once, and in
+ * checked run received back through the transport and protocol decoders
+ */
+#define DYNPRO_EVENTS       1024    //  Distinct events, repeated as needed
+
+enum { DynProCopy, DynProInPlace, DynProPacked, DynProMax };
+
+static DynProtocol_t dynProto, dynProtoRx;
+static DynProTransportUart_t dynTransport, dynTransportRx;
+static DynProTransportUartFramePool_t dynPool;
+static DynProtocolEdata_t dynEvents[DYNPRO_EVENTS];
+//  Hash of received events, 0 to send frames without receiving them
+static uint64_t *dynHash;
+static uint64_t dynWire, dynDecoded;
+
+//  End of DMA transfer is immediate, frame goes back to pool right away
+static void DynProTx(enum DynProTransportEvent e,
+                     union DynProTransportEventData data, void *cookie)
+{
+    DynProTransportUartFrame_t *frame = (DynProTransportUartFrame_t*)data.frame;
+
+    (void)cookie;
+    if (e != DYN_PRO_TRANSPORT_EVENT_TX_START_DMA)
+        return;
+    dynWire += frame->len;
+    if (dynHash != 0)
+        for (uint16_t i = 0; i < frame->len; i++)
+            DynProTransportUart_rxProcessByte(&dynTransportRx, frame->header[i]);
+    DynProTransportUart_txReleaseFrame(&dynPool, frame);
+}
+
+static void DynProRx(enum DynProTransportEvent e,
+                     union DynProTransportEventData data, void *cookie)
+{
+    (void)cookie;
+    if (e == DYN_PRO_TRANSPORT_EVENT_PKT_SIZE)
+        DynProtocol_setCurrentFrameSize(&dynProtoRx, data.pkt_size);
+    else if (e == DYN_PRO_TRANSPORT_EVENT_PKT_BYTE)
+        DynProtocol_processPktByte(&dynProtoRx, (uint8_t)data.pkt_size);
+}
+
+static void DynProDecoded(enum DynProtocolEtype etype, enum DynProtocolEid eid,
+                          const DynProtocolEdata_t *edata, void *cookie)
+{
+    const VSensorDataAny *vdata = &edata->d.async.sensorEvent.vdata;
+    uint32_t id = (uint32_t)edata->sensor_id;
+
+    (void)cookie;
+    if ((etype != DYN_PROTOCOL_ETYPE_ASYNC) ||
+        (eid != DYN_PROTOCOL_EID_NEW_SENSOR_DATA))
+        return;
+    dynDecoded++;
+    Hash(dynHash, 0, &id);
+    Hash(dynHash, 0, &vdata->base.timestamp);
+    Hash(dynHash, 0, &vdata->base.meta_data);
+    for (uint8_t k = 0; k < 4; k++)
+        Hash(dynHash, 0, &vdata->data.u32[k]);
+}
+
+//  Finish frame and hand it to transport, reserve next one
+static DynProTransportUartFrame_t* DynProSend(DynProTransportUartFrame_t *frame)
+{
+    DynProTransportUart_txEncodeFrame(&dynTransport, frame);
+    DynProTransportUart_txSendFrame(&dynTransport, frame);
+
+    return DynProTransportUart_txReserveFrame(&dynPool);
+}
+
+/**
+ * Send events through one of the encoding paths
+ * @return Bytes copied from encode buffer into frames, UINT64_MAX on error
+ */
+static uint64_t DynProRun(uint8_t mode, uint32_t events)
+{
+    uint8_t buffer[DYN_PRO_TRANSPORT_UART_POOL_PAYLOAD];
+    uint16_t len;
+    uint64_t copied = 0;
+    DynProTransportUartFrame_t *frame;
+
+    DynProTransportUart_poolInit(&dynPool);
+    frame = DynProTransportUart_txReserveFrame(&dynPool);
+    for (uint32_t i = 0; i < events; i++)
+    {
+        const DynProtocolEdata_t *event = &dynEvents[i % DYNPRO_EVENTS];
+
+        if (mode == DynProCopy)
+        {
+            if (DynProtocol_encodeAsync(&dynProto,
+                        DYN_PROTOCOL_EID_NEW_SENSOR_DATA, event, buffer,
+                        sizeof(buffer), &len) != 0)
+                return UINT64_MAX;
+            memcpy(frame->payload_data, buffer, len);
+            frame->payload_len = len;
+            copied += len;
+            frame = DynProSend(frame);
+            continue;
+        }
+
+        if (DynProtocol_encodeAsyncAppend(&dynProto,
+                    DYN_PROTOCOL_EID_NEW_SENSOR_DATA, event,
+                    frame->payload_data, frame->max_payload_len,
+                    &frame->payload_len) == INV_ERROR_SIZE)
+        {
+            //  Frame is full, event goes into the next one
+            frame = DynProSend(frame);
+            if (DynProtocol_encodeAsyncAppend(&dynProto,
+                        DYN_PROTOCOL_EID_NEW_SENSOR_DATA, event,
+                        frame->payload_data, frame->max_payload_len,
+                        &frame->payload_len) != 0)
+                return UINT64_MAX;
+        }
+        if (mode == DynProInPlace)
+            frame = DynProSend(frame);
+    }
+    if (frame->payload_len != 0)
+        frame = DynProSend(frame);
+    DynProTransportUart_txReleaseFrame(&dynPool, frame);
+
+    return copied;
+}
+
+int DynPro(uint32_t events)
+{
+    static const char *names[DynProMax] = { "encodeAsync + copy",
+                                            "in place, event per frame",
+                                            "in place, packed" };
+    static const int sensors[3] = { DYN_PRO_SENSOR_TYPE_GYROSCOPE,
+                                    DYN_PRO_SENSOR_TYPE_ACCELEROMETER,
+                                    DYN_PRO_SENSOR_TYPE_GAME_ROTATION_VECTOR };
+    uint64_t hash[DynProMax], copied[DynProMax], wire[DynProMax];
+    uint64_t decoded[DynProMax], elapsed[DynProMax];
+    uint32_t seed = 12345;
+    int rc = 0;
+
+    for (uint32_t i = 0; i < DYNPRO_EVENTS; i++)
+    {
+        DynProtocolEdata_t *event = &dynEvents[i];
+        VSensorDataAny *vdata = &event->d.async.sensorEvent.vdata;
+
+        memset(event, 0, sizeof(*event));
+        event->sensor_id = sensors[i % 3];
+        event->d.async.sensorEvent.status = DYN_PRO_SENSOR_STATUS_DATA_UPDATED;
+        vdata->base.timestamp = 1000 + i * 1125;
+        vdata->base.meta_data = i % 4;
+        //  Within range of the sensor: Q16 gyro/accel, unit quaternion in Q30
+        for (uint8_t k = 0; k < 4; k++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            vdata->data.u32[k] = (i % 3 == 2) ? (uint32_t)((int32_t)seed >> 3)
+                                              : (uint32_t)((int32_t)seed >> 9);
+        }
+    }
+
+    DynProtocol_init(&dynProto, 0, 0);
+    DynProtocol_init(&dynProtoRx, DynProDecoded, 0);
+    DynProTransportUart_init(&dynTransport, DynProTx, 0);
+    DynProTransportUart_init(&dynTransportRx, DynProRx, 0);
+    DynProTransportUart_enableTxDma(&dynTransport);
+
+    for (uint8_t m = 0; m < DynProMax; m++)
+    {
+        uint64_t t0;
+
+        //  Checked run, then timed one without receiver
+        hash[m] = 14695981039346656037ULL;
+        dynHash = &hash[m];
+        dynDecoded = 0;
+        DynProTransportUart_rxProcessReset(&dynTransportRx);
+        if (DynProRun(m, DYNPRO_EVENTS) == UINT64_MAX)
+        {
+            printf("%-26s failed to encode event\n", names[m]);
+            return -1;
+        }
+        decoded[m] = dynDecoded;
+
+        dynHash = 0;
+        dynWire = 0;
+        t0 = CYCLES();
+        copied[m] = DynProRun(m, events);
+        elapsed[m] = CYCLES() - t0;
+        wire[m] = dynWire;
+    }
+
+    printf("%u events (gyro, accel, game RV), per event:\n", events);
+    for (uint8_t m = 0; m < DynProMax; m++)
+        printf("%-26s %6.1f cycles, %5.1f bytes copied, %5.1f bytes sent\n",
+               names[m], (double)elapsed[m] / events,
+               (double)copied[m] / events, (double)wire[m] / events);
+
+    for (uint8_t m = 1; m < DynProMax; m++)
+        if ((hash[m] != hash[0]) || (decoded[m] != decoded[0]))
+            rc = -1;
+    printf("received events identical: %s (%llu of %u)\n",
+           (rc == 0) && (decoded[0] == DYNPRO_EVENTS) ? "yes" : "NO",
+           (unsigned long long)decoded[0], DYNPRO_EVENTS);
+
+    return ((rc == 0) && (decoded[0] == DYNPRO_EVENTS)) ? 0 : -1;
+}
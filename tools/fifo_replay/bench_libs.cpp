@@ -0,0 +1,606 @@
+/**
+ * bench_libs.cpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  fifo_replay commands benchmarking libs and EmbUtils against the code
+ *  they replaced: median filter, node pool and scheduler
+ */
+#include "replay_bench.h"
+
+#include "libs/medianfilter.hpp"
+#include "libs/linkedlist.hpp"
+#include "sched_bench.h"
+
+/**
+ * Median filter ICM20948 used before MedianFilter: sorted linked list, one
+ * node inserted per sample
+ */
+template <uint16_t N>
+class ListMedian
+{
+    public:
+        ListMedian(): _counter(0) {};
+
+        float Push(float arg)
+        {
+            if (_buffer.Size() == N)
+                _buffer.DeleteWhereIndex(_counter);
+            _buffer.addS(arg, _counter);
+            _counter = (_counter + 1) % N;
+
+            return _buffer.at((_buffer.Size() - 1) / 2);
+        }
+
+    private:
+        LinkedList<N>   _buffer;
+        uint8_t         _counter;
+};
+
+/**
+ * Run samples of 3 axes through 3 filters of type F
+ * @param cycles Set to time stamp counter cycles per sample (0 if not
+ *        available), per axis
+ * @param out Filtered samples, can be 0
+ * @return Time per sample per axis in ns
+ */
+template <typename F>
+static double TimeMedian(const float (*samples)[3], uint32_t count,
+                         double *cycles, float (*out)[3])
+{
+    F filter[3];
+    struct timespec t0, t1;
+    uint64_t c0, c1;
+    float sink = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    c0 = CYCLES();
+    for (uint32_t i = 0; i < count; i++)
+        for (uint8_t k = 0; k < 3; k++)
+        {
+            float m = filter[k].Push(samples[i][k]);
+            if (out != 0)
+                out[i][k] = m;
+            sink += m;
+        }
+    c1 = CYCLES();
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+
+    //  Keep compiler from dropping filters whose output is unused
+    if (sink == 1.2345f)
+        printf(" ");
+
+    *cycles = (c1 - c0) / (3.0 * count);
+    return ElapsedNs(t0, t1) / (3.0 * count);
+}
+
+/**
+ * Benchmark MedianFilter against the linked list at one window size and check
+ * it against brute-force median of the window
+ */
+template <uint16_t N>
+static int MedianWindow(const float (*samples)[3], uint32_t count,
+                        float (*out)[3])
+{
+    double ringNs, listNs, ringCycles, listCycles;
+    uint32_t listCount = (count > 20000) ? 20000 : count, bad = 0;
+
+    ringNs = TimeMedian< MedianFilter<float, N> >(samples, count, &ringCycles, out);
+    listNs = TimeMedian< ListMedian<N> >(samples, listCount, &listCycles, 0);
+
+    for (uint32_t i = 0; i < count; i += 97)
+        for (uint8_t k = 0; k < 3; k++)
+        {
+            float win[N];
+            uint16_t n = (i + 1 < N) ? (i + 1) : N, below = 0, equal = 0;
+            for (uint16_t j = 0; j < n; j++)
+                win[j] = samples[i - j][k];
+            //  Median has (n-1)/2 samples below it, or equal ones covering that
+            for (uint16_t j = 0; j < n; j++)
+            {
+                below += (win[j] < out[i][k]);
+                equal += (win[j] == out[i][k]);
+            }
+            if ((below > (n - 1) / 2) || (below + equal <= (n - 1) / 2))
+                bad++;
+        }
+
+    printf("window %2u: sorted ring %6.1f ns %6.1f cycles, linked list %7.1f ns %7.1f cycles%s\n",
+           N, ringNs, ringCycles, listNs, listCycles, bad ? ", WRONG MEDIAN" : "");
+
+    return (bad == 0) ? 0 : -1;
+}
+
+int Median(uint32_t count)
+{
+    float (*samples)[3] = (float(*)[3])malloc(count * sizeof(*samples));
+    float (*out)[3] = (float(*)[3])malloc(count * sizeof(*out));
+    uint32_t seed = 12345;
+    int rc = 0;
+
+    //  Noisy accelerometer-like signal, with repeated values from quantization
+    for (uint32_t i = 0; i < count; i++)
+        for (uint8_t k = 0; k < 3; k++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            samples[i][k] = sinf(i * 0.01f + k) +
+                            (float)((int32_t)seed >> 24) / 256.f;
+        }
+
+    printf("%u samples on 3 axes, per sample per axis:\n", count);
+    rc |= MedianWindow<3>(samples, count, out);
+    rc |= MedianWindow<23>(samples, count, out);
+    rc |= MedianWindow<63>(samples, count, out);
+
+    free(samples);
+    free(out);
+
+    return rc;
+}
+
+static int CompareU64(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * Print average, 99.9th and 99.99th percentile and worst of latencies (sorts
+ * them). Worst one on host includes interrupts and preemption by OS
+ */
+static void PrintLatency(const char *name, uint64_t *lat, uint32_t count)
+{
+    double sum = 0;
+
+    qsort(lat, count, sizeof(*lat), CompareU64);
+    for (uint32_t i = 0; i < count; i++)
+        sum += lat[i];
+
+    printf("%-26s avg %6.1f  p99.9 %5llu  p99.99 %6llu  max %8llu\n", name,
+           sum / count, (unsigned long long)lat[(uint32_t)(count * 0.999)],
+           (unsigned long long)lat[(uint32_t)(count * 0.9999)],
+           (unsigned long long)lat[count - 1]);
+}
+
+/**
+ * Random churn of up to POOL_NODES live nodes: allocate when empty, free when
+ * full, otherwise either at random. Returns slot to allocate into, or -1 after
+ * freeing one
+ */
+#define POOL_NODES      64
+
+static int16_t Churn(uint32_t *seed, LLnode **live, uint16_t *n, LLnode **freed)
+{
+    *seed = *seed * 1664525 + 1013904223;
+    *freed = 0;
+
+    if ((*n == POOL_NODES) || ((*n > 0) && (*seed & 0x10000)))
+    {
+        uint16_t k = (*seed >> 20) % *n;
+        *freed = live[k];
+        live[k] = live[--(*n)];
+        return -1;
+    }
+
+    return (*n)++;
+}
+
+int Pool(uint32_t count)
+{
+    static NodePool<LLnode, POOL_NODES> pool;
+    static LinkedList<POOL_NODES> list;
+    uint64_t *lat = (uint64_t*)malloc(count * sizeof(*lat));
+    void *frag[256] = { 0 };
+    LLnode *live[POOL_NODES], *freed;
+    uint32_t seed = 12345, allocs = 0;
+    uint16_t n = 0;
+    int16_t slot;
+    int rc = 0;
+
+#if defined(__x86_64__) || defined(__i386__)
+    printf("%u operations, latency in cycles:\n", count);
+#else
+    printf("%u operations, latency in ns:\n", count);
+#endif
+
+    //  Cost of taking time stamps alone, included in all results below
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint64_t t0 = Stamp();
+        lat[i] = Stamp() - t0;
+    }
+    PrintLatency("time stamp", lat, count);
+
+    //  Pool, nodes allocated and freed in random order
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if ((slot = Churn(&seed, live, &n, &freed)) < 0)
+        {
+            pool.Free(freed);
+            continue;
+        }
+        uint64_t t0 = Stamp();
+        live[slot] = pool.Alloc(1.0f, (uint8_t)i);
+        lat[allocs++] = Stamp() - t0;
+        if (live[slot] == 0)
+            rc = -1;
+    }
+    if (pool.Alloc(1.0f, 0) != 0 && n == POOL_NODES)
+        rc = -1;
+    while (n > 0)
+        pool.Free(live[--n]);
+    PrintLatency("NodePool::Alloc", lat, allocs);
+
+    //  Heap, same pattern with unrelated blocks of random size allocated and
+    //  freed in between, as other code sharing the heap would
+    seed = 12345;
+    allocs = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t f = (uint8_t)(seed >> 8);
+        free(frag[f]);
+        frag[f] = malloc(16 + (seed >> 16) % 1024);
+
+        if ((slot = Churn(&seed, live, &n, &freed)) < 0)
+        {
+            delete freed;
+            continue;
+        }
+        uint64_t t0 = Stamp();
+        live[slot] = new LLnode(1.0f, (uint8_t)i);
+        lat[allocs++] = Stamp() - t0;
+    }
+    while (n > 0)
+        delete live[--n];
+    for (uint16_t i = 0; i < 256; i++)
+        free(frag[i]);
+    PrintLatency("new LLnode (fragmented)", lat, allocs);
+
+    //  Sorted insert into a full list, dropping the oldest element first the
+    //  way median filter does, worst case walks all POOL_NODES nodes
+    seed = 12345;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t index = i % POOL_NODES;
+
+        seed = seed * 1664525 + 1013904223;
+        if (list.Size() == POOL_NODES)
+            list.DeleteWhereIndex(index);
+        uint64_t t0 = Stamp();
+        bool ok = list.addS((float)(int32_t)seed, index);
+        lat[i] = Stamp() - t0;
+        if (!ok)
+            rc = -1;
+    }
+    if (list.addS(0.0f, 0) || (list.Size() != POOL_NODES))
+        rc = -1;
+    PrintLatency("LinkedList::addS (full)", lat, count);
+
+    if (rc != 0)
+        printf("NodePool didn't respect its capacity\n");
+    free(lat);
+
+    return rc;
+}
+
+/**
+ * Scheduler benchmark: same set of periodic tasks run through InvScheduler and
+ * through the linked list it used to keep tasks in (below, as it was), where
+ * every dispatch walked all tasks to find the most late one
+ */
+struct ListTask
+{
+    uint8_t     priority;
+    enum InvSchedulerTaskState state;
+    uint32_t    lasttime, period, delay;
+    ListTask    *next, *prev;
+    uint16_t    id;
+};
+
+struct ListScheduler
+{
+    uint32_t    currentTime;
+    ListTask    *queue;
+};
+
+static void ListInsert(ListScheduler *scheduler, ListTask *task)
+{
+    if (scheduler->queue == 0)
+    {
+        task->prev = task;
+        task->next = 0;
+        scheduler->queue = task;
+    }
+    else
+    {
+        task->prev = scheduler->queue->prev;
+        task->next = 0;
+        scheduler->queue->prev->next = task;
+        scheduler->queue->prev = task;
+    }
+}
+
+static void ListRemove(ListScheduler *scheduler, ListTask *task)
+{
+    if (scheduler->queue == task)
+        scheduler->queue = task->next;
+    else
+    {
+        if (scheduler->queue->prev == task)
+            scheduler->queue->prev = task->prev;
+        task->prev->next = task->next;
+    }
+    if (task->next)
+        task->next->prev = task->prev;
+}
+
+static ListTask* ListGetTaskToSchedule(ListScheduler *scheduler, uint32_t now)
+{
+    ListTask *cur = scheduler->queue, *task = 0;
+    uint32_t maxDiff = 0;
+
+    for (; cur != 0; cur = cur->next)
+    {
+        const uint32_t timeout = (cur->delay != 0) ? cur->delay : cur->period;
+
+        if (cur->state == INVSCHEDULER_TASK_STATE_STARTED)
+        {
+            cur->state = INVSCHEDULER_TASK_STATE_READY;
+            cur->lasttime = now;
+            if (cur->delay == 0)
+                cur->lasttime -= cur->period;
+        }
+
+        if ((now - cur->lasttime) >= timeout)
+        {
+            const uint32_t diff = (now - cur->lasttime) - timeout;
+
+            if ((task == 0) || (diff > maxDiff) ||
+                ((diff == maxDiff) && (cur->priority > task->priority)))
+            {
+                task = cur;
+                maxDiff = diff;
+            }
+        }
+    }
+
+    return task;
+}
+
+static void ListStart(ListScheduler *scheduler, ListTask *task, uint32_t delay)
+{
+    if ((task->state == INVSCHEDULER_TASK_STATE_STARTED) ||
+        (task->state == INVSCHEDULER_TASK_STATE_READY))
+        ListRemove(scheduler, task);
+    ListInsert(scheduler, task);
+    task->delay = delay;
+    task->state = INVSCHEDULER_TASK_STATE_STARTED;
+}
+
+static void ListStop(ListScheduler *scheduler, ListTask *task)
+{
+    if ((task->state == INVSCHEDULER_TASK_STATE_STARTED) ||
+        (task->state == INVSCHEDULER_TASK_STATE_READY))
+        ListRemove(scheduler, task);
+    task->state = INVSCHEDULER_TASK_STATE_STOP;
+}
+
+static void TaskRun(void *arg);
+
+static int ListDispatchOne(ListScheduler *scheduler)
+{
+    ListTask *task = ListGetTaskToSchedule(scheduler, scheduler->currentTime);
+
+    if (task == 0)
+        return 0;
+
+    task->delay = 0;
+    task->lasttime = scheduler->currentTime;
+    task->state = INVSCHEDULER_TASK_STATE_RUNNING;
+    ListRemove(scheduler, task);
+    TaskRun(&task->id);
+    task->state = INVSCHEDULER_TASK_STATE_READY;
+    ListInsert(scheduler, task);
+
+    return 1;
+}
+
+//  Tasks run at most SCHED_BUDGET tasks per tick, what's left runs late. Every
+//  SCHED_CHURN ticks one task is restarted and one gets a new period
+#define SCHED_BUDGET    4
+#define SCHED_CHURN     1000
+
+static const uint32_t schedPeriods[] = { 4, 8, 16, 32, 64, 128, 256 };
+static uint32_t schedTick;
+static uint64_t schedHash;
+
+static void TaskRun(void *arg)
+{
+    schedHash = (schedHash ^ (((uint64_t)schedTick << 16) | *(uint16_t*)arg)) *
+                1099511628211ULL;
+}
+
+//  Time source for run time of tasks
+extern "C" uint32_t InvScheduler_getStatsTime(void)
+{
+    return (uint32_t)Stamp();
+}
+
+/**
+ * Run the task set through both schedulers for given number of ticks
+ * @return 0 if both ran the same tasks at the same ticks
+ */
+static int SchedRun(uint16_t tasks, uint32_t ticks)
+{
+    static InvScheduler scheduler;
+    static InvSchedulerTask heapTasks[INVSCHEDULER_MAX_TASKS];
+    static ListTask listTasks[INVSCHEDULER_MAX_TASKS];
+    static uint16_t ids[INVSCHEDULER_MAX_TASKS];
+    ListScheduler list = { 0, 0 };
+    uint32_t scale = (tasks > 16) ? tasks / 16 : 1, seed, runs[2] = { 0, 0 };
+    uint64_t hash[2], elapsed[2] = { 0, 0 };
+
+    for (uint8_t impl = 0; impl < 2; impl++)
+    {
+        seed = 12345;
+        schedHash = 14695981039346656037ULL;
+        InvScheduler_init(&scheduler);
+        list.currentTime = 0;
+        list.queue = 0;
+
+        for (uint16_t i = 0; i < tasks; i++)
+        {
+            uint32_t period = schedPeriods[i % 7] * scale;
+            uint8_t prio = 1 + (seed >> 8) % (INVSCHEDULER_TASK_PRIO_MAX);
+
+            seed = seed * 1664525 + 1013904223;
+            ids[i] = i;
+            if (impl == 0)
+            {
+                InvScheduler_initTask(&scheduler, &heapTasks[i], "", TaskRun,
+                                      &ids[i], prio, period);
+                InvScheduler_startTaskU(&heapTasks[i], (seed >> 16) % period);
+            }
+            else
+            {
+                listTasks[i].id = i;
+                listTasks[i].priority = prio;
+                listTasks[i].period = period;
+                listTasks[i].state = INVSCHEDULER_TASK_STATE_STOP;
+                ListStart(&list, &listTasks[i], (seed >> 16) % period);
+            }
+        }
+
+        for (schedTick = 0; schedTick < ticks; schedTick++)
+        {
+            uint64_t t0;
+
+            if ((schedTick % SCHED_CHURN) == SCHED_CHURN - 1)
+            {
+                uint16_t a, b;
+
+                seed = seed * 1664525 + 1013904223;
+                a = (seed >> 8) % tasks;
+                b = (seed >> 20) % tasks;
+                if (impl == 0)
+                {
+                    InvScheduler_stopTaskU(&heapTasks[a]);
+                    InvScheduler_startTaskU(&heapTasks[a], 0);
+                    InvScheduler_setTaskPeriodU(&heapTasks[b],
+                                                schedPeriods[seed % 7] * scale);
+                }
+                else
+                {
+                    ListStop(&list, &listTasks[a]);
+                    ListStart(&list, &listTasks[a], 0);
+                    listTasks[b].period = schedPeriods[seed % 7] * scale;
+                }
+            }
+
+            t0 = Stamp();
+            for (uint8_t k = 0; k < SCHED_BUDGET; k++)
+            {
+                if (impl == 0)
+                {
+                    if (!InvScheduler_dispatchOneTask(&scheduler))
+                        break;
+                }
+                else if (!ListDispatchOne(&list))
+                    break;
+                runs[impl]++;
+            }
+            elapsed[impl] += Stamp() - t0;
+
+            InvScheduler_updateTime(&scheduler);
+            list.currentTime++;
+        }
+        hash[impl] = schedHash;
+    }
+
+    printf("%5u tasks  %9u runs  heap %7.1f  list %8.1f  per run\n", tasks,
+           runs[0], (double)elapsed[0] / runs[0], (double)elapsed[1] / runs[1]);
+
+    {
+        uint32_t overruns = 0, lateMax = 0, runTimeMax = 0;
+        uint64_t lateSum = 0, runCount = 0;
+
+        for (uint16_t i = 0; i < tasks; i++)
+        {
+            const InvSchedulerTaskStats &st = heapTasks[i].stats;
+
+            overruns += st.overruns;
+            lateSum += st.lateSum;
+            runCount += st.runs;
+            lateMax = (st.lateMax > lateMax) ? st.lateMax : lateMax;
+            runTimeMax = (st.runTimeMax > runTimeMax) ? st.runTimeMax : runTimeMax;
+        }
+        printf("             late avg %.2f max %u ticks, %u overruns, "
+               "longest run %u\n", (double)lateSum / runCount, lateMax,
+               overruns, runTimeMax);
+    }
+
+    if ((hash[0] != hash[1]) || (runs[0] != runs[1]))
+    {
+        printf("             schedulers ran different tasks\n");
+        return -1;
+    }
+    if (InvScheduler_getDroppedCount(&scheduler) != 0)
+    {
+        printf("             %u tasks dropped, heap full\n",
+               InvScheduler_getDroppedCount(&scheduler));
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * Start one task more than the heap holds
+ * @return 0 if the last one was stopped and counted as dropped
+ */
+static int SchedOverflow()
+{
+    static InvScheduler scheduler;
+    static InvSchedulerTask tasks[INVSCHEDULER_MAX_TASKS + 1];
+    static uint16_t id = 0;
+
+    InvScheduler_init(&scheduler);
+    for (uint16_t i = 0; i <= INVSCHEDULER_MAX_TASKS; i++)
+    {
+        InvScheduler_initTask(&scheduler, &tasks[i], "", TaskRun, &id,
+                              INVSCHEDULER_TASK_PRIO_NORMAL, 4);
+        InvScheduler_startTaskU(&tasks[i], 0);
+    }
+
+    printf("%5u tasks  %u dropped\n", INVSCHEDULER_MAX_TASKS + 1,
+           InvScheduler_getDroppedCount(&scheduler));
+    if ((InvScheduler_getDroppedCount(&scheduler) != 1) ||
+        (InvScheduler_getActiveTaskCountU(&scheduler) != INVSCHEDULER_MAX_TASKS) ||
+        (tasks[INVSCHEDULER_MAX_TASKS].state != INVSCHEDULER_TASK_STATE_STOP))
+    {
+        printf("             task over the limit wasn't dropped\n");
+        return -1;
+    }
+
+    return 0;
+}
+
+int Sched(uint32_t ticks)
+{
+    static const uint16_t taskCounts[] = { 8, 64, 512 };
+    int rc = 0;
+
+#if defined(__x86_64__) || defined(__i386__)
+    printf("%u ticks, up to %u tasks per tick, dispatch time in cycles:\n",
+           ticks, SCHED_BUDGET);
+#else
+    printf("%u ticks, up to %u tasks per tick, dispatch time in ns:\n",
+           ticks, SCHED_BUDGET);
+#endif
+    for (uint8_t i = 0; i < sizeof(taskCounts)/sizeof(taskCounts[0]); i++)
+        rc |= SchedRun(taskCounts[i], ticks);
+    rc |= SchedOverflow();
+
+    return rc;
+}
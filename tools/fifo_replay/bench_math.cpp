@@ -0,0 +1,230 @@
+/**
+ * bench_math.cpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  fifo_replay commands checking accuracy and speed of driver math:
+ *  chip-to-body conversion and quaternion to RPY angles
+ */
+#include "replay_bench.h"
+
+/**
+ * DMP output as seen by the converter: largest raw value in FIFO and matching
+ * full scale in output units, per full-scale setting where it applies
+ */
+static const struct
+{
+    const char                  *name;
+    enum inv_icm20948_body_output output;
+    long                        rawMax;
+    bool                        perFsr;
+    float                       fullScale;  //  Output units at FSR setting 0
+} convertOutputs[] =
+{
+    { "gyro raw (Q15)", INV_ICM20948_BODY_GYRO_RAW, 32767, true, 250.f },
+    { "gyro (Q20)",     INV_ICM20948_BODY_GYRO,     1L << 20, false, 2000.f },
+    { "accel (Q30)",    INV_ICM20948_BODY_ACCEL,    1L << 30, true, 2.f },
+    { "compass (Q16)",  INV_ICM20948_BODY_COMPASS,  4912L << 16, false, 4912.f },
+};
+
+int Convert(uint32_t vectors)
+{
+    static struct inv_icm20948 s;
+    static long raw[4096][3];
+    static float out[4096][3];
+    signed char mount[9];
+    const uint8_t perm[6][3] = { {0,1,2}, {0,2,1}, {1,0,2}, {1,2,0}, {2,0,1}, {2,1,0} };
+    uint32_t seed = 12345, mountings = 0;
+    double fxpNs = 0, fltNs = 0;
+    uint64_t converted = 0;
+
+    if (vectors > 4096)
+        vectors = 4096;
+
+    for (uint8_t o = 0; o < sizeof(convertOutputs)/sizeof(convertOutputs[0]); o++)
+    {
+        float maxErr = 0;
+
+        //  Random vectors over the whole raw range of the output
+        for (uint32_t i = 0; i < vectors; i++)
+            for (uint8_t k = 0; k < 3; k++)
+            {
+                seed = seed * 1664525 + 1013904223;
+                raw[i][k] = (long)(((int64_t)(int32_t)seed *
+                                    convertOutputs[o].rawMax) >> 31);
+            }
+
+        //  Every axis-aligned mounting (permutation and signs, det = +1)
+        mountings = 0;
+        for (uint8_t p = 0; p < 6; p++)
+            for (uint8_t sg = 0; sg < 8; sg++)
+            {
+                int det;
+                memset(mount, 0, sizeof(mount));
+                for (uint8_t r = 0; r < 3; r++)
+                    mount[r*3 + perm[p][r]] = (sg & (1 << r)) ? -1 : 1;
+                det = mount[0]*(mount[4]*mount[8] - mount[5]*mount[7])
+                    - mount[1]*(mount[3]*mount[8] - mount[5]*mount[6])
+                    + mount[2]*(mount[3]*mount[7] - mount[4]*mount[6]);
+                if (det != 1)
+                    continue;
+                mountings++;
+
+                for (uint8_t fsr = 0; fsr < (convertOutputs[o].perFsr ? 4 : 1); fsr++)
+                {
+                    float scale, fullScale = convertOutputs[o].fullScale * (1 << fsr);
+                    struct timespec t0, t1, t2;
+
+                    //  Same scales driver computes when full-scale is set
+                    memset(&s, 0, sizeof(s));
+                    s.base_state.gyro_raw_scale = (1 << fsr) * 250.f / (1L<<15);
+                    s.base_state.accel_scale = (1 << fsr) * 2.f / (1L<<30);
+                    inv_icm20948_set_chip_to_body_axis_quaternion(&s, mount, 0.0);
+                    switch (convertOutputs[o].output)
+                    {
+                    case INV_ICM20948_BODY_GYRO_RAW: scale = s.base_state.gyro_raw_scale; break;
+                    case INV_ICM20948_BODY_GYRO:     scale = 2000.f / (1L<<20); break;
+                    case INV_ICM20948_BODY_ACCEL:    scale = s.base_state.accel_scale; break;
+                    default:                         scale = 1.f / (1L<<16); break;
+                    }
+
+                    clock_gettime(CLOCK_MONOTONIC, &t0);
+                    for (uint32_t i = 0; i < vectors; i++)
+                        inv_icm20948_convert_dmp3_to_body(&s, raw[i], scale, out[i]);
+                    clock_gettime(CLOCK_MONOTONIC, &t1);
+                    for (uint32_t i = 0; i < vectors; i++)
+                    {
+                        float flt[3];
+                        inv_icm20948_convert_dmp3_to_body_flt(&s,
+                                convertOutputs[o].output, raw[i], flt);
+                        for (uint8_t k = 0; k < 3; k++)
+                            out[i][k] -= flt[k];
+                    }
+                    clock_gettime(CLOCK_MONOTONIC, &t2);
+
+                    for (uint32_t i = 0; i < vectors; i++)
+                        for (uint8_t k = 0; k < 3; k++)
+                            if (fabsf(out[i][k]) / fullScale > maxErr)
+                                maxErr = fabsf(out[i][k]) / fullScale;
+
+                    fxpNs += (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+                    fltNs += (t2.tv_sec - t1.tv_sec) * 1e9 + (t2.tv_nsec - t1.tv_nsec);
+                    converted += vectors;
+                }
+            }
+
+        printf("%-16s max difference %.3g of full scale\n",
+               convertOutputs[o].name, maxErr);
+    }
+
+    printf("%llu vectors, %u mountings\n", (unsigned long long)converted,
+           mountings);
+    printf("fixed-point quaternion: %.1f ns/vector\n", fxpNs / converted);
+    printf("float matrix:           %.1f ns/vector\n", fltNs / converted);
+
+    return 0;
+}
+
+/**
+ * Largest error of atan2 approximations against libm over a sweep of angles,
+ * with operands on a circle of given radius
+ * @return Largest error in degrees
+ */
+static double Atan2Error(bool fixedPoint, double radius, uint32_t steps)
+{
+    double maxErr = 0;
+
+    for (uint32_t i = 0; i < steps; i++)
+    {
+        double a = -M_PI + 2 * M_PI * (i + 0.5) / steps;
+        double y = radius * sin(a), x = radius * cos(a), approx, err;
+
+        if (fixedPoint)
+            approx = inv_icm20948_math_atan2_q15_fxp(lround(y * 32768),
+                                                     lround(x * 32768)) / 32768.0;
+        else
+            approx = inv_icm20948_math_atan2f_fast((float)y, (float)x);
+        err = fabs(approx - atan2((float)y, (float)x));
+        if (err > M_PI)
+            err = 2 * M_PI - err;
+        if (err > maxErr)
+            maxErr = err;
+    }
+
+    return maxErr * 180 / M_PI;
+}
+
+int Rpy(uint32_t count)
+{
+    ICM20948::Sample *quats = (ICM20948::Sample*)malloc(count * sizeof(*quats));
+    float (*ref)[3] = (float(*)[3])malloc(count * sizeof(*ref));
+    float (*out)[3] = (float(*)[3])malloc(count * sizeof(*out));
+    double maxErr[3] = { 0, 0, 0 }, libmNs, fastNs, batchNs;
+    struct timespec t0, t1, t2, t3;
+    uint32_t seed = 12345;
+
+    //  Random unit quaternions, every 8th one close to pitch of +-90 degrees
+    for (uint32_t i = 0; i < count; i++)
+    {
+        float *q = quats[i].data, norm = 0;
+
+        for (uint8_t k = 0; k < 4; k++)
+        {
+            seed = seed * 1664525 + 1013904223;
+            q[k] = (int32_t)seed / 2147483648.f;
+        }
+        if ((i % 8) == 0)
+        {
+            q[1] = q[3] = q[1] * 1e-3f;
+            q[2] = copysignf(q[0], q[2]);
+        }
+        for (uint8_t k = 0; k < 4; k++)
+            norm += q[k] * q[k];
+        for (uint8_t k = 0; k < 4; k++)
+            q[k] /= sqrtf(norm);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (uint32_t i = 0; i < count; i++)
+        ICM20948::QuatToRPY(quats[i].data, ref[i], true, OrientationMathLibm);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    for (uint32_t i = 0; i < count; i++)
+        ICM20948::QuatToRPY(quats[i].data, out[i], true, OrientationMathFast);
+    clock_gettime(CLOCK_MONOTONIC, &t2);
+    for (uint32_t i = 0; i < count; i += 0xFFFF)
+        ICM20948::QuatToRPY(&quats[i], ((count - i) < 0xFFFF) ? (count - i) : 0xFFFF,
+                            &out[i], true, OrientationMathFast);
+    clock_gettime(CLOCK_MONOTONIC, &t3);
+
+    libmNs = ElapsedNs(t0, t1) / count;
+    fastNs = ElapsedNs(t1, t2) / count;
+    batchNs = ElapsedNs(t2, t3) / count;
+
+    //  Batch output is left in out, it has to match single conversions too
+    for (uint32_t i = 0; i < count; i++)
+        for (uint8_t k = 0; k < 3; k++)
+        {
+            double err = fabs(out[i][k] - ref[i][k]);
+            if (err > 180)
+                err = 360 - err;
+            if (err > maxErr[k])
+                maxErr[k] = err;
+        }
+
+    printf("atan2 max error: float %.4f deg, Q15 fixed point %.4f deg\n",
+           fmax(Atan2Error(false, 1e-3, 1 << 16),
+                fmax(Atan2Error(false, 1, 1 << 16), Atan2Error(false, 1e3, 1 << 16))),
+           Atan2Error(true, 0.25, 1 << 16));
+    printf("RPY max error over %u quaternions: roll %.4f, pitch %.4f, yaw %.4f deg\n",
+           count, maxErr[0], maxErr[1], maxErr[2]);
+    printf("libm:       %.1f ns/quaternion\n", libmNs);
+    printf("fast:       %.1f ns/quaternion\n", fastNs);
+    printf("fast batch: %.1f ns/quaternion\n", batchNs);
+
+    free(quats);
+    free(ref);
+    free(out);
+
+    return 0;
+}
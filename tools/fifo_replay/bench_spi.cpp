@@ -0,0 +1,279 @@
+/**
+ * bench_spi.cpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Asynchronous SPI transfers of TM4C1294 HAL (HAL/tm4c1294/hal_icm_spi_tm4c.c)
+ *  run against SSI2/uDMA model (tiva/tiva_model.h): chunking, completion order
+ *  and done-hook latency, and blocking calls made while the bus is busy, with
+ *  interrupts masked and from interrupt context
+ */
+#include "replay_bench.h"
+#include "tiva/tiva_spi.h"
+
+//  Transfer lengths, in and above uDMA limit of 1024 items
+static const uint32_t spiLengths[] = { 1, 14, 512, 1024, 1025, 3000 };
+#define SPI_MAX_LENGTH  3000
+
+//  Watchdog for a single test (simulated time), nothing takes this long
+#define SPI_WATCHDOG_NS 100000000ULL
+
+static uint8_t spiTx[SPI_MAX_LENGTH];
+static uint8_t spiRx[SPI_MAX_LENGTH];
+
+//  Transfer chain, each transfer is started from done hook of the previous one
+static uint32_t spiCount;
+static volatile uint32_t spiDone;
+static uint32_t spiErrors;
+static uint64_t spiLatencySumNs;
+static uint64_t spiLatencyMaxNs;
+
+//  Done hook of a single transfer
+static volatile bool spiHookRan;
+static bool spiHookInIsr;
+static uint8_t spiHookValue;
+
+static uint32_t SpiLength(uint32_t i)
+{
+    return spiLengths[(i / 2) % (sizeof(spiLengths)/sizeof(spiLengths[0]))];
+}
+
+/**
+ * Even transfers push a pattern into chip FIFO, odd ones read it back
+ */
+static int SpiStart(uint32_t i, void((*doneHook)(void)))
+{
+    uint32_t length = SpiLength(i);
+
+    if (i & 1)
+    {
+        memset(spiRx, 0, length);
+        return TivaSpi_ReadBytesAsync(TIVA_MODEL_FIFO_REG, spiRx, length,
+                                      doneHook);
+    }
+
+    for (uint32_t k = 0; k < length; k++)
+        spiTx[k] = (uint8_t)(k * 31 + i);
+    return TivaSpi_WriteBytesAsync(TIVA_MODEL_FIFO_REG, spiTx, length,
+                                   doneHook);
+}
+
+/**
+ * Done hook of chained transfers: transfer must be over (CS released, data
+ * in place), and the next one not started yet
+ */
+static void SpiChainDone()
+{
+    TivaModelStats stats;
+    uint64_t latency;
+    uint32_t i = spiDone;
+
+    TivaModel_StatsGet(&stats);
+    latency = TivaModel_TimeNs() - stats.chunkDoneNs;
+    spiLatencySumNs += latency;
+    if (latency > spiLatencyMaxNs)
+        spiLatencyMaxNs = latency;
+
+    if (!TivaModel_InInterrupt() || TivaModel_CsLow() ||
+        (stats.csAssertions != i + 1))
+    {
+        printf("transfer %u: done out of order\n", i);
+        spiErrors++;
+    }
+    if ((i & 1) && (memcmp(spiRx, spiTx, SpiLength(i)) != 0))
+    {
+        printf("transfer %u: read back wrong data\n", i);
+        spiErrors++;
+    }
+
+    spiDone = i + 1;
+    if ((spiDone < spiCount) && (SpiStart(spiDone, SpiChainDone) != 0))
+    {
+        printf("transfer %u: bus busy in done hook\n", spiDone);
+        spiErrors++;
+    }
+}
+
+static void SpiMarkDone()
+{
+    spiHookRan = true;
+    spiHookInIsr = TivaModel_InInterrupt();
+}
+
+/**
+ * Done hook making blocking calls, in interrupt context
+ */
+static void SpiHookBlocking()
+{
+    TivaSpi_WriteByte(0, 0x30, 0xA5);
+    spiHookValue = TivaSpi_ReadByte(0, 0x30);
+    SpiMarkDone();
+}
+
+/**
+ * Run <count> transfers chained through done hooks, while main loop keeps
+ * trying to get the bus
+ */
+static int SpiChain(uint32_t count)
+{
+    TivaModelStats stats;
+    uint64_t chunks = 0, wireNs = 0, t0;
+    //  Odd count leaves the last write in FIFO
+    uint32_t fifoLeft = (count & 1) ? SpiLength(count - 1) : 0;
+
+    spiCount = count;
+    spiDone = 0;
+    spiErrors = 0;
+    spiLatencySumNs = 0;
+    spiLatencyMaxNs = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        chunks += (SpiLength(i) + 1023) / 1024;
+        wireNs += (SpiLength(i) + 1) * 8000000000ULL / HAL_MPU_BUS_SPEED_FAST;
+    }
+
+    TivaModel_Watchdog(SPI_WATCHDOG_NS + wireNs);
+    t0 = TivaModel_TimeNs();
+    if (SpiStart(0, SpiChainDone) != 0)
+        return -1;
+    while (spiDone < count)
+    {
+        uint8_t data;
+
+        if (TivaSpi_ReadBytesAsync(0x10, &data, 1, 0) == 0)
+        {
+            printf("main loop got the bus in the middle of the chain\n");
+            return -1;
+        }
+        TivaModel_Run(1000);
+    }
+    TivaModel_Watchdog(0);
+    TivaModel_StatsGet(&stats);
+
+    if ((stats.chunks != chunks) || (stats.interrupts < chunks) ||
+        (TivaModel_FifoLevel() != fifoLeft))
+    {
+        printf("%u chunks, %u interrupts, %u bytes left in FIFO, "
+               "expected %llu chunks\n", stats.chunks, stats.interrupts,
+               TivaModel_FifoLevel(), (unsigned long long)chunks);
+        spiErrors++;
+    }
+
+    //  Empty FIFO for the next test
+    if (fifoLeft > 0)
+        TivaSpi_ReadBytes(0, TIVA_MODEL_FIFO_REG, spiRx, fifoLeft);
+
+    printf("%u transfers, %u-%u bytes at %uMHz, %u chunks\n", count,
+           spiLengths[0], SPI_MAX_LENGTH, HAL_MPU_BUS_SPEED_FAST / 1000000,
+           stats.chunks);
+    printf("  done hook latency   avg %6.0f ns, max %6llu ns\n",
+           (double)spiLatencySumNs / count,
+           (unsigned long long)spiLatencyMaxNs);
+    printf("  chunk restart       avg %6.0f ns, max %6llu ns\n",
+           (stats.chunks > count) ?
+               (double)stats.chunkGapSumNs / (stats.chunks - count) : 0.0,
+           (unsigned long long)stats.chunkGapMaxNs);
+    printf("  interrupts masked   max %6llu ns\n",
+           (unsigned long long)stats.maskedMaxNs);
+    printf("  bus utilization     %5.1f %%\n",
+           100.0 * wireNs / (TivaModel_TimeNs() - t0));
+
+    return (spiErrors == 0) ? 0 : -1;
+}
+
+/**
+ * Blocking read while an asynchronous transfer holds the bus: waits for it
+ */
+static int SpiBlockingBusy()
+{
+    uint8_t data[4];
+
+    spiHookRan = false;
+    TivaModel_Watchdog(SPI_WATCHDOG_NS);
+    if ((SpiStart(1, SpiMarkDone) != 0) ||
+        (TivaSpi_ReadBytes(0, 0x20, data, sizeof(data)) != 0) || !spiHookRan)
+        return -1;
+    TivaModel_Watchdog(0);
+
+    return 0;
+}
+
+/**
+ * Blocking write with interrupts masked while an asynchronous transfer holds
+ * the bus: SSI2 interrupt can't run, blocking call completes both by polling
+ */
+static int SpiBlockingMasked()
+{
+    uint8_t data[4] = { 1, 2, 3, 4 }, back[4];
+    bool masked;
+
+    spiHookRan = false;
+    TivaModel_Watchdog(SPI_WATCHDOG_NS);
+    masked = IntMasterDisable();
+    if ((SpiStart(4, SpiMarkDone) != 0) ||
+        (TivaSpi_WriteBytes(0, 0x20, data, sizeof(data)) != 0) || !spiHookRan)
+        return -1;
+    if (!masked)
+        IntMasterEnable();
+    TivaSpi_ReadBytes(0, 0x20, back, sizeof(back));
+    TivaModel_Watchdog(0);
+
+    //  Empty FIFO for the next test
+    TivaSpi_ReadBytes(0, TIVA_MODEL_FIFO_REG, spiRx, SpiLength(4));
+
+    return (memcmp(data, back, sizeof(data)) == 0) ? 0 : -1;
+}
+
+/**
+ * Blocking calls from done hook, in SSI2 interrupt: interrupt can't nest,
+ * blocking calls complete by polling
+ */
+static int SpiBlockingInHook()
+{
+    spiHookRan = false;
+    spiHookValue = 0;
+    TivaModel_Watchdog(SPI_WATCHDOG_NS);
+    if (SpiStart(9, SpiHookBlocking) != 0)
+        return -1;
+    while (!spiHookRan)
+        TivaModel_Run(1000);
+    TivaModel_Watchdog(0);
+
+    return (spiHookInIsr && (spiHookValue == 0xA5)) ? 0 : -1;
+}
+
+int Spi(uint32_t transfers)
+{
+    static const struct
+    {
+        const char  *name;
+        int         (*run)();
+    } tests[] =
+    {
+        { "blocking, bus busy", SpiBlockingBusy },
+        { "blocking, masked",   SpiBlockingMasked },
+        { "blocking, in hook",  SpiBlockingInHook },
+    };
+    int rc = 0;
+
+    if (transfers == 0)
+        return -1;
+
+    TivaModel_Reset();
+    TivaSpi_Init(0);
+    TivaSpi_SetBusSpeed(HAL_MPU_BUS_SPEED_FAST);
+
+    if (SpiChain(transfers) != 0)
+        rc = -1;
+    for (uint8_t i = 0; i < sizeof(tests)/sizeof(tests[0]); i++)
+    {
+        int testRc = tests[i].run();
+
+        printf("%-20s %s\n", tests[i].name, (testRc == 0) ? "ok" : "FAILED");
+        if (testRc != 0)
+            rc = -1;
+    }
+
+    return rc;
+}
@@ -0,0 +1,437 @@
+/**
+ * bench_timing.cpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  fifo_replay commands replaying captures in simulated time: data-ready
+ *  edge jitter, sensor clock drift, tickless main loop and latency from
+ *  data-ready edge to its consumer
+ */
+#include "replay_bench.h"
+
+#include "icm20948/Invn/EmbUtils/InvScheduler.h"
+#include "libs/tickless.hpp"
+
+/**
+ * Replay capture until its end, waiting for each data-ready edge
+ * @return Number of edges, first and last one in firstUs and lastUs
+ */
+static uint32_t ReplayEdges(uint64_t *firstUs, uint64_t *lastUs)
+{
+    ICM20948 &imu = ICM20948::GetI();
+    uint32_t edges = 0;
+
+    FifoReplay_Rewind(false);
+    while (FifoReplay_PushNext() >= 0)
+    {
+        uint64_t edgeUs;
+
+        if (!imu.WaitForData(0, &edgeUs))
+            continue;
+        imu.ReadSensorData();
+        if (edges++ == 0)
+            *firstUs = edgeUs;
+        *lastUs = edgeUs;
+    }
+
+    return edges;
+}
+
+int Jitter(uint32_t binNs)
+{
+    ICM20948 &imu = ICM20948::GetI();
+    uint64_t firstUs = 0, lastUs = 0;
+    uint32_t edges, periodUs;
+    double nsPerCycle = 1e9 / g_ui32SysClock;
+
+    if (StartDriver(FifoReplay_Header()) != 0)
+        return -1;
+
+    //  Average interval from a first pass, histogram from the second one
+    edges = ReplayEdges(&firstUs, &lastUs);
+    if (edges < 2)
+        return -1;
+    periodUs = (uint32_t)((lastUs - firstUs + (edges - 1) / 2) / (edges - 1));
+
+    imu.MeasureJitter(periodUs, binNs);
+    ReplayEdges(&firstUs, &lastUs);
+
+    const ICM20948::JitterHistogram &hist = imu.Jitter();
+    int64_t center = hist.BinStart(hist.Bins() / 2);
+
+    printf("%u intervals around %u us, min %+.0f ns, max %+.0f ns\n",
+           hist.Count(), periodUs, (hist.Min() - center) * nsPerCycle,
+           (hist.Max() - center) * nsPerCycle);
+    printf("bin_start_ns,count\n");
+    for (uint16_t i = 0; i < hist.Bins(); i++)
+        if (hist.Bin(i) != 0)
+            printf("%+.0f%s,%u\n", (hist.BinStart(i) - center) * nsPerCycle,
+                   (i == 0) ? " (and below)" :
+                   (i == hist.Bins() - 1) ? " (and above)" : "", hist.Bin(i));
+
+    return 0;
+}
+
+/**
+ * Replay capture as if sampled by a clock off from nominal by ppm (e.g. after
+ * warming up), one record per sample period, with data-ready interrupts served
+ * up to latencyUs late. Compare period estimated by driver with the injected
+ * one, and timestamps of gyroscope samples with the times they were sampled
+ * at, against timestamping every sample with its data-ready edge
+ * @return 0 if estimate ends up within DRIFT_TOLERANCE_PPM of injected drift
+ */
+#define DRIFT_TOLERANCE_PPM     10
+
+int Drift(int32_t ppm, uint32_t latencyUs, uint32_t samples)
+{
+    ICM20948 &imu = ICM20948::GetI();
+    const ICM20948CaptureHeader *hdr = FifoReplay_Header();
+    const inv_icm20948_sensor sensor = INV_ICM20948_SENSOR_GYROSCOPE;
+    uint32_t seed = 12345, settled = samples / 2, count = 0, measured = 0,
+             next = 16;
+    double nominalUs, periodUs, startUs, estErr[3] = {0, 1e9, -1e9},
+           edgeErr[3] = {0, 1e9, -1e9};
+    int32_t estPpm = 0;
+    float estUs = 0;
+
+    if ((hdr->sensorPeriodMs[sensor] == 0) || (StartDriver(hdr) != 0))
+        return -1;
+
+    //  True sample period, from the same DMP divider driver seeds its estimate
+    //  with (PLL trim of simulated chip is 0)
+    nominalUs = inv_icm20948_get_odr_in_us_q16(&icm_device,
+                    hdr->sensorPeriodMs[sensor] * 1125 / 1000) / 65536.0;
+    periodUs = nominalUs * (1.0 + ppm * 1e-6);
+
+    printf("Nominal period %.3f us, sampled at %.3f us (%+d ppm), "
+           "interrupts up to %u us late\n", nominalUs, periodUs, ppm, latencyUs);
+    printf("samples,estimated_period_us,estimated_ppm\n");
+
+    FifoReplay_Rewind(true);
+    startUs = (double)HAL_BOARD_TimeUS() + 1000;
+    for (uint32_t k = 0; k < samples; k++)
+    {
+        double sampleUs = startUs + k * periodUs;
+        uint64_t edgeUs;
+        ICM20948::Sample samplesRead[4];
+        uint16_t n;
+
+        //  Edge follows sample on the next tick of simulated time, plus latency
+        seed = seed * 1664525 + 1013904223;
+        if (FifoReplay_PushNextAt((uint64_t)ceil(sampleUs) +
+                                  ((latencyUs != 0) ? (seed >> 8) % (latencyUs + 1) : 0)) < 0)
+            return -1;
+        if (!imu.WaitForData(0, &edgeUs))
+            continue;
+        imu.ReadSensorData();
+
+        //  Samples read now were taken with this record and the ones before
+        //  it (driver drops the very first sample after enabling sensor)
+        n = imu.PopSamples(sensor, samplesRead, 4);
+        count += n;
+        for (uint16_t i = 0; i < n; i++)
+        {
+            double trueUs = startUs + (k + 1 - n + i) * periodUs;
+            const ICM20948::Sample &sample = samplesRead[i];
+
+            if (k + 1 - n + i >= settled)
+            {
+                double est = sample.timestamp - trueUs, edge = edgeUs - trueUs;
+
+                measured++;
+                estErr[0] += est;
+                estErr[1] = fmin(estErr[1], est);
+                estErr[2] = fmax(estErr[2], est);
+                edgeErr[0] += edge;
+                edgeErr[1] = fmin(edgeErr[1], edge);
+                edgeErr[2] = fmax(edgeErr[2], edge);
+            }
+        }
+
+        if ((k + 1 == next) || (k + 1 == samples))
+        {
+            if (imu.GetSamplePeriod(sensor, &estUs, &estPpm) == MPU_SUCCESS)
+                printf("%u,%.3f,%+d\n", k + 1, estUs, estPpm);
+            next *= 2;
+        }
+    }
+
+    if (count + 1 < samples)
+    {
+        printf("Capture has to hold one gyroscope sample per record, got %u "
+               "samples from %u records\n", count, samples);
+        return -1;
+    }
+
+    printf("Timestamp error over last %u samples (us): average, min, max\n",
+           measured);
+    printf("  estimated ODR    %+8.2f %+8.2f %+8.2f\n",
+           estErr[0] / measured, estErr[1], estErr[2]);
+    printf("  data-ready edge  %+8.2f %+8.2f %+8.2f\n",
+           edgeErr[0] / measured, edgeErr[1], edgeErr[2]);
+
+    return (abs(estPpm - ppm) <= DRIFT_TOLERANCE_PPM) ? 0 : -1;
+}
+
+/**
+ * Tickless main loop (as in main.cpp) with a set of periodic tasks, against
+ * capture replayed in the background so that edges come while core sleeps
+ * @return 0 if every task ran in the tick it was due in and every edge was
+ *         read before the next one was due
+ */
+#define IDLE_TASKS_MAX      8
+#define IDLE_TASK_WORK_US   20
+#define IDLE_DRDY_GUARD_US  2000
+
+static const uint32_t idlePeriodsMs[IDLE_TASKS_MAX] =
+        { 1, 3, 7, 10, 20, 50, 100, 250 };
+
+struct IdleTask
+{
+    InvSchedulerTask    task;
+    uint64_t            firstUs;    //  Time first run is due at
+    uint32_t            periodUs;
+    uint32_t            runs;
+    uint32_t            lateMaxUs;  //  Largest delay from due time to run
+};
+
+static void IdleTaskRun(void *arg)
+{
+    IdleTask *t = (IdleTask*)arg;
+    uint64_t dueUs = t->firstUs + (uint64_t)t->runs * t->periodUs;
+    uint64_t nowUs = HAL_BOARD_TimeUS();
+
+    if ((nowUs > dueUs) && ((nowUs - dueUs) > t->lateMaxUs))
+        t->lateMaxUs = (uint32_t)(nowUs - dueUs);
+    t->runs++;
+    HAL_BOARD_AdvanceUS(IDLE_TASK_WORK_US);
+}
+
+int Idle(uint16_t tasks)
+{
+    ICM20948 &imu = ICM20948::GetI();
+    static InvScheduler scheduler;
+    static IdleTask idleTasks[IDLE_TASKS_MAX];
+    TicklessIdle loop(scheduler);
+    HAL_BOARD_IdleStats hal;
+    uint64_t startUs, overdueUs = 0, edgeUs;
+    uint32_t dropped = 0, tasksLate = 0, edges = 0;
+    double elapsedUs;
+
+    if (StartDriver(FifoReplay_Header()) != 0)
+        return -1;
+    if (tasks > IDLE_TASKS_MAX)
+        tasks = IDLE_TASKS_MAX;
+
+    //  Edges left over from starting the driver
+    while (imu.WaitForData(0, &edgeUs))
+        imu.ReadSensorData();
+
+    InvScheduler_init(&scheduler);
+    loop.Start();
+    startUs = HAL_BOARD_TimeUS();
+    for (uint16_t i = 0; i < tasks; i++)
+    {
+        IdleTask &t = idleTasks[i];
+
+        t.periodUs = INVSCHEDULER_TO_US(INVSCHEDULER_FROM_MS(idlePeriodsMs[i]));
+        t.firstUs = startUs + t.periodUs;
+        t.runs = 0;
+        t.lateMaxUs = 0;
+        InvScheduler_initTask(&scheduler, &t.task, "", IdleTaskRun, &t,
+                              INVSCHEDULER_TASK_PRIO_NORMAL,
+                              INVSCHEDULER_FROM_MS(idlePeriodsMs[i]));
+        InvScheduler_startTaskU(&t.task, INVSCHEDULER_FROM_MS(idlePeriodsMs[i]));
+    }
+
+    FifoReplay_StartTimed();
+    while (FifoReplay_TimedRunning(&dropped) || imu.WaitForData(0))
+    {
+        uint64_t expectedUs, deadlineUs = 0;
+
+        loop.Dispatch();
+
+        expectedUs = imu.NextDataUs();
+        if ((expectedUs != 0) && (expectedUs != overdueUs))
+            deadlineUs = expectedUs + IDLE_DRDY_GUARD_US;
+
+        if (!imu.WaitForData(loop.SleepUs(deadlineUs), &edgeUs))
+        {
+            if ((deadlineUs != 0) && (HAL_BOARD_TimeUS() >= deadlineUs))
+            {
+                loop.Overdue();
+                overdueUs = expectedUs;
+                imu.ReadSensorData();
+            }
+            continue;
+        }
+
+        deadlineUs = imu.NextDataUs();
+        imu.ReadSensorData();
+        loop.Serviced(edgeUs, deadlineUs);
+        edges++;
+    }
+    //  Edge consumed by the loop condition above
+    imu.ReadSensorData();
+
+    const TicklessIdle::Stats &st = loop.GetStats();
+
+    HAL_BOARD_IdleStatsGet(&hal);
+    elapsedUs = (double)(HAL_BOARD_TimeUS() - startUs);
+
+    printf("%u records replayed over %.3f s (%u didn't fit in FIFO)\n",
+           FifoReplay_Records(), elapsedUs / 1e6, dropped);
+    printf("Asleep %.2f%% of time, %u sleeps, %u woken by timer\n",
+           100.0 * HAL_BOARD_CyclesToUS(hal.idleCycles) / elapsedUs,
+           hal.sleeps, hal.timerWakes);
+    printf("Edges read %u, edge to read %.1f us avg, %u us max, %u late, "
+           "%u overdue\n", st.events,
+           (double)st.latencySumUs / ((st.events != 0) ? st.events : 1),
+           st.latencyMaxUs, st.eventsLate, st.eventsOverdue);
+    printf("period_ms,runs,expected_runs,late_max_us\n");
+    for (uint16_t i = 0; i < tasks; i++)
+    {
+        IdleTask &t = idleTasks[i];
+        uint64_t endUs = HAL_BOARD_TimeUS();
+        uint32_t expected = (endUs >= t.firstUs) ?
+                (uint32_t)((endUs - t.firstUs) / t.periodUs + 1) : 0;
+
+        printf("%u,%u,%u,%u\n", idlePeriodsMs[i], t.runs, expected,
+               t.lateMaxUs);
+        if ((t.lateMaxUs >= INVSCHEDULER_PERIOD_US) || (t.runs + 1 < expected))
+            tasksLate++;
+    }
+
+    if ((tasksLate != 0) || (st.tasksLate != 0) || (st.eventsLate != 0) ||
+        (st.eventsOverdue != 0) || (dropped != 0) ||
+        (edges != FifoReplay_Records()))
+    {
+        printf("Deadlines missed\n");
+        return -1;
+    }
+    printf("No deadline missed\n");
+
+    return 0;
+}
+
+/**
+ * Data-ready path from edge to consumer. Capture is replayed in the background
+ * while main loop waits for each edge in WaitForData, reads FIFO and then
+ * keeps busy for up to workUs before waiting again, so edges come both while
+ * core sleeps and while it's busy. OnDataReady hook checks the time of the edge
+ * it's given against the time it runs at, main loop the time stamp WaitForData
+ * returns against the latest edge hook saw, and measures time from the oldest
+ * edge it hadn't read yet (idle reports the same through TicklessIdle::Stats)
+ * @return 0 if every edge reached the hook when it came and was read by main
+ *         loop, right away if core was asleep
+ */
+#define DRDY_TIMEOUT_US     100000
+//  Core wakes on the tick of simulated time the edge comes in
+#define DRDY_WAKE_MAX_US    1
+
+//  Updated by OnDataReady hook, in interrupt context
+static volatile bool drdyWaiting;       //  Main loop is in WaitForData
+static volatile uint32_t drdyEdges;
+static volatile uint32_t drdyUnread;    //  Edges since main loop last read FIFO
+static volatile uint32_t drdyWhileBusy;
+static volatile uint64_t drdyOldestUs;  //  Oldest edge main loop hasn't read
+static volatile uint64_t drdyLatestUs;
+static uint64_t drdyHookSumUs;
+static uint64_t drdyHookMaxUs;
+
+static void DataReadyHook(uint64_t edgeUs)
+{
+    uint64_t latencyUs = HAL_BOARD_TimeUS() - edgeUs;
+
+    drdyHookSumUs += latencyUs;
+    if (latencyUs > drdyHookMaxUs)
+        drdyHookMaxUs = latencyUs;
+
+    if (drdyUnread++ == 0)
+        drdyOldestUs = edgeUs;
+    if (!drdyWaiting)
+        drdyWhileBusy++;
+    drdyLatestUs = edgeUs;
+    drdyEdges++;
+}
+
+int DataReady(uint32_t workUs)
+{
+    ICM20948 &imu = ICM20948::GetI();
+    uint64_t edgeUs, latencyUs, sumUs[2] = {0, 0}, maxUs[2] = {0, 0};
+    uint32_t seed = 12345, dropped = 0, reads[2] = {0, 0}, stampErrors = 0;
+
+    if (StartDriver(FifoReplay_Header()) != 0)
+        return -1;
+
+    //  Edges left over from starting the driver
+    while (imu.WaitForData(0, &edgeUs))
+        imu.ReadSensorData();
+
+    drdyWaiting = false;
+    drdyEdges = 0;
+    drdyUnread = 0;
+    drdyWhileBusy = 0;
+    drdyHookSumUs = 0;
+    drdyHookMaxUs = 0;
+    imu.OnDataReady(DataReadyHook);
+
+    FifoReplay_StartTimed();
+    while (FifoReplay_TimedRunning(&dropped) || (drdyUnread != 0))
+    {
+        bool asleep = (drdyUnread == 0), got;
+
+        drdyWaiting = true;
+        got = imu.WaitForData(DRDY_TIMEOUT_US, &edgeUs);
+        drdyWaiting = false;
+        if (!got)
+        {
+            if (!FifoReplay_TimedRunning(&dropped))
+                break;
+            continue;
+        }
+
+        //  Oldest edge read now waited the longest
+        latencyUs = HAL_BOARD_TimeUS() - drdyOldestUs;
+        sumUs[asleep] += latencyUs;
+        if (latencyUs > maxUs[asleep])
+            maxUs[asleep] = latencyUs;
+        reads[asleep]++;
+        if (edgeUs != drdyLatestUs)
+            stampErrors++;
+        drdyUnread = 0;
+        imu.ReadSensorData();
+
+        seed = seed * 1664525 + 1013904223;
+        if (workUs != 0)
+            HAL_BOARD_AdvanceUS((seed >> 8) % (workUs + 1));
+    }
+    imu.OnDataReady(0);
+
+    printf("%u edges (%u records, %u didn't fit in FIFO), %u came while main "
+           "loop was busy up to %u us\n", drdyEdges, FifoReplay_Records(),
+           dropped, drdyWhileBusy, workUs);
+    printf("  edge to hook                 avg %6.1f us, max %4llu us\n",
+           (double)drdyHookSumUs / ((drdyEdges != 0) ? drdyEdges : 1),
+           (unsigned long long)drdyHookMaxUs);
+    printf("  edge to WaitForData, asleep  avg %6.1f us, max %4llu us, "
+           "%u reads\n", (double)sumUs[1] / ((reads[1] != 0) ? reads[1] : 1),
+           (unsigned long long)maxUs[1], reads[1]);
+    printf("  edge to WaitForData, busy    avg %6.1f us, max %4llu us, "
+           "%u reads, %u edges read along with a later one\n",
+           (double)sumUs[0] / ((reads[0] != 0) ? reads[0] : 1),
+           (unsigned long long)maxUs[0], reads[0],
+           drdyEdges - drdyUnread - reads[0] - reads[1]);
+
+    if ((drdyEdges != FifoReplay_Records() - dropped) || (drdyUnread != 0) ||
+        (dropped != 0) || (stampErrors != 0) || (drdyHookMaxUs != 0) ||
+        (maxUs[1] > DRDY_WAKE_MAX_US))
+    {
+        printf("%u edges not read, %u wrong time stamps\n", drdyUnread,
+               stampErrors);
+        return -1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,347 @@
+/**
+ *  fifo_replay.c
+ *
+ *  Loading and replaying raw DMP FIFO captures, see fifo_replay.h
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ */
+#include "fifo_replay.h"
+
+#include "HAL/hal.h"
+#include "icm20948/Invn/Devices/Drivers/ICM20948/Icm20948Defs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * Whole capture file, and position of replay in it
+ */
+static struct
+{
+    uint8_t     *file;
+    uint32_t    size;
+    uint32_t    records;
+    uint32_t    bytes;          //  Total FIFO bytes in all records
+    uint32_t    pos;            //  Offset of next record in file
+    uint64_t    baseUs;         //  Simulated time corresponding to capture start
+    uint64_t    recordUs;       //  Capture time of last record pushed
+    bool        loop;           //  Wrap around at the end (not by PushNext)
+    //  Background replay (FifoReplay_StartTimed): running, time at which
+    //  current record is due and records that didn't fit in FIFO
+    bool        timed;
+    uint64_t    dueUs;
+    uint32_t    dropped;
+    //  Record currently served through fake serif
+    const uint8_t *data;
+    uint16_t    left;
+} _replay;
+
+static uint32_t _GetLE(const uint8_t *p, uint8_t n)
+{
+    uint32_t v = 0;
+
+    while (n--)
+        v = (v << 8) | p[n];
+
+    return v;
+}
+
+/**
+ * Load capture file in memory and validate it
+ * @param path Path to capture file
+ * @return 0 on success, -1 if file can't be read or is not a valid capture
+ */
+int FifoReplay_Load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    const ICM20948CaptureHeader *hdr;
+    uint32_t pos;
+    long size;
+
+    FifoReplay_Free();
+    if (f == 0)
+        return -1;
+
+    fseek(f, 0, SEEK_END);
+    size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size < (long)sizeof(ICM20948CaptureHeader))
+    {
+        fclose(f);
+        return -1;
+    }
+
+    _replay.file = (uint8_t*)malloc(size);
+    _replay.size = (uint32_t)fread(_replay.file, 1, size, f);
+    fclose(f);
+
+    hdr = (const ICM20948CaptureHeader*)_replay.file;
+    if ((hdr->magic != ICM20948_CAPTURE_MAGIC) ||
+        (hdr->version != ICM20948_CAPTURE_VERSION) ||
+        (hdr->headerSize > _replay.size))
+    {
+        FifoReplay_Free();
+        return -1;
+    }
+
+    //  Count records, drop truncated one at the end (capture cut mid-write)
+    for (pos = hdr->headerSize;
+         pos + ICM20948_CAPTURE_RECORD_HDR <= _replay.size; )
+    {
+        uint16_t len = _GetLE(&_replay.file[pos + 4], 2);
+
+        if (pos + ICM20948_CAPTURE_RECORD_HDR + len > _replay.size)
+            break;
+        pos += ICM20948_CAPTURE_RECORD_HDR + len;
+        _replay.records++;
+        _replay.bytes += len;
+    }
+    _replay.size = pos;
+
+    FifoReplay_Rewind(false);
+
+    return 0;
+}
+
+/**
+ * Release loaded capture
+ */
+void FifoReplay_Free()
+{
+    free(_replay.file);
+    memset(&_replay, 0, sizeof(_replay));
+}
+
+/**
+ * @return Header of loaded capture, 0 if nothing is loaded
+ */
+const ICM20948CaptureHeader* FifoReplay_Header()
+{
+    return (const ICM20948CaptureHeader*)_replay.file;
+}
+
+/**
+ * @return Number of records in loaded capture
+ */
+uint32_t FifoReplay_Records()
+{
+    return _replay.records;
+}
+
+/**
+ * @return Number of FIFO bytes in all records of loaded capture
+ */
+uint32_t FifoReplay_Bytes()
+{
+    return _replay.bytes;
+}
+
+/**
+ * Restart replay from the first record. Replay time is aligned so that
+ * capture start corresponds to current simulated time
+ * @param loop true to have fake serif and FifoReplay_PushNextAt wrap around
+ *        to the first record at the end of capture instead of running dry
+ */
+void FifoReplay_Rewind(bool loop)
+{
+    if (_replay.file == 0)
+        return;
+
+    _replay.pos = FifoReplay_Header()->headerSize;
+    _replay.baseUs = HAL_BOARD_TimeUS();
+    _replay.recordUs = 0;
+    _replay.loop = loop;
+    _replay.left = 0;
+    _replay.timed = false;
+}
+
+/**
+ * Move to the next record
+ * @param delta Set to time between this and previous record in us
+ * @return false if there are no more records
+ */
+static bool _NextRecord(uint32_t *delta)
+{
+    if (_replay.pos >= _replay.size)
+    {
+        if (!_replay.loop || (_replay.records == 0))
+            return false;
+        _replay.pos = FifoReplay_Header()->headerSize;
+    }
+
+    *delta = _GetLE(&_replay.file[_replay.pos], 4);
+    _replay.left = _GetLE(&_replay.file[_replay.pos + 4], 2);
+    _replay.data = &_replay.file[_replay.pos + ICM20948_CAPTURE_RECORD_HDR];
+    _replay.pos += ICM20948_CAPTURE_RECORD_HDR + _replay.left;
+
+    return true;
+}
+
+/**
+ * Advance simulated time to dueUs and push current record into FIFO of
+ * simulated chip, raising its data-ready interrupt
+ */
+static int _Push(uint64_t dueUs)
+{
+    if (dueUs > HAL_BOARD_TimeUS())
+        HAL_BOARD_AdvanceUS((uint32_t)(dueUs - HAL_BOARD_TimeUS()));
+
+    if (HAL_MPU_SimPushFifo(_replay.data, _replay.left) != 0)
+        return -2;
+
+    return _replay.left;
+}
+
+/**
+ * Advance simulated time to the moment next record was captured at and push
+ * it into FIFO of simulated chip, raising its data-ready interrupt
+ * @return Number of bytes pushed, -1 at the end of capture, -2 if FIFO of
+ *         simulated chip has no room for the record
+ */
+int FifoReplay_PushNext()
+{
+    uint32_t delta;
+
+    if (!_NextRecord(&delta))
+        return -1;
+
+    _replay.recordUs += delta;
+
+    return _Push(_replay.baseUs + _replay.recordUs);
+}
+
+/**
+ * Same as FifoReplay_PushNext, but push next record at the given (simulated)
+ * time instead of the time it was captured at, to replay data with timing of
+ * a different clock
+ * @param dueUs Simulated time to push the record at, if it's in the past
+ *        record is pushed right away
+ */
+int FifoReplay_PushNextAt(uint64_t dueUs)
+{
+    uint32_t delta;
+
+    if (!_NextRecord(&delta))
+        return -1;
+
+    return _Push(dueUs);
+}
+
+/**
+ * Tick hook of background replay, pushes current record once it's due
+ */
+static void _TimedTick(uint64_t nowUs)
+{
+    uint32_t delta;
+
+    while (_replay.timed && (nowUs >= _replay.dueUs))
+    {
+        if (HAL_MPU_SimPushFifo(_replay.data, _replay.left) != 0)
+            _replay.dropped++;
+
+        if (_NextRecord(&delta))
+        {
+            _replay.recordUs += delta;
+            _replay.dueUs = _replay.baseUs + _replay.recordUs;
+        }
+        else
+            _replay.timed = false;
+    }
+}
+
+/**
+ * Replay whole capture in the background: from now on each record is pushed
+ * into FIFO of simulated chip as soon as simulated time reaches the moment it
+ * was captured at, whatever the driver is doing at the time (sleeping,
+ * reading FIFO...). Restarts replay from the first record, which is due at
+ * current simulated time
+ */
+void FifoReplay_StartTimed()
+{
+    uint32_t delta;
+
+    FifoReplay_Rewind(false);
+    _replay.dropped = 0;
+    if (!_NextRecord(&delta))
+        return;
+
+    _replay.recordUs += delta;
+    _replay.dueUs = _replay.baseUs + _replay.recordUs;
+    _replay.timed = true;
+    HAL_BOARD_TickRegister(_TimedTick);
+}
+
+/**
+ * Check whether background replay is still running
+ * @param dropped (optional) Set to number of records pushed so far that
+ *        didn't fit in FIFO of simulated chip
+ * @return false once all records were pushed
+ */
+bool FifoReplay_TimedRunning(uint32_t *dropped)
+{
+    if (dropped != 0)
+        *dropped = _replay.dropped;
+
+    return _replay.timed;
+}
+
+/**
+ * Fake serial interface read, serves one record per interrupt. Only registers
+ * read while polling DMP FIFO are meaningful, everything else reads as 0
+ */
+int FifoReplay_SerifRead(void *context, uint8_t reg, uint8_t *data,
+                         uint32_t length)
+{
+    uint32_t delta;
+
+    (void)context;
+    if (length == 0)
+        return 0;
+
+    switch (reg & 0x7F)
+    {
+    case REG_INT_STATUS:
+        //  Next record becomes available once the current one is consumed
+        if (_replay.left == 0)
+            _NextRecord(&delta);
+        data[0] = (_replay.left != 0) ? BIT_MSG_DMP_INT : 0;
+        memset(&data[1], 0, length - 1);
+        break;
+    case REG_FIFO_COUNT_H:
+        data[0] = _replay.left >> 8;
+        if (length > 1)
+            data[1] = _replay.left & 0xFF;
+        break;
+    case REG_FIFO_R_W:
+        if (length > _replay.left)
+        {
+            memset(data, 0xFF, length);
+            length = _replay.left;
+        }
+        memcpy(data, _replay.data, length);
+        _replay.data += length;
+        _replay.left -= length;
+        break;
+    default:
+        memset(data, 0, length);
+        break;
+    }
+
+    return 0;
+}
+
+/**
+ * Fake serial interface write, all writes are accepted and ignored
+ */
+int FifoReplay_SerifWrite(void *context, uint8_t reg, const uint8_t *data,
+                          uint32_t length)
+{
+    (void)context;
+    (void)reg;
+    (void)data;
+    (void)length;
+
+    return 0;
+}
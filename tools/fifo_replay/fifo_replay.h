@@ -0,0 +1,50 @@
+/**
+ * fifo_replay.h
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Replay of raw DMP FIFO captures (see icm20948/icm20948_capture.h) on a host
+ *  PC. Capture is loaded in memory and fed back to the driver in one of two
+ *  ways:
+ *    * Through simulated ICM20948 (HAL/host), each record is pushed into the
+ *      FIFO of simulated chip at the time it was captured at, which raises
+ *      data-ready interrupt just like on the board
+ *    * Through a fake serial interface attached in place of simulated chip,
+ *      serving interrupt status, FIFO count and FIFO content straight from
+ *      memory, so that decoding can be benchmarked without any bus overhead
+ */
+#ifndef TOOLS_FIFO_REPLAY_FIFO_REPLAY_H_
+#define TOOLS_FIFO_REPLAY_FIFO_REPLAY_H_
+
+#include "icm20948/icm20948_capture.h"
+
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    extern int      FifoReplay_Load(const char *path);
+    extern void     FifoReplay_Free();
+    extern const ICM20948CaptureHeader* FifoReplay_Header();
+    extern uint32_t FifoReplay_Records();
+    extern uint32_t FifoReplay_Bytes();
+    extern void     FifoReplay_Rewind(bool loop);
+
+    extern int      FifoReplay_PushNext();
+    extern int      FifoReplay_PushNextAt(uint64_t dueUs);
+    extern void     FifoReplay_StartTimed();
+    extern bool     FifoReplay_TimedRunning(uint32_t *dropped);
+
+    extern int      FifoReplay_SerifRead(void *context, uint8_t reg,
+                                         uint8_t *data, uint32_t length);
+    extern int      FifoReplay_SerifWrite(void *context, uint8_t reg,
+                                          const uint8_t *data, uint32_t length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TOOLS_FIFO_REPLAY_FIFO_REPLAY_H_ */
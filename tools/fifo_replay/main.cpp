@@ -0,0 +1,324 @@
+/**
+ * main.cpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Host tool for recording and replaying raw DMP FIFO captures. Runs whole
+ *  driver stack against simulated ICM20948 (build with -D__BOARD_HOST_SIM__
+ *  together with HAL/host, icm20948, fifo_replay.c, sched_bench.c,
+ *  replay_bench.cpp, bench_*.cpp, where commands below other than record and
+ *  play live, and the .c files of tiva/ built with -Itools/fifo_replay/tiva):
+ *    fifo_replay record <file> <count>  Capture <count> FIFO reads of
+ *                                       simulated chip into <file>
+ *    fifo_replay play <file>            Replay capture in (simulated) real
+ *                                       time and print decoded data as CSV
+ *    fifo_replay jitter <file> [bin_ns] Replay capture in simulated time and
+ *                                       print histogram of intervals between
+ *                                       data-ready edges (ICM20948::Jitter)
+ *                                       around their average, bins <bin_ns>
+ *                                       wide
+ *    fifo_replay drift <file> [ppm] [latency_us] [samples]
+ *                                       Replay <samples> records of capture
+ *                                       sampled <ppm> slower than nominal,
+ *                                       interrupts served up to <latency_us>
+ *                                       late, and check ODR estimated by driver
+ *                                       and sample timestamps against it
+ *    fifo_replay idle <file> [tasks]    Replay capture in the background while
+ *                                       tickless main loop (libs/tickless.hpp)
+ *                                       sleeps between data-ready edges and
+ *                                       <tasks> periodic tasks, check that no
+ *                                       task ran late and every edge was read
+ *                                       before the next one was due, report
+ *                                       time spent asleep and wake-ups
+ *    fifo_replay drdy <file> [work_us]  Replay capture in the background while
+ *                                       main loop waits for edges in
+ *                                       WaitForData and stays busy up to
+ *                                       <work_us> after each read, check every
+ *                                       edge reaches OnDataReady hook and main
+ *                                       loop with the right time stamp, report
+ *                                       latency from edge to both
+ *    fifo_replay bench <file> [passes]  Decode capture <passes> times through
+ *                                       inv_icm20948_poll_sensor() and through
+ *                                       ICM20948Poller specialized for sensors
+ *                                       enabled when recording, and report
+ *                                       decoding throughput of both
+ *    fifo_replay dispatch <file> [passes]
+ *                                       Feed sensor events decoded from capture
+ *                                       <passes> times through ICM20948 event
+ *                                       handler, and through the switch-based
+ *                                       handler it replaced, and compare them
+ *    fifo_replay batch <file> [passes]  Decode capture <passes> times packet
+ *                                       by packet and through batch decoder,
+ *                                       FIFO filled with a batch of packets at
+ *                                       a time, report packets/s of both and
+ *                                       check they decode the same values
+ *    fifo_replay ring <file> [passes]   Pop capture <passes> times out of SW
+ *                                       FIFO ring of the driver and out of a
+ *                                       linear SW FIFO compacted with memmove
+ *                                       after every packet, as it was before,
+ *                                       check they decode the same values and
+ *                                       report cycles and bytes moved per packet
+ *    fifo_replay convert [vectors]      Convert <vectors> random DMP vectors of
+ *                                       every output, full-scale range and
+ *                                       axis-aligned mounting through float
+ *                                       chip-to-body matrices and through the
+ *                                       fixed-point quaternion rotation, and
+ *                                       report largest difference and timing
+ *    fifo_replay rpy [quaternions]      Convert random quaternions to RPY
+ *                                       angles through libm and through fast
+ *                                       approximations, single and in batch,
+ *                                       and report largest error and timing
+ *    fifo_replay median [samples]       Filter 3-axis samples through
+ *                                       MedianFilter and through the linked
+ *                                       list it replaced, at windows 3, 23
+ *                                       and 63, check medians and report time
+ *                                       and cycles per sample
+ *    fifo_replay pool [operations]      Allocate and free linked list nodes
+ *                                       at random through NodePool and through
+ *                                       fragmented heap, insert into a full
+ *                                       sorted LinkedList, and report average,
+ *                                       99.9th percentile and worst latency
+ *    fifo_replay sched [ticks]          Run 8, 64 and 512 periodic tasks for
+ *                                       <ticks> through InvScheduler and
+ *                                       through the linked list it replaced,
+ *                                       check both run the same tasks and
+ *                                       report dispatch time and task stats,
+ *                                       check that 513th task is dropped
+ *                                       (scheduler instance of its own, see
+ *                                       sched_bench.h)
+ *    fifo_replay dynpro [events]        Send <events> gyro, accel and game
+ *                                       rotation vector events over
+ *                                       DynProtocol UART transport, encoded
+ *                                       into a buffer and copied into frames,
+ *                                       and in place into pooled frames, one
+ *                                       and several per frame, check they are
+ *                                       received the same and report cycles,
+ *                                       bytes copied and sent per event
+ *    fifo_replay bus <file> [count]     Run FIFO reads of capture, sensor
+ *                                       period changes and sensor enables
+ *                                       <count> times with and without
+ *                                       transaction scope of the driver, and
+ *                                       report DMP memory accesses, bank
+ *                                       selects, PWR_MGMT_1 writes and bus
+ *                                       transactions per call from bus stats
+ *    fifo_replay spi [transfers]        Chain <transfers> asynchronous SPI
+ *                                       transfers of TM4C1294 HAL through
+ *                                       done hooks against SSI2/uDMA model,
+ *                                       check their order and data, and report
+ *                                       done hook latency; check blocking
+ *                                       calls while the bus is busy, with
+ *                                       interrupts masked and from a done hook
+ */
+#include "replay_bench.h"
+
+//  Sensors enabled when recording
+static const struct
+{
+    inv_icm20948_sensor sensor;
+    uint32_t            period;
+} recordSensors[] =
+{
+    { INV_ICM20948_SENSOR_GYROSCOPE, 5 },
+    { INV_ICM20948_SENSOR_ACCELEROMETER, 5 },
+    { INV_ICM20948_SENSOR_GAME_ROTATION_VECTOR, 5 },
+};
+
+static FILE *captureFile = 0;
+
+static void CaptureWriter(const uint8_t *data, uint16_t length)
+{
+    fwrite(data, 1, length, captureFile);
+}
+
+/**
+ * Slowly rotate simulated chip about z axis and keep it level
+ */
+static void SimGenerator(uint16_t outputBit, uint64_t timeUs, uint8_t *data,
+                         uint16_t length)
+{
+    //  Gyro at 250dps FSR, 2^15 LSB per FSR
+    int16_t gyroZ = (int16_t)(10 * 32768 / 250);
+    //  Accel (1g) at 2g FSR, 2^15 LSB per FSR
+    int16_t accZ = (int16_t)(32768 / 2);
+    //  Quaternion (Q30) rotating at 10dps, only x,y,z are in FIFO
+    double angle = 10.0 * 3.14159265358979 / 180.0 * (double)timeUs / 1e6;
+    int32_t qz = (int32_t)(sin(angle / 2) * (1L << 30));
+
+    (void)length;
+    switch (outputBit)
+    {
+    case 0x8000:    //  Accelerometer
+        data[4] = accZ >> 8;
+        data[5] = accZ & 0xFF;
+        break;
+    case 0x4000:    //  Gyroscope
+        data[4] = gyroZ >> 8;
+        data[5] = gyroZ & 0xFF;
+        break;
+    case 0x0800:    //  6DOF quaternion
+        for (uint8_t i = 0; i < 4; i++)
+            data[8 + i] = (uint8_t)(qz >> (24 - 8 * i));
+        break;
+    default:
+        break;
+    }
+}
+
+static int Record(const char *path, uint32_t count)
+{
+    ICM20948 &imu = ICM20948::GetI();
+    uint32_t reads = 0;
+
+    captureFile = fopen(path, "wb");
+    if (captureFile == 0)
+        return -1;
+
+    HAL_MPU_SimSetGenerator(SimGenerator);
+    imu.InitHW();
+    imu.SetAccelerationFSR(AccelFSR2g);
+    imu.SetGyroscopeFSR(GyroFSR250dps);
+    imu.InitSW();
+    for (uint8_t i = 0; i < sizeof(recordSensors)/sizeof(recordSensors[0]); i++)
+        imu.EnableSensor(recordSensors[i].sensor, recordSensors[i].period);
+
+    imu.StartCapture(CaptureWriter);
+    while (reads < count)
+        if (imu.WaitForData(100000))
+        {
+            imu.ReadSensorData(0);
+            reads++;
+        }
+    imu.StopCapture();
+
+    fclose(captureFile);
+    printf("Captured %u FIFO reads into %s\n", reads, path);
+
+    return 0;
+}
+
+static int Play(void)
+{
+    ICM20948 &imu = ICM20948::GetI();
+    float gyro[3], acc[3], quat[4];
+
+    if (StartDriver(FifoReplay_Header()) != 0)
+        return -1;
+
+    printf("time_us,gyro_x,gyro_y,gyro_z,acc_x,acc_y,acc_z,q_w,q_x,q_y,q_z\n");
+    FifoReplay_Rewind(false);
+    while (FifoReplay_PushNext() >= 0)
+    {
+        uint64_t edgeUs;
+
+        if (!imu.WaitForData(0, &edgeUs))
+            continue;
+        imu.ReadSensorData(0);
+
+        imu.GetGyroscope(gyro);
+        imu.GetLinearAcceleration(acc);
+        imu.GetOrientationQuat(Orientation6DOF, quat);
+        printf("%llu,%f,%f,%f,%f,%f,%f,%f,%f,%f,%f\n",
+               (unsigned long long)edgeUs, gyro[0], gyro[1], gyro[2],
+               acc[0], acc[1], acc[2], quat[0], quat[1], quat[2], quat[3]);
+    }
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int rc;
+
+    if ((argc >= 4) && (strcmp(argv[1], "record") == 0))
+        return Record(argv[2], strtoul(argv[3], 0, 0));
+
+    if ((argc >= 2) && (strcmp(argv[1], "convert") == 0))
+        return Convert((argc > 2) ? strtoul(argv[2], 0, 0) : 4096);
+
+    if ((argc >= 2) && (strcmp(argv[1], "rpy") == 0))
+        return Rpy((argc > 2) ? strtoul(argv[2], 0, 0) : 1000000);
+
+    if ((argc >= 2) && (strcmp(argv[1], "median") == 0))
+        return (Median((argc > 2) ? strtoul(argv[2], 0, 0) : 1000000) == 0) ? 0 : 1;
+
+    if ((argc >= 2) && (strcmp(argv[1], "pool") == 0))
+        return (Pool((argc > 2) ? strtoul(argv[2], 0, 0) : 1000000) == 0) ? 0 : 1;
+
+    if ((argc >= 2) && (strcmp(argv[1], "sched") == 0))
+        return (Sched((argc > 2) ? strtoul(argv[2], 0, 0) : 100000) == 0) ? 0 : 1;
+
+    if ((argc >= 2) && (strcmp(argv[1], "dynpro") == 0))
+        return (DynPro((argc > 2) ? strtoul(argv[2], 0, 0) : 1000000) == 0) ? 0 : 1;
+
+    if ((argc >= 2) && (strcmp(argv[1], "spi") == 0))
+        return (Spi((argc > 2) ? strtoul(argv[2], 0, 0) : 1000) == 0) ? 0 : 1;
+
+    if ((argc < 3) || ((strcmp(argv[1], "play") != 0) &&
+                       (strcmp(argv[1], "jitter") != 0) &&
+                       (strcmp(argv[1], "drift") != 0) &&
+                       (strcmp(argv[1], "idle") != 0) &&
+                       (strcmp(argv[1], "drdy") != 0) &&
+                       (strcmp(argv[1], "bench") != 0) &&
+                       (strcmp(argv[1], "dispatch") != 0) &&
+                       (strcmp(argv[1], "batch") != 0) &&
+                       (strcmp(argv[1], "ring") != 0) &&
+                       (strcmp(argv[1], "bus") != 0)))
+    {
+        printf("Usage: %s record <file> <count>\n"
+               "       %s play <file>\n"
+               "       %s jitter <file> [bin_ns]\n"
+               "       %s drift <file> [ppm] [latency_us] [samples]\n"
+               "       %s idle <file> [tasks]\n"
+               "       %s drdy <file> [work_us]\n"
+               "       %s bench <file> [passes]\n"
+               "       %s dispatch <file> [passes]\n"
+               "       %s batch <file> [passes]\n"
+               "       %s ring <file> [passes]\n"
+               "       %s convert [vectors]\n"
+               "       %s rpy [quaternions]\n"
+               "       %s median [samples]\n"
+               "       %s pool [operations]\n"
+               "       %s sched [ticks]\n"
+               "       %s dynpro [events]\n"
+               "       %s bus <file> [count]\n"
+               "       %s spi [transfers]\n",
+               argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0],
+               argv[0], argv[0], argv[0], argv[0], argv[0], argv[0], argv[0],
+               argv[0], argv[0], argv[0], argv[0]);
+        return 1;
+    }
+
+    if (FifoReplay_Load(argv[2]) != 0)
+    {
+        printf("Can't load capture %s\n", argv[2]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "play") == 0)
+        rc = Play();
+    else if (strcmp(argv[1], "jitter") == 0)
+        rc = Jitter((argc > 3) ? strtoul(argv[3], 0, 0) : 1000);
+    else if (strcmp(argv[1], "drift") == 0)
+        rc = Drift((argc > 3) ? strtol(argv[3], 0, 0) : 200,
+                   (argc > 4) ? strtoul(argv[4], 0, 0) : 20,
+                   (argc > 5) ? strtoul(argv[5], 0, 0) : 4096);
+    else if (strcmp(argv[1], "idle") == 0)
+        rc = Idle((argc > 3) ? strtoul(argv[3], 0, 0) : 4);
+    else if (strcmp(argv[1], "drdy") == 0)
+        rc = DataReady((argc > 3) ? strtoul(argv[3], 0, 0) : 5000);
+    else if (strcmp(argv[1], "dispatch") == 0)
+        rc = Dispatch((argc > 3) ? strtoul(argv[3], 0, 0) : 1000);
+    else if (strcmp(argv[1], "batch") == 0)
+        rc = Batch((argc > 3) ? strtoul(argv[3], 0, 0) : 1000);
+    else if (strcmp(argv[1], "ring") == 0)
+        rc = Ring((argc > 3) ? strtoul(argv[3], 0, 0) : 1000);
+    else if (strcmp(argv[1], "bus") == 0)
+        rc = Bus((argc > 3) ? strtoul(argv[3], 0, 0) : 100);
+    else
+        rc = Bench((argc > 3) ? strtoul(argv[3], 0, 0) : 1000);
+
+    FifoReplay_Free();
+
+    return (rc == 0) ? 0 : 1;
+}
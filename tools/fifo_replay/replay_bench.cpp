@@ -0,0 +1,44 @@
+/**
+ * replay_bench.cpp
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Driver bring-up and time functions shared by fifo_replay commands
+ */
+#include "replay_bench.h"
+
+extern "C" {
+    void inv_icm20948_sleep(int ms) {
+        HAL_DelayUS(ms*1000);
+    }
+
+    void inv_icm20948_sleep_us(int us){
+        HAL_DelayUS(us);
+    }
+
+    //  Reading time costs 1us so that loops polling for data make progress
+    uint64_t inv_icm20948_get_time_us(void){
+        HAL_BOARD_AdvanceUS(1);
+        return HAL_BOARD_TimeUS();
+    }
+}
+
+int StartDriver(const ICM20948CaptureHeader *hdr)
+{
+    ICM20948 &imu = ICM20948::GetI();
+    int rc = 0;
+
+    imu.InitHW();
+    HAL_MPU_SimMuteDmp(true);
+    imu.SetAccelerationFSR((AccelerometerFSR)hdr->accelFsr);
+    imu.SetGyroscopeFSR((GyroscopeFSR)hdr->gyroFsr);
+    rc |= imu.InitSW();
+
+    for (uint8_t i = 0; i < INV_ICM20948_SENSOR_MAX; i++)
+        if (hdr->sensorPeriodMs[i] != 0)
+            rc |= imu.EnableSensor((inv_icm20948_sensor)i,
+                                   hdr->sensorPeriodMs[i]);
+
+    return rc;
+}
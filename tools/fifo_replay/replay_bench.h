@@ -0,0 +1,108 @@
+/**
+ * replay_bench.h
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Fixture shared by fifo_replay commands: driver brought up against simulated
+ *  ICM20948 with sensors of a capture enabled, time stamps and running hash of
+ *  decoded values. Commands live in one source file per feature (bench_*.cpp)
+ *  and are dispatched from main.cpp.
+ */
+#ifndef TOOLS_FIFO_REPLAY_REPLAY_BENCH_H_
+#define TOOLS_FIFO_REPLAY_REPLAY_BENCH_H_
+
+//  Standard headers first, driver headers define min/max macros that break
+//  them (<cmath>, <limits>) when included before
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+#include "HAL/hal.h"
+#include "icm20948/icm20948.h"
+#include "icm20948/Invn/Devices/Drivers/ICM20948/Icm20948.h"
+#include "icm20948/Invn/Devices/Drivers/ICM20948/Icm20948MPUFifoControl.h"
+#include "icm20948/Invn/Devices/Drivers/ICM20948/Icm20948DataBaseDriver.h"
+#include "icm20948/Invn/Devices/SensorTypes.h"
+#include "fifo_replay.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CYCLES()    __rdtsc()
+#else
+#define CYCLES()    0
+#endif
+
+//  Driver instance owned by ICM20948 class
+extern inv_icm20948_t icm_device;
+
+/**
+ * Bring up driver against simulated chip and enable sensors listed in capture
+ * header, simulated chip is not generating any data on its own
+ */
+extern int StartDriver(const ICM20948CaptureHeader *hdr);
+
+/**
+ * Time stamp for latency of a single operation: time stamp counter cycles
+ * where available, ns otherwise
+ */
+static inline uint64_t Stamp()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return CYCLES();
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+#endif
+}
+
+static inline double ElapsedNs(const struct timespec &t0,
+                               const struct timespec &t1)
+{
+    return (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+}
+
+/**
+ * Running hash of 32-bit values, one per output, so that two implementations
+ * can be checked to produce the same stream of values bit for bit. Skipped
+ * when hash is 0 (timed runs)
+ */
+static inline void Hash(uint64_t *hash, uint8_t output, const void *value)
+{
+    uint32_t bits;
+
+    if (hash == 0)
+        return;
+    memcpy(&bits, value, sizeof(bits));
+    hash[output] = (hash[output] ^ bits) * 1099511628211ULL;
+}
+
+//  Commands, return 0 on success
+//  bench_timing.cpp
+extern int Jitter(uint32_t binNs);
+extern int Drift(int32_t ppm, uint32_t latencyUs, uint32_t samples);
+extern int Idle(uint16_t tasks);
+extern int DataReady(uint32_t workUs);
+//  bench_decode.cpp
+extern int Bench(uint32_t passes);
+extern int Dispatch(uint32_t passes);
+extern int Batch(uint32_t passes);
+extern int Ring(uint32_t passes);
+//  bench_math.cpp
+extern int Convert(uint32_t vectors);
+extern int Rpy(uint32_t count);
+//  bench_libs.cpp
+extern int Median(uint32_t count);
+extern int Pool(uint32_t count);
+extern int Sched(uint32_t ticks);
+//  bench_dynpro.cpp
+extern int DynPro(uint32_t events);
+//  bench_bus.cpp
+extern int Bus(uint32_t count);
+//  bench_spi.cpp
+extern int Spi(uint32_t transfers);
+
+#endif /* TOOLS_FIFO_REPLAY_REPLAY_BENCH_H_ */
@@ -0,0 +1,12 @@
+/**
+ * sched_bench.c
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Instance of InvScheduler benchmarked by fifo_replay sched, see
+ *  sched_bench.h
+ */
+#include "sched_bench.h"
+
+#include "icm20948/Invn/EmbUtils/InvScheduler.c"
@@ -0,0 +1,45 @@
+/**
+ * sched_bench.h
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  InvScheduler (icm20948/Invn/EmbUtils) as benchmarked by fifo_replay sched:
+ *  room for 512 tasks, task statistics with run time measured by
+ *  InvScheduler_getStatsTime. Built as a separate instance (sched_bench.c)
+ *  with its names renamed to BenchScheduler*, so the bench doesn't depend on
+ *  how the library was configured and doesn't clash with it.
+ */
+#ifndef TOOLS_FIFO_REPLAY_SCHED_BENCH_H_
+#define TOOLS_FIFO_REPLAY_SCHED_BENCH_H_
+
+#ifdef _INV_SCHEDULER_H_
+#error "sched_bench.h must be included instead of InvScheduler.h"
+#endif
+
+#define INVSCHEDULER_MAX_TASKS              512
+#define INVSCHEDULER_TASK_STATS
+
+#define InvScheduler                        BenchScheduler
+#define InvSchedulerTask                    BenchSchedulerTask
+#define InvSchedulerTaskStats               BenchSchedulerTaskStats
+#define InvSchedulerTaskState               BenchSchedulerTaskState
+#define InvScheduler_getActiveTaskCountU    BenchScheduler_getActiveTaskCountU
+#define InvScheduler_getNextTimeU           BenchScheduler_getNextTimeU
+#define InvScheduler_getMinPeriodU          BenchScheduler_getMinPeriodU
+#define InvScheduler_resetTaskStatsU        BenchScheduler_resetTaskStatsU
+#define InvScheduler_dispatchOneTask        BenchScheduler_dispatchOneTask
+#define InvScheduler_dispatchTasks          BenchScheduler_dispatchTasks
+#define InvScheduler_initTaskDo             BenchScheduler_initTaskDo
+#define InvScheduler_startTaskU             BenchScheduler_startTaskU
+#define InvScheduler_startTask              BenchScheduler_startTask
+#define InvScheduler_stopTaskU              BenchScheduler_stopTaskU
+#define InvScheduler_stopTask               BenchScheduler_stopTask
+#define InvScheduler_updateTaskU            BenchScheduler_updateTaskU
+#define InvScheduler_printTask              BenchScheduler_printTask
+#define InvScheduler_dumpTasks              BenchScheduler_dumpTasks
+#define InvScheduler_getStatsTime           BenchScheduler_getStatsTime
+
+#include "icm20948/Invn/EmbUtils/InvScheduler.h"
+
+#endif /* TOOLS_FIFO_REPLAY_SCHED_BENCH_H_ */
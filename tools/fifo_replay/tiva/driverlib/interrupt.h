@@ -0,0 +1,2 @@
+//  TivaWare driverlib/interrupt.h on host, see tiva_model.h
+#include "../tiva_model.h"
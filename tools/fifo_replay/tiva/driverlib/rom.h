@@ -0,0 +1,2 @@
+//  TivaWare driverlib/rom.h on host, see tiva_model.h
+#include "../tiva_model.h"
@@ -0,0 +1,2 @@
+//  TivaWare driverlib/rom_map.h on host, see tiva_model.h
+#include "../tiva_model.h"
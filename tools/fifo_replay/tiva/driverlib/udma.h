@@ -0,0 +1,2 @@
+//  TivaWare driverlib/udma.h on host, see tiva_model.h
+#include "../tiva_model.h"
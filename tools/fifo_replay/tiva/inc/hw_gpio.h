@@ -0,0 +1,2 @@
+//  TivaWare inc/hw_gpio.h on host, see tiva_model.h
+#include "../tiva_model.h"
@@ -0,0 +1,2 @@
+//  TivaWare inc/hw_ssi.h on host, see tiva_model.h
+#include "../tiva_model.h"
@@ -0,0 +1,591 @@
+/**
+ * tiva_model.c
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Host model of SSI2, uDMA channels 12 & 13, CS pin and SSI2 interrupt of
+ *  TM4C1294, see tiva_model.h
+ */
+#include "tiva_model.h"
+#include "HAL/host/hal_common_host.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+//  Cost of a peripheral register access (3 cycles at 120MHz)
+#define TIVA_MODEL_ACCESS_NS    25
+//  Interrupt entry latency (12 cycles at 120MHz)
+#define TIVA_MODEL_IRQ_NS       100
+//  uDMA channel of SSI2 RX & TX
+#define TIVA_MODEL_CH_RX        12
+#define TIVA_MODEL_CH_TX        13
+//  Size of FIFO behind FIFO_R_W register of chip model
+#define TIVA_MODEL_FIFO_SIZE    4096
+
+typedef struct
+{
+    uint32_t    control;
+    uint8_t     *src;
+    uint8_t     *dst;
+    uint32_t    size;
+    bool        enabled;
+} TivaModelChannel;
+
+static struct
+{
+    uint64_t    nowNs;
+    uint64_t    deadlineNs;         //  0 if watchdog is off
+    bool        primask;
+    uint64_t    maskedSinceNs;
+    bool        inIsr;
+
+    //  SSI2
+    uint32_t    bitRate;
+    bool        dmaEnabled;
+    uint32_t    intMask;
+    uint32_t    intRaw;
+    uint64_t    intSinceNs;
+    void        (*handler)(void);
+    uint64_t    busyUntilNs;
+    uint32_t    rxFifo[8];
+    uint8_t     rxCount;
+
+    //  uDMA, a transfer runs once both SSI2 channels are enabled
+    TivaModelChannel ch[32];
+    bool        dmaRunning;
+    uint64_t    dmaDoneNs;
+    bool        chunkInCs;          //  A chunk completed since CS went low
+
+    //  Chip model behind CS
+    bool        csLow;
+    bool        addrPhase;
+    bool        read;
+    uint8_t     addr;
+    uint8_t     regs[128];
+    uint8_t     fifo[TIVA_MODEL_FIFO_SIZE];
+    uint32_t    fifoHead;
+    uint32_t    fifoCount;
+
+    TivaModelStats stats;
+} _model;
+
+static void _TivaModel_Tick();
+
+/**
+ * Host HAL time (HAL_DelayUS) advances model time as well
+ */
+static void _TivaModel_HostTick(uint64_t nowUs)
+{
+    (void)nowUs;
+    _model.nowNs += 1000;
+}
+
+/**
+ * Time SSI2 takes to shift one byte at configured clock
+ */
+static uint64_t _TivaModel_ByteNs()
+{
+    return (8ULL * 1000000000ULL + _model.bitRate - 1) / _model.bitRate;
+}
+
+/**
+ * Exchange one byte with chip model, first byte after CS went low is
+ * register address with R/W bit. FIFO_R_W doesn't auto-increment, other
+ * registers do
+ * @return Byte clocked in from the chip
+ */
+static uint8_t _TivaModel_Exchange(uint8_t mosi)
+{
+    uint8_t miso = 0;
+
+    _model.stats.bytes++;
+    if (!_model.csLow)
+        return 0xFF;
+    if (_model.addrPhase)
+    {
+        _model.addrPhase = false;
+        _model.read = ((mosi & 0x80) != 0);
+        _model.addr = mosi & 0x7F;
+        return 0;
+    }
+
+    if (_model.addr == TIVA_MODEL_FIFO_REG)
+    {
+        if (_model.read && (_model.fifoCount > 0))
+        {
+            miso = _model.fifo[_model.fifoHead];
+            _model.fifoHead = (_model.fifoHead + 1) % TIVA_MODEL_FIFO_SIZE;
+            _model.fifoCount--;
+        }
+        else if (!_model.read && (_model.fifoCount < TIVA_MODEL_FIFO_SIZE))
+        {
+            _model.fifo[(_model.fifoHead + _model.fifoCount) %
+                        TIVA_MODEL_FIFO_SIZE] = mosi;
+            _model.fifoCount++;
+        }
+        return miso;
+    }
+
+    if (_model.read)
+        miso = _model.regs[_model.addr];
+    else
+        _model.regs[_model.addr] = mosi;
+    _model.addr = (_model.addr + 1) & 0x7F;
+
+    return miso;
+}
+
+/**
+ * Start uDMA transfer once both SSI2 channels are enabled. Bytes are moved
+ * when it completes, which is fine as nobody looks at the buffers before
+ */
+static void _TivaModel_DmaStart()
+{
+    TivaModelChannel *rx = &_model.ch[TIVA_MODEL_CH_RX];
+    TivaModelChannel *tx = &_model.ch[TIVA_MODEL_CH_TX];
+
+    if (!_model.dmaEnabled || !rx->enabled || !tx->enabled || _model.dmaRunning)
+        return;
+
+    //  Bus sat idle since the previous chunk of the same transfer
+    if (_model.chunkInCs)
+    {
+        uint64_t gap = _model.nowNs - _model.stats.chunkDoneNs;
+
+        _model.stats.chunkGapSumNs += gap;
+        if (gap > _model.stats.chunkGapMaxNs)
+            _model.stats.chunkGapMaxNs = gap;
+    }
+
+    _model.dmaRunning = true;
+    _model.dmaDoneNs = _model.nowNs + tx->size * _TivaModel_ByteNs();
+}
+
+/**
+ * uDMA transfer is over: exchange its bytes, disable both channels (basic
+ * mode) and raise SSI2 DMA interrupts
+ */
+static void _TivaModel_DmaDone()
+{
+    TivaModelChannel *rx = &_model.ch[TIVA_MODEL_CH_RX];
+    TivaModelChannel *tx = &_model.ch[TIVA_MODEL_CH_TX];
+    bool txInc = ((tx->control & UDMA_SRC_INC_NONE) != UDMA_SRC_INC_NONE);
+    bool rxInc = ((rx->control & UDMA_DST_INC_NONE) != UDMA_DST_INC_NONE);
+
+    for (uint32_t i = 0; i < tx->size; i++)
+    {
+        uint8_t miso = _TivaModel_Exchange(tx->src[txInc ? i : 0]);
+
+        if (i < rx->size)
+            rx->dst[rxInc ? i : 0] = miso;
+    }
+
+    _model.dmaRunning = false;
+    rx->enabled = false;
+    tx->enabled = false;
+    _model.intRaw |= SSI_DMARX | SSI_DMATX;
+    _model.intSinceNs = _model.nowNs;
+    _model.chunkInCs = true;
+    _model.stats.chunks++;
+    _model.stats.chunkDoneNs = _model.nowNs;
+}
+
+/**
+ * Advance time by one register access, let uDMA finish in the background and
+ * take SSI2 interrupt if it's pending and allowed to run
+ */
+static void _TivaModel_Tick()
+{
+    _model.nowNs += TIVA_MODEL_ACCESS_NS;
+    if ((_model.deadlineNs != 0) && (_model.nowNs > _model.deadlineNs))
+    {
+        printf("tiva model: no progress by %llu ns, deadlocked\n",
+               (unsigned long long)_model.nowNs);
+        exit(1);
+    }
+
+    if (_model.dmaRunning && (_model.nowNs >= _model.dmaDoneNs))
+        _TivaModel_DmaDone();
+
+    if (!_model.primask && !_model.inIsr && (_model.handler != 0) &&
+        ((_model.intRaw & _model.intMask) != 0) &&
+        (_model.nowNs >= _model.intSinceNs + TIVA_MODEL_IRQ_NS))
+    {
+        _model.inIsr = true;
+        _model.stats.interrupts++;
+        _model.handler();
+        _model.inIsr = false;
+    }
+}
+
+void SysCtlPeripheralEnable(uint32_t peripheral)
+{
+    (void)peripheral;
+    _TivaModel_Tick();
+}
+
+void SysCtlPeripheralReset(uint32_t peripheral)
+{
+    (void)peripheral;
+    _TivaModel_Tick();
+    _model.rxCount = 0;
+    _model.intRaw = 0;
+}
+
+void GPIOPinConfigure(uint32_t pinConfig)
+{
+    (void)pinConfig;
+    _TivaModel_Tick();
+}
+
+void GPIOPinTypeSSI(uint32_t port, uint8_t pins)
+{
+    (void)port;
+    (void)pins;
+    _TivaModel_Tick();
+}
+
+void GPIOPinTypeGPIOOutput(uint32_t port, uint8_t pins)
+{
+    (void)port;
+    (void)pins;
+    _TivaModel_Tick();
+}
+
+void GPIOPinTypeGPIOInput(uint32_t port, uint8_t pins)
+{
+    (void)port;
+    (void)pins;
+    _TivaModel_Tick();
+}
+
+/**
+ * Only CS (PN2) is modelled, a falling edge starts a new chip transaction
+ */
+void GPIOPinWrite(uint32_t port, uint8_t pins, uint8_t val)
+{
+    _TivaModel_Tick();
+    if ((port != GPIO_PORTN_BASE) || !(pins & GPIO_PIN_2))
+        return;
+
+    if (!(val & GPIO_PIN_2) && !_model.csLow)
+    {
+        _model.csLow = true;
+        _model.addrPhase = true;
+        _model.chunkInCs = false;
+        _model.stats.csAssertions++;
+    }
+    else if (val & GPIO_PIN_2)
+        _model.csLow = false;
+}
+
+int32_t GPIOPinRead(uint32_t port, uint8_t pins)
+{
+    (void)port;
+    (void)pins;
+    _TivaModel_Tick();
+    return 0;
+}
+
+void GPIOIntTypeSet(uint32_t port, uint8_t pins, uint32_t intType)
+{
+    (void)port;
+    (void)pins;
+    (void)intType;
+    _TivaModel_Tick();
+}
+
+uint32_t GPIOIntStatus(uint32_t port, bool masked)
+{
+    (void)port;
+    (void)masked;
+    _TivaModel_Tick();
+    return 0;
+}
+
+void GPIOIntClear(uint32_t port, uint32_t intFlags)
+{
+    (void)port;
+    (void)intFlags;
+    _TivaModel_Tick();
+}
+
+void GPIOIntEnable(uint32_t port, uint32_t intFlags)
+{
+    (void)port;
+    (void)intFlags;
+    _TivaModel_Tick();
+}
+
+void GPIOIntDisable(uint32_t port, uint32_t intFlags)
+{
+    (void)port;
+    (void)intFlags;
+    _TivaModel_Tick();
+}
+
+void GPIOIntRegister(uint32_t port, void (*handler)(void))
+{
+    (void)port;
+    (void)handler;
+    _TivaModel_Tick();
+}
+
+void SSIConfigSetExpClk(uint32_t base, uint32_t ssiClk, uint32_t protocol,
+                        uint32_t mode, uint32_t bitRate, uint32_t dataWidth)
+{
+    (void)base;
+    (void)ssiClk;
+    (void)protocol;
+    (void)mode;
+    (void)dataWidth;
+    _TivaModel_Tick();
+    _model.bitRate = bitRate;
+}
+
+void SSIEnable(uint32_t base)
+{
+    (void)base;
+    _TivaModel_Tick();
+}
+
+void SSIDisable(uint32_t base)
+{
+    (void)base;
+    _TivaModel_Tick();
+}
+
+/**
+ * Byte written by CPU is exchanged right away, SSI stays busy while it's
+ * being shifted out
+ */
+void SSIDataPut(uint32_t base, uint32_t data)
+{
+    (void)base;
+    _TivaModel_Tick();
+    if (_model.busyUntilNs < _model.nowNs)
+        _model.busyUntilNs = _model.nowNs;
+    _model.busyUntilNs += _TivaModel_ByteNs();
+    if (_model.rxCount < sizeof(_model.rxFifo)/sizeof(_model.rxFifo[0]))
+        _model.rxFifo[_model.rxCount++] = _TivaModel_Exchange((uint8_t)data);
+}
+
+/**
+ * Wait for byte to be shifted in and take it out of RX FIFO
+ */
+void SSIDataGet(uint32_t base, uint32_t *data)
+{
+    (void)base;
+    while (_model.nowNs < _model.busyUntilNs)
+        _TivaModel_Tick();
+    SSIDataGetNonBlocking(base, data);
+}
+
+int32_t SSIDataGetNonBlocking(uint32_t base, uint32_t *data)
+{
+    (void)base;
+    _TivaModel_Tick();
+    if (_model.rxCount == 0)
+        return 0;
+
+    *data = _model.rxFifo[0];
+    memmove(&_model.rxFifo[0], &_model.rxFifo[1],
+            --_model.rxCount * sizeof(_model.rxFifo[0]));
+    return 1;
+}
+
+bool SSIBusy(uint32_t base)
+{
+    (void)base;
+    _TivaModel_Tick();
+    return _model.dmaRunning || (_model.nowNs < _model.busyUntilNs);
+}
+
+void SSIDMAEnable(uint32_t base, uint32_t dmaFlags)
+{
+    (void)base;
+    _TivaModel_Tick();
+    _model.dmaEnabled = ((dmaFlags & (SSI_DMA_RX | SSI_DMA_TX)) ==
+                         (SSI_DMA_RX | SSI_DMA_TX));
+}
+
+void SSIIntRegister(uint32_t base, void (*handler)(void))
+{
+    (void)base;
+    _TivaModel_Tick();
+    _model.handler = handler;
+}
+
+void SSIIntEnable(uint32_t base, uint32_t intFlags)
+{
+    (void)base;
+    _TivaModel_Tick();
+    _model.intMask |= intFlags;
+}
+
+uint32_t SSIIntStatus(uint32_t base, bool masked)
+{
+    (void)base;
+    _TivaModel_Tick();
+    return masked ? (_model.intRaw & _model.intMask) : _model.intRaw;
+}
+
+void SSIIntClear(uint32_t base, uint32_t intFlags)
+{
+    (void)base;
+    _TivaModel_Tick();
+    _model.intRaw &= ~intFlags;
+}
+
+void uDMAChannelAssign(uint32_t mapping)
+{
+    (void)mapping;
+    _TivaModel_Tick();
+}
+
+void uDMAChannelAttributeDisable(uint32_t channel, uint32_t attr)
+{
+    (void)channel;
+    (void)attr;
+    _TivaModel_Tick();
+}
+
+void uDMAChannelControlSet(uint32_t channel, uint32_t control)
+{
+    _TivaModel_Tick();
+    _model.ch[channel & 0x1F].control = control;
+}
+
+void uDMAChannelTransferSet(uint32_t channel, uint32_t mode, void *src,
+                            void *dst, uint32_t size)
+{
+    TivaModelChannel *ch = &_model.ch[channel & 0x1F];
+
+    (void)mode;
+    _TivaModel_Tick();
+    ch->src = (uint8_t *)src;
+    ch->dst = (uint8_t *)dst;
+    ch->size = size;
+}
+
+void uDMAChannelEnable(uint32_t channel)
+{
+    _TivaModel_Tick();
+    _model.ch[channel & 0x1F].enabled = true;
+    _TivaModel_DmaStart();
+}
+
+bool uDMAChannelIsEnabled(uint32_t channel)
+{
+    _TivaModel_Tick();
+    return _model.ch[channel & 0x1F].enabled;
+}
+
+/**
+ * Set PRIMASK
+ * @return true if interrupts were already masked
+ */
+bool IntMasterDisable(void)
+{
+    bool was = _model.primask;
+
+    _TivaModel_Tick();
+    if (!was)
+        _model.maskedSinceNs = _model.nowNs;
+    _model.primask = true;
+
+    return was;
+}
+
+/**
+ * Clear PRIMASK, interrupt that got pending meanwhile is taken right away
+ * @return true if interrupts were masked
+ */
+bool IntMasterEnable(void)
+{
+    bool was = _model.primask;
+
+    if (was && (_model.nowNs - _model.maskedSinceNs > _model.stats.maskedMaxNs))
+        _model.stats.maskedMaxNs = _model.nowNs - _model.maskedSinceNs;
+    _model.primask = false;
+    _TivaModel_Tick();
+
+    return was;
+}
+
+/**
+ * Bring model to power-on state (chip registers and FIFO cleared) and
+ * reset time and statistics
+ */
+void TivaModel_Reset()
+{
+    static bool hooked = false;
+
+    if (!hooked)
+        HAL_BOARD_TickRegister(_TivaModel_HostTick);
+    hooked = true;
+
+    memset(&_model, 0, sizeof(_model));
+    _model.bitRate = 1000000;
+}
+
+/**
+ * @return Simulated time in ns
+ */
+uint64_t TivaModel_TimeNs()
+{
+    return _model.nowNs;
+}
+
+/**
+ * Let time pass in main loop, taking interrupts as they come
+ * @param ns Time to let pass
+ */
+void TivaModel_Run(uint64_t ns)
+{
+    uint64_t end = _model.nowNs + ns;
+
+    while (_model.nowNs < end)
+        _TivaModel_Tick();
+}
+
+/**
+ * Exit with an error if time passes <ns> from now, e.g. code spinning on a
+ * transfer that can't complete
+ * @param ns Time before watchdog fires, 0 to turn it off
+ */
+void TivaModel_Watchdog(uint64_t ns)
+{
+    _model.deadlineNs = (ns != 0) ? (_model.nowNs + ns) : 0;
+}
+
+/**
+ * @return true while SSI2 interrupt handler runs as an interrupt
+ */
+bool TivaModel_InInterrupt()
+{
+    return _model.inIsr;
+}
+
+/**
+ * @return true while CS is driven low
+ */
+bool TivaModel_CsLow()
+{
+    return _model.csLow;
+}
+
+/**
+ * @return Bytes in FIFO of chip model
+ */
+uint32_t TivaModel_FifoLevel()
+{
+    return _model.fifoCount;
+}
+
+void TivaModel_StatsGet(TivaModelStats *stats)
+{
+    *stats = _model.stats;
+}
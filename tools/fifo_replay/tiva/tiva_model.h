@@ -0,0 +1,182 @@
+/**
+ * tiva_model.h
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Host model of the TM4C1294 peripherals used by SPI HAL of ICM20948
+ *  (HAL/tm4c1294/hal_icm_spi_tm4c.c): SSI2 with uDMA channels 12 & 13, CS pin,
+ *  NVIC entry of SSI2 interrupt and PRIMASK. Declares the subset of TivaWare
+ *  the HAL uses, headers in inc/, driverlib/ and utils/ next to this one only
+ *  include it, so the HAL compiles on a host unmodified.
+ *
+ *  Time is simulated in ns and advances with every register access. uDMA
+ *  moves a chunk in the background at the configured SPI clock, exchanging
+ *  bytes with a model of the chip (128 auto-incremented registers, FIFO_R_W
+ *  at 0x72 backed by a FIFO). SSI2 interrupt raised at the end of a chunk is
+ *  taken on a later register access, once PRIMASK is clear and SSI2 interrupt
+ *  isn't already active, as NVIC would.
+ */
+#ifndef TOOLS_FIFO_REPLAY_TIVA_TIVA_MODEL_H_
+#define TOOLS_FIFO_REPLAY_TIVA_TIVA_MODEL_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**     inc/hw_memmap.h, inc/hw_ssi.h       */
+#define SSI2_BASE               0x4000A000UL
+#define GPIO_PORTA_BASE         0x40058000UL
+#define GPIO_PORTD_BASE         0x4005B000UL
+#define GPIO_PORTL_BASE         0x40062000UL
+#define GPIO_PORTN_BASE         0x40064000UL
+#define SSI_O_DR                0x00000008
+
+/**     driverlib/gpio.h, driverlib/pin_map.h       */
+#define GPIO_PIN_0              0x00000001
+#define GPIO_PIN_1              0x00000002
+#define GPIO_PIN_2              0x00000004
+#define GPIO_PIN_3              0x00000008
+#define GPIO_PIN_4              0x00000010
+#define GPIO_PIN_5              0x00000020
+#define GPIO_RISING_EDGE        0x00000004
+#define GPIO_PD0_SSI2XDAT1      0x0003000F
+#define GPIO_PD1_SSI2XDAT0      0x0003040F
+#define GPIO_PD3_SSI2CLK        0x00030C0F
+
+/**     driverlib/sysctl.h      */
+#define SYSCTL_PERIPH_GPIOA     0xf0000800
+#define SYSCTL_PERIPH_GPIOD     0xf0000803
+#define SYSCTL_PERIPH_GPIOL     0xf000080a
+#define SYSCTL_PERIPH_GPION     0xf000080c
+#define SYSCTL_PERIPH_SSI2      0xf0001c02
+
+/**     driverlib/ssi.h     */
+#define SSI_FRF_MOTO_MODE_0     0x00000000
+#define SSI_MODE_MASTER         0x00000000
+#define SSI_DMA_RX              0x00000001
+#define SSI_DMA_TX              0x00000002
+#define SSI_DMARX               0x00000010
+#define SSI_DMATX               0x00000020
+
+/**     driverlib/udma.h        */
+#define UDMA_CH12_SSI2RX        0x0002000C
+#define UDMA_CH13_SSI2TX        0x0002000D
+#define UDMA_PRI_SELECT         0x00000000
+#define UDMA_ATTR_ALL           0x0000000F
+#define UDMA_SIZE_8             0x00000000
+#define UDMA_SRC_INC_8          0x00000000
+#define UDMA_SRC_INC_NONE       0x0c000000
+#define UDMA_DST_INC_8          0x00000000
+#define UDMA_DST_INC_NONE       0xc0000000
+#define UDMA_ARB_4              0x00008000
+#define UDMA_MODE_BASIC         0x00000001
+
+/**     TivaWare API used by the HAL, ROM/MAP variants are the same calls       */
+extern void     SysCtlPeripheralEnable(uint32_t peripheral);
+extern void     SysCtlPeripheralReset(uint32_t peripheral);
+
+extern void     GPIOPinConfigure(uint32_t pinConfig);
+extern void     GPIOPinTypeSSI(uint32_t port, uint8_t pins);
+extern void     GPIOPinTypeGPIOOutput(uint32_t port, uint8_t pins);
+extern void     GPIOPinTypeGPIOInput(uint32_t port, uint8_t pins);
+extern void     GPIOPinWrite(uint32_t port, uint8_t pins, uint8_t val);
+extern int32_t  GPIOPinRead(uint32_t port, uint8_t pins);
+extern void     GPIOIntTypeSet(uint32_t port, uint8_t pins, uint32_t intType);
+extern uint32_t GPIOIntStatus(uint32_t port, bool masked);
+extern void     GPIOIntClear(uint32_t port, uint32_t intFlags);
+extern void     GPIOIntEnable(uint32_t port, uint32_t intFlags);
+extern void     GPIOIntDisable(uint32_t port, uint32_t intFlags);
+extern void     GPIOIntRegister(uint32_t port, void (*handler)(void));
+
+extern void     SSIConfigSetExpClk(uint32_t base, uint32_t ssiClk,
+                                   uint32_t protocol, uint32_t mode,
+                                   uint32_t bitRate, uint32_t dataWidth);
+extern void     SSIEnable(uint32_t base);
+extern void     SSIDisable(uint32_t base);
+extern void     SSIDataPut(uint32_t base, uint32_t data);
+extern void     SSIDataGet(uint32_t base, uint32_t *data);
+extern int32_t  SSIDataGetNonBlocking(uint32_t base, uint32_t *data);
+extern bool     SSIBusy(uint32_t base);
+extern void     SSIDMAEnable(uint32_t base, uint32_t dmaFlags);
+extern void     SSIIntRegister(uint32_t base, void (*handler)(void));
+extern void     SSIIntEnable(uint32_t base, uint32_t intFlags);
+extern uint32_t SSIIntStatus(uint32_t base, bool masked);
+extern void     SSIIntClear(uint32_t base, uint32_t intFlags);
+
+extern void     uDMAChannelAssign(uint32_t mapping);
+extern void     uDMAChannelAttributeDisable(uint32_t channel, uint32_t attr);
+extern void     uDMAChannelControlSet(uint32_t channel, uint32_t control);
+extern void     uDMAChannelTransferSet(uint32_t channel, uint32_t mode,
+                                       void *src, void *dst, uint32_t size);
+extern void     uDMAChannelEnable(uint32_t channel);
+extern bool     uDMAChannelIsEnabled(uint32_t channel);
+
+extern bool     IntMasterDisable(void);
+extern bool     IntMasterEnable(void);
+
+#define MAP_SysCtlPeripheralEnable      SysCtlPeripheralEnable
+#define MAP_SysCtlPeripheralReset       SysCtlPeripheralReset
+#define MAP_GPIOPinConfigure            GPIOPinConfigure
+#define MAP_GPIOPinTypeSSI              GPIOPinTypeSSI
+#define MAP_GPIOPinTypeGPIOOutput       GPIOPinTypeGPIOOutput
+#define MAP_GPIOPinTypeGPIOInput        GPIOPinTypeGPIOInput
+#define MAP_GPIOPinWrite                GPIOPinWrite
+#define MAP_GPIOPinRead                 GPIOPinRead
+#define MAP_GPIOIntTypeSet              GPIOIntTypeSet
+#define MAP_GPIOIntStatus               GPIOIntStatus
+#define MAP_GPIOIntClear                GPIOIntClear
+#define MAP_GPIOIntEnable               GPIOIntEnable
+#define MAP_GPIOIntDisable              GPIOIntDisable
+#define MAP_SSIConfigSetExpClk          SSIConfigSetExpClk
+#define MAP_SSIEnable                   SSIEnable
+#define MAP_SSIDisable                  SSIDisable
+#define MAP_SSIDataGetNonBlocking       SSIDataGetNonBlocking
+#define MAP_SSIBusy                     SSIBusy
+#define MAP_SSIDMAEnable                SSIDMAEnable
+#define MAP_SSIIntEnable                SSIIntEnable
+#define MAP_SSIIntStatus                SSIIntStatus
+#define MAP_SSIIntClear                 SSIIntClear
+#define MAP_uDMAChannelAssign           uDMAChannelAssign
+#define MAP_uDMAChannelAttributeDisable uDMAChannelAttributeDisable
+#define MAP_uDMAChannelControlSet       uDMAChannelControlSet
+#define MAP_uDMAChannelTransferSet      uDMAChannelTransferSet
+#define MAP_uDMAChannelEnable           uDMAChannelEnable
+#define MAP_uDMAChannelIsEnabled        uDMAChannelIsEnabled
+#define MAP_IntMasterDisable            IntMasterDisable
+#define MAP_IntMasterEnable             IntMasterEnable
+
+/**     Model control & statistics      */
+//  Address of FIFO_R_W register in chip model
+#define TIVA_MODEL_FIFO_REG     0x72
+
+typedef struct
+{
+    uint32_t chunks;            //  uDMA transfers completed
+    uint32_t interrupts;        //  Times SSI2 interrupt was taken
+    uint32_t csAssertions;      //  Times CS was driven low
+    uint64_t bytes;             //  Bytes exchanged on the bus, address included
+    uint64_t chunkDoneNs;       //  Time last uDMA transfer completed
+    uint64_t chunkGapSumNs;     //  Bus idle between chunks of a transfer
+    uint64_t chunkGapMaxNs;
+    uint64_t maskedMaxNs;       //  Longest time PRIMASK was set
+} TivaModelStats;
+
+extern void     TivaModel_Reset();
+extern uint64_t TivaModel_TimeNs();
+extern void     TivaModel_Run(uint64_t ns);
+extern void     TivaModel_Watchdog(uint64_t ns);
+extern bool     TivaModel_InInterrupt();
+extern bool     TivaModel_CsLow();
+extern uint32_t TivaModel_FifoLevel();
+extern void     TivaModel_StatsGet(TivaModelStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TOOLS_FIFO_REPLAY_TIVA_TIVA_MODEL_H_ */
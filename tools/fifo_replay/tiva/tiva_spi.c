@@ -0,0 +1,30 @@
+/**
+ * tiva_spi.c
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  Compiles SPI HAL of TM4C1294 as it is against SSI2/uDMA model, see
+ *  tiva_spi.h. TivaWare headers it includes resolve to the ones next to this
+ *  file (build with -Itools/fifo_replay/tiva)
+ */
+#include "tiva_spi.h"
+
+#define HAL_MPU_Init                TivaSpi_Init
+#define HAL_MPU_SetBusSpeed         TivaSpi_SetBusSpeed
+#define HAL_MPU_GetBusSpeed         TivaSpi_GetBusSpeed
+#define HAL_MPU_PowerSwitch         TivaSpi_PowerSwitch
+#define HAL_MPU_DataAvail           TivaSpi_DataAvail
+#define HAL_MPU_DataReadyIntHandler TivaSpi_DataReadyIntHandler
+#define HAL_MPU_IntRegister         TivaSpi_IntRegister
+#define HAL_MPU_IntEnable           TivaSpi_IntEnable
+#define HAL_MPU_WriteByte           TivaSpi_WriteByte
+#define HAL_MPU_WriteBytes          TivaSpi_WriteBytes
+#define HAL_MPU_ReadByte            TivaSpi_ReadByte
+#define HAL_MPU_ReadBytes           TivaSpi_ReadBytes
+#define HAL_MPU_WriteBytesAsync     TivaSpi_WriteBytesAsync
+#define HAL_MPU_ReadBytesAsync      TivaSpi_ReadBytesAsync
+#define HAL_MPU_TransferBusy        TivaSpi_TransferBusy
+#define HAL_MPU_SPIIntHandler       TivaSpi_SPIIntHandler
+
+#include "HAL/tm4c1294/hal_icm_spi_tm4c.c"
@@ -0,0 +1,42 @@
+/**
+ * tiva_spi.h
+ *
+ *  Created on: 17. 10. 2026.
+ *      Author: Vedran Mikov
+ *
+ *  SPI HAL of TM4C1294 (HAL/tm4c1294/hal_icm_spi_tm4c.c) built on host against
+ *  SSI2/uDMA model (tiva_model.h). Its HAL_MPU_* functions are renamed to
+ *  TivaSpi_* so they can be linked next to host HAL (HAL/host).
+ */
+#ifndef TOOLS_FIFO_REPLAY_TIVA_TIVA_SPI_H_
+#define TOOLS_FIFO_REPLAY_TIVA_TIVA_SPI_H_
+
+#include "tiva_model.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+extern void     TivaSpi_Init(void((*custHook)(void)));
+extern void     TivaSpi_SetBusSpeed(uint32_t speed);
+extern void     TivaSpi_WriteByte(uint8_t I2Caddress, uint8_t regAddress,
+                                  uint8_t data);
+extern int      TivaSpi_WriteBytes(void * context, uint8_t regAddress,
+                                   const uint8_t *data, uint32_t length);
+extern uint8_t  TivaSpi_ReadByte(uint8_t I2Caddress, uint8_t regAddress);
+extern int      TivaSpi_ReadBytes(void * context, uint8_t regAddress,
+                                  uint8_t* data, uint32_t length);
+extern int      TivaSpi_WriteBytesAsync(uint8_t regAddress, const uint8_t *data,
+                                        uint32_t length,
+                                        void((*doneHook)(void)));
+extern int      TivaSpi_ReadBytesAsync(uint8_t regAddress, uint8_t* data,
+                                       uint32_t length,
+                                       void((*doneHook)(void)));
+extern bool     TivaSpi_TransferBusy();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* TOOLS_FIFO_REPLAY_TIVA_TIVA_SPI_H_ */
@@ -0,0 +1,2 @@
+//  TivaWare utils/uartstdio.h on host, see tiva_model.h
+#include "../tiva_model.h"